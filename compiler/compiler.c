@@ -0,0 +1,259 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+// Plug-in descriptor compiler
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_GETTEXT
+#include <libintl.h>
+#include <locale.h>
+#endif
+#include <cpluff.h>
+
+
+/* -----------------------------------------------------------------------
+ * Defines
+ * ---------------------------------------------------------------------*/
+
+// Gettext defines 
+#ifdef HAVE_GETTEXT
+#define _(String) gettext(String)
+#define gettext_noop(String) String
+#define N_(String) gettext_noop(String)
+#else
+#define _(String) (String)
+#define N_(String) String
+#define textdomain(Domain)
+#define bindtextdomain(Package, Directory)
+#endif
+
+// GNU C attribute defines
+#ifndef CP_GCC_NORETURN
+#if __GNUC__ > 2 || (__GNUC__ == 2 && __GNUC_MINOR__ >= 5)
+#define CP_GCC_NORETURN __attribute__((noreturn))
+#else
+#define CP_GCC_NORETURN
+#endif
+#endif
+
+
+/* -----------------------------------------------------------------------
+ * Variables
+ * ---------------------------------------------------------------------*/
+
+/// The level of verbosity
+static int verbosity = 1;
+
+
+/* -----------------------------------------------------------------------
+ * Functions
+ * ---------------------------------------------------------------------*/
+
+/**
+ * Prints an error message and exits. In quiet mode the error message is
+ * not printed.
+ * 
+ * @param msg the error message
+ */
+CP_GCC_NORETURN static void error(const char *msg) {
+	if (verbosity >= 1) {
+		/* TRANSLATORS: A formatting string for compiler error messages. */
+		fprintf(stderr, _("C-Pluff Compiler: ERROR: %s\n"), msg);
+	}
+	exit(1);
+}
+
+/**
+ * Formats and prints an error message and exits. In quiet mode the error
+ * message is not printed.
+ * 
+ * @param msg the error message
+ */
+CP_GCC_NORETURN static void errorf(const char *msg, ...) {
+	char buffer[256];
+	va_list va;
+
+	va_start(va, msg);
+	vsnprintf(buffer, sizeof(buffer), _(msg), va);
+	va_end(va);
+	strcpy(buffer + sizeof(buffer)/sizeof(char) - 4, "...");
+	error(buffer);
+}
+
+/**
+ * Prints the help text.
+ */
+static void print_help(void) {
+	printf(_("C-Pluff Compiler, version %s\n"), PACKAGE_VERSION);
+	putchar('\n');
+	fputs(_("usage: cpluff-compiler <option>... <plug-in directory>...\n"
+		"options:\n"
+		"  -h       print this help text\n"
+		"  -o FILE  write the compiled descriptor into FILE\n"
+		"  -v       be more verbose\n"
+		"  -q       be quiet\n"
+		"  -V       print C-Pluff version number and exit\n"
+		"By default, the compiled descriptor is written into file plugin.bin\n"
+		"in the plug-in directory. The compiled descriptor is specific to\n"
+		"the host platform and to the version of the C-Pluff library.\n"
+		), stdout);
+}
+
+static void logger(cp_log_severity_t severity, const char *msg, const char *apid, void *dummy) {
+	const char *level;
+	switch (severity) {
+		case CP_LOG_DEBUG:
+			/* TRANSLATORS: A tag for debug level log entries. */
+			level = _("DEBUG");
+			break;
+		case CP_LOG_INFO:
+			/* TRANSLATORS: A tag for info level log entries. */
+			level = _("INFO");
+			break;
+		case CP_LOG_WARNING:
+			/* TRANSLATORS: A tag for warning level log entries. */
+			level = _("WARNING");
+			break;
+		case CP_LOG_ERROR:
+			/* TRANSLATORS: A tag for error level log entries. */
+			level = _("ERROR");
+			break;
+		default:
+			/* TRANSLATORS: A tag for unknown severity level. */ 
+			level = _("UNKNOWN");
+			break;
+	}
+	/* TRANSLATORS: A formatting string for log messages caused by compiler activity. */ 
+	fprintf(stderr, _("C-Pluff: %s: [compiler] %s\n"), level, msg);
+}
+
+/// The main function
+int main(int argc, char *argv[]) {
+	int i;
+	const char *output = NULL;
+	cp_context_t *context;
+
+	// Set locale
+#ifdef HAVE_GETTEXT
+	setlocale(LC_ALL, "");
+#endif
+	
+	// Initialize the framework
+	if (cp_init() != CP_OK) {
+		error(_("The C-Pluff initialization failed."));
+	}
+	
+	// Set gettext domain 
+#ifdef HAVE_GETTEXT
+	textdomain(PACKAGE);
+#endif
+
+	// Parse arguments
+	while ((i = getopt(argc, argv, "ho:vqV")) != -1) {
+		switch (i) {
+			
+			// Display help and exit
+			case 'h':
+				print_help();
+				exit(0);
+
+			// Set the output file
+			case 'o':
+				output = optarg;
+				break;
+
+			// Be more verbose
+			case 'v':
+				if (verbosity < 1) {
+					error(_("Quiet and verbose modes are mutually exclusive."));
+				}
+				verbosity++;
+				break;
+
+			// Quiet mode
+			case 'q':
+				if (verbosity > 1) {
+					error(_("Quiet and verbose modes are mutually exclusive."));
+				}
+				verbosity--;
+				break;
+
+			// Display release version and exit
+			case 'V':
+				fputs(cp_get_version(), stdout);
+				putchar('\n');
+				exit(0);
+				
+			// Unrecognized option
+			default:
+				error(_("Unrecognized option or argument. Try option -h for help."));
+		}
+	}
+
+	// Check arguments
+	if (optind >= argc) {
+		error(_("No plug-ins to compile. Try option -h for help."));
+	}
+	if (output != NULL && argc - optind > 1) {
+		error(_("Option -o can only be used when compiling a single plug-in."));
+	}
+	
+	// Create the context
+	if ((context = cp_create_context(NULL)) == NULL) {
+		error(_("Plug-in context creation failed."));
+	}
+	
+	// Register logger
+	if (verbosity >= 1) {
+		cp_register_logger(context, logger, NULL, (verbosity >= 2 ? CP_LOG_INFO : CP_LOG_ERROR));
+	}
+	
+	// Compile plug-in descriptors
+	for (i = optind; i < argc; i++) {
+		cp_plugin_info_t *pi = cp_load_plugin_descriptor(context, argv[i], NULL);
+		if (pi == NULL) {
+			errorf(_("Failed to load a plug-in from path %s."), argv[i]);
+		}
+		if (cp_save_plugin_image(context, pi, output) != CP_OK) {
+			errorf(_("Failed to compile plug-in %s."), pi->identifier);
+		}
+		if (verbosity >= 2) {
+			/* TRANSLATORS: The first %s is plug-in identifier and the second %s is plug-in path. */
+			fprintf(stderr, _("Compiled plug-in %s at %s.\n"), pi->identifier, argv[i]);
+		}
+		cp_release_info(context, pi);
+	}
+	
+	// Destroy framework
+	cp_destroy();
+
+	// Return from the main program
+	return 0;
+}
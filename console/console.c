@@ -641,9 +641,11 @@ static void cmd_show_plugin_info(int argc, char *argv[]) {
 			fputs("  imports = {},\n", stdout);
 		}
 		printf("  runtime_lib_name = %s,\n"
-			"  runtime_funcs_symbol = %s,\n",
+			"  runtime_funcs_symbol = %s,\n"
+			"  runtime_exports_symbol = %s,\n",
 			str_or_null(plugin->runtime_lib_name),
-			str_or_null(plugin->runtime_funcs_symbol));
+			str_or_null(plugin->runtime_funcs_symbol),
+			str_or_null(plugin->runtime_exports_symbol));
 		if (plugin->num_ext_points) {
 			fputs("  ext_points = {{\n", stdout);
 			for (i = 0; i < plugin->num_ext_points; i++) {
@@ -0,0 +1,113 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+/** @file
+ * Atomic operations used for publishing shared data without locking
+ */ 
+
+#ifndef ATOMIC_H_
+#define ATOMIC_H_
+
+#if defined(CP_THREADS) && defined(_WIN32) && !defined(__GNUC__)
+#include <windows.h>
+#endif
+
+
+/* ------------------------------------------------------------------------
+ * Defines
+ * ----------------------------------------------------------------------*/
+
+/*
+ * cpi_atomic_load_ptr(ptrptr) loads a pointer with acquire semantics and
+ * cpi_atomic_cas_ptr(ptrptr, oldval, newval) stores a pointer with release
+ * semantics if it still has the old value, evaluating to non-zero on
+ * success. cpi_atomic_load_int(intptr) loads an integer with acquire
+ * semantics, cpi_atomic_add_int(intptr, delta) adds to an integer and
+ * evaluates to the new value, cpi_atomic_cas_int(intptr, oldval, newval)
+ * stores an integer if it still has the old value, evaluating to non-zero
+ * on success, and cpi_atomic_fence() is a full memory barrier; these are
+ * sequentially consistent. Without threads these are plain memory
+ * operations.
+ */
+#if !defined(CP_THREADS)
+#define cpi_atomic_load_ptr(ptrptr) (*(ptrptr))
+#define cpi_atomic_load_int(intptr) (*(intptr))
+#define cpi_atomic_cas_ptr(ptrptr, oldval, newval) \
+	(*(ptrptr) == (oldval) ? (*(ptrptr) = (newval), 1) : 0)
+#define cpi_atomic_add_int(intptr, delta) (*(intptr) += (delta))
+#define cpi_atomic_cas_int(intptr, oldval, newval) \
+	(*(intptr) == (oldval) ? (*(intptr) = (newval), 1) : 0)
+#define cpi_atomic_fence() ((void) 0)
+#elif defined(__ATOMIC_ACQUIRE)
+#define cpi_atomic_load_ptr(ptrptr) __atomic_load_n((ptrptr), __ATOMIC_ACQUIRE)
+#define cpi_atomic_load_int(intptr) __atomic_load_n((intptr), __ATOMIC_ACQUIRE)
+#define cpi_atomic_cas_ptr(ptrptr, oldval, newval) \
+	cpi_atomic_cas_ptr_impl((void **) (ptrptr), (oldval), (newval))
+#define cpi_atomic_add_int(intptr, delta) \
+	__atomic_add_fetch((intptr), (delta), __ATOMIC_SEQ_CST)
+#define cpi_atomic_cas_int(intptr, oldval, newval) \
+	cpi_atomic_cas_int_impl((intptr), (oldval), (newval))
+#define cpi_atomic_fence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+static inline int cpi_atomic_cas_ptr_impl(void **ptrptr, void *oldval, void *newval) {
+	return __atomic_compare_exchange_n(ptrptr, &oldval, newval, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+static inline int cpi_atomic_cas_int_impl(int *intptr, int oldval, int newval) {
+	return __atomic_compare_exchange_n(intptr, &oldval, newval, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#elif defined(__GNUC__)
+#define cpi_atomic_load_ptr(ptrptr) cpi_atomic_load_ptr_impl((void * volatile *) (ptrptr))
+#define cpi_atomic_load_int(intptr) cpi_atomic_load_int_impl((int volatile *) (intptr))
+#define cpi_atomic_cas_ptr(ptrptr, oldval, newval) \
+	__sync_bool_compare_and_swap((void **) (ptrptr), (void *) (oldval), (void *) (newval))
+#define cpi_atomic_add_int(intptr, delta) __sync_add_and_fetch((intptr), (delta))
+#define cpi_atomic_cas_int(intptr, oldval, newval) \
+	__sync_bool_compare_and_swap((intptr), (oldval), (newval))
+#define cpi_atomic_fence() __sync_synchronize()
+static inline void *cpi_atomic_load_ptr_impl(void * volatile *ptrptr) {
+	void *ptr = *ptrptr;
+	__sync_synchronize();
+	return ptr;
+}
+static inline int cpi_atomic_load_int_impl(int volatile *intptr) {
+	int val = *intptr;
+	__sync_synchronize();
+	return val;
+}
+#elif defined(_WIN32)
+#define cpi_atomic_load_ptr(ptrptr) \
+	InterlockedCompareExchangePointer((PVOID volatile *) (ptrptr), NULL, NULL)
+#define cpi_atomic_load_int(intptr) \
+	InterlockedCompareExchange((LONG volatile *) (intptr), 0, 0)
+#define cpi_atomic_cas_ptr(ptrptr, oldval, newval) \
+	(InterlockedCompareExchangePointer((PVOID volatile *) (ptrptr), (newval), (oldval)) == (oldval))
+#define cpi_atomic_add_int(intptr, delta) \
+	(InterlockedExchangeAdd((LONG volatile *) (intptr), (delta)) + (delta))
+#define cpi_atomic_cas_int(intptr, oldval, newval) \
+	(InterlockedCompareExchange((LONG volatile *) (intptr), (newval), (oldval)) == (oldval))
+#define cpi_atomic_fence() MemoryBarrier()
+#else
+#error Atomic pointer operations are not available for this compiler.
+#endif
+
+
+#endif //ATOMIC_H_
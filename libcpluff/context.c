@@ -34,6 +34,12 @@
 #include <assert.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stdint.h>
+#if !defined(CP_THREADS) && defined(_WIN32)
+#include <windows.h>
+#elif !defined(CP_THREADS)
+#include <time.h>
+#endif
 #include "../kazlib/list.h"
 #include "cpluff.h"
 #include "util.h"
@@ -41,6 +47,7 @@
 #include "thread.h"
 #endif
 #include "internal.h"
+#include "atomic.h"
 
 
 /* ------------------------------------------------------------------------
@@ -103,10 +110,30 @@ static void free_plugin_env(cp_plugin_env_t *env) {
 		assert(hash_isempty(env->extensions));
 		hash_destroy(env->extensions);
 	}
+	assert(env->registry == NULL);
+	assert(env->registry_epochs.retired == NULL && env->registry_epochs.expiring == NULL);
+	if (env->symbol_caching_contexts != NULL) {
+		assert(list_isempty(env->symbol_caching_contexts));
+		list_destroy(env->symbol_caching_contexts);
+	}
 	if (env->run_funcs != NULL) {
 		assert(list_isempty(env->run_funcs));
 		list_destroy(env->run_funcs);
 	}
+	cpi_free_run_waits(env);
+	if (env->strings != NULL) {
+		hscan_t scan;
+		hnode_t *node;
+		
+		hash_scan_begin(&scan, env->strings);
+		while ((node = hash_scan_next(&scan)) != NULL) {
+			char *str = (char *) hnode_getkey(node);
+			hash_scan_delfree(env->strings, node);
+			free(str);
+		}
+		hash_destroy(env->strings);
+		env->strings = NULL;
+	}
 	
 	// Destroy mutex 
 #ifdef CP_THREADS
@@ -123,6 +150,9 @@ static void free_plugin_env(cp_plugin_env_t *env) {
 CP_HIDDEN void cpi_free_context(cp_context_t *context) {
 	assert(context != NULL);
 	
+	// Free the symbol cache while the environment is still available
+	cpi_free_symbol_cache(context);
+	
 	// Free environment if this is the client program context
 	if (context->plugin == NULL && context->env != NULL) {
 		free_plugin_env(context->env);
@@ -162,6 +192,7 @@ CP_HIDDEN cp_context_t * cpi_new_context(cp_plugin_t *plugin, cp_plugin_env_t *e
 		context->env = env;
 		context->resolved_symbols = NULL;
 		context->symbol_providers = NULL;
+		context->symbol_cache = NULL;
 		
 	} while (0);
 	
@@ -202,6 +233,8 @@ CP_C_API cp_context_t * cp_create_context(cp_status_t *error) {
 		env->local_loader = NULL;
 		env->loaders_to_plugins = hash_create(LISTCOUNT_T_MAX, cpi_comp_ptr, cpi_hashfunc_ptr);
 		env->infos = hash_create(HASHCOUNT_T_MAX, cpi_comp_ptr, cpi_hashfunc_ptr);
+		env->strings = hash_create(HASHCOUNT_T_MAX,
+			(int (*)(const void *, const void *)) strcmp, NULL);
 		env->plugins = hash_create(HASHCOUNT_T_MAX,
 			(int (*)(const void *, const void *)) strcmp, NULL);
 		env->started_plugins = list_create(LISTCOUNT_T_MAX);
@@ -209,8 +242,18 @@ CP_C_API cp_context_t * cp_create_context(cp_status_t *error) {
 			(int (*)(const void *, const void *)) strcmp, NULL);
 		env->extensions = hash_create(HASHCOUNT_T_MAX,
 			(int (*)(const void *, const void *)) strcmp, NULL);
+		env->registry = NULL;
+		memset(&(env->registry_epochs), 0, sizeof(cpi_epochs_t));
+		env->index_runtime_symbols = 0;
+		env->plugin_jobs = 0;
+		env->job_plugins = 0;
+		env->symbol_caching_contexts = NULL;
 		env->run_funcs = list_create(LISTCOUNT_T_MAX);
 		env->run_wait = NULL;
+		env->run_scheduler = NULL;
+		env->run_poller = NULL;
+		env->run_timers = NULL;
+		env->run_stop_requests = 0;
 		if (env->plugin_listeners == NULL
 			|| env->loggers == NULL
 #ifdef CP_THREADS
@@ -218,6 +261,7 @@ CP_C_API cp_context_t * cp_create_context(cp_status_t *error) {
 #endif
 			|| env->loaders_to_plugins == NULL
 			|| env->infos == NULL
+			|| env->strings == NULL
 			|| env->plugins == NULL
 			|| env->started_plugins == NULL
 			|| env->ext_points == NULL
@@ -313,7 +357,10 @@ CP_C_API void cp_destroy_context(cp_context_t *context) {
 		cp_unregister_ploader(context, context->env->local_loader);
 	}
 
-	// Release remaining information objects
+	// Release the registry snapshots and remaining information objects
+	cpi_lock_context(context);
+	cpi_release_registry(context);
+	cpi_unlock_context(context);
 	cpi_release_infos(context);
 	
 	// Free context
@@ -412,6 +459,41 @@ CP_C_API void cp_unregister_pcollections(cp_context_t *context) {
 	cpi_unlock_context(context);
 }
 
+CP_C_API cp_status_t cp_watch_pcollections(cp_context_t *context, int watch) {
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	if (watch) {
+		if ((status = init_local_ploader(context)) == CP_OK) {
+			status = cp_lpl_set_watch(context->env->local_loader, 1);
+		}
+		if (status != CP_OK) {
+			cpi_error(context, N_("Plug-in collections could not be watched due to insufficient system resources."));
+		}
+	} else if (context->env->local_loader != NULL) {
+		cp_lpl_set_watch(context->env->local_loader, 0);
+	}
+	cpi_unlock_context(context);
+	
+	return status;
+}
+
+CP_C_API int cp_get_pcollections_watch_fd(cp_context_t *context) {
+	int fd = -1;
+	
+	CHECK_NOT_NULL(context);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	if (context->env->local_loader != NULL) {
+		fd = cp_lpl_get_watch_fd(context->env->local_loader);
+	}
+	cpi_unlock_context(context);
+	
+	return fd;
+}
+
 
 // Plug-in loaders
 
@@ -545,8 +627,74 @@ CP_C_API char **cp_get_context_args(cp_context_t *ctx, int *argc) {
 }
 
 
+// Interned strings
+
+/*
+ * The interned strings are the keys of the string table and the
+ * associated data is the reference count of the string.
+ */
+
+CP_HIDDEN char *cpi_intern_string(cp_context_t *ctx, const char *str) {
+	hnode_t *node;
+	char *istr;
+	
+	assert(cpi_is_context_locked(ctx));
+	if ((node = hash_lookup(ctx->env->strings, str)) != NULL) {
+		hnode_put(node, (void *) ((intptr_t) hnode_get(node) + 1));
+		return (char *) hnode_getkey(node);
+	}
+	if ((istr = strdup(str)) == NULL) {
+		return NULL;
+	}
+	if (!hash_alloc_insert(ctx->env->strings, istr, (void *) (intptr_t) 1)) {
+		free(istr);
+		return NULL;
+	}
+	return istr;
+}
+
+CP_HIDDEN void cpi_release_string(cp_context_t *ctx, const char *str) {
+	hnode_t *node;
+	intptr_t refs;
+	
+	assert(cpi_is_context_locked(ctx));
+	node = hash_lookup(ctx->env->strings, str);
+	assert(node != NULL && hnode_getkey(node) == str);
+	if ((refs = (intptr_t) hnode_get(node) - 1) > 0) {
+		hnode_put(node, (void *) refs);
+	} else {
+		hash_delete_free(ctx->env->strings, node);
+		free((char *) str);
+	}
+}
+
+CP_HIDDEN char *cpi_lookup_string(cp_context_t *ctx, const char *str) {
+	hnode_t *node;
+	
+	assert(cpi_is_context_locked(ctx));
+	if ((node = hash_lookup(ctx->env->strings, str)) != NULL) {
+		return (char *) hnode_getkey(node);
+	}
+	return NULL;
+}
+
+
 // Checking API call invocation
 
+/**
+ * Returns whether the specified context is within an invocation recorded
+ * by the specified counter. Runtime functions of concurrently started or
+ * stopped plug-ins are recorded in the plug-in instead of the counter.
+ * 
+ * @param ctx the plug-in context
+ * @param counter the invocation counter
+ * @return whether within an invocation
+ */
+static int in_invocation(cp_context_t *ctx, int *counter) {
+	return (*counter
+		|| (ctx->plugin != NULL && ctx->plugin->job_invocation == counter));
+}
+
 CP_HIDDEN void cpi_check_invocation(cp_context_t *ctx, int funcmask, const char *func) {
 	assert(ctx != NULL);
 	assert(funcmask != 0);
@@ -561,21 +709,57 @@ CP_HIDDEN void cpi_check_invocation(cp_context_t *ctx, int funcmask, const char
 		cpi_fatalf(_("Function %s was called from within an event listener invocation."), func);
 	}
 	if ((funcmask & CPI_CF_START)
-		&& ctx->env->in_start_func_invocation) {
+		&& in_invocation(ctx, &(ctx->env->in_start_func_invocation))) {
 		cpi_fatalf(_("Function %s was called from within a plug-in start function invocation."), func);
 	}
 	if ((funcmask & CPI_CF_STOP)
-		&& ctx->env->in_stop_func_invocation) {
+		&& in_invocation(ctx, &(ctx->env->in_stop_func_invocation))) {
 		cpi_fatalf(_("Function %s was called from within a plug-in stop function invocation."), func);
 	}
-	if (ctx->env->in_create_func_invocation) {
+	if (in_invocation(ctx, &(ctx->env->in_create_func_invocation))) {
 		cpi_fatalf(_("Function %s was called from within a plug-in create function invocation."), func);
 	}
-	if (ctx->env->in_destroy_func_invocation) {
+	if (in_invocation(ctx, &(ctx->env->in_destroy_func_invocation))) {
 		cpi_fatalf(_("Function %s was called from within a plug-in destroy function invocation."), func);
 	}
 }
 
+/**
+ * Returns whether any callback function invocation disallowed by the
+ * specified mask might be in progress, without locking the context.
+ * 
+ * @param ctx the plug-in context
+ * @param funcmask the bitmask of disallowed callback functions
+ * @return whether an invocation might be in progress
+ */
+static int may_be_in_invocation(cp_context_t *ctx, int funcmask) {
+	cp_plugin_env_t *env = ctx->env;
+	
+	return (((funcmask & CPI_CF_LOGGER)
+			&& cpi_atomic_load_int(&(env->in_logger_invocation)))
+		|| ((funcmask & CPI_CF_LISTENER)
+			&& cpi_atomic_load_int(&(env->in_event_listener_invocation)))
+		|| ((funcmask & CPI_CF_START)
+			&& cpi_atomic_load_int(&(env->in_start_func_invocation)))
+		|| ((funcmask & CPI_CF_STOP)
+			&& cpi_atomic_load_int(&(env->in_stop_func_invocation)))
+		|| cpi_atomic_load_int(&(env->in_create_func_invocation))
+		|| cpi_atomic_load_int(&(env->in_destroy_func_invocation))
+		|| (ctx->plugin != NULL
+			&& cpi_atomic_load_ptr(&(ctx->plugin->job_invocation)) != NULL));
+}
+
+CP_HIDDEN void cpi_check_invocation_unlocked(cp_context_t *ctx, int funcmask, const char *func) {
+	assert(ctx != NULL);
+	assert(funcmask != 0);
+	assert(func != NULL);
+	if (may_be_in_invocation(ctx, funcmask)) {
+		cpi_lock_context(ctx);
+		cpi_check_invocation(ctx, funcmask, func);
+		cpi_unlock_context(ctx);
+	}
+}
+
 
 // Locking 
 
@@ -634,3 +818,18 @@ CP_HIDDEN char *cpi_context_owner(cp_context_t *ctx, char *name, size_t size) {
 }
 
 #endif
+
+CP_HIDDEN void cpi_wait_context_timed(cp_context_t *context, unsigned long timeout) {
+#if defined(CP_THREADS)
+	cpi_wait_mutex_timed(context->env->mutex, timeout);
+#elif defined(_WIN32)
+	Sleep(timeout);
+#else
+	struct timespec ts;
+	
+	// Nothing could signal the context so just let the time pass
+	ts.tv_sec = timeout / 1000;
+	ts.tv_nsec = (long) (timeout % 1000) * 1000000L;
+	nanosleep(&ts, NULL);
+#endif
+}
@@ -99,6 +99,24 @@ extern "C" {
 /*@}*/
 
 
+/**
+ * @defgroup cFdEvents Flags for file descriptor events
+ * @ingroup cDefines
+ *
+ * These constants can be orred together for the events
+ * parameter of ::cp_run_function_on_fd.
+ */
+/*@{*/
+
+/** The run function is called when the file descriptor is readable. */
+#define CP_FD_READ 0x01
+
+/** The run function is called when the file descriptor is writable. */
+#define CP_FD_WRITE 0x02
+
+/*@}*/
+
+
 /* ------------------------------------------------------------------------
  * Data types
  * ----------------------------------------------------------------------*/
@@ -280,6 +298,13 @@ enum cp_log_severity_t {
  */
 typedef struct cp_context_t cp_context_t;
 
+/**
+ * A compiled configuration path created using ::cp_compile_cfg_path. It is
+ * an opaque reference counted information object which can be evaluated
+ * against any configuration element without parsing the path again.
+ */
+typedef struct cp_cfg_path_t cp_cfg_path_t;
+
 /*@}*/
 
  /**
@@ -310,6 +335,12 @@ typedef struct cp_plugin_runtime_t cp_plugin_runtime_t;
 /** A type for cp_plugin_loader_t structure. */
 typedef struct cp_plugin_loader_t cp_plugin_loader_t;
 
+/** A type for cp_symbol_export_t structure. */
+typedef struct cp_symbol_export_t cp_symbol_export_t;
+
+/** A type for cp_ext_iter_t structure. */
+typedef struct cp_ext_iter_t cp_ext_iter_t;
+
 /** A type for cp_status_t enumeration. */
 typedef enum cp_status_t cp_status_t;
 
@@ -523,6 +554,15 @@ struct cp_plugin_info_t {
 	 */
 	cp_extension_t *extensions;
 
+	/**
+	 * The symbol pointing to the symbol export table of the plug-in runtime
+	 * or NULL if none. The symbol with this name should point to a
+	 * NULL-terminated array of @ref cp_symbol_export_t entries. This
+	 * corresponds to the @a exports attribute of the @a runtime element in
+	 * a plug-in descriptor.
+	 */
+	char *runtime_exports_symbol;
+
 };
 
 /**
@@ -818,6 +858,27 @@ struct cp_plugin_runtime_t {
 
 };
 
+/**
+ * @ingroup cStructs
+ * An entry in a plug-in symbol export table. A plug-in runtime may define
+ * a static array of these entries, terminated by an entry having a NULL
+ * name, to declare the symbols it exports. The symbol pointing to the
+ * table is named by the @a exports attribute of the @a runtime element in
+ * a plug-in descriptor. The framework indexes the table when the plug-in
+ * runtime library is loaded and ::cp_resolve_symbol looks up the table
+ * before asking the dynamic linker. The names and addresses must remain
+ * valid as long as the runtime library is loaded.
+ */
+struct cp_symbol_export_t {
+	
+	/** The name of the symbol, or NULL to terminate the table */
+	const char *name;
+	
+	/** The address associated with the symbol */
+	void *address;
+	
+};
+
 /**
  * @ingroup cStructs
  * A plug-in loader instance. Plug-in loaders are responsible for
@@ -901,6 +962,24 @@ struct cp_plugin_loader_t {
 
 };
 
+/**
+ * An iterator over installed extensions. The iterator is allocated by the
+ * caller, typically on the stack, and initialized using
+ * ::cp_ext_iter_begin. The fields are private to the framework.
+ */
+struct cp_ext_iter_t {
+	
+	/** The associated plug-in context */
+	cp_context_t *context;
+	
+	/** The shared extension array being iterated, or NULL if empty */
+	cp_extension_t **extensions;
+	
+	/** The index of the next extension */
+	int index;
+	
+};
+
 /*@}*/
 
 
@@ -1084,6 +1163,33 @@ CP_C_API void cp_unregister_pcollection(cp_context_t *ctx, const char *dir) CP_G
  */
 CP_C_API void cp_unregister_pcollections(cp_context_t *ctx) CP_GCC_NONNULL(1);
 
+/**
+ * Enables or disables watching the plug-in collections of a plug-in
+ * context for changes. When watching, ::cp_scan_plugins only loads the
+ * plug-ins that have been added or modified since the previous scan.
+ * 
+ * This is equivalent to having registered a local plug-in loader and
+ * calling ::cp_lpl_set_watch for it.
+ *
+ * @param ctx the plug-in context
+ * @param watch whether to watch the plug-in collections
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient
+ *   system resources or if file change notifications are not supported
+ */
+CP_C_API cp_status_t cp_watch_pcollections(cp_context_t *ctx, int watch) CP_GCC_NONNULL(1);
+
+/**
+ * Returns a file descriptor that becomes readable when there are pending
+ * changes in the watched plug-in collections of a plug-in context.
+ * 
+ * This is equivalent to having registered a local plug-in loader and
+ * calling ::cp_lpl_get_watch_fd for it.
+ *
+ * @param ctx the plug-in context
+ * @return the file descriptor or -1 if plug-in collections are not being watched
+ */
+CP_C_API int cp_get_pcollections_watch_fd(cp_context_t *ctx) CP_GCC_NONNULL(1);
+
 /**
  * Registers a plug-in loader that will be used to load plug-ins into this
  * context when ::cp_scan_plugins is called. Several plug-in loaders can be
@@ -1196,7 +1302,9 @@ CP_C_API int cp_is_logged(cp_context_t *ctx, cp_log_severity_t severity) CP_GCC_
  * is invalid then NULL is returned. The caller must release the returned
  * information by calling ::cp_release_info when it does not
  * need the information anymore, typically after installing the plug-in.
- * The returned plug-in information must not be modified.
+ * The returned plug-in information must not be modified. The descriptor
+ * is read and parsed without blocking other threads using the same
+ * plug-in context.
  * 
  * @param ctx the plug-in context
  * @param path the installation path of the plug-in
@@ -1224,6 +1332,41 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor(cp_context_t *ctx, const c
  */
 CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor_from_memory(cp_context_t *ctx, const char *buffer, unsigned int buffer_len, cp_status_t *status) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Loads a compiled plug-in descriptor from the specified plug-in installation
+ * path and returns information about the plug-in. A compiled descriptor is
+ * a binary image of the plug-in information stored in file @c plugin.bin
+ * in the plug-in directory. It can be created using ::cp_save_plugin_image
+ * or the @c cpluff-compiler tool. The image file is mapped into memory, if
+ * supported by the platform, and the returned information refers directly
+ * to the mapped image so that loading involves neither parsing nor
+ * copying of the descriptor data and processes loading the same image
+ * share the memory pages. The image is validated during loading. Otherwise
+ * this function behaves like ::cp_load_plugin_descriptor. Compiled
+ * descriptors are specific to the host platform and to the version of
+ * the C-Pluff library.
+ * 
+ * @param ctx the plug-in context
+ * @param path the installation path of the plug-in
+ * @param status a pointer to the location where status code is to be stored, or NULL
+ * @return pointer to the information structure or NULL if error occurs
+ */
+CP_C_API cp_plugin_info_t * cp_load_plugin_image(cp_context_t *ctx, const char *path, cp_status_t *status) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Saves the specified plug-in information as a compiled plug-in descriptor
+ * which can be loaded using ::cp_load_plugin_image. The image file is
+ * replaced atomically so that processes having the previous image loaded
+ * are not affected. Possible errors are reported via the specified plug-in
+ * context.
+ * 
+ * @param ctx the plug-in context
+ * @param pi the plug-in information, typically loaded using ::cp_load_plugin_descriptor
+ * @param file the image file, or NULL to use @c plugin.bin in the plug-in directory
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+CP_C_API cp_status_t cp_save_plugin_image(cp_context_t *ctx, cp_plugin_info_t *pi, const char *file) CP_GCC_NONNULL(1, 2);
+
 /**
  * Installs the plug-in described by the specified plug-in information
  * structure to the specified plug-in context. The plug-in information
@@ -1242,6 +1385,23 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor_from_memory(cp_context_t *
  */
 CP_C_API cp_status_t cp_install_plugin(cp_context_t *ctx, cp_plugin_info_t *pi) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Installs a batch of plug-ins to the specified plug-in context. This is
+ * equivalent to calling ::cp_install_plugin for each plug-in but the
+ * context is locked only once and the whole batch is validated for
+ * conflicting plug-in and extension point identifiers, both against the
+ * installed plug-ins and within the batch, before any plug-in is
+ * installed. Either all plug-ins are installed or none of them is. The
+ * plug-in listeners are notified of the installations in a single pass
+ * after all plug-ins of the batch have been installed.
+ *
+ * @param ctx the plug-in context
+ * @param pis an array of plug-in information structures
+ * @param num_pis the number of plug-ins in the array
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+CP_C_API cp_status_t cp_install_plugins(cp_context_t *ctx, cp_plugin_info_t **pis, int num_pis) CP_GCC_NONNULL(1);
+
 /**
  * Scans for plug-ins in the registered plug-in directories, installing
  * new plug-ins and upgrading installed plug-ins. This function can be used to
@@ -1281,6 +1441,38 @@ CP_C_API cp_status_t cp_scan_plugins(cp_context_t *ctx, int flags) CP_GCC_NONNUL
  */
 CP_C_API cp_status_t cp_start_plugin(cp_context_t *ctx, const char *id) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Starts the specified plug-ins and any imported plug-ins using a bounded
+ * pool of worker threads. The dependency graph is derived from the plug-in
+ * imports and a plug-in is started only after all the plug-ins it imports
+ * are active, so independent plug-ins are created and started concurrently.
+ * The plug-in state events are delivered as in ::cp_start_plugin, each
+ * plug-in passing through #CP_PLUGIN_STARTING before becoming
+ * #CP_PLUGIN_ACTIVE. Plug-ins in static dependency loops are started
+ * serially once the other plug-ins have been started. The calling thread
+ * participates in starting the plug-ins and the function returns after all
+ * the plug-ins have been started or have failed to start.
+ * 
+ * The create, start and, on failure, stop and destroy functions of
+ * concurrently started plug-ins are called in worker threads without
+ * holding the context lock and must therefore be thread-safe. Disallowed
+ * API calls made from within these functions using the plug-in context
+ * are rejected as for serially started plug-ins. Plug-ins can not be
+ * stopped or uninstalled while they are being started concurrently; such
+ * calls from other threads block until the start has completed.
+ * 
+ * If the framework has been built without multi-threading support or
+ * @a num_threads is less than two then the plug-ins are started serially
+ * as by ::cp_start_plugin.
+ * 
+ * @param ctx the plug-in context
+ * @param ids identifiers of the plug-ins to be started, or NULL for all installed plug-ins
+ * @param num_ids the number of identifiers
+ * @param num_threads the maximum number of threads, including the calling thread
+ * @return @ref CP_OK (zero) on success or the first error code on failure
+ */
+CP_C_API cp_status_t cp_start_plugins_mt(cp_context_t *ctx, const char * const *ids, int num_ids, int num_threads) CP_GCC_NONNULL(1);
+
 /**
  * Stops a plug-in. First stops any dependent plug-ins that are currently
  * active. Then stops the specified plug-in. If the plug-in is already
@@ -1302,6 +1494,28 @@ CP_C_API cp_status_t cp_stop_plugin(cp_context_t *ctx, const char *id) CP_GCC_NO
  */
 CP_C_API void cp_stop_plugins(cp_context_t *ctx) CP_GCC_NONNULL(1);
 
+/**
+ * Stops all active plug-ins using a bounded pool of worker threads. A
+ * plug-in is stopped once all the plug-ins importing it, statically or by
+ * having resolved its symbols, have been stopped. Independent plug-ins are
+ * therefore stopped concurrently in waves starting from the plug-ins no
+ * other active plug-in depends on. Plug-ins in dependency loops are
+ * finally stopped serially as by ::cp_stop_plugins. The calling thread
+ * participates in stopping the plug-ins.
+ * 
+ * The stop functions of concurrently stopped plug-ins are called in worker
+ * threads without holding the context lock and must therefore be
+ * thread-safe. Disallowed API calls made from within these functions
+ * using the plug-in context are rejected as for serially stopped plug-ins.
+ * If the framework has been built without multi-threading support or
+ * @a num_threads is less than two then this function is equivalent to
+ * ::cp_stop_plugins.
+ * 
+ * @param ctx the plug-in context
+ * @param num_threads the maximum number of threads, including the calling thread
+ */
+CP_C_API void cp_stop_plugins_mt(cp_context_t *ctx, int num_threads) CP_GCC_NONNULL(1);
+
 /**
  * Uninstalls the specified plug-in. The plug-in is first stopped if it is active.
  * Then uninstalls the plug-in and any dependent plug-ins.
@@ -1320,6 +1534,16 @@ CP_C_API cp_status_t cp_uninstall_plugin(cp_context_t *ctx, const char *id) CP_G
  */
 CP_C_API void cp_uninstall_plugins(cp_context_t *ctx) CP_GCC_NONNULL(1);
 
+/**
+ * Uninstalls all plug-ins. All plug-ins are first stopped concurrently as
+ * by ::cp_stop_plugins_mt and then unresolved and uninstalled in a single
+ * pass over the installed plug-ins.
+ * 
+ * @param ctx the plug-in context
+ * @param num_threads the maximum number of threads, including the calling thread
+ */
+CP_C_API void cp_uninstall_plugins_mt(cp_context_t *ctx, int num_threads) CP_GCC_NONNULL(1);
+
 /*@}*/
 
 
@@ -1352,7 +1576,9 @@ CP_C_API cp_plugin_info_t * cp_get_plugin_info(cp_context_t *ctx, const char *id
  * Returns static information about the installed plug-ins. The returned
  * information must not be modified and the caller must
  * release the information by calling ::cp_release_info when the
- * information is not needed anymore.
+ * information is not needed anymore. The returned array is shared with
+ * other callers until the installed plug-ins change, so it must not be
+ * modified or reordered either; copy the pointers to sort them.
  * 
  * @param ctx the plug-in context
  * @param status a pointer to the location where status code is to be stored, or NULL
@@ -1366,7 +1592,9 @@ CP_C_API cp_plugin_info_t ** cp_get_plugins_info(cp_context_t *ctx, cp_status_t
  * Returns static information about the currently installed extension points.
  * The returned information must not be modified and the caller must
  * release the information by calling ::cp_release_info when the
- * information is not needed anymore.
+ * information is not needed anymore. Like the array returned by
+ * ::cp_get_plugins_info, the returned array is shared with other callers
+ * and must not be modified or reordered.
  *
  * @param ctx the plug-in context
  * @param status a pointer to the location where status code is to be stored, or NULL
@@ -1377,10 +1605,14 @@ CP_C_API cp_plugin_info_t ** cp_get_plugins_info(cp_context_t *ctx, cp_status_t
 CP_C_API cp_ext_point_t ** cp_get_ext_points_info(cp_context_t *ctx, cp_status_t *status, int *num) CP_GCC_NONNULL(1);
 
 /**
- * Returns static information about the currently installed extension points.
+ * Returns static information about the currently installed extensions.
  * The returned information must not be modified and the caller must
  * release the information by calling ::cp_release_info when the
- * information is not needed anymore.
+ * information is not needed anymore. The returned array is shared by all
+ * callers asking for the same extensions until the installed plug-ins
+ * change. It is typed as mutable for compatibility only: it must not be
+ * modified or reordered, for example sorted in place, as that would affect
+ * the other holders. Copy the pointers to process them in another order.
  *
  * @param ctx the plug-in context
  * @param extpt_id the extension point identifier or NULL for all extensions
@@ -1391,6 +1623,38 @@ CP_C_API cp_ext_point_t ** cp_get_ext_points_info(cp_context_t *ctx, cp_status_t
  */
 CP_C_API cp_extension_t ** cp_get_extensions_info(cp_context_t *ctx, const char *extpt_id, cp_status_t *status, int *num) CP_GCC_NONNULL(1);
 
+/**
+ * Starts iterating over the currently installed extensions without
+ * building a new extension array. The iterator holds a single reference
+ * to the extensions as they were when the iteration started and it does
+ * not observe later installations or uninstallations. Each successful
+ * call must be matched by a call to ::cp_ext_iter_end.
+ * 
+ * @param ctx the plug-in context
+ * @param iter the caller allocated iterator to be initialized
+ * @param extpt_id the extension point identifier or NULL for all extensions
+ * @return CP_OK (0) on success, CP_ERR_RESOURCE if out of resources
+ */
+CP_C_API cp_status_t cp_ext_iter_begin(cp_context_t *ctx, cp_ext_iter_t *iter, const char *extpt_id) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns the next extension of an iteration. The returned information
+ * must not be modified and it remains valid until ::cp_ext_iter_end is
+ * called. This function does not lock the plug-in context.
+ * 
+ * @param iter the iterator
+ * @return the next extension or NULL if there are no more extensions
+ */
+CP_C_API cp_extension_t * cp_ext_iter_next(cp_ext_iter_t *iter) CP_GCC_NONNULL(1);
+
+/**
+ * Ends an iteration and releases the extension information held by the
+ * iterator. The iterator may be reused by calling ::cp_ext_iter_begin.
+ * 
+ * @param iter the iterator
+ */
+CP_C_API void cp_ext_iter_end(cp_ext_iter_t *iter) CP_GCC_NONNULL(1);
+
 /**
  * Releases a previously obtained reference counted information object. The
  * documentation for functions returning such information refers
@@ -1444,13 +1708,15 @@ CP_C_API void cp_unregister_plistener(cp_context_t *ctx, cp_plugin_listener_func
  * separated by slash '/'. Two dots ".." can be used to designate a parent
  * element. Returns NULL if the specified element does not exist. If there are
  * several subelements with the same name, this function chooses the first one
- * when traversing the tree.
+ * when traversing the tree. Elements having many children are indexed on
+ * the first lookup so that later lookups do not scan the children. The
+ * function can be called concurrently from several threads.
  *
  * @param base the base configuration element
  * @param path the path to the target element
  * @return the target element or NULL if nonexisting
  */
-CP_C_API cp_cfg_element_t * cp_lookup_cfg_element(cp_cfg_element_t *base, const char *path) CP_GCC_PURE CP_GCC_NONNULL(1, 2);
+CP_C_API cp_cfg_element_t * cp_lookup_cfg_element(cp_cfg_element_t *base, const char *path) CP_GCC_NONNULL(1, 2);
 
 /**
  * Traverses a configuration element tree and returns the value of the
@@ -1468,7 +1734,46 @@ CP_C_API cp_cfg_element_t * cp_lookup_cfg_element(cp_cfg_element_t *base, const
  * @param path the path to the target element
  * @return the value of the target element or attribute or NULL
  */
-CP_C_API char * cp_lookup_cfg_value(cp_cfg_element_t *base, const char *path) CP_GCC_PURE CP_GCC_NONNULL(1, 2);
+CP_C_API char * cp_lookup_cfg_value(cp_cfg_element_t *base, const char *path) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Compiles a configuration path for repeated evaluation using
+ * ::cp_eval_cfg_element and ::cp_eval_cfg_value. The path syntax is the
+ * same as for ::cp_lookup_cfg_value, so the path may end with '@' followed
+ * by an attribute name. The caller must release the compiled path by
+ * calling ::cp_release_info when it is not needed anymore.
+ *
+ * @param ctx the plug-in context
+ * @param path the path to be compiled
+ * @param status a pointer to the location where status code is to be stored, or NULL
+ * @return the compiled path or NULL on failure
+ */
+CP_C_API cp_cfg_path_t * cp_compile_cfg_path(cp_context_t *ctx, const char *path, cp_status_t *status) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Evaluates a compiled configuration path and returns the target element.
+ * A possible attribute selector at the end of the path is ignored. This
+ * is equivalent to ::cp_lookup_cfg_element for paths without '@'. The
+ * function does not access the plug-in context and can be called
+ * concurrently from several threads.
+ *
+ * @param path the compiled path
+ * @param base the base configuration element
+ * @return the target element or NULL if nonexisting
+ */
+CP_C_API cp_cfg_element_t * cp_eval_cfg_element(const cp_cfg_path_t *path, cp_cfg_element_t *base) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Evaluates a compiled configuration path and returns the value of the
+ * target element or attribute. This is equivalent to ::cp_lookup_cfg_value
+ * with the original path. The function does not access the plug-in context
+ * and can be called concurrently from several threads.
+ *
+ * @param path the compiled path
+ * @param base the base configuration element
+ * @return the value of the target element or attribute or NULL
+ */
+CP_C_API char * cp_eval_cfg_value(const cp_cfg_path_t *path, cp_cfg_element_t *base) CP_GCC_NONNULL(1, 2);
 
 /*@}*/
 
@@ -1513,10 +1818,77 @@ CP_C_API char * cp_lookup_cfg_value(cp_cfg_element_t *base, const char *path) CP
  */
 CP_C_API cp_status_t cp_run_function(cp_context_t *ctx, cp_run_func_t runfunc) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Registers a run function that is called when a file descriptor becomes
+ * ready. Unlike a run function registered using ::cp_run_function, the
+ * run function is not called repeatedly but only when the plug-in context
+ * reports that the file descriptor is readable or writable, as specified
+ * by @a events. If the run function returns non-zero it waits for the file
+ * descriptor again, and if it returns zero it is unregistered.
+ * ::cp_run_plugins_blocking waits for the file descriptors without using
+ * processor time while ::cp_run_plugins, ::cp_run_plugins_mt and
+ * ::cp_run_plugins_step only check them without waiting, so a run
+ * function waiting for a file descriptor does not keep them running. The file descriptor must remain open until the run
+ * function has been unregistered, at the latest when the plug-in stops.
+ * This function does nothing if the specified run function is already
+ * registered for the calling plug-in instance and the file descriptor.
+ * Only one run function at a time can wait for a given file descriptor
+ * within a plug-in context, also across plug-ins. Registering another
+ * run function for a file descriptor that already has one fails with
+ * @ref CP_ERR_RUNTIME. A plug-in handling several kinds of events on the
+ * same file descriptor should register a single run function for all of
+ * them. This function is only supported on platforms providing epoll.
+ * 
+ * @param ctx the plug-in context of the registering plug-in
+ * @param fd the file descriptor to wait for
+ * @param events the events to wait for, @ref CP_FD_READ and/or @ref CP_FD_WRITE
+ * @param runfunc the run function to be registered
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+CP_C_API cp_status_t cp_run_function_on_fd(cp_context_t *ctx, int fd, int events, cp_run_func_t runfunc) CP_GCC_NONNULL(1, 4);
+
+/**
+ * Registers a run function that is called after a delay. The run function
+ * is called once the specified number of milliseconds has elapsed. If it
+ * returns non-zero it is called again after the same delay, counted from
+ * the time it returned, and if it returns zero it is unregistered. Like
+ * run functions waiting for file descriptors, timed run functions are only
+ * waited for by ::cp_run_plugins_blocking, which sleeps until the earliest
+ * deadline instead of using processor time, while the other runs only call
+ * the timed run functions whose deadline has already passed. Timed run functions may be called late if the
+ * other run functions keep the runs busy. This function does nothing if
+ * the specified run function is already registered for the calling
+ * plug-in instance with the same delay.
+ *
+ * @param ctx the plug-in context of the registering plug-in
+ * @param delay the delay in milliseconds
+ * @param runfunc the run function to be registered
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+CP_C_API cp_status_t cp_run_function_after(cp_context_t *ctx, unsigned long delay, cp_run_func_t runfunc) CP_GCC_NONNULL(1, 3);
+
+/**
+ * Registers a run function that is called periodically. The run function
+ * is first called when the specified period has elapsed and then at a
+ * fixed rate, one period after the previous deadline, for as long as it
+ * returns non-zero. Periods missed because the run function was late
+ * are skipped rather than made up for. Otherwise works like
+ * ::cp_run_function_after. The period must not be zero.
+ *
+ * @param ctx the plug-in context of the registering plug-in
+ * @param period the period in milliseconds
+ * @param runfunc the run function to be registered
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+CP_C_API cp_status_t cp_run_function_every(cp_context_t *ctx, unsigned long period, cp_run_func_t runfunc) CP_GCC_NONNULL(1, 3);
+
 /**
  * Runs the started plug-ins as long as there is something to run.
  * This function calls repeatedly run functions registered by started plug-ins
- * until there are no more active run functions. This function is normally
+ * until there are no more active run functions. Run functions waiting for
+ * a file descriptor that is not ready or for a deadline that has not yet
+ * passed are not active, so this function never blocks waiting for them;
+ * they are left for later runs. This function is normally
  * called by a thin main proram, a loader, which loads plug-ins, starts some
  * plug-ins and then passes control over to the started plug-ins.
  * 
@@ -1524,6 +1896,60 @@ CP_C_API cp_status_t cp_run_function(cp_context_t *ctx, cp_run_func_t runfunc) C
  */
 CP_C_API void cp_run_plugins(cp_context_t *ctx) CP_GCC_NONNULL(1);
 
+/**
+ * Runs the started plug-ins using a pool of threads as long as there is
+ * something to run. The calling thread and up to @a num_threads - 1
+ * worker threads call the registered run functions concurrently until
+ * there are no more registered run functions. A run function is never
+ * called concurrently with itself, and stopping a plug-in still waits
+ * for its run functions in execution to return. Each thread keeps its
+ * own queue of run functions to be rerun and idle threads take work from
+ * the queues of busy threads, so the threads do not contend for the
+ * plug-in context while running. Like ::cp_run_plugins, this function
+ * does not wait for run functions waiting for file descriptors or
+ * deadlines once there is nothing else left to run. Only one multi-threaded run can be in
+ * progress in a plug-in framework at a time; while it is in progress,
+ * newly registered run functions are handed over to its threads and other
+ * calls to this function or to ::cp_run_plugins return without running
+ * anything. If the framework has been built without multi-threading
+ * support or @a num_threads is less than two then this function is
+ * equivalent to ::cp_run_plugins.
+ * 
+ * @param ctx the plug-in context containing the plug-ins
+ * @param num_threads the maximum number of threads, including the calling thread
+ */
+CP_C_API void cp_run_plugins_mt(cp_context_t *ctx, int num_threads) CP_GCC_NONNULL(1);
+
+/**
+ * Runs the started plug-ins until a stop is requested. Like
+ * ::cp_run_plugins, this function calls the registered run functions but
+ * instead of returning when there is nothing left to run it waits for the
+ * file descriptors and deadlines of the waiting run functions and until
+ * another thread registers a run function using ::cp_run_function or
+ * requests the run to stop using ::cp_request_run_stop. The calling thread
+ * does not consume any processor time while waiting. This function
+ * returns when the run function in execution, if any, returns after a
+ * stop has been requested. If the framework has been built without
+ * multi-threading support then nothing else could wake up a waiting run
+ * and this function returns when there is nothing left to run or to
+ * wait for.
+ * 
+ * @param ctx the plug-in context containing the plug-ins
+ */
+CP_C_API void cp_run_plugins_blocking(cp_context_t *ctx) CP_GCC_NONNULL(1);
+
+/**
+ * Requests the blocking runs of the specified plug-in context to return.
+ * All runs in progress in ::cp_run_plugins_blocking return as soon as
+ * their current run function, if any, returns. The request does not
+ * apply to blocking runs started afterwards. Registered run
+ * functions are kept and can be run again later. This function can be
+ * called from any thread, including from within a run function.
+ * 
+ * @param ctx the plug-in context containing the plug-ins
+ */
+CP_C_API void cp_request_run_stop(cp_context_t *ctx) CP_GCC_NONNULL(1);
+
 /**
  * Runs one registered run function. This function calls one
  * active run function registered by a started plug-in. When the run function
@@ -1597,8 +2023,9 @@ CP_C_API cp_status_t cp_define_symbol(cp_context_t *ctx, const char *name, void
  * Resolves a symbol provided by the specified plug-in. The plug-in is started
  * automatically if it is not already active. The symbol may be context
  * specific or global. The framework first looks for a context specific
- * symbol and then falls back to resolving a global symbol exported by the
- * plug-in runtime library. The symbol can be released using
+ * symbol, then for a symbol in the symbol export table declared by the
+ * plug-in, if any, and then falls back to resolving a global symbol
+ * exported by the plug-in runtime library. The symbol can be released using
  * ::cp_release_symbol when it is not needed anymore. Pointers obtained from
  * this function must not be passed on to other plug-ins or the main
  * program.
@@ -1636,6 +2063,74 @@ CP_C_API void *cp_resolve_symbol(cp_context_t *ctx, const char *id, const char *
  */
 CP_C_API void cp_release_symbol(cp_context_t *ctx, const void *ptr) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Resolves several symbols provided by the specified plug-in at once. This
+ * is equivalent to calling ::cp_resolve_symbol for each name except that
+ * the symbol defining plug-in is looked up and started, and the dynamic
+ * dependency is created, only once. Either all symbols are resolved or, on
+ * failure, none of them are and the symbol array is filled with NULL
+ * pointers. The resolved symbols can be released using
+ * ::cp_release_symbols or individually using ::cp_release_symbol.
+ *
+ * @param ctx the plug-in context
+ * @param id the identifier of the symbol defining plug-in
+ * @param names the names of the symbols
+ * @param symbols an array to be filled with the pointers associated with the symbols
+ * @param num the number of symbols
+ * @return @ref CP_OK (zero) on success or a status code on failure
+ */
+CP_C_API cp_status_t cp_resolve_symbols(cp_context_t *ctx, const char *id, const char * const *names, void **symbols, int num) CP_GCC_NONNULL(1, 2, 3, 4);
+
+/**
+ * Releases several previously obtained symbols under a single lock of the
+ * plug-in context. This is equivalent to calling ::cp_release_symbol for
+ * each pointer.
+ *
+ * @param ctx the plug-in context
+ * @param symbols the pointers associated with the symbols
+ * @param num the number of symbols
+ */
+CP_C_API void cp_release_symbols(cp_context_t *ctx, void * const *symbols, int num) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Sets the maximum number of recently resolved symbols cached by the
+ * specified plug-in context. Symbols resolved using ::cp_resolve_symbol
+ * are kept in the cache and releasing them is deferred, so that repeated
+ * resolving and releasing of a cached symbol does not lock the plug-in
+ * context. The oldest symbol is released from the cache when a new symbol
+ * is added to a full cache. Cached symbols of a plug-in are released when
+ * the plug-in is about to be stopped. Releasing a symbol which is still
+ * cached does not detect unbalanced calls to ::cp_release_symbol.
+ * Symbol caching is disabled by default. Changing the size releases the
+ * currently cached symbols.
+ *
+ * @param ctx the plug-in context
+ * @param max_symbols the maximum number of cached symbols, or zero to
+ *   disable symbol caching
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if
+ *   insufficient memory
+ */
+CP_C_API cp_status_t cp_set_symbol_cache_size(cp_context_t *ctx, int max_symbols) CP_GCC_NONNULL(1);
+
+/**
+ * Enables or disables indexing the dynamic symbols of plug-in runtime
+ * libraries. When enabled, the global functions and variables defined by a
+ * runtime library are read from its dynamic symbol table when the library
+ * is loaded and ::cp_resolve_symbol looks them up in the resulting table
+ * instead of calling the dynamic linker. Context specific symbols and
+ * symbols declared in a symbol export table still take precedence. This
+ * speeds up resolving symbols of plug-ins exporting a large number of
+ * symbols. The setting only affects runtime libraries loaded after the call.
+ * Indexing is disabled by default and is only supported for ELF runtime
+ * libraries loaded using the Posix dlopen facility.
+ *
+ * @param ctx the plug-in context
+ * @param index whether to index the dynamic symbols of runtime libraries
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RUNTIME if indexing
+ *   is not supported on this platform
+ */
+CP_C_API cp_status_t cp_index_runtime_symbols(cp_context_t *ctx, int index) CP_GCC_NONNULL(1);
+
 /*@}*/
 
 
@@ -1701,6 +2196,72 @@ CP_C_API void cp_lpl_unregister_dir(cp_plugin_loader_t *loader, const char *dir)
  */
 CP_C_API void cp_lpl_unregister_dirs(cp_plugin_loader_t *loader) CP_GCC_NONNULL(1);
 
+/**
+ * Sets the maximum number of threads the specified local plug-in loader
+ * uses for parsing plug-in descriptors during a plug-in scan. By default,
+ * descriptors are parsed serially in the scanning thread. When more than
+ * one thread is allowed, the descriptors are parsed concurrently by a
+ * bounded pool of worker threads but the results, including any log
+ * messages, are processed in the same deterministic order as in serial
+ * scanning. This setting has no effect if the framework has been built
+ * without multi-threading support.
+ *
+ * @param loader the plug-in loader obtained from ::cp_create_local_ploader
+ * @param num_threads the maximum number of parsing threads, or 1 for serial parsing
+ */
+CP_C_API void cp_lpl_set_scan_threads(cp_plugin_loader_t *loader, int num_threads) CP_GCC_NONNULL(1);
+
+/**
+ * Sets a scan cache file for a plug-in directory registered with the
+ * specified local plug-in loader. The loader stores a binary image of each
+ * plug-in descriptor it has parsed in the cache file and, on subsequent
+ * scans, loads plug-ins whose descriptor file has not changed directly
+ * from the cache instead of parsing the XML descriptor. A descriptor file
+ * is considered unchanged if its inode, size and modification time match
+ * the cached values. The cache file is created or updated at the end of a
+ * scan if necessary. A missing or invalid cache file is not an error; the
+ * descriptors are then parsed and the cache is rebuilt.
+ *
+ * @param loader the plug-in loader obtained from ::cp_create_local_ploader
+ * @param dir the registered plug-in directory
+ * @param cache_file the path of the cache file, or NULL to disable caching
+ * @return @ref CP_OK (zero) on success, @ref CP_ERR_UNKNOWN if the directory
+ *   has not been registered or @ref CP_ERR_RESOURCE if insufficient memory
+ */
+CP_C_API cp_status_t cp_lpl_set_cache_file(cp_plugin_loader_t *loader, const char *dir, const char *cache_file) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Enables or disables the watch mode of the specified local plug-in loader.
+ * In watch mode the loader watches the registered plug-in directories for
+ * changes using operating system file change notifications. A plug-in scan
+ * then only loads the plug-ins in plug-in directories that have been
+ * added or modified since the previous scan, while the unchanged plug-ins
+ * are provided from memory without accessing their descriptors. Removed
+ * plug-in directories are no longer provided. Each plug-in directory is
+ * fully listed during the first scan after enabling the watch mode.
+ * 
+ * The application can use the file descriptor returned by
+ * ::cp_lpl_get_watch_fd to wait for changes, for example using select or
+ * poll, and call ::cp_scan_plugins when the descriptor becomes readable.
+ * The pending change notifications are consumed during the scan.
+ *
+ * @param loader the plug-in loader obtained from ::cp_create_local_ploader
+ * @param watch whether to watch the plug-in directories
+ * @return @ref CP_OK (zero) on success or @ref CP_ERR_RESOURCE if insufficient
+ *   system resources or if file change notifications are not supported
+ */
+CP_C_API cp_status_t cp_lpl_set_watch(cp_plugin_loader_t *loader, int watch) CP_GCC_NONNULL(1);
+
+/**
+ * Returns a file descriptor that becomes readable when there are pending
+ * changes in the plug-in directories watched by the specified local plug-in
+ * loader. The descriptor must not be read or closed by the application.
+ *
+ * @param loader the plug-in loader obtained from ::cp_create_local_ploader
+ * @return the file descriptor or -1 if the loader is not in watch mode
+ */
+CP_C_API int cp_lpl_get_watch_fd(cp_plugin_loader_t *loader) CP_GCC_NONNULL(1);
+
 /*@}*/
 
 
@@ -35,6 +35,7 @@
 
 #include "defines.h"
 #include <assert.h>
+#include <stdarg.h>
 #if defined(DLOPEN_POSIX)
 #include <dlfcn.h>
 #elif defined(DLOPEN_LIBTOOL)
@@ -43,6 +44,7 @@
 #include "../kazlib/list.h"
 #include "../kazlib/hash.h"
 #include "cpluff.h"
+#include "util.h"
 #ifdef CP_THREADS
 #include "thread.h"
 #endif
@@ -61,6 +63,12 @@ extern "C" {
 /// Preliminarily OK 
 #define CP_OK_PRELIMINARY (-1)
 
+/// Plugin descriptor name 
+#define CP_PLUGIN_DESCRIPTOR "plugin.xml"
+
+/// Compiled plug-in descriptor name
+#define CP_PLUGIN_IMAGE "plugin.bin"
+
 /// Callback function logger function
 #define CPI_CF_LOGGER 1
 
@@ -76,6 +84,12 @@ extern "C" {
 /// Bitmask corresponding to any callback function
 #define CPI_CF_ANY (~0)
 
+/// Concurrent job state: the plug-in waits for a worker thread
+#define CPI_JOB_QUEUED 1
+
+/// Concurrent job state: the plug-in is being started or stopped by some thread
+#define CPI_JOB_RUNNING 2
+
 /// Logging limit for no logging
 #define CP_LOG_NONE 1000
 
@@ -114,6 +128,12 @@ extern "C" {
 
 typedef struct cp_plugin_t cp_plugin_t;
 typedef struct cp_plugin_env_t cp_plugin_env_t;
+typedef struct cpi_registry_snapshot_t cpi_registry_snapshot_t;
+typedef struct cpi_info_header_t cpi_info_header_t;
+typedef struct cpi_symbol_cache_t cpi_symbol_cache_t;
+typedef struct cpi_run_scheduler_t cpi_run_scheduler_t;
+typedef struct cpi_run_poller_t cpi_run_poller_t;
+typedef struct cpi_run_timers_t cpi_run_timers_t;
 
 // Plug-in context
 struct cp_context_t {
@@ -130,6 +150,85 @@ struct cp_context_t {
 	/// Information about symbol providing plugins or NULL if not initialized
 	hash_t *symbol_providers;
 	
+	/// Cache of recently resolved symbols, or NULL if never enabled
+	cpi_symbol_cache_t *symbol_cache;
+	
+};
+
+// A plug-in in a registry snapshot
+typedef struct cpi_snapshot_plugin_t {
+	
+	/// The interned plug-in identifier
+	const char *identifier;
+	
+	/// The plug-in information, referenced by the snapshot
+	cp_plugin_info_t *plugin;
+	
+	/// The plug-in state
+	cp_plugin_state_t state;
+	
+} cpi_snapshot_plugin_t;
+
+// The extensions of an extension point in a registry snapshot
+typedef struct cpi_snapshot_extensions_t {
+	
+	/// The interned extension point identifier
+	const char *ext_point_id;
+	
+	/// The extensions in installation order
+	cp_extension_t **extensions;
+	
+	/// The number of extensions
+	int num;
+	
+	/// The shared extension information array, or NULL if not yet requested
+	cp_extension_t **info;
+	
+} cpi_snapshot_extensions_t;
+
+/**
+ * Snapshot of the plug-in registry for lock-free readers. The snapshot is
+ * immutable except for the shared information arrays which are built on
+ * the first request and published atomically.
+ */
+struct cpi_registry_snapshot_t {
+	
+	/// Link to the next retired snapshot
+	cpi_retired_t retired;
+	
+	/// The number of plug-ins
+	int num_plugins;
+	
+	/// The plug-ins sorted by identifier
+	cpi_snapshot_plugin_t *plugins;
+	
+	/// The plug-in information in registry order
+	cp_plugin_info_t **plugin_infos;
+	
+	/// The number of extension points
+	int num_ext_points;
+	
+	/// The extension points in registry order
+	cp_ext_point_t **ext_points;
+	
+	/// The number of extension point identifiers having extensions
+	int num_ext_point_ids;
+	
+	/// The extensions by extension point, sorted by extension point identifier
+	cpi_snapshot_extensions_t *ext_point_extensions;
+	
+	/// The extensions of all extension points in registry order
+	cpi_snapshot_extensions_t all_extensions;
+	
+	/// The shared plug-in information array, or NULL if not yet requested
+	cp_plugin_info_t **plugins_info;
+	
+	/// The shared extension point information array, or NULL if not yet requested
+	cp_ext_point_t **ext_points_info;
+	
+	/// The shared empty extension information array, or NULL if not yet requested
+	cp_extension_t **no_extensions_info;
+	
 };
 
 // Plug-in environment
@@ -166,26 +265,59 @@ struct cp_plugin_env_t {
 	/// Maps registered plug-in loaders to the lists of plug-in identifiers
 	hash_t *loaders_to_plugins;
 	
-	/// Map of in-use reference counted information objects
+	/// Set of in-use reference counted information objects
 	hash_t *infos;
 
-	/// Maps plug-in identifiers to plug-in state structures 
+	/// Interned identifier strings mapped to their reference counts
+	hash_t *strings;
+
+	/// Maps interned plug-in identifiers to plug-in state structures 
 	hash_t *plugins;
 
 	/// List of started plug-ins in the order they were started 
 	list_t *started_plugins;
 
-	/// Maps extension point names to installed extension points
+	/// Maps interned extension point names to installed extension points
 	hash_t *ext_points;
 	
-	/// Maps extension point names to installed extensions
+	/// Maps interned extension point names to installed extensions
 	hash_t *extensions;
 	
+	/// The published registry snapshot, or NULL if it could not be built
+	cpi_registry_snapshot_t *registry;
+	
+	/// Reader epochs of the registry snapshots
+	cpi_epochs_t registry_epochs;
+	
+	/// Whether to index the dynamic symbols of loaded runtime libraries
+	int index_runtime_symbols;
+	
+	/// The contexts having a symbol cache, or NULL if none
+	list_t *symbol_caching_contexts;
+	
+	/// The number of concurrent plug-in start or stop jobs in progress
+	int plugin_jobs;
+	
+	/// The number of plug-ins queued for or being started or stopped concurrently
+	int job_plugins;
+	
 	/// FIFO queue of run functions, currently running functions at front
 	list_t *run_funcs;
 	
 	/// First waiting run function, or NULL if none
 	lnode_t *run_wait;
+	
+	/// The scheduler of a multi-threaded run, or NULL if none
+	cpi_run_scheduler_t *run_scheduler;
+	
+	/// The poller of run functions waiting for file descriptors, or NULL if none
+	cpi_run_poller_t *run_poller;
+	
+	/// The run functions waiting for deadlines, or NULL if none registered yet
+	cpi_run_timers_t *run_timers;
+	
+	/// The number of stop requests made for blocking runs
+	unsigned int run_stop_requests;
 
 	/// Is logger currently being invoked
 	int in_logger_invocation;
@@ -236,6 +368,9 @@ struct cp_plugin_t {
 	
 	/// Plug-in runtime function information, or NULL if not resolved
 	cp_plugin_runtime_t *runtime_funcs;
+	
+	/// Index of the declared and indexed runtime symbols, or NULL if none
+	hash_t *exported_symbols;
 
 	/// Plug-in instance data or NULL if instance does not exist
 	void *plugin_data;
@@ -246,6 +381,24 @@ struct cp_plugin_t {
 	/// Used by recursive operations: has this plug-in been processed already
 	int processed;
 	
+	/// Concurrent job state, CPI_JOB_QUEUED, CPI_JOB_RUNNING or zero
+	int job_state;
+	
+	/// The plug-in on whose behalf this plug-in is being started or stopped
+	cp_plugin_t *job_owner;
+	
+	/// The plug-in whose start the thread handling this plug-in waits for
+	cp_plugin_t *job_waiting_for;
+	
+	/**
+	 * The invocation counter of the runtime function currently called
+	 * concurrently without the context lock, or NULL
+	 */
+	int *job_invocation;
+	
+	/// Whether the run functions of this plug-in are being stopped
+	int run_stopping;
+	
 };
 
 
@@ -258,6 +411,24 @@ struct cp_plugin_t {
  */
 typedef void (*cpi_dealloc_func_t)(cp_context_t *ctx, void *resource);
 
+/**
+ * Header immediately preceding each reference counted information object
+ * in memory. Information objects are allocated using ::cpi_malloc_info or
+ * otherwise reserve space for the header.
+ */
+struct cpi_info_header_t {
+	
+	/// The usage count, modified atomically
+	int usage_count;
+	
+	/// The deallocation function
+	cpi_dealloc_func_t dealloc_func;
+	
+};
+
+/// Returns the header of the specified information object
+#define CPI_INFO_HEADER(info) (((cpi_info_header_t *) (info)) - 1)
+
 typedef struct cpi_plugin_event_t cpi_plugin_event_t;
 
 /// Plug-in event information
@@ -333,6 +504,17 @@ CP_HIDDEN void cpi_signal_context(cp_context_t *context) CP_GCC_NONNULL(1);
 #define cpi_unlock_framework() do {} while(0)
 #endif
 
+/**
+ * Waits until the specified plug-in context is signalled or the specified
+ * time has elapsed. The caller must have locked the context. Without
+ * multi-threading support nothing could signal the context and this
+ * function just sleeps.
+ * 
+ * @param context the plug-in context
+ * @param timeout the maximum time to wait in milliseconds
+ */
+CP_HIDDEN void cpi_wait_context_timed(cp_context_t *context, unsigned long timeout) CP_GCC_NONNULL(1);
+
 /** 
  * @def cpi_is_context_locked
  * 
@@ -378,6 +560,42 @@ CP_HIDDEN void cpi_log(cp_context_t *ctx, cp_log_severity_t severity, const char
  */
 CP_HIDDEN void cpi_logf(cp_context_t *ctx, cp_log_severity_t severity, const char *msg, ...) CP_GCC_PRINTF(3, 4) CP_GCC_NONNULL(1, 3);
 
+/**
+ * Formats and logs a message using a variable argument list. Otherwise
+ * identical to ::cpi_logf.
+ * 
+ * @param ctx the related plug-in context
+ * @param severity the severity of the message
+ * @param msg the localized message format
+ * @param va the message parameters
+ */
+CP_HIDDEN void cpi_vlogf(cp_context_t *ctx, cp_log_severity_t severity, const char *msg, va_list va) CP_GCC_NONNULL(1, 3);
+
+/**
+ * Formats a message and appends it to a list of deferred log messages.
+ * Calls dgettext for @a msg to localize it before formatting the message.
+ * This function does not access the plug-in context, so it can be used by
+ * threads not holding the context lock. The messages are later delivered
+ * to loggers by calling ::cpi_flush_log. A message is silently dropped if
+ * there are insufficient resources for storing it.
+ * 
+ * @param log the list of deferred log messages
+ * @param severity the severity of the message
+ * @param msg the localized message format
+ * @param va the message parameters
+ */
+CP_HIDDEN void cpi_deferred_vlogf(list_t *log, cp_log_severity_t severity, const char *msg, va_list va) CP_GCC_NONNULL(1, 3);
+
+/**
+ * Delivers deferred log messages to loggers in the order they were
+ * recorded and empties the list. Messages below the current minimum
+ * severity level are discarded. The caller must have locked the context.
+ * 
+ * @param ctx the related plug-in context
+ * @param log the list of deferred log messages
+ */
+CP_HIDDEN void cpi_flush_log(cp_context_t *ctx, list_t *log) CP_GCC_NONNULL(1, 2);
+
 /**
  * Returns whether the messages of the specified severity level are
  * being logged for the specified context. The caller must have locked the context.
@@ -436,6 +654,39 @@ CP_HIDDEN char *cpi_context_owner(cp_context_t *ctx, char *name, size_t size) CP
  */
 CP_HIDDEN void cpi_fatal_null_arg(const char *arg, const char *func) CP_GCC_NORETURN CP_GCC_NONNULL(1, 2);
 
+/**
+ * Returns a reference to the interned copy of the specified string,
+ * interning it if necessary. Interned strings are unique within a plug-in
+ * environment, so they can be compared by pointer, and they stay valid
+ * until the reference is released using ::cpi_release_string. The caller
+ * must have locked the context.
+ * 
+ * @param ctx the plug-in context
+ * @param str the string to be interned
+ * @return the interned string or NULL if memory allocation failed
+ */
+CP_HIDDEN char *cpi_intern_string(cp_context_t *ctx, const char *str) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Releases a reference to an interned string. The string is freed when
+ * the last reference is released. The caller must have locked the context.
+ * 
+ * @param ctx the plug-in context
+ * @param str the interned string
+ */
+CP_HIDDEN void cpi_release_string(cp_context_t *ctx, const char *str) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns the interned copy of the specified string without interning it.
+ * A string that has not been interned is not a key in any of the registries
+ * of the plug-in environment. The caller must have locked the context.
+ * 
+ * @param ctx the plug-in context
+ * @param str the string to look up
+ * @return the interned string or NULL if the string has not been interned
+ */
+CP_HIDDEN char *cpi_lookup_string(cp_context_t *ctx, const char *str) CP_GCC_NONNULL(1, 2);
+
 /**
  * Checks that we are currently not in a specific callback function invocation.
  * Otherwise, reports a fatal error. The caller must have locked the context
@@ -447,6 +698,17 @@ CP_HIDDEN void cpi_fatal_null_arg(const char *arg, const char *func) CP_GCC_NORE
  */
 CP_HIDDEN void cpi_check_invocation(cp_context_t *ctx, int funcmask, const char *func) CP_GCC_NONNULL(1, 3);
 
+/**
+ * Checks that we are currently not in a specific callback function
+ * invocation without requiring the context lock. The context is locked
+ * for the exact check only if some disallowed invocation is in progress.
+ * 
+ * @param ctx the associated plug-in context
+ * @param funcmask the bitmask of disallowed callback functions
+ * @param func the current plug-in framework function
+ */
+CP_HIDDEN void cpi_check_invocation_unlocked(cp_context_t *ctx, int funcmask, const char *func) CP_GCC_NONNULL(1, 3);
+
 
 // Context management
 
@@ -485,6 +747,35 @@ CP_HIDDEN void cpi_destroy_all_contexts(void);
  */
 CP_HIDDEN void cpi_deliver_event(cp_context_t *context, const cpi_plugin_event_t *event) CP_GCC_NONNULL(1, 2);
 
+/**
+ * Delivers a batch of plug-in events to registered event listeners while
+ * holding the context lock only once. The events are delivered in order.
+ * 
+ * @param context the plug-in context
+ * @param events the plug-in events
+ * @param num_events the number of events
+ */
+CP_HIDDEN void cpi_deliver_events(cp_context_t *context, const cpi_plugin_event_t *events, int num_events) CP_GCC_NONNULL(1);
+
+/**
+ * Replaces the published registry snapshot with an up to date one. Must be
+ * called whenever the set of installed plug-ins or the state of a plug-in
+ * changes. The caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_invalidate_registry(cp_context_t *context) CP_GCC_NONNULL(1);
+
+/**
+ * Retires the published registry snapshot without publishing a new one and
+ * frees the retired snapshots. Called when destroying the context. The
+ * caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_release_registry(cp_context_t *context) CP_GCC_NONNULL(1);
+
+
 
 // Plug-in management
 
@@ -499,12 +790,88 @@ CP_HIDDEN void cpi_deliver_event(cp_context_t *context, const cpi_plugin_event_t
 CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t *plugin, cp_plugin_loader_t *loader) CP_GCC_NONNULL(1, 2);
 
 /**
- * Frees any resources allocated for a plug-in description.
+ * Frees any resources allocated for a plug-in description parsed by
+ * ::cpi_parse_plugin_descriptor. All the information lives in a single
+ * memory arena which is released at once, apart from configuration lookup
+ * indexes.
  * 
  * @param plugin the plug-in to be freed
  */
 CP_HIDDEN void cpi_free_plugin(cp_plugin_info_t *plugin) CP_GCC_NONNULL(1);
 
+/**
+ * Builds the lookup indexes of the large configuration elements of the
+ * extensions of the specified plug-in. The configuration lookup functions
+ * use the indexes without locking. Failing to index an element is not
+ * an error, the element is just looked up without an index.
+ * 
+ * @param plugin the plug-in information
+ */
+CP_HIDDEN void cpi_add_cfg_indexes(cp_plugin_info_t *plugin) CP_GCC_NONNULL(1);
+
+/**
+ * Frees the configuration element lookup indexes built for the extensions
+ * of the specified plug-in.
+ * 
+ * @param plugin the plug-in information
+ */
+CP_HIDDEN void cpi_free_cfg_indexes(cp_plugin_info_t *plugin) CP_GCC_NONNULL(1);
+
+/**
+ * Parses a plug-in descriptor from the specified plug-in installation path.
+ * Does not access the plug-in context apart from logging and it can be
+ * called concurrently from several threads. If @a log is NULL then
+ * messages are logged directly, temporarily locking the context for each
+ * message. Otherwise messages are appended to the specified list of
+ * deferred log messages and the context is not locked at all. The returned
+ * information has not been registered yet and must be passed to
+ * ::cpi_register_plugin_info.
+ * 
+ * @param context the plug-in context
+ * @param path the installation path of the plug-in
+ * @param log the list of deferred log messages or NULL to log directly
+ * @param status a pointer to the location where the status code is to be stored, or NULL
+ * @return pointer to the unregistered information structure or NULL on failure
+ */
+CP_HIDDEN cp_plugin_info_t * cpi_parse_plugin_descriptor(cp_context_t *context, const char *path, list_t *log, cp_status_t *status) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Registers a plug-in information structure returned by
+ * ::cpi_parse_plugin_descriptor as a reference counted information object.
+ * The information is freed on failure. The caller must have locked the
+ * context.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in information
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+CP_HIDDEN cp_status_t cpi_register_plugin_info(cp_context_t *context, cp_plugin_info_t *plugin) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Replaces the plug-in identifier, the imported plug-in identifiers and
+ * the extension point identifiers of a plug-in information structure
+ * being registered with references to their interned copies. This must be
+ * done before the information is registered so that it can be used as
+ * keys in the registries of the plug-in environment. Either all or none
+ * of the identifiers are interned. Failures are not reported. The caller
+ * must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in information
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+CP_HIDDEN cp_status_t cpi_intern_plugin_info(cp_context_t *context, cp_plugin_info_t *plugin) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Releases the interned identifiers of plug-in information being
+ * deallocated or failing registration. The identifiers must not be used
+ * afterwards. The caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in information
+ */
+CP_HIDDEN void cpi_unintern_plugin_info(cp_context_t *context, cp_plugin_info_t *plugin) CP_GCC_NONNULL(1, 2);
+
 /**
  * Starts the specified plug-in and its dependencies.
  * 
@@ -515,14 +882,124 @@ CP_HIDDEN void cpi_free_plugin(cp_plugin_info_t *plugin) CP_GCC_NONNULL(1);
 CP_HIDDEN cp_status_t cpi_start_plugin(cp_context_t *context, cp_plugin_t *plugin) CP_GCC_NONNULL(1, 2);
 
 
+// Runtime symbol indexing
+
+/**
+ * Indexes the global symbols defined by the dynamic symbol table of a
+ * freshly loaded plug-in runtime library into the symbol export index
+ * of the plug-in. Symbols already present in the index, such as those
+ * declared in a symbol export table, take precedence. The caller must
+ * have locked the associated context.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in whose runtime library has been loaded
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+CP_HIDDEN cp_status_t cpi_index_runtime_symbols(cp_context_t *context, cp_plugin_t *plugin) CP_GCC_NONNULL(1, 2);
+
+
+// Symbol caches
+
+/**
+ * Releases the cached symbols of a plug-in context. Symbols still in use
+ * through the cache are turned into ordinary resolved symbols. The caller
+ * must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param provider the plug-in whose symbols are released, or NULL for all
+ */
+CP_HIDDEN void cpi_flush_symbol_cache(cp_context_t *context, cp_plugin_t *provider) CP_GCC_NONNULL(1);
+
+/**
+ * Releases the symbols provided by the specified plug-in from the symbol
+ * caches of all contexts of the plug-in environment. This must be called
+ * before the provider is stopped. The caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param provider the symbol providing plug-in
+ */
+CP_HIDDEN void cpi_flush_symbol_caches(cp_context_t *context, cp_plugin_t *provider) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Frees the symbol cache of a plug-in context being destroyed. The cache
+ * must have been flushed.
+ * 
+ * @param context the plug-in context
+ */
+CP_HIDDEN void cpi_free_symbol_cache(cp_context_t *context) CP_GCC_NONNULL(1);
+
+
+// Plug-in descriptor images
+
+/**
+ * Encodes plug-in information into a self-contained binary image. The image
+ * can be stored and later turned back into plug-in information using
+ * ::cpi_load_plugin_image without parsing the plug-in descriptor. The
+ * plug-in path is not included in the image.
+ * 
+ * @param plugin the plug-in information
+ * @param size filled with the size of the image in bytes
+ * @return the newly allocated image or NULL if insufficient memory
+ */
+CP_HIDDEN void *cpi_encode_plugin_image(const cp_plugin_info_t *plugin, size_t *size) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Validates a binary plug-in image and decodes it into a reference counted
+ * plug-in information object. The information is allocated as a single
+ * memory block and does not refer to the image. The caller must have
+ * locked the plug-in context.
+ * 
+ * @param context the plug-in context
+ * @param image the image, aligned at least to a 32-bit boundary
+ * @param size the size of the image in bytes
+ * @param path the plug-in path
+ * @param status a pointer to the location where the status code is to be stored, or NULL
+ * @return the registered plug-in information or NULL on failure
+ */
+CP_HIDDEN cp_plugin_info_t *cpi_load_plugin_image(cp_context_t *context, const void *image, size_t size, const char *path, cp_status_t *status) CP_GCC_NONNULL(1, 2, 4);
+
+/**
+ * Loads the compiled plug-in descriptor of the specified plug-in into
+ * memory and decodes it into a reference counted plug-in information
+ * object. The image file is mapped into memory, if supported, and the
+ * strings of the information refer directly to the mapped image which is
+ * unmapped when the information is released. Failures are not reported.
+ * The caller must have locked the plug-in context.
+ * 
+ * @param context the plug-in context
+ * @param path the plug-in path
+ * @param status a pointer to the location where the status code is to be stored, or NULL
+ * @return the registered plug-in information or NULL on failure
+ */
+CP_HIDDEN cp_plugin_info_t *cpi_map_plugin_image(cp_context_t *context, const char *path, cp_status_t *status) CP_GCC_NONNULL(1, 2);
+
+
 // Dynamic resource management
 
+/**
+ * Allocates memory for a reference counted information object, reserving
+ * space for the information header.
+ * 
+ * @param size the size of the object
+ * @return the object or NULL if out of memory
+ */
+CP_HIDDEN void *cpi_malloc_info(size_t size);
+
+/**
+ * Frees an unregistered information object allocated using
+ * ::cpi_malloc_info. Does nothing if the object is NULL.
+ * 
+ * @param info the object, or NULL
+ */
+CP_HIDDEN void cpi_free_info(void *info);
+
 /**
  * Registers a new reference counted information object.
  * Initializes the reference count to 1. The object is released and
  * deallocated using the specified deallocation function @a df when its
  * reference count becomes zero. Reference count is incresed by
- * ::cpi_use_info and decreased by ::cp_release_info. The caller must have
+ * ::cpi_use_info and decreased by ::cp_release_info. The object must be
+ * preceded by an information header. The caller must have
  * locked the plug-in context.
  * 
  * @param ctx the associated plug-in context
@@ -534,7 +1011,8 @@ CP_HIDDEN cp_status_t cpi_register_info(cp_context_t *ctx, void *res, cpi_deallo
 
 /**
  * Increases the reference count for the specified information object.
- * The caller must have locked the plug-in context.
+ * Reports a fatal error if the object is not registered. The caller must
+ * have locked the plug-in context.
  * 
  * @param ctx the plug-in context
  * @param res the resource
@@ -542,8 +1020,10 @@ CP_HIDDEN cp_status_t cpi_register_info(cp_context_t *ctx, void *res, cpi_deallo
 CP_HIDDEN void cpi_use_info(cp_context_t *ctx, void *res) CP_GCC_NONNULL(1, 2);
 
 /**
- * Decreases the reference count for the specified information object.
- * The caller must have locked the plug-in context.
+ * Decreases the reference count for the specified information object,
+ * deallocating it when the count becomes zero. Reports a fatal error if
+ * the object is not registered. The caller must have locked the plug-in
+ * context.
  * 
  * @param ctx the plug-in context
  * @param res the resource
@@ -551,8 +1031,8 @@ CP_HIDDEN void cpi_use_info(cp_context_t *ctx, void *res) CP_GCC_NONNULL(1, 2);
 CP_HIDDEN void cpi_release_info(cp_context_t *ctx, void *res) CP_GCC_NONNULL(1, 2);
 
 /**
- * Checks for remaining information objects in the specified plug-in context.
- * Does not destroy the infos hash.
+ * Checks for remaining information objects in the specified plug-in context
+ * and unregisters them without deallocating.
  * 
  * @param ctx the plug-in context
  */
@@ -570,6 +1050,15 @@ CP_HIDDEN void cpi_release_infos(cp_context_t *ctx) CP_GCC_NONNULL(1);
  */
 CP_HIDDEN void cpi_stop_plugin_run(cp_plugin_t *plugin) CP_GCC_NONNULL(1);
 
+/**
+ * Frees the poller of run functions waiting for file descriptors and the
+ * timers of run functions waiting for deadlines, if any. All run functions
+ * must have been unregistered.
+ * 
+ * @param env the plug-in environment
+ */
+CP_HIDDEN void cpi_free_run_waits(cp_plugin_env_t *env) CP_GCC_NONNULL(1);
+
 
 #ifdef __cplusplus
 }
@@ -38,6 +38,7 @@
 #include "defines.h"
 #include "util.h"
 #include "internal.h"
+#include "atomic.h"
 
 
 /* ------------------------------------------------------------------------
@@ -63,6 +64,16 @@ typedef struct logger_t {
 	cp_plugin_env_t *env_selection;
 } logger_t;
 
+/// Contains a log message whose delivery has been deferred
+typedef struct deferred_msg_t {
+	
+	/// Severity of the message
+	cp_log_severity_t severity;
+	
+	/// The localized and formatted message
+	char msg[];
+} deferred_msg_t;
+
 
 /* ------------------------------------------------------------------------
  * Function definitions
@@ -189,7 +200,7 @@ static void do_log(cp_context_t *context, cp_log_severity_t severity, const char
 	if (context->plugin != NULL) {
 		apid = context->plugin->plugin->identifier;
 	}
-	context->env->in_logger_invocation++;
+	cpi_atomic_add_int(&(context->env->in_logger_invocation), 1);
 	node = list_first(context->env->loggers);
 	while (node != NULL) {
 		logger_t *lh = lnode_get(node);
@@ -198,7 +209,7 @@ static void do_log(cp_context_t *context, cp_log_severity_t severity, const char
 		}
 		node = list_next(context->env->loggers, node);
 	}
-	context->env->in_logger_invocation--;
+	cpi_atomic_add_int(&(context->env->in_logger_invocation), -1);
 }
 
 CP_HIDDEN void cpi_log(cp_context_t *context, cp_log_severity_t severity, const char *msg) {
@@ -209,20 +220,67 @@ CP_HIDDEN void cpi_log(cp_context_t *context, cp_log_severity_t severity, const
 }
 
 CP_HIDDEN void cpi_logf(cp_context_t *context, cp_log_severity_t severity, const char *msg, ...) {
-	char buffer[256];
 	va_list va;
 	
+	va_start(va, msg);
+	cpi_vlogf(context, severity, msg, va);
+	va_end(va);
+}
+
+CP_HIDDEN void cpi_vlogf(cp_context_t *context, cp_log_severity_t severity, const char *msg, va_list va) {
+	char buffer[256];
+	
 	assert(context != NULL);
 	assert(msg != NULL);
 	assert(severity >= CP_LOG_DEBUG && severity <= CP_LOG_ERROR);
 		
-	va_start(va, msg);
 	vsnprintf(buffer, sizeof(buffer), _(msg), va);
-	va_end(va);
 	strcpy(buffer + sizeof(buffer)/sizeof(char) - 4, "...");
 	do_log(context, severity, buffer);
 }
 
+CP_HIDDEN void cpi_deferred_vlogf(list_t *log, cp_log_severity_t severity, const char *msg, va_list va) {
+	char buffer[256];
+	deferred_msg_t *dm;
+	lnode_t *node;
+	
+	assert(log != NULL);
+	assert(msg != NULL);
+	assert(severity >= CP_LOG_DEBUG && severity <= CP_LOG_ERROR);
+	
+	vsnprintf(buffer, sizeof(buffer), _(msg), va);
+	strcpy(buffer + sizeof(buffer)/sizeof(char) - 4, "...");
+	if ((dm = malloc(sizeof(deferred_msg_t) + (strlen(buffer) + 1) * sizeof(char))) == NULL) {
+		return;
+	}
+	dm->severity = severity;
+	strcpy(dm->msg, buffer);
+	if ((node = lnode_create(dm)) == NULL) {
+		free(dm);
+		return;
+	}
+	list_append(log, node);
+}
+
+CP_HIDDEN void cpi_flush_log(cp_context_t *context, list_t *log) {
+	lnode_t *node;
+	
+	assert(context != NULL);
+	assert(log != NULL);
+	while (!list_isempty(log)) {
+		deferred_msg_t *dm;
+		
+		node = list_del_first(log);
+		dm = lnode_get(node);
+		
+		if (cpi_is_logged(context, dm->severity)) {
+			do_log(context, dm->severity, dm->msg);
+		}
+		lnode_destroy(node);
+		free(dm);
+	}
+}
+
 static void process_unregister_logger(list_t *list, lnode_t *node, void *plugin) {
 	logger_t *lh = lnode_get(node);
 	if (plugin == NULL || lh->plugin == plugin) {
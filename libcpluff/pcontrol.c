@@ -40,6 +40,42 @@
 #include "defines.h"
 #include "util.h"
 #include "internal.h"
+#include "atomic.h"
+#ifdef CP_THREADS
+#include "thread.h"
+#endif
+
+
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+#ifdef CP_THREADS
+
+/// Shared state of a concurrent plug-in start or stop job, protected by the context lock
+typedef struct plugin_job_t {
+
+	/// The plug-in context
+	cp_context_t *context;
+
+	/// Whether the job stops rather than starts plug-ins
+	int stop;
+
+	/// The plug-ins queued for or being handled by the job
+	list_t *plugins;
+
+	/// The number of threads working on the job
+	int num_workers;
+
+	/// The number of plug-ins currently being handled by the job
+	int num_running;
+
+	/// The first failure status or CP_OK
+	cp_status_t status;
+
+} plugin_job_t;
+
+#endif
 
 
 /* ------------------------------------------------------------------------
@@ -93,22 +129,33 @@ static void unregister_extensions(cp_context_t *context, cp_plugin_info_t *plugi
 				lnode = nn;
 			}
 			if (list_isempty(el)) {
-				char *epid = (char *) hnode_getkey(hnode);				
 				hash_delete_free(context->env->extensions, hnode);
-				free(epid);
 				list_destroy(el);
 			}
 		}
 	}
 }
 
-CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t *plugin, cp_plugin_loader_t *loader) {
+/**
+ * Registers the plug-in state, extension points and extensions of the
+ * specified plug-in without delivering any events. On failure all changes
+ * made to the context are undone.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in information
+ * @param loader the loader that loaded the plug-in, or NULL
+ * @param rpp a pointer to the location where the plug-in state is to be stored
+ * @return CP_OK (0) on success or an error code on failure
+ */
+static cp_status_t register_plugin(cp_context_t *context, cp_plugin_info_t *plugin, cp_plugin_loader_t *loader, cp_plugin_t **rpp) {
 	cp_plugin_t *rp = NULL;
 	cp_status_t status = CP_OK;
-	cpi_plugin_event_t event;
+	int used = 0;
+	int inserted = 0;
 	int i;
 
 	assert(cpi_is_context_locked(context));
+	assert(cpi_lookup_string(context, plugin->identifier) == plugin->identifier);
 	do {
 		
 		// Check that there is no conflicting plug-in already loaded 
@@ -122,6 +169,7 @@ CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t
 
 		// Increase usage count for the plug-in descriptor
 		cpi_use_info(context, plugin);
+		used = 1;
 
 		// Allocate space for the plug-in state 
 		if ((rp = malloc(sizeof(cp_plugin_t))) == NULL) {
@@ -138,6 +186,7 @@ CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t
 		rp->imported = NULL;
 		rp->runtime_lib = NULL;
 		rp->runtime_funcs = NULL;
+		rp->exported_symbols = NULL;
 		rp->plugin_data = NULL;
 		rp->importing = list_create(LISTCOUNT_T_MAX);
 		if (rp->importing == NULL) {
@@ -148,6 +197,7 @@ CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t
 			status = CP_ERR_RESOURCE;
 			break;
 		}
+		inserted = 1;
 		
 		// Register extension points
 		for (i = 0; status == CP_OK && i < plugin->num_ext_points; i++) {
@@ -170,18 +220,12 @@ CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t
 			list_t *el;
 			
 			if ((hnode = hash_lookup(context->env->extensions, e->ext_point_id)) == NULL) {
-				char *epid;
-				if ((el = list_create(LISTCOUNT_T_MAX)) != NULL
-					&& (epid = strdup(e->ext_point_id)) != NULL) {
-					if (!hash_alloc_insert(context->env->extensions, epid, el)) {
-						list_destroy(el);
-						status = CP_ERR_RESOURCE;
-						break;
-					}
-				} else {
-					if (el != NULL) {
-						list_destroy(el);
-					}
+				if ((el = list_create(LISTCOUNT_T_MAX)) == NULL) {
+					status = CP_ERR_RESOURCE;
+					break;
+				}
+				if (!hash_alloc_insert(context->env->extensions, e->ext_point_id, el)) {
+					list_destroy(el);
 					status = CP_ERR_RESOURCE;
 					break;
 				}
@@ -196,21 +240,14 @@ CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t
 			}
 		}
 
-		// Break if previous loops failed
-		if (status != CP_OK) {
-			break;
-		}
-		
-		// Plug-in installed 
-		event.plugin_id = plugin->identifier;
-		event.old_state = CP_PLUGIN_UNINSTALLED;
-		event.new_state = rp->state;
-		cpi_deliver_event(context, &event);
-
 	} while (0);
 
 	// Release resources on failure
 	if (status != CP_OK) {
+		if (inserted) {
+			hash_delete_free(context->env->plugins,
+				hash_lookup(context->env->plugins, plugin->identifier));
+		}
 		if (rp != NULL) {
 			if (rp->importing != NULL) {
 				list_destroy(rp->importing);
@@ -218,6 +255,9 @@ CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t
 			free(rp);
 		}
 		unregister_extensions(context, plugin);
+		if (used) {
+			cpi_release_info(context, plugin);
+		}
 	}
 
 	// Report possible resource error
@@ -226,6 +266,48 @@ CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t
 			N_("Plug-in %s could not be installed due to insufficient system resources."), plugin->identifier);
 	}
 
+	if (status == CP_OK && rpp != NULL) {
+		*rpp = rp;
+	}
+	return status;
+}
+
+/**
+ * Undoes the registration of a plug-in that has been registered using
+ * ::register_plugin but has not yet been announced to event listeners.
+ * 
+ * @param context the plug-in context
+ * @param rp the plug-in state
+ */
+static void unregister_plugin(cp_context_t *context, cp_plugin_t *rp) {
+	cp_plugin_info_t *plugin = rp->plugin;
+	hnode_t *hnode;
+	
+	assert(cpi_is_context_locked(context));
+	if ((hnode = hash_lookup(context->env->plugins, plugin->identifier)) != NULL
+		&& hnode_get(hnode) == rp) {
+		hash_delete_free(context->env->plugins, hnode);
+	}
+	unregister_extensions(context, plugin);
+	list_destroy(rp->importing);
+	free(rp);
+	cpi_release_info(context, plugin);
+}
+
+CP_HIDDEN cp_status_t cpi_install_plugin(cp_context_t *context, cp_plugin_info_t *plugin, cp_plugin_loader_t *loader) {
+	cp_plugin_t *rp;
+	cp_status_t status;
+	cpi_plugin_event_t event;
+
+	assert(cpi_is_context_locked(context));
+	if ((status = register_plugin(context, plugin, loader, &rp)) == CP_OK) {
+		
+		// Plug-in installed 
+		event.plugin_id = plugin->identifier;
+		event.old_state = CP_PLUGIN_UNINSTALLED;
+		event.new_state = rp->state;
+		cpi_deliver_event(context, &event);
+	}
 	return status;
 }
 
@@ -243,6 +325,130 @@ CP_C_API cp_status_t cp_install_plugin(cp_context_t *context, cp_plugin_info_t *
 	return status;
 }
 
+/**
+ * Checks that the specified plug-in does not conflict with the installed
+ * plug-ins or with the plug-ins preceding it in the same installation
+ * batch. The identifiers of the plug-in and its extension points are
+ * added to the batch tables.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in information
+ * @param batch_plugins the plug-in identifiers of the batch
+ * @param batch_ext_points the extension point identifiers of the batch
+ * @return CP_OK (0) on success or an error code on failure
+ */
+static cp_status_t check_batch_conflicts(cp_context_t *context, cp_plugin_info_t *plugin, hash_t *batch_plugins, hash_t *batch_ext_points) {
+	int i;
+	
+	if (hash_lookup(context->env->plugins, plugin->identifier) != NULL
+		|| hash_lookup(batch_plugins, plugin->identifier) != NULL) {
+		cpi_errorf(context,
+			N_("Plug-in %s could not be installed because a plug-in with the same identifier is already installed."), 
+			plugin->identifier);
+		return CP_ERR_CONFLICT;
+	}
+	if (!hash_alloc_insert(batch_plugins, plugin->identifier, plugin)) {
+		return CP_ERR_RESOURCE;
+	}
+	for (i = 0; i < plugin->num_ext_points; i++) {
+		cp_ext_point_t *ep = plugin->ext_points + i;
+		
+		if (hash_lookup(context->env->ext_points, ep->identifier) != NULL
+			|| hash_lookup(batch_ext_points, ep->identifier) != NULL) {
+			cpi_errorf(context, N_("Plug-in %s could not be installed because extension point %s conflicts with an already installed extension point."), plugin->identifier, ep->identifier);
+			return CP_ERR_CONFLICT;
+		}
+		if (!hash_alloc_insert(batch_ext_points, ep->identifier, ep)) {
+			return CP_ERR_RESOURCE;
+		}
+	}
+	return CP_OK;
+}
+
+CP_C_API cp_status_t cp_install_plugins(cp_context_t *context, cp_plugin_info_t **plugins, int num_plugins) {
+	hash_t *batch_plugins = NULL;
+	hash_t *batch_ext_points = NULL;
+	cp_plugin_t **rps = NULL;
+	cpi_plugin_event_t *events = NULL;
+	cp_status_t status = CP_OK;
+	int i, n;
+
+	CHECK_NOT_NULL(context);
+	if (num_plugins > 0) {
+		CHECK_NOT_NULL(plugins);
+	}
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	do {
+		if (num_plugins <= 0) {
+			break;
+		}
+		
+		// Allocate the batch tables
+		if ((batch_plugins = hash_create(HASHCOUNT_T_MAX, cpi_comp_ptr, cpi_hashfunc_ptr)) == NULL
+			|| (batch_ext_points = hash_create(HASHCOUNT_T_MAX, cpi_comp_ptr, cpi_hashfunc_ptr)) == NULL
+			|| (rps = malloc(num_plugins * sizeof(cp_plugin_t *))) == NULL
+			|| (events = malloc(num_plugins * sizeof(cpi_plugin_event_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		// Validate the whole batch before changing the context
+		for (i = 0; status == CP_OK && i < num_plugins; i++) {
+			assert(plugins[i] != NULL);
+			status = check_batch_conflicts(context, plugins[i], batch_plugins, batch_ext_points);
+		}
+		if (status != CP_OK) {
+			break;
+		}
+		
+		// Register the plug-ins
+		for (n = 0; n < num_plugins; n++) {
+			if ((status = register_plugin(context, plugins[n], NULL, rps + n)) != CP_OK) {
+				break;
+			}
+		}
+		if (status != CP_OK) {
+			
+			// Undo the plug-ins registered before the failure
+			while (n > 0) {
+				unregister_plugin(context, rps[--n]);
+			}
+			break;
+		}
+		
+		// Plug-ins installed
+		for (i = 0; i < num_plugins; i++) {
+			events[i].plugin_id = plugins[i]->identifier;
+			events[i].old_state = CP_PLUGIN_UNINSTALLED;
+			events[i].new_state = rps[i]->state;
+		}
+		cpi_deliver_events(context, events, num_plugins);
+		
+	} while (0);
+	
+	// Report possible resource error
+	if (status == CP_ERR_RESOURCE) {
+		cpi_error(context, N_("Plug-ins could not be installed due to insufficient system resources."));
+	}
+	
+	// Release the batch tables
+	if (batch_plugins != NULL) {
+		hash_free_nodes(batch_plugins);
+		hash_destroy(batch_plugins);
+	}
+	if (batch_ext_points != NULL) {
+		hash_free_nodes(batch_ext_points);
+		hash_destroy(batch_ext_points);
+	}
+	free(rps);
+	free(events);
+	cpi_unlock_context(context);
+
+	return status;
+}
+
 /**
  * Unresolves the plug-in runtime information.
  * 
@@ -252,14 +458,21 @@ static void unresolve_plugin_runtime(cp_plugin_t *plugin) {
 
 	// Destroy the plug-in instance, if necessary
 	if (plugin->context != NULL) {
-		plugin->context->env->in_destroy_func_invocation++;
+		cpi_atomic_add_int(&(plugin->context->env->in_destroy_func_invocation), 1);
 		plugin->runtime_funcs->destroy(plugin->plugin_data);
-		plugin->context->env->in_destroy_func_invocation--;
+		cpi_atomic_add_int(&(plugin->context->env->in_destroy_func_invocation), -1);
 		plugin->plugin_data = NULL;
 		cpi_free_context(plugin->context);
 		plugin->context = NULL;
 	}
 
+	// Forget the symbol exports which refer to the runtime library
+	if (plugin->exported_symbols != NULL) {
+		hash_free_nodes(plugin->exported_symbols);
+		hash_destroy(plugin->exported_symbols);
+		plugin->exported_symbols = NULL;
+	}
+
 	// Close plug-in runtime library	
 	plugin->runtime_funcs = NULL;
 	if (plugin->runtime_lib != NULL) {
@@ -268,6 +481,44 @@ static void unresolve_plugin_runtime(cp_plugin_t *plugin) {
 	}	
 }
 
+/**
+ * Indexes the symbol export table declared by the plug-in runtime. If a
+ * name is exported several times the first entry is used.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in whose runtime library has been loaded
+ * @return CP_OK (zero) on success or error code on failure
+ */
+static int index_plugin_exports(cp_context_t *context, cp_plugin_t *plugin) {
+	const cp_symbol_export_t *exports;
+	int i;
+	
+	exports = (const cp_symbol_export_t *) DLSYM(plugin->runtime_lib, plugin->plugin->runtime_exports_symbol);
+	if (exports == NULL) {
+		const char *error = DLERROR();
+		if (error == NULL) {
+			error = _("Unspecified error.");
+		}
+		cpi_errorf(context, N_("Plug-in %s symbol %s containing the symbol export table could not be resolved: %s"), plugin->plugin->identifier, plugin->plugin->runtime_exports_symbol, error);
+		return CP_ERR_RUNTIME;
+	}
+	if ((plugin->exported_symbols = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL)) == NULL) {
+		cpi_errorf(context, N_("Plug-in %s symbol exports could not be indexed due to insufficient memory."), plugin->plugin->identifier);
+		return CP_ERR_RESOURCE;
+	}
+	for (i = 0; exports[i].name != NULL; i++) {
+		if (exports[i].address == NULL
+			|| hash_lookup(plugin->exported_symbols, exports[i].name) != NULL) {
+			continue;
+		}
+		if (!hash_alloc_insert(plugin->exported_symbols, exports[i].name, exports[i].address)) {
+			cpi_errorf(context, N_("Plug-in %s symbol exports could not be indexed due to insufficient memory."), plugin->plugin->identifier);
+			return CP_ERR_RESOURCE;
+		}
+	}
+	return CP_OK;
+}
+
 /**
  * Loads and resolves the plug-in runtime library and initialization functions.
  * 
@@ -360,6 +611,18 @@ static int resolve_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 				break;
 			}
 		}
+		
+		// Index the declared symbol exports
+		if (plugin->plugin->runtime_exports_symbol != NULL
+			&& (status = index_plugin_exports(context, plugin)) != CP_OK) {
+			break;
+		}
+		
+		// Index the dynamic symbols of the runtime library, if enabled
+		if (context->env->index_runtime_symbols
+			&& (status = cpi_index_runtime_symbols(context, plugin)) != CP_OK) {
+			break;
+		}
 
 	} while (0);
 	
@@ -613,6 +876,49 @@ static int resolve_plugin(cp_context_t *context, cp_plugin_t *plugin) {
 	return status;
 }
 
+/**
+ * Prepares for calling a plug-in runtime function while starting or
+ * stopping the plug-in. Runtime functions of concurrently started or
+ * stopped plug-ins are called without holding the context lock. Their
+ * invocation is recorded in the plug-in rather than in the shared
+ * counter so that only calls made from the plug-in itself are rejected.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in
+ * @param counter the invocation counter of the runtime function
+ * @param concurrent whether the plug-in is being handled concurrently
+ */
+static void enter_runtime_func(cp_context_t *context, cp_plugin_t *plugin, int *counter, int concurrent) {
+	if (concurrent) {
+		if (!cpi_atomic_cas_ptr(&(plugin->job_invocation), NULL, counter)) {
+			assert(0);
+		}
+		cpi_unlock_context(context);
+	} else {
+		cpi_atomic_add_int(counter, 1);
+	}
+}
+
+/**
+ * Finishes calling a plug-in runtime function while starting or stopping
+ * the plug-in.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in
+ * @param counter the invocation counter of the runtime function
+ * @param concurrent whether the plug-in is being handled concurrently
+ */
+static void leave_runtime_func(cp_context_t *context, cp_plugin_t *plugin, int *counter, int concurrent) {
+	if (concurrent) {
+		cpi_lock_context(context);
+		if (!cpi_atomic_cas_ptr(&(plugin->job_invocation), counter, NULL)) {
+			assert(0);
+		}
+	} else {
+		cpi_atomic_add_int(counter, -1);
+	}
+}
+
 /**
  * Starts the plug-in runtime of the specified plug-in. This function does
  * not consider dependencies and assumes that the plug-in is resolved but
@@ -620,9 +926,10 @@ static int resolve_plugin(cp_context_t *context, cp_plugin_t *plugin) {
  * 
  * @param context the plug-in context
  * @param plugin the plug-in
+ * @param concurrent whether to call the runtime functions without the context lock
  * @return CP_OK (zero) on success or an error code on failure
  */
-static int start_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
+static int start_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin, int concurrent) {
 	cp_status_t status = CP_OK;
 	cpi_plugin_event_t event;
 	lnode_t *node = NULL;
@@ -645,9 +952,9 @@ static int start_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 				if ((plugin->context = cpi_new_context(plugin, context->env, &status)) == NULL) {
 					break;
 				}
-				context->env->in_create_func_invocation++;
+				enter_runtime_func(context, plugin, &(context->env->in_create_func_invocation), concurrent);
 				plugin->plugin_data = plugin->runtime_funcs->create(plugin->context);
-				context->env->in_create_func_invocation--;
+				leave_runtime_func(context, plugin, &(context->env->in_create_func_invocation), concurrent);
 				if (plugin->plugin_data == NULL) {
 					status = CP_ERR_RUNTIME;
 					break;
@@ -664,9 +971,9 @@ static int start_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 				cpi_deliver_event(context, &event);
 		
 				// Start the plug-in
-				context->env->in_start_func_invocation++;
+				enter_runtime_func(context, plugin, &(context->env->in_start_func_invocation), concurrent);
 				s = plugin->runtime_funcs->start(plugin->plugin_data);
-				context->env->in_start_func_invocation--;
+				leave_runtime_func(context, plugin, &(context->env->in_start_func_invocation), concurrent);
 
 				if (s != CP_OK) {
 			
@@ -679,15 +986,15 @@ static int start_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 						cpi_deliver_event(context, &event);
 					
 						// Call stop function
-						context->env->in_stop_func_invocation++;
+						enter_runtime_func(context, plugin, &(context->env->in_stop_func_invocation), concurrent);
 						plugin->runtime_funcs->stop(plugin->plugin_data);
-						context->env->in_stop_func_invocation--;
+						leave_runtime_func(context, plugin, &(context->env->in_stop_func_invocation), concurrent);
 					}
 				
 					// Destroy plug-in object
-					context->env->in_destroy_func_invocation++;
+					enter_runtime_func(context, plugin, &(context->env->in_destroy_func_invocation), concurrent);
 					plugin->runtime_funcs->destroy(plugin->plugin_data);
-					context->env->in_destroy_func_invocation--;
+					leave_runtime_func(context, plugin, &(context->env->in_destroy_func_invocation), concurrent);
 			
 					status = CP_ERR_RUNTIME;
 					break;
@@ -787,6 +1094,69 @@ static void warn_dependency_loop(cp_context_t *context, cp_plugin_t *plugin, lis
 	}
 }
 
+#ifdef CP_THREADS
+
+/**
+ * Returns the plug-in on whose behalf the calling thread is starting
+ * plug-ins during concurrent plug-in starts.
+ * 
+ * @param context the plug-in context
+ * @param importing stack of importing plug-ins
+ * @return the plug-in or NULL if not known
+ */
+static cp_plugin_t *current_job_owner(cp_context_t *context, list_t *importing) {
+	lnode_t *node;
+	
+	if ((node = list_last(importing)) != NULL) {
+		cp_plugin_t *p = lnode_get(node);
+		
+		if (p->job_state == CPI_JOB_RUNNING) {
+			return p->job_owner;
+		}
+	}
+	if (context->plugin != NULL
+		&& context->plugin->job_state == CPI_JOB_RUNNING) {
+		return context->plugin->job_owner;
+	}
+	return NULL;
+}
+
+/**
+ * Waits until another thread has finished starting or stopping the
+ * specified plug-in.
+ * Does not wait if the other thread is, directly or indirectly, waiting
+ * for the calling thread.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in being handled by another thread
+ * @param importing stack of importing plug-ins
+ * @return whether waited, or zero on a runtime dependency loop
+ */
+static int wait_plugin_job(cp_context_t *context, cp_plugin_t *plugin, list_t *importing) {
+	cp_plugin_t *owner = current_job_owner(context, importing);
+	
+	if (owner != NULL) {
+		cp_plugin_t *p = plugin->job_owner;
+		
+		while (p != NULL) {
+			if (p == owner) {
+				return 0;
+			}
+			p = (p->job_waiting_for != NULL ? p->job_waiting_for->job_owner : NULL);
+		}
+		owner->job_waiting_for = plugin;
+	}
+	while (plugin->job_state == CPI_JOB_RUNNING) {
+		cpi_wait_context(context);
+	}
+	if (owner != NULL) {
+		owner->job_waiting_for = NULL;
+	}
+	return 1;
+}
+
+#endif
+
 /**
  * Starts the specified plug-in and its dependencies.
  * 
@@ -798,6 +1168,20 @@ static void warn_dependency_loop(cp_context_t *context, cp_plugin_t *plugin, lis
 static int start_plugin_rec(cp_context_t *context, cp_plugin_t *plugin, list_t *importing) {
 	cp_status_t status = CP_OK;
 	lnode_t *node;
+#ifdef CP_THREADS
+	cp_plugin_t *owner = NULL;
+	int marked = 0;
+	
+	// Wait if another thread is starting or stopping the plug-in concurrently
+	while (plugin->job_state == CPI_JOB_RUNNING
+		&& plugin->state != CP_PLUGIN_ACTIVE
+		&& !cpi_ptrset_contains(importing, plugin)) {
+		if (!wait_plugin_job(context, plugin, importing)) {
+			warn_dependency_loop(context, plugin, importing, 1);
+			return CP_OK;
+		}
+	}
+#endif
 	
 	// Check if already started or starting
 	if (plugin->state == CP_PLUGIN_ACTIVE) {
@@ -813,29 +1197,54 @@ static int start_plugin_rec(cp_context_t *context, cp_plugin_t *plugin, list_t *
 		warn_dependency_loop(context, plugin, importing, 0);
 		return CP_OK;
 	}
+#ifdef CP_THREADS
+	
+	// Claim the plug-in from concurrent jobs, if any in progress
+	if (context->env->plugin_jobs > 0) {
+		owner = current_job_owner(context, importing);
+		if (plugin->job_state == 0) {
+			context->env->job_plugins++;
+		}
+		plugin->job_state = CPI_JOB_RUNNING;
+		plugin->job_owner = (owner != NULL ? owner : plugin);
+		marked = 1;
+	}
+#endif
 	if (!cpi_ptrset_add(importing, plugin)) {
 		cpi_errorf(context,
 			N_("Plug-in %s could not be started due to insufficient memory."),
 			plugin->plugin->identifier);
-		return CP_ERR_RESOURCE;
+		status = CP_ERR_RESOURCE;
 	}
 
 	// Start up dependencies
-	node = list_first(plugin->imported);
-	while (node != NULL) {
-		cp_plugin_t *ip = lnode_get(node);
-		
-		if ((status = start_plugin_rec(context, ip, importing)) != CP_OK) {
-			break;
+	if (status == CP_OK) {
+		node = list_first(plugin->imported);
+		while (node != NULL) {
+			cp_plugin_t *ip = lnode_get(node);
+			
+			if ((status = start_plugin_rec(context, ip, importing)) != CP_OK) {
+				break;
+			}
+			node = list_next(plugin->imported, node);
 		}
-		node = list_next(plugin->imported, node);
+		cpi_ptrset_remove(importing, plugin);
 	}
-	cpi_ptrset_remove(importing, plugin);
 	
 	// Start up this plug-in
 	if (status == CP_OK) {
-		status = start_plugin_runtime(context, plugin);
+		status = start_plugin_runtime(context, plugin, 0);
+	}
+#ifdef CP_THREADS
+	
+	// Release the plug-in for concurrent jobs
+	if (marked) {
+		plugin->job_state = 0;
+		plugin->job_owner = NULL;
+		context->env->job_plugins--;
+		cpi_signal_context(context);
 	}
+#endif
 
 	return status;
 }
@@ -887,8 +1296,9 @@ CP_C_API cp_status_t cp_start_plugin(cp_context_t *context, const char *id) {
  * 
  * @param context the plug-in context
  * @param plugin the plug-in
+ * @param concurrent whether to call the stop function without the context lock
  */
-static void stop_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
+static void stop_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin, int concurrent) {
 	cpi_plugin_event_t event;
 	
 	// Destroy plug-in instance
@@ -898,6 +1308,9 @@ static void stop_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 		// Wait until possible run functions have stopped
 		cpi_stop_plugin_run(plugin);
 
+		// Release the symbols of the plug-in from symbol caches
+		cpi_flush_symbol_caches(context, plugin);
+
 		// Stop the plug-in
 		if (plugin->runtime_funcs->stop != NULL) {
 
@@ -907,9 +1320,9 @@ static void stop_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 			cpi_deliver_event(context, &event);
 	
 			// Invoke stop function	
-			context->env->in_stop_func_invocation++;
+			enter_runtime_func(context, plugin, &(context->env->in_stop_func_invocation), concurrent);
 			plugin->runtime_funcs->stop(plugin->plugin_data);
-			context->env->in_stop_func_invocation--;
+			leave_runtime_func(context, plugin, &(context->env->in_stop_func_invocation), concurrent);
 
 		}
 
@@ -920,6 +1333,7 @@ static void stop_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 		cpi_unregister_plisteners(plugin->context->env->plugin_listeners, plugin);	
 
 		// Release resolved symbols
+		cpi_flush_symbol_cache(plugin->context, NULL);
 		if (plugin->context->resolved_symbols != NULL) {
 			while (!hash_isempty(plugin->context->resolved_symbols)) {
 				hscan_t scan;
@@ -929,7 +1343,7 @@ static void stop_plugin_runtime(cp_context_t *context, cp_plugin_t *plugin) {
 				hash_scan_begin(&scan, plugin->context->resolved_symbols);
 				node = hash_scan_next(&scan);
 				ptr = hnode_getkey(node);
-				cp_release_symbol(context, ptr);
+				cp_release_symbol(plugin->context, ptr);
 			}
 			assert(hash_isempty(plugin->context->resolved_symbols));
 		}
@@ -990,7 +1404,7 @@ static void stop_plugin_rec(cp_context_t *context, cp_plugin_t *plugin) {
 
 	// Stop this plug-in
 	assert(plugin->state == CP_PLUGIN_ACTIVE);
-	stop_plugin_runtime(context, plugin);
+	stop_plugin_runtime(context, plugin, 0);
 	assert(plugin->state < CP_PLUGIN_ACTIVE);
 	
 	// Clear processed flag
@@ -1002,6 +1416,19 @@ static void stop_plugin(cp_context_t *context, cp_plugin_t *plugin) {
 	assert_processed_zero(context);
 }
 
+/**
+ * Waits until no plug-ins are being started or stopped concurrently.
+ * 
+ * @param context the plug-in context
+ */
+static void wait_plugin_jobs(cp_context_t *context) {
+#ifdef CP_THREADS
+	while (context->env->job_plugins > 0) {
+		cpi_wait_context(context);
+	}
+#endif
+}
+
 CP_C_API cp_status_t cp_stop_plugin(cp_context_t *context, const char *id) {
 	hnode_t *node;
 	cp_plugin_t *plugin;
@@ -1013,6 +1440,7 @@ CP_C_API cp_status_t cp_stop_plugin(cp_context_t *context, const char *id) {
 	// Look up and stop the plug-in 
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	wait_plugin_jobs(context);
 	node = hash_lookup(context->env->plugins, id);
 	if (node != NULL) {
 		plugin = hnode_get(node);
@@ -1034,12 +1462,507 @@ CP_C_API void cp_stop_plugins(cp_context_t *context) {
 	// Stop the active plug-ins in the reverse order they were started 
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	wait_plugin_jobs(context);
 	while ((node = list_last(context->env->started_plugins)) != NULL) {
 		stop_plugin(context, lnode_get(node));
 	}
 	cpi_unlock_context(context);
 }
 
+#ifdef CP_THREADS
+
+/**
+ * Queues the specified plug-in and its inactive dependencies to be started
+ * by a concurrent start job. Plug-ins already queued or being started by
+ * any thread are skipped.
+ * 
+ * @param job the start job
+ * @param plugin the resolved plug-in
+ * @return CP_OK (zero) on success or an error code on failure
+ */
+static cp_status_t queue_plugin_start(plugin_job_t *job, cp_plugin_t *plugin) {
+	cp_status_t status = CP_OK;
+	lnode_t *node;
+	
+	if (plugin->state == CP_PLUGIN_ACTIVE || plugin->job_state != 0) {
+		return CP_OK;
+	}
+	if ((node = lnode_create(plugin)) == NULL) {
+		cpi_errorf(job->context,
+			N_("Plug-in %s could not be started due to insufficient memory."),
+			plugin->plugin->identifier);
+		return CP_ERR_RESOURCE;
+	}
+	list_append(job->plugins, node);
+	plugin->job_state = CPI_JOB_QUEUED;
+	job->context->env->job_plugins++;
+	
+	// Queue the imported plug-ins
+	node = list_first(plugin->imported);
+	while (node != NULL && status == CP_OK) {
+		status = queue_plugin_start(job, lnode_get(node));
+		node = list_next(plugin->imported, node);
+	}
+	return status;
+}
+
+/**
+ * Returns the next queued plug-in whose imported plug-ins are all active.
+ * Drops plug-ins already handled by other threads and plug-ins with an
+ * imported plug-in that failed to start.
+ * 
+ * @param job the start job
+ * @return the plug-in or NULL if none is currently startable
+ */
+static cp_plugin_t *next_startable_plugin(plugin_job_t *job) {
+	lnode_t *node = list_first(job->plugins);
+	
+	while (node != NULL) {
+		cp_plugin_t *plugin = lnode_get(node);
+		lnode_t *next = list_next(job->plugins, node);
+		
+		if (plugin->job_state == CPI_JOB_QUEUED) {
+			int ready = 1;
+			int failed = 0;
+			lnode_t *inode = list_first(plugin->imported);
+			
+			while (inode != NULL && !failed) {
+				cp_plugin_t *ip = lnode_get(inode);
+				
+				if (ip != plugin && ip->state != CP_PLUGIN_ACTIVE) {
+					ready = 0;
+					failed = (ip->job_state == 0);
+				}
+				inode = list_next(plugin->imported, inode);
+			}
+			if (failed) {
+				cpi_errorf(job->context,
+					N_("Plug-in %s could not be started because an imported plug-in could not be started."),
+					plugin->plugin->identifier);
+				if (job->status == CP_OK) {
+					job->status = CP_ERR_DEPENDENCY;
+				}
+				plugin->job_state = 0;
+				job->context->env->job_plugins--;
+			} else if (ready) {
+				return plugin;
+			}
+		}
+		if (plugin->job_state == 0) {
+			list_delete(job->plugins, node);
+			lnode_destroy(node);
+		}
+		node = next;
+	}
+	return NULL;
+}
+
+/**
+ * Queues the active plug-ins to be stopped by a concurrent stop job.
+ * Plug-ins already queued or being handled by any thread are skipped.
+ * 
+ * @param job the stop job
+ */
+static void queue_plugin_stops(plugin_job_t *job) {
+	list_t *started = job->context->env->started_plugins;
+	lnode_t *node;
+	
+	for (node = list_first(started); node != NULL; node = list_next(started, node)) {
+		cp_plugin_t *plugin = lnode_get(node);
+		lnode_t *jnode;
+		
+		if (plugin->job_state != 0) {
+			continue;
+		}
+		if ((jnode = lnode_create(plugin)) == NULL) {
+			cpi_error(job->context, N_("Plug-ins could not be stopped concurrently due to insufficient memory."));
+			return;
+		}
+		list_append(job->plugins, jnode);
+		plugin->job_state = CPI_JOB_QUEUED;
+		job->context->env->job_plugins++;
+	}
+}
+
+/**
+ * Returns the next queued plug-in whose importing plug-ins have all been
+ * stopped. Drops plug-ins already stopped by other threads.
+ * 
+ * @param job the stop job
+ * @return the plug-in or NULL if none is currently stoppable
+ */
+static cp_plugin_t *next_stoppable_plugin(plugin_job_t *job) {
+	lnode_t *node = list_first(job->plugins);
+	
+	while (node != NULL) {
+		cp_plugin_t *plugin = lnode_get(node);
+		lnode_t *next = list_next(job->plugins, node);
+		
+		if (plugin->job_state == CPI_JOB_QUEUED) {
+			if (plugin->state == CP_PLUGIN_ACTIVE) {
+				int ready = 1;
+				lnode_t *inode = list_first(plugin->importing);
+				
+				while (inode != NULL && ready) {
+					cp_plugin_t *ip = lnode_get(inode);
+					
+					ready = (ip == plugin || ip->state <= CP_PLUGIN_RESOLVED);
+					inode = list_next(plugin->importing, inode);
+				}
+				if (ready) {
+					return plugin;
+				}
+			} else {
+				plugin->job_state = 0;
+				job->context->env->job_plugins--;
+			}
+		}
+		if (plugin->job_state == 0) {
+			list_delete(job->plugins, node);
+			lnode_destroy(node);
+		}
+		node = next;
+	}
+	return NULL;
+}
+
+/**
+ * Starts or stops queued plug-ins as they become ready until no more
+ * plug-ins can be handled. Must be called holding the context lock.
+ * 
+ * @param job the start or stop job
+ */
+static void run_plugin_job(plugin_job_t *job) {
+	cp_context_t *context = job->context;
+	
+	while (1) {
+		cp_plugin_t *plugin = (job->stop ? next_stoppable_plugin(job) : next_startable_plugin(job));
+		
+		if (plugin != NULL) {
+			cp_status_t status;
+			
+			plugin->job_state = CPI_JOB_RUNNING;
+			plugin->job_owner = plugin;
+			job->num_running++;
+			if (job->stop) {
+				stop_plugin_runtime(context, plugin, 1);
+			} else if ((status = start_plugin_runtime(context, plugin, 1)) != CP_OK
+				&& job->status == CP_OK) {
+				job->status = status;
+			}
+			job->num_running--;
+			plugin->job_state = 0;
+			plugin->job_owner = NULL;
+			context->env->job_plugins--;
+			cpi_signal_context(context);
+		} else if (job->num_running == 0) {
+			break;
+		} else {
+			cpi_wait_context(context);
+		}
+	}
+}
+
+/**
+ * Worker thread of a concurrent start or stop job.
+ * 
+ * @param arg the job
+ */
+static void plugin_job_worker(void *arg) {
+	plugin_job_t *job = arg;
+	
+	cpi_lock_context(job->context);
+	run_plugin_job(job);
+	job->num_workers--;
+	cpi_signal_context(job->context);
+	cpi_unlock_context(job->context);
+}
+
+/**
+ * Runs a concurrent job using a bounded pool of worker threads. The
+ * calling thread participates in the job. Returns when no more plug-ins
+ * of the job can be handled and all the workers have finished.
+ * 
+ * @param job the start or stop job
+ * @param max_threads the maximum number of threads, including the calling thread
+ */
+static void run_plugin_job_threads(plugin_job_t *job, int max_threads) {
+	cpi_thread_t **threads = NULL;
+	int num_threads = 0;
+	int i;
+	
+	// Start the worker threads
+	if (max_threads > (int) list_count(job->plugins)) {
+		max_threads = list_count(job->plugins);
+	}
+	if (max_threads > 1
+		&& (threads = malloc((max_threads - 1) * sizeof(cpi_thread_t *))) != NULL) {
+		for (num_threads = 0; num_threads < max_threads - 1; num_threads++) {
+			job->num_workers++;
+			if ((threads[num_threads] = cpi_create_thread(plugin_job_worker, job)) == NULL) {
+				job->num_workers--;
+				break;
+			}
+		}
+	}
+	
+	// Work in this thread as well and wait for the workers
+	run_plugin_job(job);
+	while (job->num_workers > 0) {
+		cpi_wait_context(job->context);
+	}
+	for (i = 0; i < num_threads; i++) {
+		cpi_join_thread(threads[i]);
+	}
+	if (threads != NULL) {
+		free(threads);
+	}
+}
+
+/**
+ * Releases the plug-ins still queued after running a job so that they can
+ * be handled serially. Only the released plug-ins are left in the job.
+ * 
+ * @param job the start or stop job
+ */
+static void release_remaining_plugins(plugin_job_t *job) {
+	lnode_t *node = list_first(job->plugins);
+	
+	while (node != NULL) {
+		cp_plugin_t *plugin = lnode_get(node);
+		lnode_t *next = list_next(job->plugins, node);
+		
+		if (plugin->job_state == CPI_JOB_QUEUED) {
+			plugin->job_state = 0;
+			job->context->env->job_plugins--;
+		} else {
+			list_delete(job->plugins, node);
+			lnode_destroy(node);
+		}
+		node = next;
+	}
+}
+
+/**
+ * Starts the specified plug-ins and their dependencies using a bounded
+ * pool of worker threads. A plug-in is started once all the plug-ins it
+ * imports are active, so independent plug-ins are started concurrently.
+ * The calling thread participates in starting the plug-ins. Plug-ins in
+ * static dependency loops are finally started serially.
+ * 
+ * @param context the plug-in context
+ * @param plugins the plug-ins to be started
+ * @param max_threads the maximum number of threads, including the calling thread
+ * @return CP_OK (zero) on success or an error code on failure
+ */
+static cp_status_t start_plugins_concurrently(cp_context_t *context, list_t *plugins, int max_threads) {
+	plugin_job_t job;
+	lnode_t *node;
+	
+	memset(&job, 0, sizeof(job));
+	job.context = context;
+	job.status = CP_OK;
+	context->env->plugin_jobs++;
+	do {
+		
+		// Resolve the plug-ins and queue them with their dependencies
+		if ((job.plugins = list_create(LISTCOUNT_T_MAX)) == NULL) {
+			cpi_error(context, N_("Plug-ins could not be started due to insufficient memory."));
+			job.status = CP_ERR_RESOURCE;
+			break;
+		}
+		node = list_first(plugins);
+		while (node != NULL) {
+			cp_plugin_t *plugin = lnode_get(node);
+			cp_status_t status;
+			
+			if (((status = resolve_plugin(context, plugin)) != CP_OK
+				|| (status = queue_plugin_start(&job, plugin)) != CP_OK)
+				&& job.status == CP_OK) {
+				job.status = status;
+			}
+			node = list_next(plugins, node);
+		}
+		
+		// Start the plug-ins as their imports become active
+		run_plugin_job_threads(&job, max_threads);
+		
+		// Start the remaining plug-ins serially
+		release_remaining_plugins(&job);
+		while ((node = list_first(job.plugins)) != NULL) {
+			cp_plugin_t *plugin = lnode_get(node);
+			cp_status_t status;
+			
+			list_delete(job.plugins, node);
+			lnode_destroy(node);
+			if ((status = cpi_start_plugin(context, plugin)) != CP_OK
+				&& job.status == CP_OK) {
+				job.status = status;
+			}
+		}
+		
+	} while (0);
+	
+	// Release resources
+	context->env->plugin_jobs--;
+	cpi_signal_context(context);
+	if (job.plugins != NULL) {
+		assert(list_isempty(job.plugins));
+		list_destroy(job.plugins);
+	}
+	
+	return job.status;
+}
+
+/**
+ * Stops the active plug-ins using a bounded pool of worker threads. A
+ * plug-in is stopped once all the plug-ins importing it have stopped, so
+ * the plug-ins are stopped in waves starting from the leaves of the
+ * dependency graph. Plug-ins in dependency loops are left active.
+ * 
+ * @param context the plug-in context
+ * @param max_threads the maximum number of threads, including the calling thread
+ */
+static void stop_plugins_concurrently(cp_context_t *context, int max_threads) {
+	plugin_job_t job;
+	
+	memset(&job, 0, sizeof(job));
+	job.context = context;
+	job.stop = 1;
+	job.status = CP_OK;
+	context->env->plugin_jobs++;
+	if ((job.plugins = list_create(LISTCOUNT_T_MAX)) != NULL) {
+		queue_plugin_stops(&job);
+		run_plugin_job_threads(&job, max_threads);
+		release_remaining_plugins(&job);
+		list_destroy_nodes(job.plugins);
+		list_destroy(job.plugins);
+	} else {
+		cpi_error(context, N_("Plug-ins could not be stopped concurrently due to insufficient memory."));
+	}
+	context->env->plugin_jobs--;
+	cpi_signal_context(context);
+}
+
+#endif
+
+CP_C_API cp_status_t cp_start_plugins_mt(cp_context_t *context, const char * const *ids, int num_ids, int num_threads) {
+	cp_status_t status = CP_OK;
+	list_t *plugins = NULL;
+	lnode_t *node;
+	int started = 0;
+	int i;
+	
+	CHECK_NOT_NULL(context);
+	if (num_ids > 0) {
+		CHECK_NOT_NULL(ids);
+	}
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	do {
+		
+		// Look up the plug-ins to be started
+		if ((plugins = list_create(LISTCOUNT_T_MAX)) == NULL) {
+			cpi_error(context, N_("Plug-ins could not be started due to insufficient memory."));
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		if (ids == NULL) {
+			hscan_t scan;
+			hnode_t *hnode;
+			
+			hash_scan_begin(&scan, context->env->plugins);
+			while ((hnode = hash_scan_next(&scan)) != NULL) {
+				if ((node = lnode_create(hnode_get(hnode))) == NULL) {
+					status = CP_ERR_RESOURCE;
+					break;
+				}
+				list_append(plugins, node);
+			}
+		} else {
+			for (i = 0; i < num_ids && status != CP_ERR_RESOURCE; i++) {
+				hnode_t *hnode = hash_lookup(context->env->plugins, ids[i]);
+				
+				if (hnode == NULL) {
+					cpi_warnf(context, N_("Unknown plug-in %s could not be started."), ids[i]);
+					if (status == CP_OK) {
+						status = CP_ERR_UNKNOWN;
+					}
+				} else if (!cpi_ptrset_add(plugins, hnode_get(hnode))) {
+					status = CP_ERR_RESOURCE;
+				}
+			}
+		}
+		if (status == CP_ERR_RESOURCE) {
+			cpi_error(context, N_("Plug-ins could not be started due to insufficient memory."));
+			break;
+		}
+		
+		// Start the plug-ins
+#ifdef CP_THREADS
+		if (num_threads > 1) {
+			cp_status_t s = start_plugins_concurrently(context, plugins, num_threads);
+			
+			if (status == CP_OK) {
+				status = s;
+			}
+			started = 1;
+		}
+#endif
+		if (!started) {
+			node = list_first(plugins);
+			while (node != NULL) {
+				cp_status_t s = cpi_start_plugin(context, lnode_get(node));
+				
+				if (status == CP_OK) {
+					status = s;
+				}
+				node = list_next(plugins, node);
+			}
+		}
+		
+	} while (0);
+	cpi_unlock_context(context);
+	
+	// Release resources
+	if (plugins != NULL) {
+		list_destroy_nodes(plugins);
+		list_destroy(plugins);
+	}
+	
+	return status;
+}
+
+/**
+ * Stops all active plug-ins concurrently and then stops any remaining
+ * plug-ins serially. The caller must hold the context lock exactly once
+ * because the lock is released only once while the stop functions are
+ * called, and the worker threads need it to make progress.
+ * 
+ * @param context the plug-in context
+ * @param num_threads the maximum number of threads, including the calling thread
+ */
+static void stop_plugins_mt(cp_context_t *context, int num_threads) {
+	assert(cpi_is_context_locked(context));
+	wait_plugin_jobs(context);
+#ifdef CP_THREADS
+	if (num_threads > 1) {
+		stop_plugins_concurrently(context, num_threads);
+	}
+#endif
+	cp_stop_plugins(context);
+}
+
+CP_C_API void cp_stop_plugins_mt(cp_context_t *context, int num_threads) {
+	CHECK_NOT_NULL(context);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	stop_plugins_mt(context, num_threads);
+	cpi_unlock_context(context);
+}
+
 static void unresolve_plugin_rec(cp_context_t *context, cp_plugin_t *plugin) {
 	lnode_t *node;
 	cpi_plugin_event_t event;
@@ -1086,75 +2009,6 @@ static void unresolve_plugin(cp_context_t *context, cp_plugin_t *plugin) {
 	unresolve_plugin_rec(context, plugin);
 }
 
-static void free_plugin_import_content(cp_plugin_import_t *import) {
-	assert(import != NULL);
-	free(import->plugin_id);
-	free(import->version);
-}
-
-static void free_ext_point_content(cp_ext_point_t *ext_point) {
-	free(ext_point->name);
-	free(ext_point->local_id);
-	free(ext_point->identifier);
-	free(ext_point->schema_path);
-}
-
-static void free_extension_content(cp_extension_t *extension) {
-	free(extension->name);
-	free(extension->local_id);
-	free(extension->identifier);
-	free(extension->ext_point_id);
-}
-
-static void free_cfg_element_content(cp_cfg_element_t *ce) {
-	int i;
-
-	assert(ce != NULL);
-	free(ce->name);
-	if (ce->atts != NULL) {
-		free(ce->atts[0]);
-		free(ce->atts);
-	}
-	free(ce->value);
-	for (i = 0; i < ce->num_children; i++) {
-		free_cfg_element_content(ce->children + i);
-	}
-	free(ce->children);
-}
-
-CP_HIDDEN void cpi_free_plugin(cp_plugin_info_t *plugin) {
-	int i;
-	
-	assert(plugin != NULL);
-	free(plugin->name);
-	free(plugin->identifier);
-	free(plugin->version);
-	free(plugin->provider_name);
-	free(plugin->plugin_path);
-	free(plugin->abi_bw_compatibility);
-	free(plugin->api_bw_compatibility);
-	free(plugin->req_cpluff_version);
-	for (i = 0; i < plugin->num_imports; i++) {
-		free_plugin_import_content(plugin->imports + i);
-	}
-	free(plugin->imports);
-	free(plugin->runtime_lib_name);
-	free(plugin->runtime_funcs_symbol);
-	for (i = 0; i < plugin->num_ext_points; i++) {
-		free_ext_point_content(plugin->ext_points + i);
-	}
-	free(plugin->ext_points);
-	for (i = 0; i < plugin->num_extensions; i++) {
-		free_extension_content(plugin->extensions + i);
-		if (plugin->extensions[i].configuration != NULL) {
-			free_cfg_element_content(plugin->extensions[i].configuration);
-			free(plugin->extensions[i].configuration);
-		}
-	}
-	free(plugin->extensions);
-	free(plugin);
-}
-
 /**
  * Frees any memory allocated for a registered plug-in.
  * 
@@ -1183,8 +2037,9 @@ static void free_registered_plugin(cp_context_t *context, cp_plugin_t *plugin) {
  * 
  * @param context the plug-in context
  * @param node the hash node of the plug-in to be uninstalled
+ * @param scanning whether the plug-in hash is being scanned
  */
-static void uninstall_plugin(cp_context_t *context, hnode_t *node) {
+static void uninstall_plugin(cp_context_t *context, hnode_t *node, int scanning) {
 	cp_plugin_t *plugin;
 	cpi_plugin_event_t event;
 	
@@ -1209,7 +2064,12 @@ static void uninstall_plugin(cp_context_t *context, hnode_t *node) {
 	unregister_extensions(context, plugin->plugin);
 
 	// Unregister the plug-in 
-	hash_delete_free(context->env->plugins, node);
+	if (scanning) {
+		hash_scan_delfree(context->env->plugins, node);
+	} else {
+		hash_delete_free(context->env->plugins, node);
+	}
+	cpi_invalidate_registry(context);
 	
 	// If the plug-in was loaded using loaders, remove it from loader maps
 	if (plugin->loader != NULL) {
@@ -1237,9 +2097,10 @@ CP_C_API cp_status_t cp_uninstall_plugin(cp_context_t *context, const char *id)
 	// Look up and unload the plug-in 
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	wait_plugin_jobs(context);
 	node = hash_lookup(context->env->plugins, id);
 	if (node != NULL) {
-		uninstall_plugin(context, node);
+		uninstall_plugin(context, node, 0);
 	} else {
 		cpi_warnf(context, N_("Unknown plug-in %s could not be uninstalled."), id);
 		status = CP_ERR_UNKNOWN;
@@ -1258,14 +2119,21 @@ CP_C_API void cp_uninstall_plugins(cp_context_t *context) {
 	
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	wait_plugin_jobs(context);
 	cp_stop_plugins(context);
-	while (1) {
-		hash_scan_begin(&scan, context->env->plugins);
-		if ((node = hash_scan_next(&scan)) != NULL) {
-			uninstall_plugin(context, node);
-		} else {
-			break;
-		}
+	hash_scan_begin(&scan, context->env->plugins);
+	while ((node = hash_scan_next(&scan)) != NULL) {
+		uninstall_plugin(context, node, 1);
 	}
 	cpi_unlock_context(context);
 }
+
+CP_C_API void cp_uninstall_plugins_mt(cp_context_t *context, int num_threads) {
+	CHECK_NOT_NULL(context);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	stop_plugins_mt(context, num_threads);
+	cp_uninstall_plugins(context);
+	cpi_unlock_context(context);
+}
@@ -34,6 +34,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <expat.h>
@@ -60,8 +61,9 @@
 /// Initial configuration element value size 
 #define CP_CFG_ELEMENT_VALUE_INITSIZE 64
 
-/// Plugin descriptor name 
-#define CP_PLUGIN_DESCRIPTOR "plugin.xml"
+/// Returns the arena allocated plug-in information of plug-in information
+#define ARENA_PLUGIN_INFO(plugin) ((arena_plugin_info_t *) (((char *) (plugin)) - offsetof(arena_plugin_info_t, plugin)))
+
 
 
 /* ------------------------------------------------------------------------
@@ -70,6 +72,20 @@
 
 typedef struct ploader_context_t ploader_context_t;
 
+/// Plug-in information allocated from the arena holding all its data
+typedef struct arena_plugin_info_t {
+	
+	/// The arena holding the plug-in information
+	cpi_arena_t *arena;
+	
+	/// The information header, immediately preceding the plug-in information
+	cpi_info_header_t header;
+	
+	/// The plug-in information
+	cp_plugin_info_t plugin;
+	
+} arena_plugin_info_t;
+
 /// Parser states 
 typedef enum parser_state_t {
 	PARSER_BEGIN,
@@ -87,12 +103,18 @@ struct ploader_context_t {
 	/// The plug-in context, or NULL if none
 	cp_context_t *context;
 
+	/// Deferred log messages, or NULL if logging directly
+	list_t *log;
+
 	/// The XML parser being used 
 	XML_Parser parser;
 	
 	/// The file being parsed 
 	char *file;
 	
+	/// The arena from which the plug-in information is allocated
+	cpi_arena_t *arena;
+	
 	/// The plug-in being constructed 
 	cp_plugin_info_t *plugin;
 	
@@ -143,6 +165,34 @@ struct ploader_context_t {
  * Function definitions
  * ----------------------------------------------------------------------*/
 
+/**
+ * Logs a message related to descriptor loading. The message is either
+ * logged directly, locking the context for the duration of the call, or
+ * appended to the specified list of deferred log messages.
+ * 
+ * @param context the plug-in context
+ * @param log the list of deferred log messages or NULL to log directly
+ * @param severity the severity of the message
+ * @param msg the localized message format
+ * @param ... the message parameters
+ */
+static void descriptor_logf(cp_context_t *context, list_t *log,
+	cp_log_severity_t severity, const char *msg, ...) {
+	va_list ap;
+
+	va_start(ap, msg);
+	if (log != NULL) {
+		cpi_deferred_vlogf(log, severity, msg, ap);
+	} else {
+		cpi_lock_context(context);
+		if (cpi_is_logged(context, severity)) {
+			cpi_vlogf(context, severity, msg, ap);
+		}
+		cpi_unlock_context(context);
+	}
+	va_end(ap);
+}
+
 /**
  * Reports a descriptor error. Does not set the parser to error state but
  * increments the error count, unless this is merely a warning.
@@ -162,14 +212,14 @@ static void descriptor_errorf(ploader_context_t *plcontext, int warn,
 	va_end(ap);
 	message[127] = '\0';
 	if (warn) {
-		cpi_warnf(plcontext->context,
+		descriptor_logf(plcontext->context, plcontext->log, CP_LOG_WARNING,
 			N_("Suspicious plug-in descriptor content in %s, line %d, column %d (%s)."),
 		plcontext->file,
 		(int) XML_GetCurrentLineNumber(plcontext->parser),
 		(int) (XML_GetCurrentColumnNumber(plcontext->parser) + 1),
 		message);
 	} else {				
-		cpi_errorf(plcontext->context,
+		descriptor_logf(plcontext->context, plcontext->log, CP_LOG_ERROR,
 			N_("Invalid plug-in descriptor content in %s, line %d, column %d (%s)."),
 			plcontext->file,
 			(int) XML_GetCurrentLineNumber(plcontext->parser),
@@ -189,7 +239,7 @@ static void descriptor_errorf(ploader_context_t *plcontext, int warn,
  */
 static void resource_error(ploader_context_t *plcontext) {
 	if (plcontext->resource_error_count == 0) {
-		cpi_errorf(plcontext->context,
+		descriptor_logf(plcontext->context, plcontext->log, CP_LOG_ERROR,
 			N_("Insufficient system resources to parse plug-in descriptor content in %s, line %d, column %d."),
 			plcontext->file,
 			(int) XML_GetCurrentLineNumber(plcontext->parser),
@@ -293,8 +343,8 @@ static int check_attributes(ploader_context_t *plcontext,
 }
 
 /**
- * Allocates memory using malloc. Reports a resource error if there is not
- * enough available memory.
+ * Allocates memory from the plug-in arena. Reports a resource error if
+ * there is not enough available memory.
  * 
  * @param context the parsing context
  * @param size the number of bytes to allocate
@@ -303,15 +353,35 @@ static int check_attributes(ploader_context_t *plcontext,
 static void *parser_malloc(ploader_context_t *plcontext, size_t size) {
 	void *ptr;
 
-	if ((ptr = malloc(size)) == NULL) {
+	if ((ptr = cpi_arena_alloc(plcontext->arena, size)) == NULL) {
 		resource_error(plcontext);
 	}
 	return ptr;
 }
 
 /**
- * Makes a copy of the specified string. The memory is allocated using malloc.
- * Reports a resource error if there is not enough available memory.
+ * Resizes memory allocated from the plug-in arena. Reports a resource
+ * error if there is not enough available memory.
+ * 
+ * @param context the parsing context
+ * @param ptr the memory to be resized, or NULL
+ * @param old_size the current size of the memory
+ * @param new_size the requested size of the memory
+ * @return pointer to the resized memory, or NULL if memory allocation failed
+ */
+static void *parser_realloc(ploader_context_t *plcontext, void *ptr, size_t old_size, size_t new_size) {
+	void *np;
+	
+	if ((np = cpi_arena_realloc(plcontext->arena, ptr, old_size, new_size)) == NULL) {
+		resource_error(plcontext);
+	}
+	return np;
+}
+
+/**
+ * Makes a copy of the specified string. The memory is allocated from the
+ * plug-in arena. Reports a resource error if there is not enough available
+ * memory.
  * 
  * @param context the parsing context
  * @param src the source string to be copied
@@ -320,7 +390,7 @@ static void *parser_malloc(ploader_context_t *plcontext, size_t size) {
 static char *parser_strdup(ploader_context_t *plcontext, const char *src) {
 	char *dup;
 
-	if ((dup = strdup(src)) == NULL) {
+	if ((dup = cpi_arena_strdup(plcontext->arena, src)) == NULL) {
 		resource_error(plcontext);
 	}
 	return dup;
@@ -328,7 +398,7 @@ static char *parser_strdup(ploader_context_t *plcontext, const char *src) {
 
 /**
  * Concatenates the specified strings into a new string. The memory for the concatenated
- * string is allocated using malloc. Reports a resource error if there is not
+ * string is allocated from the plug-in arena. Reports a resource error if there is not
  * enough available memory.
  * 
  * @param context the parsing context
@@ -418,15 +488,13 @@ static char **parser_attsdup(ploader_context_t *plcontext, const XML_Char * cons
 		}
 	}
 	
-	// If successful then return duplicates, otherwise free any allocations 
+	// If successful then return duplicates, the arena keeps any partial allocations 
 	if (num == 0 || (atts != NULL && attr_data != NULL)) {
 		if (num_atts != NULL) {
 			*num_atts = num / 2;
 		}
 		return atts;
 	} else {
-		free(attr_data);
-		free(atts);
 		return NULL;
 	}
 }
@@ -455,6 +523,24 @@ static void init_cfg_element(ploader_context_t *plcontext, cp_cfg_element_t *ce,
 	ce->children = NULL;	
 }
 
+/**
+ * Updates the parent pointers of the grandchildren of a configuration
+ * element after its children have been moved in memory.
+ * 
+ * @param ce the configuration element whose children were moved
+ */
+static void relink_cfg_children(cp_cfg_element_t *ce) {
+	unsigned int i, j;
+	
+	for (i = 0; i < ce->num_children; i++) {
+		cp_cfg_element_t *child = ce->children + i;
+		
+		for (j = 0; j < child->num_children; j++) {
+			child->children[j].parent = child;
+		}
+	}
+}
+
 /**
  * Processes the character data while parsing.
  * 
@@ -495,11 +581,11 @@ static void CP_XMLCALL character_data_handler(
 				ns = 2 * ns;
 			}
 		}
-		if ((nv = realloc(plcontext->value, ns * sizeof(char))) != NULL) {
+		if ((nv = parser_realloc(plcontext, plcontext->value,
+				plcontext->value_size * sizeof(char), ns * sizeof(char))) != NULL) {
 			plcontext->value = nv;
 			plcontext->value_size = ns;
 		} else {
-			resource_error(plcontext);
 			return;
 		}
 	}
@@ -527,7 +613,7 @@ static void CP_XMLCALL start_element_handler(
 	static const XML_Char * const req_import_atts[] = { "plugin", NULL };
 	static const XML_Char * const opt_import_atts[] = { "version", "optional", NULL };
 	static const XML_Char * const req_runtime_atts[] = { "library", NULL };
-	static const XML_Char * const opt_runtime_atts[] = { "funcs", NULL };
+	static const XML_Char * const opt_runtime_atts[] = { "funcs", "exports", NULL };
 	static const XML_Char * const req_ext_point_atts[] = { "id", NULL };
 	static const XML_Char * const opt_ext_point_atts[] = { "name", "schema", NULL };
 	static const XML_Char * const req_extension_atts[] = { "point", NULL };
@@ -589,6 +675,9 @@ static void CP_XMLCALL start_element_handler(
 						} else if (!strcmp(atts[i], "funcs")) {
 							plcontext->plugin->runtime_funcs_symbol
 								= parser_strdup(plcontext, atts[i+1]);
+						} else if (!strcmp(atts[i], "exports")) {
+							plcontext->plugin->runtime_exports_symbol
+								= parser_strdup(plcontext, atts[i+1]);
 						}
 					}
 				}
@@ -607,9 +696,9 @@ static void CP_XMLCALL start_element_handler(
 						} else {
 							ns = plcontext->ext_points_size * 2;
 						}
-						if ((nep = realloc(plcontext->plugin->ext_points,
+						if ((nep = parser_realloc(plcontext, plcontext->plugin->ext_points,
+								plcontext->ext_points_size * sizeof(cp_ext_point_t),
 								ns * sizeof(cp_ext_point_t))) == NULL) {
-							resource_error(plcontext);
 							break;
 						}
 						plcontext->plugin->ext_points = nep;
@@ -660,9 +749,9 @@ static void CP_XMLCALL start_element_handler(
 						} else {
 							ns = plcontext->extensions_size * 2;
 						}
-						if ((ne = realloc(plcontext->plugin->extensions,
+						if ((ne = parser_realloc(plcontext, plcontext->plugin->extensions,
+								plcontext->extensions_size * sizeof(cp_extension_t),
 								ns * sizeof(cp_extension_t))) == NULL) {
-							resource_error(plcontext);
 							break;
 						}
 						plcontext->plugin->extensions = ne;
@@ -733,9 +822,9 @@ static void CP_XMLCALL start_element_handler(
 						} else {
 							ns = plcontext->imports_size * 2;
 						}
-						if ((ni = realloc(plcontext->plugin->imports,
+						if ((ni = parser_realloc(plcontext, plcontext->plugin->imports,
+								plcontext->imports_size * sizeof(cp_plugin_import_t),
 								ns * sizeof(cp_plugin_import_t))) == NULL) {
-							resource_error(plcontext);
 							break;
 						}
 						plcontext->plugin->imports = ni;
@@ -786,13 +875,16 @@ static void CP_XMLCALL start_element_handler(
 					} else {
 						ns = plcontext->configuration->index * 2;
 					}
-					if ((nce = realloc(plcontext->configuration->children,
+					if ((nce = parser_realloc(plcontext, plcontext->configuration->children,
+							plcontext->configuration->index * sizeof(cp_cfg_element_t),
 							ns * sizeof(cp_cfg_element_t))) == NULL) {
 						plcontext->skippedCEs++;
-						resource_error(plcontext);
 						break;
 					}
-					plcontext->configuration->children = nce;
+					if (nce != plcontext->configuration->children) {
+						plcontext->configuration->children = nce;
+						relink_cfg_children(plcontext->configuration);
+					}
 					plcontext->configuration->index = ns;
 				}
 				
@@ -838,10 +930,10 @@ static void CP_XMLCALL end_element_handler(
 				if (plcontext->ext_points_size != plcontext->plugin->num_ext_points) {
 					cp_ext_point_t *nep;
 					
-					if ((nep = realloc(plcontext->plugin->ext_points,
+					if ((nep = cpi_arena_realloc(plcontext->arena, plcontext->plugin->ext_points,
+							plcontext->ext_points_size * sizeof(cp_ext_point_t),
 							plcontext->plugin->num_ext_points *
-								sizeof(cp_ext_point_t))) != NULL
-						|| plcontext->plugin->num_ext_points == 0) {
+								sizeof(cp_ext_point_t))) != NULL) {
 						plcontext->plugin->ext_points = nep;
 						plcontext->ext_points_size = plcontext->plugin->num_ext_points;
 					}
@@ -851,10 +943,10 @@ static void CP_XMLCALL end_element_handler(
 				if (plcontext->extensions_size != plcontext->plugin->num_extensions) {
 					cp_extension_t *ne;
 					
-					if ((ne = realloc(plcontext->plugin->extensions,
+					if ((ne = cpi_arena_realloc(plcontext->arena, plcontext->plugin->extensions,
+							plcontext->extensions_size * sizeof(cp_extension_t),
 							plcontext->plugin->num_extensions *
-								sizeof(cp_extension_t))) != NULL
-						|| plcontext->plugin->num_extensions == 0) {
+								sizeof(cp_extension_t))) != NULL) {
 						plcontext->plugin->extensions = ne;
 						plcontext->extensions_size = plcontext->plugin->num_extensions;
 					}					
@@ -871,10 +963,10 @@ static void CP_XMLCALL end_element_handler(
 				if (plcontext->imports_size != plcontext->plugin->num_imports) {
 					cp_plugin_import_t *ni;
 					
-					if ((ni = realloc(plcontext->plugin->imports,
+					if ((ni = cpi_arena_realloc(plcontext->arena, plcontext->plugin->imports,
+							plcontext->imports_size * sizeof(cp_plugin_import_t),
 							plcontext->plugin->num_imports *
-								sizeof(cp_plugin_import_t))) != NULL
-						|| plcontext->plugin->num_imports == 0) {
+								sizeof(cp_plugin_import_t))) != NULL) {
 						plcontext->plugin->imports = ni;
 						plcontext->imports_size = plcontext->plugin->num_imports;
 					}
@@ -899,11 +991,13 @@ static void CP_XMLCALL end_element_handler(
 				if (plcontext->configuration->index != plcontext->configuration->num_children) {
 					cp_cfg_element_t *nce;
 					
-					if ((nce = realloc(plcontext->configuration->children,
+					if ((nce = cpi_arena_realloc(plcontext->arena, plcontext->configuration->children,
+							plcontext->configuration->index * sizeof(cp_cfg_element_t),
 							plcontext->configuration->num_children *
 								sizeof(cp_cfg_element_t))) != NULL
-						|| plcontext->configuration->num_children == 0) {
+						&& nce != plcontext->configuration->children) {
 						plcontext->configuration->children = nce;
+						relink_cfg_children(plcontext->configuration);
 					}
 				}
 				
@@ -923,7 +1017,6 @@ static void CP_XMLCALL end_element_handler(
 						}
 					}
 					if (i  < 0) {
-						free(plcontext->value);
 						plcontext->value = NULL;
 						plcontext->value_length = 0;
 						plcontext->value_size = 0;
@@ -937,7 +1030,9 @@ static void CP_XMLCALL end_element_handler(
 					if (plcontext->value_size > plcontext->value_length + 1) {
 						char *nv;
 						
-						if ((nv = realloc(plcontext->value, (plcontext->value_length + 1) * sizeof(char))) != NULL) {
+						if ((nv = cpi_arena_realloc(plcontext->arena, plcontext->value,
+								plcontext->value_size * sizeof(char),
+								(plcontext->value_length + 1) * sizeof(char))) != NULL) {
 							plcontext->value = nv;
 						}
 					}
@@ -955,10 +1050,7 @@ static void CP_XMLCALL end_element_handler(
 					&& plcontext->configuration->value != NULL) {
 					plcontext->value = plcontext->configuration->value;
 					plcontext->value_length = strlen(plcontext->value);
-					plcontext->value_size = CP_CFG_ELEMENT_VALUE_INITSIZE;
-					while (plcontext->value_size < plcontext->value_length + 1) {
-						plcontext->value_size *= 2;
-					}
+					plcontext->value_size = plcontext->value_length + 1;
 				}
 				
 			}			
@@ -976,13 +1068,21 @@ static void CP_XMLCALL end_element_handler(
 	}
 }
 
+CP_HIDDEN void cpi_free_plugin(cp_plugin_info_t *plugin) {
+	assert(plugin != NULL);
+	cpi_free_cfg_indexes(plugin);
+	cpi_destroy_arena(ARENA_PLUGIN_INFO(plugin)->arena);
+}
+
 static void dealloc_plugin_info(cp_context_t *ctx, cp_plugin_info_t *plugin) {
+	cpi_unintern_plugin_info(ctx, plugin);
 	cpi_free_plugin(plugin);
 }
 
-static cp_status_t init_descriptor_parsing(cp_context_t *context, ploader_context_t **plcontextptr, XML_Parser *parserptr, char *file) {
+static cp_status_t init_descriptor_parsing(cp_context_t *context, list_t *log, ploader_context_t **plcontextptr, XML_Parser *parserptr, char *file) {
 	XML_Parser parser;
 	ploader_context_t *plcontext;
+	arena_plugin_info_t *api;
 
 	// Initialize the XML parsing 
 	*parserptr = parser = XML_ParserCreate(NULL);
@@ -998,10 +1098,17 @@ static cp_status_t init_descriptor_parsing(cp_context_t *context, ploader_contex
 		return CP_ERR_RESOURCE;
 	}
 	memset(plcontext, 0, sizeof(ploader_context_t));
-	if ((plcontext->plugin = malloc(sizeof(cp_plugin_info_t))) == NULL) {
+	
+	// All plug-in information is allocated from a single arena
+	if ((plcontext->arena = cpi_create_arena(0)) == NULL
+		|| (api = cpi_arena_alloc(plcontext->arena, sizeof(arena_plugin_info_t))) == NULL) {
 		return CP_ERR_RESOURCE;
 	}
+	api->arena = plcontext->arena;
+	plcontext->plugin = &(api->plugin);
+	assert(CPI_INFO_HEADER(plcontext->plugin) == &(api->header));
 	plcontext->context = context;
+	plcontext->log = log;
 	plcontext->configuration = NULL;
 	plcontext->value = NULL;
 	plcontext->parser = parser;
@@ -1021,6 +1128,7 @@ static cp_status_t init_descriptor_parsing(cp_context_t *context, ploader_contex
 	plcontext->plugin->runtime_funcs_symbol = NULL;
 	plcontext->plugin->ext_points = NULL;
 	plcontext->plugin->extensions = NULL;
+	plcontext->plugin->runtime_exports_symbol = NULL;
 	XML_SetUserData(parser, plcontext);
 
 	return CP_OK;
@@ -1032,14 +1140,12 @@ static cp_status_t do_descriptor_parsing(XML_Parser parser, cp_context_t *contex
 	// Parse the data 
 	if (!(i = XML_ParseBuffer(parser, buffer_len, buffer_len == 0))
 		&& context != NULL) {
-		cpi_lock_context(context);
-		cpi_errorf(context,
+		descriptor_logf(context, plcontext->log, CP_LOG_ERROR,
 			N_("XML parsing error in %s, line %d, column %d (%s)."),
 			file,
 			(int) XML_GetErrorLineNumber(parser),
 			(int) (XML_GetErrorColumnNumber(parser) + 1),
 			XML_ErrorString(XML_GetErrorCode(parser)));
-		cpi_unlock_context(context);
 	}
 	if (!i || plcontext->state == PARSER_ERROR) {
 		return CP_ERR_MALFORMED;
@@ -1048,7 +1154,7 @@ static cp_status_t do_descriptor_parsing(XML_Parser parser, cp_context_t *contex
 	}
 }
 
-static cp_status_t finish_descriptor_parsing(cp_status_t status, cp_context_t *context, ploader_context_t *plcontext, char **path) {
+static cp_status_t finish_descriptor_parsing(cp_status_t status, cp_context_t *context, ploader_context_t *plcontext, const char *path) {
 	if (status == CP_OK) {
 		if (plcontext->state != PARSER_END || plcontext->error_count > 0) {
 			status = CP_ERR_MALFORMED;
@@ -1062,47 +1168,54 @@ static cp_status_t finish_descriptor_parsing(cp_status_t status, cp_context_t *c
 	}
 
 	// Initialize the plug-in path 
-	plcontext->plugin->plugin_path = *path;
-	*path = NULL;
+	if ((plcontext->plugin->plugin_path = cpi_arena_strdup(plcontext->arena, path)) == NULL) {
+		status = CP_ERR_RESOURCE;
+	}
 
-	// Increase plug-in usage count
-	status = cpi_register_info(context, plcontext->plugin, (void (*)(cp_context_t *, void *)) dealloc_plugin_info);
 	return status;
+}
 
+/**
+ * Reports a failure to load a plug-in descriptor.
+ * 
+ * @param context the plug-in context
+ * @param log the list of deferred log messages or NULL to log directly
+ * @param status the failure status
+ * @param path the plug-in path
+ */
+static void report_descriptor_failure(cp_context_t *context, list_t *log, cp_status_t status, const char *path) {
+	switch (status) {
+		case CP_ERR_MALFORMED:
+			descriptor_logf(context, log, CP_LOG_ERROR,
+				N_("Plug-in descriptor in %s is invalid."), path);
+			break;
+		case CP_ERR_IO:
+			descriptor_logf(context, log, CP_LOG_ERROR,
+				N_("An I/O error occurred while loading a plug-in descriptor from %s."), path);
+			break;
+		case CP_ERR_RESOURCE:
+			descriptor_logf(context, log, CP_LOG_ERROR,
+				N_("Insufficient system resources to load a plug-in descriptor from %s."), path);
+			break;
+		default:
+			descriptor_logf(context, log, CP_LOG_ERROR,
+				N_("Failed to load a plug-in descriptor from %s."), path);
+			break;
+	}
 }
 
-static void check_cleanup_descriptor_parsing(cp_status_t status, cp_context_t *context, ploader_context_t *plcontext, XML_Parser parser, const char *path, char *file, cp_plugin_info_t **plugin) {
+static void check_cleanup_descriptor_parsing(cp_status_t status, cp_context_t *context, list_t *log, ploader_context_t *plcontext, XML_Parser parser, const char *path, char *file, cp_plugin_info_t **plugin) {
 
 	// Report possible errors
 	if (status != CP_OK) {
-		switch (status) {
-			case CP_ERR_MALFORMED:
-				cpi_errorf(context,
-					N_("Plug-in descriptor in %s is invalid."), path);
-				break;
-			case CP_ERR_IO:
-				cpi_errorf(context,
-					N_("An I/O error occurred while loading a plug-in descriptor from %s."), path);
-				break;
-			case CP_ERR_RESOURCE:
-				cpi_errorf(context,
-					N_("Insufficient system resources to load a plug-in descriptor from %s."), path);
-				break;
-			default:
-				cpi_errorf(context,
-					N_("Failed to load a plug-in descriptor from %s."), path);
-				break;
-		}
+		report_descriptor_failure(context, log, status, path);
 	}
-	cpi_unlock_context(context);
 
-	// Release persistently allocated data on failure 
+	// Release the plug-in arena on failure 
 	if (status != CP_OK) {
-		if (file != NULL) {
-			free(file);
-		}
-		if (plcontext != NULL && plcontext->plugin != NULL) {
-			cpi_free_plugin(plcontext->plugin);
+		if (plcontext != NULL && plcontext->arena != NULL) {
+			cpi_destroy_arena(plcontext->arena);
+			plcontext->arena = NULL;
 			plcontext->plugin = NULL;
 		}
 	}
@@ -1113,20 +1226,36 @@ static void check_cleanup_descriptor_parsing(cp_status_t status, cp_context_t *c
 	}
 
 	// Release data allocated for parsing 
+	free(file);
 	if (parser != NULL) {
 		XML_ParserFree(parser);
 	}
 	if (plcontext != NULL) {
-		if (plcontext->value != NULL) {
-			free(plcontext->value);
-		}
 		free(plcontext);
 		plcontext = NULL;
 	}
 
 }
 
-CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor(cp_context_t *context, const char *path, cp_status_t *error) {
+CP_HIDDEN cp_status_t cpi_register_plugin_info(cp_context_t *context, cp_plugin_info_t *plugin) {
+	cp_status_t status;
+
+	// Intern the identifiers and increase plug-in usage count
+	assert(cpi_is_context_locked(context));
+	if ((status = cpi_intern_plugin_info(context, plugin)) == CP_OK
+		&& (status = cpi_register_info(context, plugin, (void (*)(cp_context_t *, void *)) dealloc_plugin_info)) != CP_OK) {
+		cpi_unintern_plugin_info(context, plugin);
+	}
+	if (status == CP_OK) {
+		cpi_add_cfg_indexes(plugin);
+	} else {
+		report_descriptor_failure(context, NULL, status, plugin->plugin_path);
+		cpi_free_plugin(plugin);
+	}
+	return status;
+}
+
+CP_HIDDEN cp_plugin_info_t * cpi_parse_plugin_descriptor(cp_context_t *context, const char *path, list_t *log, cp_status_t *error) {
 	char *file = NULL;
 	cp_status_t status = CP_OK;
 	FILE *fh = NULL;
@@ -1134,10 +1263,6 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor(cp_context_t *context, con
 	ploader_context_t *plcontext = NULL;
 	cp_plugin_info_t *plugin = NULL;
 
-	CHECK_NOT_NULL(context);
-	CHECK_NOT_NULL(path);
-	cpi_lock_context(context);
-	cpi_check_invocation(context, CPI_CF_ANY, __func__);
 	do {
 		int path_len;
 
@@ -1166,7 +1291,7 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor(cp_context_t *context, con
 		}
 
 		// Initialize descriptor parsing
-		status = init_descriptor_parsing(context, &plcontext, &parser, file);
+		status = init_descriptor_parsing(context, log, &plcontext, &parser, file);
 		if (status != CP_OK) {
 			break;
 		}
@@ -1199,11 +1324,11 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor(cp_context_t *context, con
 
 		// Finish parsing
 		*(file + path_len) = '\0';
-		status = finish_descriptor_parsing(status, context, plcontext, &file);
+		status = finish_descriptor_parsing(status, context, plcontext, file);
 	} while (0);
 
 	// Check and clean up
-	check_cleanup_descriptor_parsing(status, context, plcontext, parser, path, file, &plugin);
+	check_cleanup_descriptor_parsing(status, context, log, plcontext, parser, path, file, &plugin);
 	if (fh != NULL) {
 		fclose(fh);
 	}
@@ -1216,7 +1341,52 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor(cp_context_t *context, con
 	return plugin;
 }
 
-CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor_from_memory(cp_context_t *context, const char *buffer, unsigned int buffer_len, cp_status_t *error) {
+CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor(cp_context_t *context, const char *path, cp_status_t *error) {
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(path);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_unlock_context(context);
+	
+	/*
+	 * Read and parse the descriptor without holding the context lock so
+	 * that slow file system access does not block other threads. Parsing
+	 * messages lock the context only briefly while being logged.
+	 */
+	plugin = cpi_parse_plugin_descriptor(context, path, NULL, &status);
+	
+	// Register the information
+	if (plugin != NULL) {
+		cpi_lock_context(context);
+		if ((status = cpi_register_plugin_info(context, plugin)) != CP_OK) {
+			plugin = NULL;
+		}
+		cpi_unlock_context(context);
+	}
+
+	// Return error code
+	if (error != NULL) {
+		*error = status;
+	}
+
+	return plugin;
+}
+
+/**
+ * Parses a plug-in descriptor from memory. Otherwise identical to
+ * ::cpi_parse_plugin_descriptor.
+ * 
+ * @param context the plug-in context
+ * @param buffer the buffer containing the plug-in descriptor
+ * @param buffer_len the length of the plug-in descriptor
+ * @param log the list of deferred log messages or NULL to log directly
+ * @param error a pointer to the location where the status code is to be stored, or NULL
+ * @return pointer to the unregistered information structure or NULL on failure
+ */
+static cp_plugin_info_t * parse_plugin_descriptor_from_memory(cp_context_t *context, const char *buffer, unsigned int buffer_len, list_t *log, cp_status_t *error) {
 	char *file = NULL;
 	const char *path = "memory";
 	cp_status_t status = CP_OK;
@@ -1224,10 +1394,6 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor_from_memory(cp_context_t *
 	ploader_context_t *plcontext = NULL;
 	cp_plugin_info_t *plugin = NULL;
 
-	CHECK_NOT_NULL(context);
-	CHECK_NOT_NULL(buffer);
-	cpi_lock_context(context);
-	cpi_check_invocation(context, CPI_CF_ANY, __func__);
 	do {
 		int path_len = 6;
 		file = malloc((path_len + 1) * sizeof(char));
@@ -1238,7 +1404,7 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor_from_memory(cp_context_t *
 		strcpy(file, path);
 
 		// Initialize descriptor parsing
-		status = init_descriptor_parsing(context, &plcontext, &parser, file);
+		status = init_descriptor_parsing(context, log, &plcontext, &parser, file);
 		if (status != CP_OK) {
 			break;
 		}
@@ -1266,12 +1432,42 @@ CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor_from_memory(cp_context_t *
 
 		// Finish parsing
 		*(file + path_len) = '\0';
-		status = finish_descriptor_parsing(status, context, plcontext, &file);
+		status = finish_descriptor_parsing(status, context, plcontext, file);
 		
 	} while (0);
 
 	// Check and clean up
-	check_cleanup_descriptor_parsing(status, context, plcontext, parser, path, file, &plugin);
+	check_cleanup_descriptor_parsing(status, context, log, plcontext, parser, path, file, &plugin);
+
+	// Return error code
+	if (error != NULL) {
+		*error = status;
+	}
+
+	return plugin;
+}
+
+CP_C_API cp_plugin_info_t * cp_load_plugin_descriptor_from_memory(cp_context_t *context, const char *buffer, unsigned int buffer_len, cp_status_t *error) {
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(buffer);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	cpi_unlock_context(context);
+	
+	// Parse the descriptor without holding the context lock
+	plugin = parse_plugin_descriptor_from_memory(context, buffer, buffer_len, NULL, &status);
+	
+	// Register the information
+	if (plugin != NULL) {
+		cpi_lock_context(context);
+		if ((status = cpi_register_plugin_info(context, plugin)) != CP_OK) {
+			plugin = NULL;
+		}
+		cpi_unlock_context(context);
+	}
 
 	// Return error code
 	if (error != NULL) {
@@ -0,0 +1,1016 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+/** @file
+ * Binary plug-in descriptor images
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+#include <errno.h>
+#ifdef HAVE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "cpluff.h"
+#include "defines.h"
+#include "util.h"
+#include "internal.h"
+
+
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+/// Image magic number
+#define IMG_MAGIC 0x49445043
+
+/// Image format version
+#define IMG_VERSION 2
+
+/// Null reference
+#define IMG_NONE 0xffffffffU
+
+/// Maximum number of entries in an image section
+#define IMG_MAX_ENTRIES 0x00ffffffU
+
+
+/* ------------------------------------------------------------------------
+ * Internal data types
+ * ----------------------------------------------------------------------*/
+
+/*
+ * An image consists of a header, followed by the import, extension point,
+ * extension, configuration element and attribute sections and finally the
+ * string table. Strings are referred to using offsets into the string
+ * table and other entries using indices into the corresponding sections.
+ * The configuration element trees are flattened so that the children of
+ * each element are stored contiguously after the element itself.
+ */
+
+/// Image header
+typedef struct img_header_t {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint32_t num_imports;
+	uint32_t num_ext_points;
+	uint32_t num_extensions;
+	uint32_t num_cfg_elements;
+	uint32_t num_atts;
+	uint32_t strings_offset;
+	uint32_t strings_size;
+	uint32_t identifier;
+	uint32_t name;
+	uint32_t version_str;
+	uint32_t provider_name;
+	uint32_t abi_bw_compatibility;
+	uint32_t api_bw_compatibility;
+	uint32_t req_cpluff_version;
+	uint32_t runtime_lib_name;
+	uint32_t runtime_funcs_symbol;
+	uint32_t runtime_exports_symbol;
+} img_header_t;
+
+/// Image import entry
+typedef struct img_import_t {
+	uint32_t plugin_id;
+	uint32_t version;
+	uint32_t optional;
+} img_import_t;
+
+/// Image extension point entry
+typedef struct img_ext_point_t {
+	uint32_t local_id;
+	uint32_t identifier;
+	uint32_t name;
+	uint32_t schema_path;
+} img_ext_point_t;
+
+/// Image extension entry
+typedef struct img_extension_t {
+	uint32_t ext_point_id;
+	uint32_t local_id;
+	uint32_t identifier;
+	uint32_t name;
+	uint32_t configuration;
+} img_extension_t;
+
+/// Image configuration element entry
+typedef struct img_cfg_element_t {
+	uint32_t name;
+	uint32_t value;
+	uint32_t parent;
+	uint32_t index;
+	uint32_t num_atts;
+	uint32_t atts;
+	uint32_t num_children;
+	uint32_t children;
+} img_cfg_element_t;
+
+/// A plug-in image file loaded into memory
+typedef struct img_file_t {
+
+	/// The image
+	void *image;
+
+	/// The size of the image
+	size_t size;
+
+	/// Whether the image has been mapped into memory or read into a buffer
+	int mapped;
+
+} img_file_t;
+
+/// Image encoding state
+typedef struct img_encoder_t {
+
+	/// String table being constructed
+	char *strings;
+
+	/// Current size of the string table
+	size_t strings_size;
+
+	/// Allocated size of the string table
+	size_t strings_alloc;
+
+	/// String offsets keyed by the encoded source strings
+	hash_t *string_offsets;
+
+	/// Whether the encoder has run out of memory
+	int failed;
+
+} img_encoder_t;
+
+
+/* ------------------------------------------------------------------------
+ * Function definitions
+ * ----------------------------------------------------------------------*/
+
+/**
+ * Adds a string to the string table being constructed unless an equal
+ * string has already been added.
+ * 
+ * @param enc the encoder
+ * @param str the string or NULL
+ * @return the string reference
+ */
+static uint32_t encode_string(img_encoder_t *enc, const char *str) {
+	hnode_t *node;
+	size_t len;
+	uint32_t offset;
+	
+	if (str == NULL || enc->failed) {
+		return IMG_NONE;
+	}
+	if ((node = hash_lookup(enc->string_offsets, str)) != NULL) {
+		return (uint32_t) (uintptr_t) hnode_get(node);
+	}
+	len = strlen(str) + 1;
+	if (enc->strings_size + len > enc->strings_alloc) {
+		size_t ns = (enc->strings_alloc == 0 ? 256 : enc->strings_alloc);
+		char *nstrings;
+		
+		while (enc->strings_size + len > ns) {
+			ns *= 2;
+		}
+		if ((nstrings = realloc(enc->strings, ns)) == NULL) {
+			enc->failed = 1;
+			return IMG_NONE;
+		}
+		enc->strings = nstrings;
+		enc->strings_alloc = ns;
+	}
+	offset = enc->strings_size;
+	memcpy(enc->strings + offset, str, len);
+	enc->strings_size += len;
+	if (!hash_alloc_insert(enc->string_offsets, str, (void *) (uintptr_t) offset)) {
+		enc->failed = 1;
+	}
+	return offset;
+}
+
+/**
+ * Returns the number of configuration elements in the specified tree.
+ * 
+ * @param ce the root element
+ * @return the number of elements
+ */
+static uint32_t count_cfg_elements(const cp_cfg_element_t *ce) {
+	uint32_t n = 1;
+	unsigned int i;
+	
+	for (i = 0; i < ce->num_children; i++) {
+		n += count_cfg_elements(ce->children + i);
+	}
+	return n;
+}
+
+/**
+ * Returns the number of attribute strings in the specified tree.
+ * 
+ * @param ce the root element
+ * @return the number of attribute names and values
+ */
+static uint32_t count_cfg_atts(const cp_cfg_element_t *ce) {
+	uint32_t n = 2 * ce->num_atts;
+	unsigned int i;
+	
+	for (i = 0; i < ce->num_children; i++) {
+		n += count_cfg_atts(ce->children + i);
+	}
+	return n;
+}
+
+CP_HIDDEN void *cpi_encode_plugin_image(const cp_plugin_info_t *plugin, size_t *size) {
+	img_encoder_t enc;
+	img_header_t hdr;
+	img_import_t *imports = NULL;
+	img_ext_point_t *ext_points = NULL;
+	img_extension_t *extensions = NULL;
+	img_cfg_element_t *cfg = NULL;
+	uint32_t *atts = NULL;
+	const cp_cfg_element_t **cfg_src = NULL;
+	char *image = NULL;
+	uint32_t num_cfg = 0, num_atts = 0;
+	uint32_t i;
+	
+	assert(plugin != NULL);
+	assert(size != NULL);
+	memset(&enc, 0, sizeof(enc));
+	memset(&hdr, 0, sizeof(hdr));
+	do {
+		uint32_t next_cfg = 0, next_att = 0;
+		size_t offset;
+		
+		if ((enc.string_offsets = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL)) == NULL) {
+			break;
+		}
+		
+		// Allocate sections
+		for (i = 0; i < plugin->num_extensions; i++) {
+			if (plugin->extensions[i].configuration != NULL) {
+				num_cfg += count_cfg_elements(plugin->extensions[i].configuration);
+				num_atts += count_cfg_atts(plugin->extensions[i].configuration);
+			}
+		}
+		if (plugin->num_imports > IMG_MAX_ENTRIES
+			|| plugin->num_ext_points > IMG_MAX_ENTRIES
+			|| plugin->num_extensions > IMG_MAX_ENTRIES
+			|| num_cfg > IMG_MAX_ENTRIES
+			|| num_atts > IMG_MAX_ENTRIES) {
+			break;
+		}
+		imports = malloc(plugin->num_imports * sizeof(img_import_t) + 1);
+		ext_points = malloc(plugin->num_ext_points * sizeof(img_ext_point_t) + 1);
+		extensions = malloc(plugin->num_extensions * sizeof(img_extension_t) + 1);
+		cfg = malloc(num_cfg * sizeof(img_cfg_element_t) + 1);
+		cfg_src = malloc(num_cfg * sizeof(cp_cfg_element_t *) + 1);
+		atts = malloc(num_atts * sizeof(uint32_t) + 1);
+		if (imports == NULL || ext_points == NULL || extensions == NULL
+			|| cfg == NULL || cfg_src == NULL || atts == NULL) {
+			break;
+		}
+		
+		// Encode plug-in information
+		hdr.identifier = encode_string(&enc, plugin->identifier);
+		hdr.name = encode_string(&enc, plugin->name);
+		hdr.version_str = encode_string(&enc, plugin->version);
+		hdr.provider_name = encode_string(&enc, plugin->provider_name);
+		hdr.abi_bw_compatibility = encode_string(&enc, plugin->abi_bw_compatibility);
+		hdr.api_bw_compatibility = encode_string(&enc, plugin->api_bw_compatibility);
+		hdr.req_cpluff_version = encode_string(&enc, plugin->req_cpluff_version);
+		hdr.runtime_lib_name = encode_string(&enc, plugin->runtime_lib_name);
+		hdr.runtime_funcs_symbol = encode_string(&enc, plugin->runtime_funcs_symbol);
+		hdr.runtime_exports_symbol = encode_string(&enc, plugin->runtime_exports_symbol);
+		for (i = 0; i < plugin->num_imports; i++) {
+			const cp_plugin_import_t *imp = plugin->imports + i;
+			
+			imports[i].plugin_id = encode_string(&enc, imp->plugin_id);
+			imports[i].version = encode_string(&enc, imp->version);
+			imports[i].optional = imp->optional;
+		}
+		for (i = 0; i < plugin->num_ext_points; i++) {
+			const cp_ext_point_t *ep = plugin->ext_points + i;
+			
+			ext_points[i].local_id = encode_string(&enc, ep->local_id);
+			ext_points[i].identifier = encode_string(&enc, ep->identifier);
+			ext_points[i].name = encode_string(&enc, ep->name);
+			ext_points[i].schema_path = encode_string(&enc, ep->schema_path);
+		}
+		for (i = 0; i < plugin->num_extensions; i++) {
+			const cp_extension_t *e = plugin->extensions + i;
+			uint32_t j;
+			
+			extensions[i].ext_point_id = encode_string(&enc, e->ext_point_id);
+			extensions[i].local_id = encode_string(&enc, e->local_id);
+			extensions[i].identifier = encode_string(&enc, e->identifier);
+			extensions[i].name = encode_string(&enc, e->name);
+			if (e->configuration == NULL) {
+				extensions[i].configuration = IMG_NONE;
+				continue;
+			}
+			
+			// Flatten the configuration tree in breadth-first order
+			extensions[i].configuration = next_cfg;
+			cfg_src[next_cfg] = e->configuration;
+			cfg[next_cfg].parent = IMG_NONE;
+			cfg[next_cfg].index = 0;
+			for (j = next_cfg++; j < next_cfg; j++) {
+				const cp_cfg_element_t *ce = cfg_src[j];
+				uint32_t k;
+				
+				cfg[j].name = encode_string(&enc, ce->name);
+				cfg[j].value = encode_string(&enc, ce->value);
+				cfg[j].num_atts = ce->num_atts;
+				cfg[j].atts = next_att;
+				for (k = 0; k < 2 * ce->num_atts; k++) {
+					atts[next_att++] = encode_string(&enc, ce->atts[k]);
+				}
+				cfg[j].num_children = ce->num_children;
+				cfg[j].children = (ce->num_children > 0 ? next_cfg : IMG_NONE);
+				for (k = 0; k < ce->num_children; k++) {
+					cfg_src[next_cfg] = ce->children + k;
+					cfg[next_cfg].parent = j;
+					cfg[next_cfg].index = k;
+					next_cfg++;
+				}
+			}
+		}
+		assert(enc.failed || (next_cfg == num_cfg && next_att == num_atts));
+		if (enc.failed) {
+			break;
+		}
+		
+		// Construct the header
+		hdr.magic = IMG_MAGIC;
+		hdr.version = IMG_VERSION;
+		hdr.num_imports = plugin->num_imports;
+		hdr.num_ext_points = plugin->num_ext_points;
+		hdr.num_extensions = plugin->num_extensions;
+		hdr.num_cfg_elements = num_cfg;
+		hdr.num_atts = num_atts;
+		hdr.strings_offset = sizeof(img_header_t)
+			+ hdr.num_imports * sizeof(img_import_t)
+			+ hdr.num_ext_points * sizeof(img_ext_point_t)
+			+ hdr.num_extensions * sizeof(img_extension_t)
+			+ hdr.num_cfg_elements * sizeof(img_cfg_element_t)
+			+ hdr.num_atts * sizeof(uint32_t);
+		hdr.strings_size = enc.strings_size;
+		hdr.size = hdr.strings_offset + ((hdr.strings_size + 3) & ~3U);
+		
+		// Assemble the image
+		if ((image = malloc(hdr.size)) == NULL) {
+			break;
+		}
+		memset(image, 0, hdr.size);
+		offset = 0;
+		memcpy(image + offset, &hdr, sizeof(hdr));
+		offset += sizeof(hdr);
+		memcpy(image + offset, imports, hdr.num_imports * sizeof(img_import_t));
+		offset += hdr.num_imports * sizeof(img_import_t);
+		memcpy(image + offset, ext_points, hdr.num_ext_points * sizeof(img_ext_point_t));
+		offset += hdr.num_ext_points * sizeof(img_ext_point_t);
+		memcpy(image + offset, extensions, hdr.num_extensions * sizeof(img_extension_t));
+		offset += hdr.num_extensions * sizeof(img_extension_t);
+		memcpy(image + offset, cfg, hdr.num_cfg_elements * sizeof(img_cfg_element_t));
+		offset += hdr.num_cfg_elements * sizeof(img_cfg_element_t);
+		memcpy(image + offset, atts, hdr.num_atts * sizeof(uint32_t));
+		offset += hdr.num_atts * sizeof(uint32_t);
+		assert(offset == hdr.strings_offset);
+		if (enc.strings_size > 0) {
+			memcpy(image + offset, enc.strings, enc.strings_size);
+		}
+		*size = hdr.size;
+		
+	} while (0);
+	
+	// Release resources
+	free(imports);
+	free(ext_points);
+	free(extensions);
+	free(cfg);
+	free(cfg_src);
+	free(atts);
+	free(enc.strings);
+	if (enc.string_offsets != NULL) {
+		hash_free_nodes(enc.string_offsets);
+		hash_destroy(enc.string_offsets);
+	}
+	
+	return image;
+}
+
+/**
+ * Checks that a string reference is valid.
+ * 
+ * @param hdr the image header
+ * @param ref the string reference
+ * @param optional whether the string is optional
+ * @return whether the reference is valid
+ */
+static int check_string(const img_header_t *hdr, uint32_t ref, int optional) {
+	return (ref == IMG_NONE ? optional : ref < hdr->strings_size);
+}
+
+/**
+ * Validates the structure of an image.
+ * 
+ * @param image the image
+ * @param size the size of the image
+ * @return whether the image is valid
+ */
+static int check_image(const void *image, size_t size) {
+	const img_header_t *hdr = image;
+	const img_import_t *imports;
+	const img_ext_point_t *ext_points;
+	const img_extension_t *extensions;
+	const img_cfg_element_t *cfg;
+	const uint32_t *atts;
+	size_t offset;
+	uint32_t i;
+	
+	// Check the header
+	if (size < sizeof(img_header_t)
+		|| ((uintptr_t) image) % sizeof(uint32_t) != 0
+		|| hdr->magic != IMG_MAGIC
+		|| hdr->version != IMG_VERSION
+		|| hdr->size != size
+		|| hdr->num_imports > IMG_MAX_ENTRIES
+		|| hdr->num_ext_points > IMG_MAX_ENTRIES
+		|| hdr->num_extensions > IMG_MAX_ENTRIES
+		|| hdr->num_cfg_elements > IMG_MAX_ENTRIES
+		|| hdr->num_atts > IMG_MAX_ENTRIES) {
+		return 0;
+	}
+	offset = sizeof(img_header_t)
+		+ (size_t) hdr->num_imports * sizeof(img_import_t)
+		+ (size_t) hdr->num_ext_points * sizeof(img_ext_point_t)
+		+ (size_t) hdr->num_extensions * sizeof(img_extension_t)
+		+ (size_t) hdr->num_cfg_elements * sizeof(img_cfg_element_t)
+		+ (size_t) hdr->num_atts * sizeof(uint32_t);
+	if (hdr->strings_offset != offset
+		|| hdr->strings_size > size - offset
+		|| (hdr->strings_size > 0
+			&& ((const char *) image)[offset + hdr->strings_size - 1] != '\0')) {
+		return 0;
+	}
+	imports = (const img_import_t *) (hdr + 1);
+	ext_points = (const img_ext_point_t *) (imports + hdr->num_imports);
+	extensions = (const img_extension_t *) (ext_points + hdr->num_ext_points);
+	cfg = (const img_cfg_element_t *) (extensions + hdr->num_extensions);
+	atts = (const uint32_t *) (cfg + hdr->num_cfg_elements);
+	
+	// Check plug-in information
+	if (!check_string(hdr, hdr->identifier, 0)
+		|| !check_string(hdr, hdr->name, 1)
+		|| !check_string(hdr, hdr->version_str, 1)
+		|| !check_string(hdr, hdr->provider_name, 1)
+		|| !check_string(hdr, hdr->abi_bw_compatibility, 1)
+		|| !check_string(hdr, hdr->api_bw_compatibility, 1)
+		|| !check_string(hdr, hdr->req_cpluff_version, 1)
+		|| !check_string(hdr, hdr->runtime_lib_name, 1)
+		|| !check_string(hdr, hdr->runtime_funcs_symbol, 1)
+		|| !check_string(hdr, hdr->runtime_exports_symbol, 1)) {
+		return 0;
+	}
+	for (i = 0; i < hdr->num_imports; i++) {
+		if (!check_string(hdr, imports[i].plugin_id, 0)
+			|| !check_string(hdr, imports[i].version, 1)) {
+			return 0;
+		}
+	}
+	for (i = 0; i < hdr->num_ext_points; i++) {
+		if (!check_string(hdr, ext_points[i].local_id, 0)
+			|| !check_string(hdr, ext_points[i].identifier, 0)
+			|| !check_string(hdr, ext_points[i].name, 1)
+			|| !check_string(hdr, ext_points[i].schema_path, 1)) {
+			return 0;
+		}
+	}
+	for (i = 0; i < hdr->num_extensions; i++) {
+		if (!check_string(hdr, extensions[i].ext_point_id, 0)
+			|| !check_string(hdr, extensions[i].local_id, 1)
+			|| !check_string(hdr, extensions[i].identifier, 1)
+			|| !check_string(hdr, extensions[i].name, 1)
+			|| (extensions[i].configuration != IMG_NONE
+				&& (extensions[i].configuration >= hdr->num_cfg_elements
+					|| cfg[extensions[i].configuration].parent != IMG_NONE))) {
+			return 0;
+		}
+	}
+	for (i = 0; i < hdr->num_atts; i++) {
+		if (!check_string(hdr, atts[i], 0)) {
+			return 0;
+		}
+	}
+	
+	// Check configuration elements, children always follow their parent
+	for (i = 0; i < hdr->num_cfg_elements; i++) {
+		const img_cfg_element_t *ce = cfg + i;
+		uint32_t j;
+		
+		if (!check_string(hdr, ce->name, 0)
+			|| !check_string(hdr, ce->value, 1)
+			|| ce->num_atts > hdr->num_atts / 2
+			|| ce->atts > hdr->num_atts - 2 * ce->num_atts) {
+			return 0;
+		}
+		if (ce->num_children > 0) {
+			if (ce->children == IMG_NONE
+				|| ce->children <= i
+				|| ce->num_children > hdr->num_cfg_elements - ce->children) {
+				return 0;
+			}
+			for (j = 0; j < ce->num_children; j++) {
+				if (cfg[ce->children + j].parent != i
+					|| cfg[ce->children + j].index != j) {
+					return 0;
+				}
+			}
+		}
+	}
+	
+	return 1;
+}
+
+/**
+ * Decodes a previously validated image into plug-in information allocated
+ * as a single memory block. The block optionally starts with space reserved
+ * for the caller. The strings are either copied into the block or referred
+ * to directly in the image, in which case the image must stay valid as long
+ * as the information is being used.
+ * 
+ * @param image the image
+ * @param path the plug-in path
+ * @param prefix_size the number of bytes reserved before the information
+ * @param copy_strings whether to copy the strings
+ * @return the plug-in information or NULL if insufficient memory
+ */
+static cp_plugin_info_t *decode_image(const void *image, const char *path, size_t prefix_size, int copy_strings) {
+	const img_header_t *hdr = image;
+	const img_import_t *imports;
+	const img_ext_point_t *ext_points;
+	const img_extension_t *extensions;
+	const img_cfg_element_t *cfg;
+	const uint32_t *atts;
+	cp_plugin_info_t *plugin;
+	cp_cfg_element_t *ces;
+	char **att_ptrs;
+	char *block;
+	char *strings;
+	size_t block_size;
+	uint32_t i;
+	
+	assert(image != NULL);
+	assert(path != NULL);
+	imports = (const img_import_t *) (hdr + 1);
+	ext_points = (const img_ext_point_t *) (imports + hdr->num_imports);
+	extensions = (const img_extension_t *) (ext_points + hdr->num_ext_points);
+	cfg = (const img_cfg_element_t *) (extensions + hdr->num_extensions);
+	atts = (const uint32_t *) (cfg + hdr->num_cfg_elements);
+	
+	// Allocate all the information as a single memory block
+	block_size = prefix_size
+		+ sizeof(cp_plugin_info_t)
+		+ hdr->num_imports * sizeof(cp_plugin_import_t)
+		+ hdr->num_ext_points * sizeof(cp_ext_point_t)
+		+ hdr->num_extensions * sizeof(cp_extension_t)
+		+ hdr->num_cfg_elements * sizeof(cp_cfg_element_t)
+		+ hdr->num_atts * sizeof(char *)
+		+ (copy_strings ? hdr->strings_size : 0)
+		+ strlen(path) + 1;
+	if ((block = malloc(block_size)) == NULL) {
+		return NULL;
+	}
+	plugin = (cp_plugin_info_t *) (block + prefix_size);
+	memset(plugin, 0, sizeof(cp_plugin_info_t));
+	plugin->imports = (cp_plugin_import_t *) (plugin + 1);
+	plugin->ext_points = (cp_ext_point_t *) (plugin->imports + hdr->num_imports);
+	plugin->extensions = (cp_extension_t *) (plugin->ext_points + hdr->num_ext_points);
+	ces = (cp_cfg_element_t *) (plugin->extensions + hdr->num_extensions);
+	att_ptrs = (char **) (ces + hdr->num_cfg_elements);
+	if (copy_strings) {
+		strings = (char *) (att_ptrs + hdr->num_atts);
+		memcpy(strings, ((const char *) image) + hdr->strings_offset, hdr->strings_size);
+		plugin->plugin_path = strings + hdr->strings_size;
+	} else {
+		strings = ((char *) image) + hdr->strings_offset;
+		plugin->plugin_path = (char *) (att_ptrs + hdr->num_atts);
+	}
+	strcpy(plugin->plugin_path, path);
+#define IMG_STR(ref) ((ref) == IMG_NONE ? NULL : strings + (ref))
+	
+	// Decode plug-in information
+	plugin->identifier = IMG_STR(hdr->identifier);
+	plugin->name = IMG_STR(hdr->name);
+	plugin->version = IMG_STR(hdr->version_str);
+	plugin->provider_name = IMG_STR(hdr->provider_name);
+	plugin->abi_bw_compatibility = IMG_STR(hdr->abi_bw_compatibility);
+	plugin->api_bw_compatibility = IMG_STR(hdr->api_bw_compatibility);
+	plugin->req_cpluff_version = IMG_STR(hdr->req_cpluff_version);
+	plugin->runtime_lib_name = IMG_STR(hdr->runtime_lib_name);
+	plugin->runtime_funcs_symbol = IMG_STR(hdr->runtime_funcs_symbol);
+	plugin->runtime_exports_symbol = IMG_STR(hdr->runtime_exports_symbol);
+	plugin->num_imports = hdr->num_imports;
+	for (i = 0; i < hdr->num_imports; i++) {
+		plugin->imports[i].plugin_id = IMG_STR(imports[i].plugin_id);
+		plugin->imports[i].version = IMG_STR(imports[i].version);
+		plugin->imports[i].optional = (imports[i].optional != 0);
+	}
+	plugin->num_ext_points = hdr->num_ext_points;
+	for (i = 0; i < hdr->num_ext_points; i++) {
+		plugin->ext_points[i].plugin = plugin;
+		plugin->ext_points[i].local_id = IMG_STR(ext_points[i].local_id);
+		plugin->ext_points[i].identifier = IMG_STR(ext_points[i].identifier);
+		plugin->ext_points[i].name = IMG_STR(ext_points[i].name);
+		plugin->ext_points[i].schema_path = IMG_STR(ext_points[i].schema_path);
+	}
+	plugin->num_extensions = hdr->num_extensions;
+	for (i = 0; i < hdr->num_extensions; i++) {
+		plugin->extensions[i].plugin = plugin;
+		plugin->extensions[i].ext_point_id = IMG_STR(extensions[i].ext_point_id);
+		plugin->extensions[i].local_id = IMG_STR(extensions[i].local_id);
+		plugin->extensions[i].identifier = IMG_STR(extensions[i].identifier);
+		plugin->extensions[i].name = IMG_STR(extensions[i].name);
+		plugin->extensions[i].configuration = (extensions[i].configuration == IMG_NONE ? NULL : ces + extensions[i].configuration);
+	}
+	for (i = 0; i < hdr->num_atts; i++) {
+		att_ptrs[i] = IMG_STR(atts[i]);
+	}
+	for (i = 0; i < hdr->num_cfg_elements; i++) {
+		cp_cfg_element_t *ce = ces + i;
+		
+		ce->name = IMG_STR(cfg[i].name);
+		ce->value = IMG_STR(cfg[i].value);
+		ce->num_atts = cfg[i].num_atts;
+		ce->atts = (cfg[i].num_atts > 0 ? att_ptrs + cfg[i].atts : NULL);
+		ce->parent = (cfg[i].parent == IMG_NONE ? NULL : ces + cfg[i].parent);
+		ce->index = cfg[i].index;
+		ce->num_children = cfg[i].num_children;
+		ce->children = (cfg[i].num_children > 0 ? ces + cfg[i].children : NULL);
+	}
+#undef IMG_STR
+	
+	return plugin;
+}
+
+static void dealloc_plugin_image_info(cp_context_t *ctx, cp_plugin_info_t *plugin) {
+	cpi_unintern_plugin_info(ctx, plugin);
+	cpi_free_cfg_indexes(plugin);
+	cpi_free_info(plugin);
+}
+
+CP_HIDDEN cp_plugin_info_t *cpi_load_plugin_image(cp_context_t *context, const void *image, size_t size, const char *path, cp_status_t *error) {
+	cp_plugin_info_t *plugin;
+	cp_status_t status = CP_OK;
+	
+	assert(cpi_is_context_locked(context));
+	if (!check_image(image, size)) {
+		plugin = NULL;
+		status = CP_ERR_MALFORMED;
+	} else if ((plugin = decode_image(image, path, sizeof(cpi_info_header_t), 1)) == NULL) {
+		status = CP_ERR_RESOURCE;
+	} else if ((status = cpi_intern_plugin_info(context, plugin)) != CP_OK) {
+		cpi_free_info(plugin);
+		plugin = NULL;
+	} else if ((status = cpi_register_info(context, plugin, (void (*)(cp_context_t *, void *)) dealloc_plugin_image_info)) != CP_OK) {
+		cpi_unintern_plugin_info(context, plugin);
+		cpi_free_info(plugin);
+		plugin = NULL;
+	} else {
+		cpi_add_cfg_indexes(plugin);
+	}
+	if (error != NULL) {
+		*error = status;
+	}
+	return plugin;
+}
+
+/**
+ * Releases an image file loaded into memory.
+ * 
+ * @param file the image file
+ */
+static void release_image_file(img_file_t *file) {
+#ifdef HAVE_MMAP
+	if (file->mapped) {
+		munmap(file->image, file->size);
+		return;
+	}
+#endif
+	free(file->image);
+}
+
+/**
+ * Loads an image file into memory. The file is mapped into memory, if
+ * possible, so that processes loading the same image share the pages.
+ * Otherwise the file is read into a buffer.
+ * 
+ * @param path the path of the image file
+ * @param file filled with the loaded image file
+ * @return @ref CP_OK (zero) on success or an error code on failure
+ */
+static cp_status_t load_image_file(const char *path, img_file_t *file) {
+	FILE *fh;
+	long size;
+	cp_status_t status = CP_OK;
+	
+	memset(file, 0, sizeof(img_file_t));
+	
+#ifdef HAVE_MMAP
+	{
+		struct stat st;
+		int fd;
+		
+		if ((fd = open(path, O_RDONLY)) < 0) {
+			return (errno == ENOMEM ? CP_ERR_RESOURCE : CP_ERR_IO);
+		}
+		if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+			close(fd);
+			return CP_ERR_IO;
+		}
+		if (st.st_size < (off_t) sizeof(img_header_t) || (uintmax_t) st.st_size > SIZE_MAX) {
+			close(fd);
+			return CP_ERR_MALFORMED;
+		}
+		file->size = st.st_size;
+		file->image = mmap(NULL, file->size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (file->image != MAP_FAILED) {
+			file->mapped = 1;
+			return CP_OK;
+		}
+		file->image = NULL;
+		
+		// Fall back to reading the file
+	}
+#endif
+	
+	do {
+		if ((fh = fopen(path, "rb")) == NULL) {
+			status = CP_ERR_IO;
+			break;
+		}
+		if (fseek(fh, 0, SEEK_END) || (size = ftell(fh)) < 0 || fseek(fh, 0, SEEK_SET)) {
+			status = CP_ERR_IO;
+			break;
+		}
+		if ((size_t) size < sizeof(img_header_t)) {
+			status = CP_ERR_MALFORMED;
+			break;
+		}
+		file->size = size;
+		if ((file->image = malloc(file->size)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		if (fread(file->image, 1, file->size, fh) != file->size) {
+			status = CP_ERR_IO;
+			break;
+		}
+	} while (0);
+	
+	if (fh != NULL) {
+		fclose(fh);
+	}
+	if (status != CP_OK) {
+		free(file->image);
+		file->image = NULL;
+	}
+	return status;
+}
+
+/// Returns the image file of plug-in information loaded using ::cpi_map_plugin_image
+#define MAPPED_IMAGE_FILE(plugin) (((img_file_t *) CPI_INFO_HEADER(plugin)) - 1)
+
+static void dealloc_mapped_plugin_info(cp_context_t *ctx, cp_plugin_info_t *plugin) {
+	img_file_t *file = MAPPED_IMAGE_FILE(plugin);
+	
+	cpi_unintern_plugin_info(ctx, plugin);
+	cpi_free_cfg_indexes(plugin);
+	release_image_file(file);
+	free(file);
+}
+
+CP_HIDDEN cp_plugin_info_t *cpi_map_plugin_image(cp_context_t *context, const char *path, cp_status_t *error) {
+	cp_plugin_info_t *plugin = NULL;
+	img_file_t file;
+	char *image_path = NULL;
+	cp_status_t status = CP_OK;
+	
+	assert(cpi_is_context_locked(context));
+	memset(&file, 0, sizeof(img_file_t));
+	do {
+		
+		// Load the image file
+		if ((image_path = malloc((strlen(path) + strlen(CP_PLUGIN_IMAGE) + 2) * sizeof(char))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		strcpy(image_path, path);
+		strcat(image_path, CP_FNAMESEP_STR);
+		strcat(image_path, CP_PLUGIN_IMAGE);
+		if ((status = load_image_file(image_path, &file)) != CP_OK) {
+			break;
+		}
+		
+		// Decode the image, keeping the strings in the loaded image
+		if (!check_image(file.image, file.size)) {
+			status = CP_ERR_MALFORMED;
+			break;
+		}
+		if ((plugin = decode_image(file.image, path, sizeof(img_file_t) + sizeof(cpi_info_header_t), 0)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		*MAPPED_IMAGE_FILE(plugin) = file;
+		if ((status = cpi_intern_plugin_info(context, plugin)) != CP_OK) {
+			free(MAPPED_IMAGE_FILE(plugin));
+			plugin = NULL;
+			break;
+		}
+		if ((status = cpi_register_info(context, plugin, (void (*)(cp_context_t *, void *)) dealloc_mapped_plugin_info)) != CP_OK) {
+			cpi_unintern_plugin_info(context, plugin);
+			free(MAPPED_IMAGE_FILE(plugin));
+			plugin = NULL;
+			break;
+		}
+		cpi_add_cfg_indexes(plugin);
+		
+	} while (0);
+	
+	// Release resources on failure
+	if (status != CP_OK && file.image != NULL) {
+		release_image_file(&file);
+	}
+	free(image_path);
+	
+	if (error != NULL) {
+		*error = status;
+	}
+	return plugin;
+}
+
+/**
+ * Reports a failure to load or save a plug-in image.
+ * 
+ * @param context the plug-in context
+ * @param status the failure status
+ * @param path the plug-in path or the image file
+ */
+static void report_image_failure(cp_context_t *context, cp_status_t status, const char *path) {
+	switch (status) {
+		case CP_ERR_MALFORMED:
+			cpi_errorf(context, N_("Plug-in descriptor in %s is invalid."), path);
+			break;
+		case CP_ERR_IO:
+			cpi_errorf(context, N_("An I/O error occurred while loading a plug-in descriptor from %s."), path);
+			break;
+		case CP_ERR_RESOURCE:
+			cpi_errorf(context, N_("Insufficient system resources to load a plug-in descriptor from %s."), path);
+			break;
+		default:
+			cpi_errorf(context, N_("Failed to load a plug-in descriptor from %s."), path);
+			break;
+	}
+}
+
+CP_C_API cp_plugin_info_t * cp_load_plugin_image(cp_context_t *context, const char *path, cp_status_t *error) {
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(path);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	if ((plugin = cpi_map_plugin_image(context, path, &status)) == NULL) {
+		report_image_failure(context, status, path);
+	}
+	cpi_unlock_context(context);
+	
+	if (error != NULL) {
+		*error = status;
+	}
+	return plugin;
+}
+
+CP_C_API cp_status_t cp_save_plugin_image(cp_context_t *context, cp_plugin_info_t *plugin, const char *file) {
+	char *image_file = NULL;
+	char *tmp_file = NULL;
+	void *image = NULL;
+	size_t size;
+	FILE *fh = NULL;
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(plugin);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+	do {
+		
+		// Determine the image file
+		if (file == NULL) {
+			if (plugin->plugin_path == NULL) {
+				status = CP_ERR_IO;
+				break;
+			}
+			if ((image_file = malloc((strlen(plugin->plugin_path) + strlen(CP_PLUGIN_IMAGE) + 2) * sizeof(char))) == NULL) {
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+			strcpy(image_file, plugin->plugin_path);
+			strcat(image_file, CP_FNAMESEP_STR);
+			strcat(image_file, CP_PLUGIN_IMAGE);
+			file = image_file;
+		}
+		
+		// Encode the image
+		if ((image = cpi_encode_plugin_image(plugin, &size)) == NULL
+			|| (tmp_file = malloc((strlen(file) + 5) * sizeof(char))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		
+		/*
+		 * Write the image into a temporary file and rename it over the
+		 * target so that processes which have mapped the previous image
+		 * are not affected.
+		 */
+		strcpy(tmp_file, file);
+		strcat(tmp_file, ".tmp");
+		if ((fh = fopen(tmp_file, "wb")) == NULL) {
+			status = CP_ERR_IO;
+			break;
+		}
+		if (fwrite(image, 1, size, fh) != size) {
+			status = CP_ERR_IO;
+		}
+		if (fclose(fh)) {
+			status = CP_ERR_IO;
+		}
+		fh = NULL;
+		if (status != CP_OK) {
+			break;
+		}
+		if (rename(tmp_file, file)) {
+			remove(file);
+			if (rename(tmp_file, file)) {
+				status = CP_ERR_IO;
+				break;
+			}
+		}
+		
+	} while (0);
+	
+	// Report failure and release resources
+	if (status != CP_OK) {
+		if (fh != NULL) {
+			fclose(fh);
+		}
+		if (tmp_file != NULL) {
+			remove(tmp_file);
+		}
+		if (file != NULL) {
+			cpi_errorf(context, N_("Could not save a binary plug-in descriptor image to %s."), file);
+		} else {
+			cpi_errorf(context, N_("Could not save a binary plug-in descriptor image for plug-in %s."), plugin->identifier);
+		}
+	}
+	cpi_unlock_context(context);
+	free(tmp_file);
+	free(image_file);
+	free(image);
+	
+	return status;
+}
@@ -32,30 +32,87 @@
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <limits.h>
 #include "../kazlib/hash.h"
 #include "cpluff.h"
 #include "defines.h"
 #include "util.h"
+#include "atomic.h"
 #include "internal.h"
 
 
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+/// Minimum number of children or attributes for building a lookup index
+#define CFG_INDEX_MIN_SIZE 8
+
+
 /* ------------------------------------------------------------------------
  * Data types
  * ----------------------------------------------------------------------*/
 
-/// Registration of a dynamically allocated information object
-typedef struct info_resource_t {
+/// Lookup index of a configuration element
+typedef struct cfg_index_t {
+	
+	/// Children sorted by name and index, or NULL if not indexed
+	cp_cfg_element_t **children;
+	
+	/// Attribute name and value pairs sorted by name, or NULL if not indexed
+	char ***atts;
+	
+} cfg_index_t;
 
-	/// Pointer to the resource
-	void *resource;	
+/// A lookup index table entry
+typedef struct cfg_index_entry_t {
+	
+	/// The indexed configuration element
+	const cp_cfg_element_t *element;
+	
+	/// The lookup index, or NULL once the element has been unregistered
+	cfg_index_t *index;
+	
+} cfg_index_entry_t;
 
-	/// Usage count for the resource
-	int usage_count;
+/// A lookup index table, replaced rather than modified
+typedef struct cfg_index_table_t {
+	
+	/// The link used when the table is retired, must be the first member
+	cpi_retired_t retired;
 	
-	/// Deallocation function
-	cpi_dealloc_func_t dealloc_func;
+	/// The number of entries
+	unsigned int num_entries;
+	
+	/// The entries sorted by element
+	cfg_index_entry_t *entries;
+	
+} cfg_index_table_t;
+
+/// A step of a compiled configuration path
+typedef struct cfg_path_step_t {
+	
+	/// The child element name, or NULL to step to the parent element
+	const char *name;
+	
+	/// The length of the name
+	size_t len;
+	
+} cfg_path_step_t;
+
+/// A compiled configuration path
+struct cp_cfg_path_t {
+	
+	/// The number of steps
+	unsigned int num_steps;
+	
+	/// The steps
+	cfg_path_step_t *steps;
+	
+	/// The attribute name, or NULL to select the element value
+	const char *attr;
 	
-} info_resource_t;
+};
 
 /// A plug-in listener registration
 typedef struct el_holder_t {
@@ -72,6 +129,22 @@ typedef struct el_holder_t {
 } el_holder_t;
 
 
+/* ------------------------------------------------------------------------
+ * Variables
+ * ----------------------------------------------------------------------*/
+
+/**
+ * Lookup indexes of the configuration elements of registered plug-in
+ * information. Lookups read the table without locking. The table is
+ * replaced, holding the framework lock, when plug-in information is
+ * registered or unregistered; the only change made to a published table
+ * is clearing the index of an unregistered element.
+ */
+static cfg_index_table_t *cfg_index_table = NULL;
+
+/// Reader epochs of the lookup index tables, the framework lock as writer lock
+static cpi_epochs_t cfg_index_epochs;
+
 
 /* ------------------------------------------------------------------------
  * Function definitions
@@ -79,56 +152,59 @@ typedef struct el_holder_t {
 
 // General information object management
 
+CP_HIDDEN void *cpi_malloc_info(size_t size) {
+	cpi_info_header_t *header;
+	
+	if ((header = malloc(sizeof(cpi_info_header_t) + size)) == NULL) {
+		return NULL;
+	}
+	return header + 1;
+}
+
+CP_HIDDEN void cpi_free_info(void *info) {
+	if (info != NULL) {
+		free(CPI_INFO_HEADER(info));
+	}
+}
+
 CP_HIDDEN cp_status_t cpi_register_info(cp_context_t *context, void *res, cpi_dealloc_func_t df) {
-	cp_status_t status = CP_OK;
-	info_resource_t *ir = NULL;
+	cpi_info_header_t *header;
 
 	assert(context != NULL);
 	assert(res != NULL);
 	assert(df != NULL);
 	assert(cpi_is_context_locked(context));
-	do {
-		if ((ir = malloc(sizeof(info_resource_t))) == NULL) {
-			status = CP_ERR_RESOURCE;
-			break;
-		}
-		ir->resource = res;
-		ir->usage_count = 1;
-		ir->dealloc_func = df;
-		if (!hash_alloc_insert(context->env->infos, res, ir)) {
-			status = CP_ERR_RESOURCE;
-			break;
-		}
-	} while (0);
-	
-	// Report success
-	if (status == CP_OK) {
-		cpi_debugf(context, N_("Registered a new reference counted object at address %p."), res);
-	}		
-	
-	// Release resources on failure
-	if (status != CP_OK) {
-		if (ir != NULL) {
-			free(ir);
-		}
+	header = CPI_INFO_HEADER(res);
+	header->usage_count = 1;
+	header->dealloc_func = df;
+	if (!hash_alloc_insert(context->env->infos, res, res)) {
+		return CP_ERR_RESOURCE;
 	}
-	
-	return status;
+	cpi_debugf(context, N_("Registered a new reference counted object at address %p."), res);
+	return CP_OK;
 }
 
 CP_HIDDEN void cpi_use_info(cp_context_t *context, void *res) {
-	hnode_t *node;
-	
 	assert(context != NULL);
 	assert(res != NULL);
 	assert(cpi_is_context_locked(context));
-	if ((node = hash_lookup(context->env->infos, res)) != NULL) {
-		info_resource_t *ir = hnode_get(node);
-		ir->usage_count++;
-		cpi_debugf(context, N_("Reference count of the object at address %p increased to %d."), res, ir->usage_count);
-	} else {
+	if (hash_lookup(context->env->infos, res) == NULL) {
 		cpi_fatalf(_("Attempt to increase the reference count of an unknown object at address %p."), res);
 	}
+	cpi_atomic_add_int(&(CPI_INFO_HEADER(res)->usage_count), 1);
+}
+
+/**
+ * Increases the reference count of an information object without locking
+ * the context. The object must be known to be registered and referenced
+ * for the duration of the call, for example by a pinned registry snapshot.
+ * 
+ * @param info the information object
+ */
+static void use_referenced_info(void *info) {
+	if (cpi_atomic_add_int(&(CPI_INFO_HEADER(info)->usage_count), 1) <= 1) {
+		cpi_fatalf(_("Attempt to increase the reference count of an unknown object at address %p."), info);
+	}
 }
 
 CP_HIDDEN void cpi_release_info(cp_context_t *context, void *info) {
@@ -137,20 +213,14 @@ CP_HIDDEN void cpi_release_info(cp_context_t *context, void *info) {
 	assert(context != NULL);
 	assert(info != NULL);
 	assert(cpi_is_context_locked(context));
-	if ((node = hash_lookup(context->env->infos, info)) != NULL) {
-		info_resource_t *ir = hnode_get(node);
-		assert(ir != NULL && info == ir->resource);
-		ir->usage_count--;
-		cpi_debugf(context, N_("Reference count of the object at address %p decreased to %d."), info, ir->usage_count);
-		if (ir->usage_count == 0) {
-			hash_delete_free(context->env->infos, node);
-			ir->dealloc_func(context, info);
-			cpi_debugf(context, N_("Deallocated the reference counted object at address %p."), info);
-			free(ir);
-		}
-	} else {
+	if ((node = hash_lookup(context->env->infos, info)) == NULL) {
 		cpi_fatalf(_("Attempt to release an unknown reference counted object at address %p."), info);
 	}
+	if (cpi_atomic_add_int(&(CPI_INFO_HEADER(info)->usage_count), -1) == 0) {
+		hash_delete_free(context->env->infos, node);
+		CPI_INFO_HEADER(info)->dealloc_func(context, info);
+		cpi_debugf(context, N_("Deallocated the reference counted object at address %p."), info);
+	}
 }
 
 CP_C_API void cp_release_info(cp_context_t *context, void *info) {
@@ -166,15 +236,464 @@ CP_HIDDEN void cpi_release_infos(cp_context_t *context) {
 	hscan_t scan;
 	hnode_t *node;
 		
+	cpi_lock_context(context);
 	hash_scan_begin(&scan, context->env->infos);
 	while ((node = hash_scan_next(&scan)) != NULL) {
-		info_resource_t *ir = hnode_get(node);			
+		void *info = hnode_get(node);
+		
+		cpi_errorf(context, N_("An unreleased information object was encountered at address %p with reference count %d when destroying the associated plug-in context. Not releasing the object."), info, CPI_INFO_HEADER(info)->usage_count);
+		hash_scan_delfree(context->env->infos, node);
+	}
+	cpi_unlock_context(context);
+}
+
+
+// Interning plug-in information
+
+/**
+ * Replaces a string reference with the interned copy of the string.
+ * 
+ * @param context the plug-in context
+ * @param str the string reference
+ * @return whether successful
+ */
+static int intern_string_ref(cp_context_t *context, char **str) {
+	char *istr;
+	
+	if (*str == NULL) {
+		return 1;
+	}
+	if ((istr = cpi_intern_string(context, *str)) == NULL) {
+		return 0;
+	}
+	*str = istr;
+	return 1;
+}
+
+/**
+ * Releases an interned string reference.
+ * 
+ * @param context the plug-in context
+ * @param str the string reference
+ * @return always non-zero
+ */
+static int release_string_ref(cp_context_t *context, char **str) {
+	if (*str != NULL) {
+		cpi_release_string(context, *str);
+	}
+	return 1;
+}
+
+/**
+ * Applies a function to the identifier references of plug-in information
+ * in a fixed order until the function fails or the limit is reached.
+ * 
+ * @param context the plug-in context
+ * @param plugin the plug-in information
+ * @param func the function to be applied
+ * @param limit the maximum number of references to process
+ * @return the number of references processed successfully
+ */
+static unsigned int process_plugin_strings(cp_context_t *context, cp_plugin_info_t *plugin, int (*func)(cp_context_t *, char **), unsigned int limit) {
+	unsigned int n = 0;
+	unsigned int i;
+	
+	if (n < limit && func(context, &(plugin->identifier))) {
+		n++;
+	} else {
+		return n;
+	}
+	for (i = 0; i < plugin->num_imports; i++, n++) {
+		if (n >= limit || !func(context, &(plugin->imports[i].plugin_id))) {
+			return n;
+		}
+	}
+	for (i = 0; i < plugin->num_ext_points; i++, n++) {
+		if (n >= limit || !func(context, &(plugin->ext_points[i].identifier))) {
+			return n;
+		}
+	}
+	for (i = 0; i < plugin->num_extensions; i++, n++) {
+		if (n >= limit || !func(context, &(plugin->extensions[i].ext_point_id))) {
+			return n;
+		}
+	}
+	return n;
+}
+
+CP_HIDDEN cp_status_t cpi_intern_plugin_info(cp_context_t *context, cp_plugin_info_t *plugin) {
+	unsigned int n;
+	
+	assert(cpi_is_context_locked(context));
+	n = process_plugin_strings(context, plugin, intern_string_ref, UINT_MAX);
+	if (n < 1 + plugin->num_imports + plugin->num_ext_points + plugin->num_extensions) {
+		
+		// Release the strings interned before the failure
+		process_plugin_strings(context, plugin, release_string_ref, n);
+		return CP_ERR_RESOURCE;
+	}
+	return CP_OK;
+}
+
+CP_HIDDEN void cpi_unintern_plugin_info(cp_context_t *context, cp_plugin_info_t *plugin) {
+	assert(cpi_is_context_locked(context));
+	process_plugin_strings(context, plugin, release_string_ref, UINT_MAX);
+}
+
+
+// Registry snapshots
+
+/*
+ * Writers replace the published snapshot while holding the context lock
+ * and retire the old one. Lock-free readers pin the published snapshot by
+ * entering a reader epoch, and retired snapshots are freed once the
+ * readers which might still use them have left, by the writer or by the
+ * last such reader.
+ */
+
+/**
+ * Releases and frees a registry snapshot.
+ * 
+ * @param context the plug-in context
+ * @param snapshot the snapshot
+ */
+static void free_registry_snapshot(cp_context_t *context, cpi_registry_snapshot_t *snapshot) {
+	int i;
+	
+	if (snapshot->plugins_info != NULL) {
+		cpi_release_info(context, snapshot->plugins_info);
+	}
+	if (snapshot->ext_points_info != NULL) {
+		cpi_release_info(context, snapshot->ext_points_info);
+	}
+	if (snapshot->no_extensions_info != NULL) {
+		cpi_release_info(context, snapshot->no_extensions_info);
+	}
+	if (snapshot->all_extensions.info != NULL) {
+		cpi_release_info(context, snapshot->all_extensions.info);
+	}
+	for (i = 0; i < snapshot->num_ext_point_ids; i++) {
+		if (snapshot->ext_point_extensions[i].info != NULL) {
+			cpi_release_info(context, snapshot->ext_point_extensions[i].info);
+		}
+	}
+	for (i = 0; i < snapshot->num_plugins; i++) {
+		cpi_release_info(context, snapshot->plugins[i].plugin);
+	}
+	free(snapshot->plugins);
+	free(snapshot->plugin_infos);
+	free(snapshot->ext_points);
+	free(snapshot->all_extensions.extensions);
+	free(snapshot->ext_point_extensions);
+	free(snapshot);
+}
+
+/**
+ * Frees the retired registry snapshots no longer used by any reader. The
+ * caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ */
+static void reclaim_registry_snapshots(cp_context_t *context) {
+	cpi_retired_t *retired;
+	
+	assert(cpi_is_context_locked(context));
+	retired = cpi_reclaim_retired(&(context->env->registry_epochs));
+	while (retired != NULL) {
+		cpi_retired_t *next = retired->next;
+		
+		free_registry_snapshot(context, (cpi_registry_snapshot_t *) retired);
+		retired = next;
+	}
+}
+
+static int comp_snapshot_plugin(const void *p1, const void *p2) {
+	const cpi_snapshot_plugin_t *sp1 = p1;
+	const cpi_snapshot_plugin_t *sp2 = p2;
+	
+	return strcmp(sp1->identifier, sp2->identifier);
+}
+
+static int comp_snapshot_extensions(const void *p1, const void *p2) {
+	const cpi_snapshot_extensions_t *se1 = p1;
+	const cpi_snapshot_extensions_t *se2 = p2;
+	
+	return strcmp(se1->ext_point_id, se2->ext_point_id);
+}
+
+/**
+ * Builds a snapshot of the current plug-in registry. The caller must have
+ * locked the context.
+ * 
+ * @param context the plug-in context
+ * @return the snapshot or NULL if out of resources
+ */
+static cpi_registry_snapshot_t *build_registry_snapshot(cp_context_t *context) {
+	cp_plugin_env_t *env = context->env;
+	cpi_registry_snapshot_t *snapshot;
+	hscan_t scan;
+	hnode_t *hnode;
+	int i, n, ne = 0;
+	
+	// Allocate the snapshot
+	hash_scan_begin(&scan, env->extensions);
+	while ((hnode = hash_scan_next(&scan)) != NULL) {
+		ne += list_count((list_t *) hnode_get(hnode));
+	}
+	if ((snapshot = calloc(1, sizeof(cpi_registry_snapshot_t))) == NULL) {
+		return NULL;
+	}
+	n = hash_count(env->plugins);
+	snapshot->plugins = malloc((n + 1) * sizeof(cpi_snapshot_plugin_t));
+	snapshot->plugin_infos = malloc((n + 1) * sizeof(cp_plugin_info_t *));
+	snapshot->ext_points = malloc((hash_count(env->ext_points) + 1) * sizeof(cp_ext_point_t *));
+	snapshot->all_extensions.extensions = malloc((ne + 1) * sizeof(cp_extension_t *));
+	snapshot->ext_point_extensions = malloc((hash_count(env->extensions) + 1) * sizeof(cpi_snapshot_extensions_t));
+	if (snapshot->plugins == NULL
+		|| snapshot->plugin_infos == NULL
+		|| snapshot->ext_points == NULL
+		|| snapshot->all_extensions.extensions == NULL
+		|| snapshot->ext_point_extensions == NULL) {
+		free_registry_snapshot(context, snapshot);
+		return NULL;
+	}
+	
+	// Take the plug-ins, keeping the registry order for listing them
+	i = 0;
+	hash_scan_begin(&scan, env->plugins);
+	while ((hnode = hash_scan_next(&scan)) != NULL) {
+		cp_plugin_t *rp = hnode_get(hnode);
+		
+		snapshot->plugins[i].identifier = rp->plugin->identifier;
+		snapshot->plugins[i].plugin = rp->plugin;
+		cpi_use_info(context, rp->plugin);
+		snapshot->plugins[i].state = rp->state;
+		snapshot->plugin_infos[i] = rp->plugin;
+		i++;
+	}
+	assert(i == n);
+	snapshot->num_plugins = n;
+	qsort(snapshot->plugins, n, sizeof(cpi_snapshot_plugin_t), comp_snapshot_plugin);
+	
+	// Take the extension points
+	i = 0;
+	hash_scan_begin(&scan, env->ext_points);
+	while ((hnode = hash_scan_next(&scan)) != NULL) {
+		snapshot->ext_points[i++] = hnode_get(hnode);
+	}
+	snapshot->num_ext_points = i;
+	
+	// Take the extensions, grouped by extension point
+	n = 0;
+	hash_scan_begin(&scan, env->extensions);
+	while ((hnode = hash_scan_next(&scan)) != NULL) {
+		list_t *el = hnode_get(hnode);
+		cpi_snapshot_extensions_t *se = snapshot->ext_point_extensions + n;
+		lnode_t *lnode;
+		
+		if (list_isempty(el)) {
+			continue;
+		}
+		se->ext_point_id = hnode_getkey(hnode);
+		se->extensions = snapshot->all_extensions.extensions + snapshot->all_extensions.num;
+		se->num = 0;
+		se->info = NULL;
+		for (lnode = list_first(el); lnode != NULL; lnode = list_next(el, lnode)) {
+			se->extensions[se->num++] = lnode_get(lnode);
+		}
+		snapshot->all_extensions.num += se->num;
+		n++;
+	}
+	assert(snapshot->all_extensions.num == ne);
+	snapshot->num_ext_point_ids = n;
+	qsort(snapshot->ext_point_extensions, n, sizeof(cpi_snapshot_extensions_t), comp_snapshot_extensions);
+	
+	return snapshot;
+}
+
+/**
+ * Publishes an up to date registry snapshot, or none if it can not be
+ * built, and retires the previously published one. The caller must have
+ * locked the context.
+ * 
+ * @param context the plug-in context
+ * @param rebuild whether to build a new snapshot
+ */
+static void publish_registry_snapshot(cp_context_t *context, int rebuild) {
+	cpi_registry_snapshot_t *old = context->env->registry;
+	cpi_registry_snapshot_t *snapshot = NULL;
+	
+	assert(cpi_is_context_locked(context));
+	if (rebuild) {
+		snapshot = build_registry_snapshot(context);
+	}
+	if (!cpi_atomic_cas_ptr(&(context->env->registry), old, snapshot)) {
+		assert(0);
+	}
+	if (old != NULL) {
+		cpi_retire(&(context->env->registry_epochs), &(old->retired));
+	}
+	reclaim_registry_snapshots(context);
+}
+
+CP_HIDDEN void cpi_invalidate_registry(cp_context_t *context) {
+	publish_registry_snapshot(context, 1);
+}
+
+CP_HIDDEN void cpi_release_registry(cp_context_t *context) {
+	publish_registry_snapshot(context, 0);
+	assert(context->env->registry_epochs.retired == NULL);
+	assert(context->env->registry_epochs.expiring == NULL);
+}
+
+/**
+ * Pins the published registry snapshot for reading without locking the
+ * context, publishing one first if necessary. Each call must be matched by
+ * a call to unpin_registry, also if no snapshot is returned.
+ * 
+ * @param context the plug-in context
+ * @param func the name of the calling API function
+ * @param epoch filled with the reader epoch to be passed to unpin_registry
+ * @return the snapshot, or NULL if it could not be built
+ */
+static cpi_registry_snapshot_t *pin_registry(cp_context_t *context, const char *func, int *epoch) {
+	cpi_registry_snapshot_t *snapshot;
+	
+	cpi_check_invocation_unlocked(context, CPI_CF_LOGGER, func);
+	while ((*epoch = cpi_enter_epoch(&(context->env->registry_epochs))) < 0) {
 		cpi_lock_context(context);
-		cpi_errorf(context, N_("An unreleased information object was encountered at address %p with reference count %d when destroying the associated plug-in context. Not releasing the object."), ir->resource, ir->usage_count);
+		reclaim_registry_snapshots(context);
 		cpi_unlock_context(context);
-		hash_scan_delfree(context->env->infos, node);
-		free(ir);
 	}
+	if ((snapshot = cpi_atomic_load_ptr(&(context->env->registry))) == NULL) {
+		
+		// Try again to build a snapshot which previously failed
+		cpi_lock_context(context);
+		if (context->env->registry == NULL) {
+			publish_registry_snapshot(context, 1);
+		}
+		snapshot = context->env->registry;
+		cpi_unlock_context(context);
+	}
+	return snapshot;
+}
+
+/**
+ * Unpins the registry snapshot, freeing retired snapshots if this was the
+ * last reader using them.
+ * 
+ * @param context the plug-in context
+ * @param epoch the reader epoch returned by pin_registry
+ */
+static void unpin_registry(cp_context_t *context, int epoch) {
+	if (cpi_leave_epoch(&(context->env->registry_epochs), epoch)) {
+		cpi_lock_context(context);
+		reclaim_registry_snapshots(context);
+		cpi_unlock_context(context);
+	}
+}
+
+/**
+ * Looks up a plug-in in a registry snapshot.
+ * 
+ * @param snapshot the registry snapshot
+ * @param id the plug-in identifier
+ * @return the plug-in or NULL if not installed
+ */
+static const cpi_snapshot_plugin_t *find_snapshot_plugin(const cpi_registry_snapshot_t *snapshot, const char *id) {
+	cpi_snapshot_plugin_t key;
+	
+	key.identifier = id;
+	return bsearch(&key, snapshot->plugins, snapshot->num_plugins, sizeof(cpi_snapshot_plugin_t), comp_snapshot_plugin);
+}
+
+/**
+ * Looks up the extensions of an extension point in a registry snapshot.
+ * 
+ * @param snapshot the registry snapshot
+ * @param extpt_id the extension point identifier or NULL for all extensions
+ * @return the extensions or NULL if there are none
+ */
+static cpi_snapshot_extensions_t *find_snapshot_extensions(cpi_registry_snapshot_t *snapshot, const char *extpt_id) {
+	cpi_snapshot_extensions_t key;
+	
+	if (extpt_id == NULL) {
+		return &(snapshot->all_extensions);
+	}
+	key.ext_point_id = extpt_id;
+	return bsearch(&key, snapshot->ext_point_extensions, snapshot->num_ext_point_ids, sizeof(cpi_snapshot_extensions_t), comp_snapshot_extensions);
+}
+
+static cp_plugin_info_t *plugin_owner(void *plugin) {
+	return plugin;
+}
+
+static cp_plugin_info_t *ext_point_owner(void *ext_point) {
+	return ((cp_ext_point_t *) ext_point)->plugin;
+}
+
+static cp_plugin_info_t *extension_owner(void *extension) {
+	return ((cp_extension_t *) extension)->plugin;
+}
+
+/**
+ * Returns a referenced information array shared by the users of a
+ * registry snapshot, building it on the first request. The array holds a
+ * reference to the plug-in information of each item.
+ * 
+ * @param context the plug-in context
+ * @param arrayptr the shared array in the snapshot
+ * @param items the items of the array
+ * @param n the number of items
+ * @param owner returns the plug-in information of an item
+ * @param df the deallocation function of the array
+ * @return the array or NULL if out of resources
+ */
+static void *use_snapshot_array(cp_context_t *context, void **arrayptr, void **items, int n, cp_plugin_info_t *(*owner)(void *), cpi_dealloc_func_t df) {
+	void **array;
+	int i;
+	
+	if ((array = cpi_atomic_load_ptr(arrayptr)) == NULL) {
+		cpi_lock_context(context);
+		if ((array = *arrayptr) == NULL
+			&& (array = cpi_malloc_info(sizeof(void *) * (n + 1))) != NULL) {
+			for (i = 0; i < n; i++) {
+				cpi_use_info(context, owner(items[i]));
+				array[i] = items[i];
+			}
+			array[n] = NULL;
+			if (cpi_register_info(context, array, df) != CP_OK) {
+				df(context, array);
+				array = NULL;
+			} else if (!cpi_atomic_cas_ptr(arrayptr, NULL, array)) {
+				assert(0);
+			}
+		}
+		cpi_unlock_context(context);
+	}
+	if (array != NULL) {
+		use_referenced_info(array);
+	}
+	return array;
+}
+
+/**
+ * Returns the status of an information query and reports running out of
+ * resources.
+ * 
+ * @param context the plug-in context
+ * @param info the returned information or NULL on failure
+ * @param msg the error message
+ * @return CP_OK (0) on success, CP_ERR_RESOURCE if out of resources
+ */
+static cp_status_t info_status(cp_context_t *context, const void *info, const char *msg) {
+	if (info != NULL) {
+		return CP_OK;
+	}
+	cpi_lock_context(context);
+	cpi_error(context, msg);
+	cpi_unlock_context(context);
+	return CP_ERR_RESOURCE;
 }
 
 
@@ -189,6 +708,28 @@ CP_C_API cp_plugin_info_t * cp_get_plugin_info(cp_context_t *context, const char
 	if (id == NULL && context->plugin == NULL) {
 		cpi_fatalf(_("The plug-in identifier argument to cp_get_plugin_info must not be NULL when the main program calls it."));
 	}
+	
+	// Look up installed plug-ins from the registry snapshot
+	if (id != NULL) {
+		cpi_registry_snapshot_t *snapshot;
+		int epoch;
+		
+		if ((snapshot = pin_registry(context, __func__, &epoch)) != NULL) {
+			const cpi_snapshot_plugin_t *sp;
+			
+			if ((sp = find_snapshot_plugin(snapshot, id)) != NULL) {
+				plugin = sp->plugin;
+				use_referenced_info(plugin);
+			}
+		}
+		unpin_registry(context, epoch);
+		if (plugin != NULL) {
+			if (error != NULL) {
+				*error = CP_OK;
+			}
+			return plugin;
+		}
+	}
 
 	// Look up the plug-in and return information 
 	cpi_lock_context(context);
@@ -225,60 +766,27 @@ static void dealloc_plugins_info(cp_context_t *context, cp_plugin_info_t **plugi
 	for (i = 0; plugins[i] != NULL; i++) {
 		cpi_release_info(context, plugins[i]);
 	}
-	free(plugins);
+	cpi_free_info(plugins);
 }
 
 CP_C_API cp_plugin_info_t ** cp_get_plugins_info(cp_context_t *context, cp_status_t *error, int *num) {
+	cpi_registry_snapshot_t *snapshot;
 	cp_plugin_info_t **plugins = NULL;
-	int i, n;
-	cp_status_t status = CP_OK;
+	int n = 0, epoch;
+	cp_status_t status;
 	
 	CHECK_NOT_NULL(context);
 	
-	cpi_lock_context(context);
-	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
-	do {
-		hscan_t scan;
-		hnode_t *node;
-		
-		// Allocate space for pointer array 
-		n = hash_count(context->env->plugins);
-		if ((plugins = malloc(sizeof(cp_plugin_info_t *) * (n + 1))) == NULL) {
-			status = CP_ERR_RESOURCE;
-			break;
-		}
-		
-		// Get plug-in information structures 
-		hash_scan_begin(&scan, context->env->plugins);
-		i = 0;
-		while ((node = hash_scan_next(&scan)) != NULL) {
-			cp_plugin_t *rp = hnode_get(node);
-			
-			assert(i < n);
-			cpi_use_info(context, rp->plugin);
-			plugins[i] = rp->plugin;
-			i++;
-		}
-		plugins[i] = NULL;
-		
-		// Register the array
-		status = cpi_register_info(context, plugins, (void (*)(cp_context_t *, void *)) dealloc_plugins_info);
-		
-	} while (0);
-
-	// Report error
-	if (status != CP_OK) {
-		cpi_error(context, N_("Plug-in information could not be returned due to insufficient memory."));
-	}
-	cpi_unlock_context(context);
-
-	// Release resources on error 
-	if (status != CP_OK) {
-		if (plugins != NULL) {
-			dealloc_plugins_info(context, plugins);
-			plugins = NULL;
-		}
+	// Return the shared array of the registry snapshot
+	if ((snapshot = pin_registry(context, __func__, &epoch)) != NULL) {
+		n = snapshot->num_plugins;
+		plugins = use_snapshot_array(context,
+			(void **) &(snapshot->plugins_info),
+			(void **) snapshot->plugin_infos, n, plugin_owner,
+			(cpi_dealloc_func_t) dealloc_plugins_info);
 	}
+	unpin_registry(context, epoch);
+	status = info_status(context, plugins, N_("Plug-in information could not be returned due to insufficient memory."));
 	
 	assert(status != CP_OK || n == 0 || plugins[n - 1] != NULL);
 	if (error != NULL) {
@@ -292,12 +800,26 @@ CP_C_API cp_plugin_info_t ** cp_get_plugins_info(cp_context_t *context, cp_statu
 
 CP_C_API cp_plugin_state_t cp_get_plugin_state(cp_context_t *context, const char *id) {
 	cp_plugin_state_t state = CP_PLUGIN_UNINSTALLED;
+	cpi_registry_snapshot_t *snapshot;
 	hnode_t *hnode;
+	int epoch;
 	
 	CHECK_NOT_NULL(context);
 	CHECK_NOT_NULL(id);
 	
-	// Look up the plug-in state 
+	// Look up the plug-in state from the registry snapshot
+	if ((snapshot = pin_registry(context, __func__, &epoch)) != NULL) {
+		const cpi_snapshot_plugin_t *sp;
+		
+		if ((sp = find_snapshot_plugin(snapshot, id)) != NULL) {
+			state = sp->state;
+		}
+		unpin_registry(context, epoch);
+		return state;
+	}
+	unpin_registry(context, epoch);
+	
+	// Fall back to the registry if the snapshot could not be built
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
 	if ((hnode = hash_lookup(context->env->plugins, id)) != NULL) {
@@ -316,60 +838,27 @@ static void dealloc_ext_points_info(cp_context_t *context, cp_ext_point_t **ext_
 	for (i = 0; ext_points[i] != NULL; i++) {
 		cpi_release_info(context, ext_points[i]->plugin);
 	}
-	free(ext_points);
+	cpi_free_info(ext_points);
 }
 
 CP_C_API cp_ext_point_t ** cp_get_ext_points_info(cp_context_t *context, cp_status_t *error, int *num) {
+	cpi_registry_snapshot_t *snapshot;
 	cp_ext_point_t **ext_points = NULL;
-	int i, n;
-	cp_status_t status = CP_OK;
+	int n = 0, epoch;
+	cp_status_t status;
 	
 	CHECK_NOT_NULL(context);
 	
-	cpi_lock_context(context);
-	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
-	do {
-		hscan_t scan;
-		hnode_t *node;
-		
-		// Allocate space for pointer array 
-		n = hash_count(context->env->ext_points);
-		if ((ext_points = malloc(sizeof(cp_ext_point_t *) * (n + 1))) == NULL) {
-			status = CP_ERR_RESOURCE;
-			break;
-		}
-		
-		// Get extension point information structures 
-		hash_scan_begin(&scan, context->env->ext_points);
-		i = 0;
-		while ((node = hash_scan_next(&scan)) != NULL) {
-			cp_ext_point_t *ep = hnode_get(node);
-			
-			assert(i < n);
-			cpi_use_info(context, ep->plugin);
-			ext_points[i] = ep;
-			i++;
-		}
-		ext_points[i] = NULL;
-		
-		// Register the array
-		status = cpi_register_info(context, ext_points, (void (*)(cp_context_t *, void *)) dealloc_ext_points_info);
-		
-	} while (0);
-	
-	// Report error
-	if (status != CP_OK) {
-		cpi_error(context, N_("Extension point information could not be returned due to insufficient memory."));
-	}
-	cpi_unlock_context(context);
-	
-	// Release resources on error 
-	if (status != CP_OK) {
-		if (ext_points != NULL) {
-			dealloc_ext_points_info(context, ext_points);
-			ext_points = NULL;
-		}
+	// Return the shared array of the registry snapshot
+	if ((snapshot = pin_registry(context, __func__, &epoch)) != NULL) {
+		n = snapshot->num_ext_points;
+		ext_points = use_snapshot_array(context,
+			(void **) &(snapshot->ext_points_info),
+			(void **) snapshot->ext_points, n, ext_point_owner,
+			(cpi_dealloc_func_t) dealloc_ext_points_info);
 	}
+	unpin_registry(context, epoch);
+	status = info_status(context, ext_points, N_("Extension point information could not be returned due to insufficient memory."));
 	
 	assert(status != CP_OK || n == 0 || ext_points[n - 1] != NULL);
 	if (error != NULL) {
@@ -389,112 +878,108 @@ static void dealloc_extensions_info(cp_context_t *context, cp_extension_t **exte
 	for (i = 0; extensions[i] != NULL; i++) {
 		cpi_release_info(context, extensions[i]->plugin);
 	}
-	free(extensions);
+	cpi_free_info(extensions);
+}
+
+/**
+ * Returns the referenced extension array of a registry snapshot shared by
+ * the extension information queries.
+ * 
+ * @param context the plug-in context
+ * @param snapshot the registry snapshot
+ * @param se the extensions or NULL if there are none
+ * @return the array or NULL if out of resources
+ */
+static cp_extension_t **use_snapshot_extensions(cp_context_t *context, cpi_registry_snapshot_t *snapshot, cpi_snapshot_extensions_t *se) {
+	if (se != NULL) {
+		return use_snapshot_array(context, (void **) &(se->info),
+			(void **) se->extensions, se->num, extension_owner,
+			(cpi_dealloc_func_t) dealloc_extensions_info);
+	} else {
+		return use_snapshot_array(context,
+			(void **) &(snapshot->no_extensions_info), NULL, 0,
+			extension_owner, (cpi_dealloc_func_t) dealloc_extensions_info);
+	}
 }
 
 CP_C_API cp_extension_t ** cp_get_extensions_info(cp_context_t *context, const char *extpt_id, cp_status_t *error, int *num) {
+	cpi_registry_snapshot_t *snapshot;
 	cp_extension_t **extensions = NULL;
-	int i, n;
-	cp_status_t status = CP_OK;
+	int n = 0, epoch;
+	cp_status_t status;
 	
 	CHECK_NOT_NULL(context);
 	
-	cpi_lock_context(context);
-	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
-	do {
-		hscan_t scan;
-		hnode_t *hnode;
-
-		// Count the number of extensions
-		if (extpt_id != NULL) {
-			if ((hnode = hash_lookup(context->env->extensions, extpt_id)) != NULL) {
-				n = list_count((list_t *) hnode_get(hnode));
-			} else {
-				n = 0;
-			}
-		} else {
-			hscan_t scan;
-			
-			n = 0;
-			hash_scan_begin(&scan, context->env->extensions);
-			while ((hnode = hash_scan_next(&scan)) != NULL) {
-				n += list_count((list_t *) hnode_get(hnode));
-			}
-		}
-		
-		// Allocate space for pointer array 
-		if ((extensions = malloc(sizeof(cp_extension_t *) * (n + 1))) == NULL) {
-			status = CP_ERR_RESOURCE;
-			break;
-		}
-		
-		// Get extension information structures
-		if (extpt_id != NULL) {
-			i = 0;
-			if ((hnode = hash_lookup(context->env->extensions, extpt_id)) != NULL) {
-				list_t *el = hnode_get(hnode);
-				lnode_t *lnode;
-				
-				lnode = list_first(el);
-				while (lnode != NULL) {
-					cp_extension_t *e = lnode_get(lnode);
-				
-					assert(i < n);
-					cpi_use_info(context, e->plugin);
-					extensions[i] = e;
-					i++;
-					lnode = list_next(el, lnode);
-				}
-			}
-			extensions[i] = NULL;
-		} else { 
-			hash_scan_begin(&scan, context->env->extensions);
-			i = 0;
-			while ((hnode = hash_scan_next(&scan)) != NULL) {
-				list_t *el = hnode_get(hnode);
-				lnode_t *lnode;
-			
-				lnode = list_first(el);
-				while (lnode != NULL) {
-					cp_extension_t *e = lnode_get(lnode);
-				
-					assert(i < n);
-					cpi_use_info(context, e->plugin);
-					extensions[i] = e;
-					i++;
-					lnode = list_next(el, lnode);
-				}
-			}
-		}
-		extensions[i] = NULL;
-		
-		// Register the array
-		status = cpi_register_info(context, extensions, (void (*)(cp_context_t *, void *)) dealloc_extensions_info);
+	// Return the shared array of the registry snapshot
+	if ((snapshot = pin_registry(context, __func__, &epoch)) != NULL) {
+		cpi_snapshot_extensions_t *se;
 		
-	} while (0);
-	
-	// Report error
-	if (status != CP_OK) {
-		cpi_error(context, N_("Extension information could not be returned due to insufficient memory."));
-	}
-	cpi_unlock_context(context);
-	
-	// Release resources on error 
-	if (status != CP_OK) {
-		if (extensions != NULL) {
-			dealloc_extensions_info(context, extensions);
-			extensions = NULL;
+		if ((se = find_snapshot_extensions(snapshot, extpt_id)) != NULL) {
+			n = se->num;
 		}
+		extensions = use_snapshot_extensions(context, snapshot, se);
 	}
+	unpin_registry(context, epoch);
+	status = info_status(context, extensions, N_("Extension information could not be returned due to insufficient memory."));
 	
 	assert(status != CP_OK || n == 0 || extensions[n - 1] != NULL);
 	if (error != NULL) {
 		*error = status;
 	}
-	if (num != NULL && status == CP_OK) {
-		*num = n;
+	if (num != NULL && status == CP_OK) {
+		*num = n;
+	}
+	return extensions;
+}
+
+CP_C_API cp_status_t cp_ext_iter_begin(cp_context_t *context, cp_ext_iter_t *iter, const char *extpt_id) {
+	cpi_registry_snapshot_t *snapshot;
+	cp_status_t status = CP_OK;
+	int epoch;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(iter);
+	
+	// Iterate over the shared array of the registry snapshot, if any
+	iter->context = context;
+	iter->extensions = NULL;
+	iter->index = 0;
+	if ((snapshot = pin_registry(context, __func__, &epoch)) != NULL) {
+		cpi_snapshot_extensions_t *se;
+		
+		if ((se = find_snapshot_extensions(snapshot, extpt_id)) != NULL
+			&& se->num > 0
+			&& (iter->extensions = use_snapshot_extensions(context, snapshot, se)) == NULL) {
+			status = CP_ERR_RESOURCE;
+		}
+	} else {
+		status = CP_ERR_RESOURCE;
+	}
+	unpin_registry(context, epoch);
+	if (status != CP_OK) {
+		info_status(context, NULL, N_("Extension iteration could not be started due to insufficient memory."));
+	}
+	return status;
+}
+
+CP_C_API cp_extension_t * cp_ext_iter_next(cp_ext_iter_t *iter) {
+	cp_extension_t *e;
+	
+	CHECK_NOT_NULL(iter);
+	if (iter->extensions == NULL
+		|| (e = iter->extensions[iter->index]) == NULL) {
+		return NULL;
+	}
+	iter->index++;
+	return e;
+}
+
+CP_C_API void cp_ext_iter_end(cp_ext_iter_t *iter) {
+	CHECK_NOT_NULL(iter);
+	if (iter->extensions != NULL) {
+		cp_release_info(iter->context, iter->extensions);
+		iter->extensions = NULL;
 	}
-	return extensions;
 }
 
 
@@ -603,14 +1088,13 @@ CP_C_API void cp_unregister_plistener(cp_context_t *context, cp_plugin_listener_
 	cpi_unlock_context(context);
 }
 
-CP_HIDDEN void cpi_deliver_event(cp_context_t *context, const cpi_plugin_event_t *event) {
-	assert(event != NULL);
-	assert(event->plugin_id != NULL);
-	cpi_lock_context(context);
-	context->env->in_event_listener_invocation++;
-	list_process(context->env->plugin_listeners, (void *) event, process_event);
-	context->env->in_event_listener_invocation--;
-	cpi_unlock_context(context);
+/**
+ * Logs the delivery of a plug-in event.
+ * 
+ * @param context the plug-in context
+ * @param event the plug-in event
+ */
+static void log_event(cp_context_t *context, const cpi_plugin_event_t *event) {
 	if (cpi_is_logged(context, CP_LOG_INFO)) {
 		char *str;
 		switch (event->new_state) {
@@ -650,9 +1134,442 @@ CP_HIDDEN void cpi_deliver_event(cp_context_t *context, const cpi_plugin_event_t
 	}
 }
 
+CP_HIDDEN void cpi_deliver_event(cp_context_t *context, const cpi_plugin_event_t *event) {
+	cpi_deliver_events(context, event, 1);
+}
+
+CP_HIDDEN void cpi_deliver_events(cp_context_t *context, const cpi_plugin_event_t *events, int num_events) {
+	int i;
+	
+	assert(events != NULL || num_events == 0);
+	cpi_lock_context(context);
+	
+	// Every plug-in state change is delivered as an event
+	cpi_invalidate_registry(context);
+	
+	cpi_atomic_add_int(&(context->env->in_event_listener_invocation), 1);
+	for (i = 0; i < num_events; i++) {
+		assert(events[i].plugin_id != NULL);
+		list_process(context->env->plugin_listeners, (void *) (events + i), process_event);
+	}
+	cpi_atomic_add_int(&(context->env->in_event_listener_invocation), -1);
+	cpi_unlock_context(context);
+	for (i = 0; i < num_events; i++) {
+		log_event(context, events + i);
+	}
+}
+
 
 // Configuration element helpers
 
+static int comp_cfg_children(const void *p1, const void *p2) {
+	cp_cfg_element_t *e1 = *((cp_cfg_element_t * const *) p1);
+	cp_cfg_element_t *e2 = *((cp_cfg_element_t * const *) p2);
+	int c;
+	
+	// Keep the children with the same name in document order
+	if ((c = strcmp(e1->name, e2->name)) == 0) {
+		c = (e1 < e2 ? -1 : (e1 > e2 ? 1 : 0));
+	}
+	return c;
+}
+
+static int comp_cfg_atts(const void *p1, const void *p2) {
+	char **a1 = *((char ** const *) p1);
+	char **a2 = *((char ** const *) p2);
+	int c;
+	
+	if ((c = strcmp(a1[0], a2[0])) == 0) {
+		c = (a1 < a2 ? -1 : (a1 > a2 ? 1 : 0));
+	}
+	return c;
+}
+
+/**
+ * Returns whether a configuration element is large enough to be indexed.
+ * 
+ * @param ce the configuration element
+ * @return non-zero if the element should be indexed
+ */
+static int is_cfg_indexable(const cp_cfg_element_t *ce) {
+	return (ce->num_children >= CFG_INDEX_MIN_SIZE
+		|| ce->num_atts >= CFG_INDEX_MIN_SIZE);
+}
+
+/**
+ * Builds a lookup index for a configuration element.
+ * 
+ * @param ce the configuration element
+ * @return the lookup index, or NULL if memory allocation failed
+ */
+static cfg_index_t *build_cfg_index(cp_cfg_element_t *ce) {
+	cfg_index_t *index;
+	unsigned int nc, na, i;
+	
+	nc = (ce->num_children >= CFG_INDEX_MIN_SIZE ? ce->num_children : 0);
+	na = (ce->num_atts >= CFG_INDEX_MIN_SIZE ? ce->num_atts : 0);
+	
+	// Build the index as a single memory block
+	if ((index = malloc(sizeof(cfg_index_t) + nc * sizeof(cp_cfg_element_t *) + na * sizeof(char **))) == NULL) {
+		return NULL;
+	}
+	index->children = NULL;
+	index->atts = NULL;
+	if (nc > 0) {
+		index->children = (cp_cfg_element_t **) (index + 1);
+		for (i = 0; i < nc; i++) {
+			index->children[i] = ce->children + i;
+		}
+		qsort(index->children, nc, sizeof(cp_cfg_element_t *), comp_cfg_children);
+	}
+	if (na > 0) {
+		index->atts = (char ***) (((cp_cfg_element_t **) (index + 1)) + nc);
+		for (i = 0; i < na; i++) {
+			index->atts[i] = ce->atts + 2*i;
+		}
+		qsort(index->atts, na, sizeof(char **), comp_cfg_atts);
+	}
+	return index;
+}
+
+static int comp_cfg_index_entry(const void *p1, const void *p2) {
+	const cp_cfg_element_t *e1 = ((const cfg_index_entry_t *) p1)->element;
+	const cp_cfg_element_t *e2 = ((const cfg_index_entry_t *) p2)->element;
+	
+	return (e1 < e2 ? -1 : (e1 > e2 ? 1 : 0));
+}
+
+/**
+ * Looks up the lookup index table entry of a configuration element.
+ * 
+ * @param table the lookup index table or NULL
+ * @param ce the configuration element
+ * @return the entry or NULL if the element is not in the table
+ */
+static cfg_index_entry_t *find_cfg_index_entry(const cfg_index_table_t *table, const cp_cfg_element_t *ce) {
+	cfg_index_entry_t key;
+	
+	if (table == NULL) {
+		return NULL;
+	}
+	key.element = ce;
+	return bsearch(&key, table->entries, table->num_entries, sizeof(cfg_index_entry_t), comp_cfg_index_entry);
+}
+
+/**
+ * Frees the lookup index tables no longer accessible to lookups. Must be
+ * called holding the framework lock.
+ */
+static void reclaim_cfg_index_tables(void) {
+	cpi_retired_t *retired;
+	
+	retired = cpi_reclaim_retired(&cfg_index_epochs);
+	while (retired != NULL) {
+		cpi_retired_t *next = retired->next;
+		
+		free(retired);
+		retired = next;
+	}
+}
+
+/**
+ * Returns the lookup index of a configuration element without locking.
+ * Only elements of registered plug-in information are indexed so that
+ * elements constructed by the application are never cached. The index
+ * stays valid as long as the caller may access the element.
+ * 
+ * @param ce the configuration element
+ * @return the lookup index, or NULL if the element is not indexed
+ */
+static cfg_index_t *get_cfg_index(cp_cfg_element_t *ce) {
+	cfg_index_t *index = NULL;
+	cfg_index_entry_t *entry;
+	int epoch;
+	
+	if (!is_cfg_indexable(ce)) {
+		return NULL;
+	}
+	while ((epoch = cpi_enter_epoch(&cfg_index_epochs)) < 0) {
+		cpi_lock_framework();
+		reclaim_cfg_index_tables();
+		cpi_unlock_framework();
+	}
+	if ((entry = find_cfg_index_entry(cpi_atomic_load_ptr(&cfg_index_table), ce)) != NULL) {
+		index = cpi_atomic_load_ptr(&(entry->index));
+	}
+	if (cpi_leave_epoch(&cfg_index_epochs, epoch)) {
+		cpi_lock_framework();
+		reclaim_cfg_index_tables();
+		cpi_unlock_framework();
+	}
+	return index;
+}
+
+/**
+ * Compares a possibly non-terminated name to a name.
+ * 
+ * @param name the name being compared
+ * @param key the key to compare to
+ * @param len the length of the key
+ * @return less than, equal to or greater than zero if name is less than, equal to or greater than the key
+ */
+static int comp_name(const char *name, const char *key, size_t len) {
+	int c;
+	
+	if ((c = strncmp(name, key, len)) == 0 && name[len] != '\0') {
+		c = 1;
+	}
+	return c;
+}
+
+/**
+ * Finds the first child element with the specified name.
+ * 
+ * @param base the parent element
+ * @param name the child name, not necessarily NUL terminated
+ * @param len the length of the child name
+ * @return the child element or NULL if not found
+ */
+static cp_cfg_element_t *find_cfg_child(cp_cfg_element_t *base, const char *name, size_t len) {
+	cfg_index_t *index;
+	unsigned int i;
+	
+	// Binary search for the first child with the name
+	if ((index = get_cfg_index(base)) != NULL && index->children != NULL) {
+		unsigned int lo = 0, hi = base->num_children;
+		
+		while (lo < hi) {
+			unsigned int mid = lo + (hi - lo) / 2;
+			if (comp_name(index->children[mid]->name, name, len) < 0) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		if (lo < base->num_children && comp_name(index->children[lo]->name, name, len) == 0) {
+			return index->children[lo];
+		}
+		return NULL;
+	}
+	
+	// Otherwise scan the children
+	for (i = 0; i < base->num_children; i++) {
+		cp_cfg_element_t *e = base->children + i;
+		if (comp_name(e->name, name, len) == 0) {
+			return e;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Finds the value of the first attribute with the specified name.
+ * 
+ * @param e the configuration element
+ * @param name the attribute name
+ * @return the attribute value or NULL if not found
+ */
+static char *find_cfg_attribute(cp_cfg_element_t *e, const char *name) {
+	cfg_index_t *index;
+	unsigned int i;
+	
+	// Binary search for the first attribute with the name
+	if ((index = get_cfg_index(e)) != NULL && index->atts != NULL) {
+		unsigned int lo = 0, hi = e->num_atts;
+		
+		while (lo < hi) {
+			unsigned int mid = lo + (hi - lo) / 2;
+			if (strcmp(index->atts[mid][0], name) < 0) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		if (lo < e->num_atts && !strcmp(index->atts[lo][0], name)) {
+			return index->atts[lo][1];
+		}
+		return NULL;
+	}
+	
+	// Otherwise scan the attributes
+	for (i = 0; i < e->num_atts; i++) {
+		if (!strcmp(name, e->atts[2*i])) {
+			return e->atts[2*i + 1];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Replaces the lookup index table with one containing the entries of the
+ * current table whose elements are still registered and the specified
+ * new entries. Must be called holding the framework lock.
+ * 
+ * @param added the new entries sorted by element, not in the current table
+ * @param num_added the number of new entries
+ * @return whether the table was replaced, otherwise memory allocation failed
+ */
+static int replace_cfg_index_table(const cfg_index_entry_t *added, unsigned int num_added) {
+	cfg_index_table_t *old = cfg_index_table;
+	cfg_index_table_t *table = NULL;
+	unsigned int num_old, n, i, j;
+	
+	num_old = (old != NULL ? old->num_entries : 0);
+	n = num_added;
+	for (i = 0; i < num_old; i++) {
+		if (old->entries[i].index != NULL) {
+			n++;
+		}
+	}
+	
+	// Merge the remaining entries with the new ones
+	if (n > 0) {
+		if ((table = malloc(sizeof(cfg_index_table_t) + n * sizeof(cfg_index_entry_t))) == NULL) {
+			return 0;
+		}
+		table->entries = (cfg_index_entry_t *) (table + 1);
+		table->num_entries = 0;
+		i = j = 0;
+		while (i < num_old || j < num_added) {
+			if (i < num_old && old->entries[i].index == NULL) {
+				i++;
+			} else if (j >= num_added
+				|| (i < num_old && comp_cfg_index_entry(old->entries + i, added + j) < 0)) {
+				table->entries[table->num_entries++] = old->entries[i++];
+			} else {
+				table->entries[table->num_entries++] = added[j++];
+			}
+		}
+	}
+	
+	// Publish the new table and retire the old one
+	if (!cpi_atomic_cas_ptr(&cfg_index_table, old, table)) {
+		assert(0);
+	}
+	if (old != NULL) {
+		cpi_retire(&cfg_index_epochs, &(old->retired));
+	}
+	reclaim_cfg_index_tables();
+	return 1;
+}
+
+/**
+ * Returns the number of indexable elements in a configuration element tree.
+ * 
+ * @param ce the root of the configuration element tree
+ * @return the number of indexable elements
+ */
+static unsigned int count_cfg_indexable(const cp_cfg_element_t *ce) {
+	unsigned int n, i;
+	
+	n = (is_cfg_indexable(ce) ? 1 : 0);
+	for (i = 0; i < ce->num_children; i++) {
+		n += count_cfg_indexable(ce->children + i);
+	}
+	return n;
+}
+
+/**
+ * Builds the lookup indexes of the indexable elements of a configuration
+ * element tree which are not yet indexed. Elements whose index can not be
+ * built are not indexed.
+ * 
+ * @param ce the root of the configuration element tree
+ * @param entries the array to which the new entries are appended
+ * @param num_entries the number of entries in the array, updated
+ */
+static void build_cfg_indexes(cp_cfg_element_t *ce, cfg_index_entry_t *entries, unsigned int *num_entries) {
+	unsigned int i;
+	
+	if (is_cfg_indexable(ce)
+		&& find_cfg_index_entry(cfg_index_table, ce) == NULL
+		&& (entries[*num_entries].index = build_cfg_index(ce)) != NULL) {
+		entries[(*num_entries)++].element = ce;
+	}
+	for (i = 0; i < ce->num_children; i++) {
+		build_cfg_indexes(ce->children + i, entries, num_entries);
+	}
+}
+
+CP_HIDDEN void cpi_add_cfg_indexes(cp_plugin_info_t *plugin) {
+	cfg_index_entry_t *added;
+	unsigned int n = 0, i;
+	
+	for (i = 0; i < plugin->num_extensions; i++) {
+		if (plugin->extensions[i].configuration != NULL) {
+			n += count_cfg_indexable(plugin->extensions[i].configuration);
+		}
+	}
+	if (n == 0 || (added = malloc(n * sizeof(cfg_index_entry_t))) == NULL) {
+		return;
+	}
+	
+	// Build the indexes eagerly so that lookups never modify the table
+	cpi_lock_framework();
+	n = 0;
+	for (i = 0; i < plugin->num_extensions; i++) {
+		if (plugin->extensions[i].configuration != NULL) {
+			build_cfg_indexes(plugin->extensions[i].configuration, added, &n);
+		}
+	}
+	if (n > 0) {
+		qsort(added, n, sizeof(cfg_index_entry_t), comp_cfg_index_entry);
+		if (!replace_cfg_index_table(added, n)) {
+			for (i = 0; i < n; i++) {
+				free(added[i].index);
+			}
+		}
+	}
+	cpi_unlock_framework();
+	free(added);
+}
+
+/**
+ * Clears and frees the lookup indexes of the elements of a configuration
+ * element tree. No lookups may access the elements any more.
+ * 
+ * @param ce the root of the configuration element tree
+ */
+static void free_cfg_indexes(cp_cfg_element_t *ce) {
+	cfg_index_entry_t *entry;
+	unsigned int i;
+	
+	if (is_cfg_indexable(ce)
+		&& (entry = find_cfg_index_entry(cfg_index_table, ce)) != NULL
+		&& entry->index != NULL) {
+		cfg_index_t *index = entry->index;
+		
+		if (!cpi_atomic_cas_ptr(&(entry->index), index, NULL)) {
+			assert(0);
+		}
+		free(index);
+	}
+	for (i = 0; i < ce->num_children; i++) {
+		free_cfg_indexes(ce->children + i);
+	}
+}
+
+CP_HIDDEN void cpi_free_cfg_indexes(cp_plugin_info_t *plugin) {
+	unsigned int i;
+	
+	cpi_lock_framework();
+	if (cfg_index_table != NULL) {
+		for (i = 0; i < plugin->num_extensions; i++) {
+			if (plugin->extensions[i].configuration != NULL) {
+				free_cfg_indexes(plugin->extensions[i].configuration);
+			}
+		}
+		
+		// Drop the cleared entries, or keep them if out of memory
+		replace_cfg_index_table(NULL, 0);
+	}
+	cpi_unlock_framework();
+}
+
+static void dealloc_cfg_path(cp_context_t *context, cp_cfg_path_t *path) {
+	cpi_free_info(path);
+}
+
 static cp_cfg_element_t * lookup_cfg_element(cp_cfg_element_t *base, const char *path, int len) {
 	int start = 0;
 	
@@ -667,20 +1584,7 @@ static cp_cfg_element_t * lookup_cfg_element(cp_cfg_element_t *base, const char
 		if (end - start == 2 && !strncmp(path + start, "..", 2)) {
 			base = base->parent;
 		} else {
-			int i;
-			int found = 0;
-			
-			for (i = 0; !found && i < base->num_children; i++) {
-				cp_cfg_element_t *e = base->children + i;
-				if (end - start == strlen(e->name)
-					&& !strncmp(path + start, e->name, end - start)) {
-					base = e;
-					found = 1;
-				}
-			}
-			if (!found) {
-				base = NULL;
-			}
+			base = find_cfg_child(base, path + start, end - start);
 		}
 		start = end;
 		if (path[start] == '/') {
@@ -694,6 +1598,125 @@ CP_C_API cp_cfg_element_t * cp_lookup_cfg_element(cp_cfg_element_t *base, const
 	return lookup_cfg_element(base, path, -1);
 }
 
+CP_C_API cp_cfg_path_t * cp_compile_cfg_path(cp_context_t *context, const char *path, cp_status_t *error) {
+	cp_cfg_path_t *cpath = NULL;
+	cp_status_t status = CP_OK;
+	const char *attr;
+	size_t len, i, n;
+	char *str;
+	
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(path);
+	
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER, __func__);
+	do {
+		
+		// Count the steps
+		if ((attr = strrchr(path, '@')) != NULL) {
+			len = attr - path;
+			attr++;
+		} else {
+			len = strlen(path);
+		}
+		for (i = 0, n = 0; i < len; n++) {
+			while (i < len && path[i] != '/') {
+				i++;
+			}
+			if (i < len) {
+				i++;
+			}
+		}
+		
+		// Allocate the compiled path with the step names as a single block
+		if ((cpath = cpi_malloc_info(sizeof(cp_cfg_path_t) + n * sizeof(cfg_path_step_t) + strlen(path) + 1)) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		cpath->num_steps = n;
+		cpath->steps = (cfg_path_step_t *) (cpath + 1);
+		str = (char *) (cpath->steps + n);
+		strcpy(str, path);
+		cpath->attr = (attr != NULL ? str + (attr - path) : NULL);
+		
+		// Split the path into steps
+		for (i = 0, n = 0; i < len; n++) {
+			size_t start = i;
+			
+			while (i < len && str[i] != '/') {
+				i++;
+			}
+			if (i - start == 2 && !strncmp(str + start, "..", 2)) {
+				cpath->steps[n].name = NULL;
+			} else {
+				cpath->steps[n].name = str + start;
+			}
+			cpath->steps[n].len = i - start;
+			if (i < len) {
+				i++;
+			}
+		}
+		
+		status = cpi_register_info(context, cpath, (void (*)(cp_context_t *, void *)) dealloc_cfg_path);
+		
+	} while (0);
+	
+	// Release resources on failure
+	if (status != CP_OK) {
+		cpi_error(context, N_("A configuration path could not be compiled due to insufficient memory."));
+		cpi_free_info(cpath);
+		cpath = NULL;
+	}
+	cpi_unlock_context(context);
+	
+	if (error != NULL) {
+		*error = status;
+	}
+	return cpath;
+}
+
+/**
+ * Evaluates the element steps of a compiled configuration path.
+ * 
+ * @param path the compiled path
+ * @param base the base configuration element
+ * @return the target element or NULL if nonexisting
+ */
+static cp_cfg_element_t *eval_cfg_element(const cp_cfg_path_t *path, cp_cfg_element_t *base) {
+	unsigned int i;
+	
+	for (i = 0; base != NULL && i < path->num_steps; i++) {
+		const cfg_path_step_t *step = path->steps + i;
+		
+		if (step->name == NULL) {
+			base = base->parent;
+		} else {
+			base = find_cfg_child(base, step->name, step->len);
+		}
+	}
+	return base;
+}
+
+CP_C_API cp_cfg_element_t * cp_eval_cfg_element(const cp_cfg_path_t *path, cp_cfg_element_t *base) {
+	CHECK_NOT_NULL(path);
+	CHECK_NOT_NULL(base);
+	return eval_cfg_element(path, base);
+}
+
+CP_C_API char * cp_eval_cfg_value(const cp_cfg_path_t *path, cp_cfg_element_t *base) {
+	cp_cfg_element_t *e;
+	
+	CHECK_NOT_NULL(path);
+	CHECK_NOT_NULL(base);
+	if ((e = eval_cfg_element(path, base)) == NULL) {
+		return NULL;
+	} else if (path->attr == NULL) {
+		return e->value;
+	} else {
+		return find_cfg_attribute(e, path->attr);
+	}
+}
+
 CP_C_API char * cp_lookup_cfg_value(cp_cfg_element_t *base, const char *path) {
 	cp_cfg_element_t *e;
 	const char *attr;
@@ -711,14 +1734,7 @@ CP_C_API char * cp_lookup_cfg_value(cp_cfg_element_t *base, const char *path) {
 		if (attr == NULL) {
 			return e->value;
 		} else {
-			int i;
-			
-			for (i = 0; i < e->num_atts; i++) {
-				if (!strcmp(attr, e->atts[2*i])) {
-					return e->atts[2*i + 1];
-				}
-			}
-			return NULL;
+			return find_cfg_attribute(e, attr);
 		}
 	} else {
 		return NULL;
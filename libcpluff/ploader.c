@@ -25,6 +25,7 @@
  * Local plug-in loader
  */
 
+
 #ifdef HAVE_CONFIG_H
 #include <config.h>
 #endif
@@ -33,17 +34,221 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <dirent.h>
 #include <errno.h>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 #include "cpluff.h"
 #include "defines.h"
 #include "util.h"
+#ifdef CP_THREADS
+#include "thread.h"
+#endif
 #include "internal.h"
 
 
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+/// Scan cache file magic number
+#define LPL_CACHE_MAGIC 0x434c5043
+
+/// Scan cache file format version
+#define LPL_CACHE_VERSION 1
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+/// Events watched for plug-in collection directories
+#define LPL_DIR_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+/// Events watched for plug-in directories
+#define LPL_PLUGIN_EVENTS (IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+#endif
+
+
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/// Identifies the state of a plug-in descriptor file
+typedef struct lpl_file_key_t {
+
+	/// The inode number
+	uint64_t ino;
+
+	/// The file size
+	uint64_t size;
+
+	/// The modification time, seconds
+	int64_t mtime;
+
+	/// The modification time, nanoseconds
+	int64_t mtime_nsec;
+
+} lpl_file_key_t;
+
+/// A cached plug-in descriptor
+typedef struct lpl_cache_entry_t {
+
+	/// The name of the plug-in directory within the collection
+	char *name;
+
+	/// The state of the descriptor file when it was cached
+	lpl_file_key_t key;
+
+	/// The binary plug-in image
+	void *image;
+
+	/// The size of the image
+	size_t image_size;
+
+	/// Whether the entry was seen during the latest scan
+	int seen;
+
+} lpl_cache_entry_t;
+
+/// A registered plug-in collection directory
+typedef struct lpl_dir_t {
+
+	/// The directory path
+	char *path;
+
+	/// The scan cache file path, or NULL if not caching
+	char *cache_file;
+
+	/// Cached descriptors keyed by name, or NULL if not loaded yet
+	hash_t *cache;
+
+	/// Whether the cache has been modified since it was loaded or saved
+	int cache_dirty;
+
+	/// Watched plug-in directory entries keyed by name, or NULL if not listed
+	hash_t *entries;
+
+	/// The sequence number given to the next new plug-in directory entry
+	unsigned int next_entry_seq;
+
+	/// The watch descriptor of the directory, or -1 if not watched
+	int wd;
+
+} lpl_dir_t;
+
+/// A plug-in directory entry in a watched collection directory
+typedef struct lpl_entry_t {
+
+	/// The name of the plug-in directory within the collection
+	char *name;
+
+	/// The watch descriptor of the plug-in directory, or -1 if not watched
+	int wd;
+
+	/// Whether the plug-in directory has changed since the latest scan
+	int changed;
+
+	/// Whether loading the plug-in failed during the latest scan
+	int failed;
+
+	/// The order in which the entry was found in the collection directory
+	unsigned int seq;
+
+} lpl_entry_t;
+
+/// A watched directory
+typedef struct lpl_watch_t {
+
+	/// The collection directory
+	lpl_dir_t *dir;
+
+	/// The name of the plug-in directory, or NULL for the collection directory
+	char *name;
+
+} lpl_watch_t;
+
+/// Local plug-in loader data
+typedef struct lpl_data_t {
+
+	/// The registered plug-in directories
+	list_t *dirs;
+
+	/// Maximum number of threads used for parsing plug-in descriptors
+	int scan_threads;
+
+	/// The inotify file descriptor, or -1 if not watching
+	int watch_fd;
+
+	/// Watched directories keyed by watch descriptor, or NULL if not watching
+	hash_t *watches;
+
+} lpl_data_t;
+
+/// A possible plug-in location found during a scan
+typedef struct lpl_candidate_t {
+
+	/// The plug-in path
+	char *path;
+
+	/// The name of the plug-in directory within the collection
+	const char *name;
+
+	/// The collection directory
+	lpl_dir_t *dir;
+
+	/// The watched directory entry, or NULL if not watching
+	lpl_entry_t *entry;
+
+	/// Whether the plug-in directory is known to be unchanged since the latest scan
+	int unchanged;
+
+	/// The state of the descriptor file, if has_key is set
+	lpl_file_key_t key;
+
+	/// Whether the state of the descriptor file is known
+	int has_key;
+
+	/// The loaded plug-in or NULL if none
+	cp_plugin_info_t *plugin;
+
+	/// Whether the plug-in was loaded without parsing and is registered
+	int registered;
+
+} lpl_candidate_t;
+
+#ifdef CP_THREADS
+
+/// Shared state of a parallel plug-in descriptor parsing job
+typedef struct lpl_parse_job_t {
+
+	/// The plug-in context
+	cp_context_t *ctx;
+
+	/// Mutex protecting the job state
+	cpi_mutex_t *mutex;
+
+	/// Plug-in candidates
+	lpl_candidate_t *cands;
+
+	/// Deferred log messages, indexed as candidates
+	list_t *logs;
+
+	/// Number of candidates
+	int num_cands;
+
+	/// Index of the next candidate to be parsed
+	int next_cand;
+
+} lpl_parse_job_t;
+
+#endif
+
+
 /* ------------------------------------------------------------------------
  * Variables
  * ----------------------------------------------------------------------*/
@@ -58,8 +263,112 @@ static list_t *local_ploaders = NULL;
 
 static cp_plugin_info_t **lpl_scan_plugins(void *data, cp_context_t *ctx);
 
+static void free_cache_entry(lpl_cache_entry_t *entry) {
+	free(entry->name);
+	free(entry->image);
+	free(entry);
+}
+
+/**
+ * Releases the cached descriptors of a directory.
+ * 
+ * @param dir the directory
+ */
+static void free_dir_cache(lpl_dir_t *dir) {
+	if (dir->cache != NULL) {
+		hscan_t hscan;
+		hnode_t *hnode;
+		
+		hash_scan_begin(&hscan, dir->cache);
+		while ((hnode = hash_scan_next(&hscan)) != NULL) {
+			lpl_cache_entry_t *entry = hnode_get(hnode);
+			hash_scan_delfree(dir->cache, hnode);
+			free_cache_entry(entry);
+		}
+		hash_destroy(dir->cache);
+		dir->cache = NULL;
+	}
+	dir->cache_dirty = 0;
+}
+
+/**
+ * Removes a watch. Does nothing if the watch descriptor is negative.
+ * 
+ * @param lpl the local plug-in loader data
+ * @param wd the watch descriptor
+ */
+static void remove_watch(lpl_data_t *lpl, int wd) {
+#ifdef HAVE_SYS_INOTIFY_H
+	hnode_t *hnode;
+	
+	if (wd < 0 || lpl->watches == NULL) {
+		return;
+	}
+	inotify_rm_watch(lpl->watch_fd, wd);
+	if ((hnode = hash_lookup(lpl->watches, (void *) (intptr_t) wd)) != NULL) {
+		lpl_watch_t *watch = hnode_get(hnode);
+		
+		hash_delete_free(lpl->watches, hnode);
+		free(watch->name);
+		free(watch);
+	}
+#endif
+}
+
+static void free_entry(lpl_data_t *lpl, lpl_entry_t *entry) {
+	remove_watch(lpl, entry->wd);
+	free(entry->name);
+	free(entry);
+}
+
+/**
+ * Releases the watched entries of a directory and removes the associated
+ * watches. The directory is listed again during the next scan.
+ * 
+ * @param lpl the local plug-in loader data
+ * @param dir the directory
+ */
+static void free_dir_entries(lpl_data_t *lpl, lpl_dir_t *dir) {
+	if (dir->entries != NULL) {
+		hscan_t hscan;
+		hnode_t *hnode;
+		
+		hash_scan_begin(&hscan, dir->entries);
+		while ((hnode = hash_scan_next(&hscan)) != NULL) {
+			lpl_entry_t *entry = hnode_get(hnode);
+			hash_scan_delfree(dir->entries, hnode);
+			free_entry(lpl, entry);
+		}
+		hash_destroy(dir->entries);
+		dir->entries = NULL;
+		dir->next_entry_seq = 0;
+	}
+	remove_watch(lpl, dir->wd);
+	dir->wd = -1;
+}
+
+static void free_dir(lpl_data_t *lpl, lpl_dir_t *dir) {
+	free_dir_entries(lpl, dir);
+	free_dir_cache(dir);
+	free(dir->path);
+	free(dir->cache_file);
+	free(dir);
+}
+
+static void process_free_dir(list_t *list, lnode_t *node, void *lpl) {
+	lpl_dir_t *dir = lnode_get(node);
+	list_delete(list, node);
+	lnode_destroy(node);
+	free_dir(lpl, dir);
+}
+
+static int comp_dir_path(const void *d, const void *path) {
+	return strcmp(((const lpl_dir_t *) d)->path, path);
+}
+
 CP_C_API cp_plugin_loader_t *cp_create_local_ploader(cp_status_t *error) {
 	cp_plugin_loader_t *loader = NULL;
+	lpl_data_t *lpl = NULL;
 	cp_status_t status = CP_OK;
 	
 	// Allocate and initialize a new local plug-in loader
@@ -73,11 +382,18 @@ CP_C_API cp_plugin_loader_t *cp_create_local_ploader(cp_status_t *error) {
 		
 		// Initialize loader
 		memset(loader, 0, sizeof(cp_plugin_loader_t));
-		loader->data = list_create(LISTCOUNT_T_MAX);
 		loader->scan_plugins = lpl_scan_plugins;
 		loader->resolve_files = NULL;
 		loader->release_plugins = NULL;
-		if (loader->data == NULL) {
+		if ((lpl = malloc(sizeof(lpl_data_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		memset(lpl, 0, sizeof(lpl_data_t));
+		loader->data = lpl;
+		lpl->scan_threads = 1;
+		lpl->watch_fd = -1;
+		if ((lpl->dirs = list_create(LISTCOUNT_T_MAX)) == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
@@ -120,21 +436,28 @@ CP_C_API cp_plugin_loader_t *cp_create_local_ploader(cp_status_t *error) {
 }
 
 CP_C_API void cp_destroy_local_ploader(cp_plugin_loader_t *loader) {
-	list_t *dirs;
+	lpl_data_t *lpl;
 	
 	CHECK_NOT_NULL(loader);
 	
-	dirs = (list_t *) loader->data;
-	if (loader->data != NULL) {
-		list_process(dirs, NULL, cpi_process_free_ptr);
-		list_destroy(dirs);
+	lpl = (lpl_data_t *) loader->data;
+	if (lpl != NULL) {
+		
+		// Stop watching while the directories still exist
+		cp_lpl_set_watch(loader, 0);
+		if (lpl->dirs != NULL) {
+			list_process(lpl->dirs, lpl, process_free_dir);
+			list_destroy(lpl->dirs);
+		}
+		free(lpl);
 		loader->data = NULL;
 	}
 	free(loader);
 }
 
 CP_C_API cp_status_t cp_lpl_register_dir(cp_plugin_loader_t *loader, const char *dir) {
-	char *d = NULL;
+	lpl_data_t *lpl;
+	lpl_dir_t *d = NULL;
 	lnode_t *node = NULL;
 	cp_status_t status = CP_OK;
 	list_t *dirs;
@@ -142,24 +465,30 @@ CP_C_API cp_status_t cp_lpl_register_dir(cp_plugin_loader_t *loader, const char
 	CHECK_NOT_NULL(loader);
 	CHECK_NOT_NULL(dir);
 	
-	dirs = (list_t *) loader->data;
+	lpl = loader->data;
+	dirs = lpl->dirs;
 	do {
 	
 		// Check if directory has already been registered 
-		if (list_find(dirs, dir, (int (*)(const void *, const void *)) strcmp) != NULL) {
+		if (list_find(dirs, dir, comp_dir_path) != NULL) {
 			break;
 		}
 	
 		// Allocate resources 
-		d = malloc(sizeof(char) * (strlen(dir) + 1));
+		if ((d = malloc(sizeof(lpl_dir_t))) == NULL) {
+			status = CP_ERR_RESOURCE;
+			break;
+		}
+		memset(d, 0, sizeof(lpl_dir_t));
+		d->wd = -1;
+		d->path = strdup(dir);
 		node = lnode_create(d);
-		if (d == NULL || node == NULL) {
+		if (d->path == NULL || node == NULL) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
 	
 		// Register directory 
-		strcpy(d, dir);
 		list_append(dirs, node);
 		
 	} while (0);
@@ -167,7 +496,7 @@ CP_C_API cp_status_t cp_lpl_register_dir(cp_plugin_loader_t *loader, const char
 	// Release resources on failure 
 	if (status != CP_OK) {	
 		if (d != NULL) {
-			free(d);
+			free_dir(lpl, d);
 		}
 		if (node != NULL) {
 			lnode_destroy(node);
@@ -178,144 +507,1052 @@ CP_C_API cp_status_t cp_lpl_register_dir(cp_plugin_loader_t *loader, const char
 }
 
 CP_C_API void cp_lpl_unregister_dir(cp_plugin_loader_t *loader, const char *dir) {
-	char *d;
+	lpl_data_t *lpl;
 	lnode_t *node;
-	list_t *dirs;
 	
 	CHECK_NOT_NULL(loader);
 	CHECK_NOT_NULL(dir);
 	
-	dirs = (list_t *) loader->data;
-	node = list_find(dirs, dir, (int (*)(const void *, const void *)) strcmp);
+	lpl = loader->data;
+	node = list_find(lpl->dirs, dir, comp_dir_path);
 	if (node != NULL) {
-		d = lnode_get(node);
-		list_delete(dirs, node);
-		lnode_destroy(node);
-		free(d);
+		process_free_dir(lpl->dirs, node, lpl);
 	}
 }
 
 CP_C_API void cp_lpl_unregister_dirs(cp_plugin_loader_t *loader) {
-	list_t *dirs;
+	lpl_data_t *lpl;
+	
+	CHECK_NOT_NULL(loader);
+	lpl = loader->data;
+	list_process(lpl->dirs, lpl, process_free_dir);
+}
+
+CP_C_API void cp_lpl_set_scan_threads(cp_plugin_loader_t *loader, int num_threads) {
+	CHECK_NOT_NULL(loader);
+	((lpl_data_t *) loader->data)->scan_threads = (num_threads > 1 ? num_threads : 1);
+}
+
+CP_C_API cp_status_t cp_lpl_set_cache_file(cp_plugin_loader_t *loader, const char *dir, const char *cache_file) {
+	lnode_t *node;
+	lpl_dir_t *d;
+	char *cf = NULL;
 	
 	CHECK_NOT_NULL(loader);
-	dirs = (list_t *) loader->data;
-	list_process(dirs, NULL, cpi_process_free_ptr);
+	CHECK_NOT_NULL(dir);
+	
+	if ((node = list_find(((lpl_data_t *) loader->data)->dirs, dir, comp_dir_path)) == NULL) {
+		return CP_ERR_UNKNOWN;
+	}
+	d = lnode_get(node);
+	if (cache_file != NULL && (cf = strdup(cache_file)) == NULL) {
+		return CP_ERR_RESOURCE;
+	}
+	free_dir_cache(d);
+	free(d->cache_file);
+	d->cache_file = cf;
+	return CP_OK;
+}
+
+CP_C_API cp_status_t cp_lpl_set_watch(cp_plugin_loader_t *loader, int watch) {
+	lpl_data_t *lpl;
+	lnode_t *node;
+	
+	CHECK_NOT_NULL(loader);
+	lpl = loader->data;
+	
+	// Stop watching
+	if (!watch) {
+		if (lpl->watch_fd >= 0) {
+			for (node = list_first(lpl->dirs); node != NULL; node = list_next(lpl->dirs, node)) {
+				lpl_dir_t *d = lnode_get(node);
+				
+				free_dir_entries(lpl, d);
+				if (d->cache_file == NULL) {
+					free_dir_cache(d);
+				}
+			}
+			assert(hash_isempty(lpl->watches));
+			hash_destroy(lpl->watches);
+			lpl->watches = NULL;
+#ifdef HAVE_SYS_INOTIFY_H
+			close(lpl->watch_fd);
+#endif
+			lpl->watch_fd = -1;
+		}
+		return CP_OK;
+	}
+	
+	// Start watching
+#ifdef HAVE_SYS_INOTIFY_H
+	if (lpl->watch_fd < 0) {
+		if ((lpl->watches = hash_create(HASHCOUNT_T_MAX, cpi_comp_ptr, cpi_hashfunc_ptr)) == NULL) {
+			return CP_ERR_RESOURCE;
+		}
+		if ((lpl->watch_fd = inotify_init()) < 0
+			|| fcntl(lpl->watch_fd, F_SETFL, fcntl(lpl->watch_fd, F_GETFL) | O_NONBLOCK)
+			|| fcntl(lpl->watch_fd, F_SETFD, FD_CLOEXEC)) {
+			if (lpl->watch_fd >= 0) {
+				close(lpl->watch_fd);
+				lpl->watch_fd = -1;
+			}
+			hash_destroy(lpl->watches);
+			lpl->watches = NULL;
+			return CP_ERR_RESOURCE;
+		}
+	}
+	return CP_OK;
+#else
+	return CP_ERR_RESOURCE;
+#endif
+}
+
+CP_C_API int cp_lpl_get_watch_fd(cp_plugin_loader_t *loader) {
+	CHECK_NOT_NULL(loader);
+	return ((lpl_data_t *) loader->data)->watch_fd;
+}
+
+/**
+ * Reads the state of the descriptor file of the specified plug-in.
+ * 
+ * @param path the plug-in path
+ * @param key filled with the state of the descriptor file
+ * @return whether the state could be read
+ */
+static int get_file_key(const char *path, lpl_file_key_t *key) {
+#ifdef HAVE_STAT
+	struct stat st;
+	char *file;
+	int ok;
+	
+	if ((file = malloc((strlen(path) + strlen(CP_PLUGIN_DESCRIPTOR) + 2) * sizeof(char))) == NULL) {
+		return 0;
+	}
+	sprintf(file, "%s%c%s", path, CP_FNAMESEP_CHAR, CP_PLUGIN_DESCRIPTOR);
+	ok = !stat(file, &st);
+	free(file);
+	if (ok) {
+		memset(key, 0, sizeof(lpl_file_key_t));
+		key->ino = st.st_ino;
+		key->size = st.st_size;
+		key->mtime = st.st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+		key->mtime_nsec = st.st_mtim.tv_nsec;
+#endif
+	}
+	return ok;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Loads the scan cache of the specified directory from the cache file.
+ * A missing or invalid cache file results in an empty cache.
+ * 
+ * @param ctx the plug-in context
+ * @param dir the directory
+ * @return whether the cache is available
+ */
+static int load_dir_cache(cp_context_t *ctx, lpl_dir_t *dir) {
+	FILE *fh;
+	uint32_t hdr[4];
+	uint32_t i;
+	int ok = 1;
+	
+	assert(dir->cache == NULL);
+	if ((dir->cache = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL)) == NULL) {
+		return 0;
+	}
+	dir->cache_dirty = 0;
+	if ((fh = fopen(dir->cache_file, "rb")) == NULL) {
+		if (errno != ENOENT) {
+			cpi_warnf(ctx, N_("Could not open plug-in scan cache %s: %s"), dir->cache_file, strerror(errno));
+		}
+		return 1;
+	}
+	if (fread(hdr, sizeof(uint32_t), 4, fh) != 4
+		|| hdr[0] != LPL_CACHE_MAGIC
+		|| hdr[1] != LPL_CACHE_VERSION) {
+		ok = 0;
+	}
+	for (i = 0; ok && i < hdr[2]; i++) {
+		lpl_cache_entry_t *entry;
+		uint32_t sizes[2];
+		
+		if ((entry = malloc(sizeof(lpl_cache_entry_t))) == NULL) {
+			ok = 0;
+			break;
+		}
+		memset(entry, 0, sizeof(lpl_cache_entry_t));
+		if (fread(sizes, sizeof(uint32_t), 2, fh) != 2
+			|| fread(&(entry->key), sizeof(lpl_file_key_t), 1, fh) != 1
+			|| sizes[0] == 0
+			|| (entry->name = malloc(sizes[0] * sizeof(char))) == NULL
+			|| (entry->image = malloc(sizes[1] + 1)) == NULL
+			|| fread(entry->name, sizeof(char), sizes[0], fh) != sizes[0]
+			|| fread(entry->image, 1, sizes[1], fh) != sizes[1]
+			|| entry->name[sizes[0] - 1] != '\0'
+			|| hash_lookup(dir->cache, entry->name) != NULL
+			|| !hash_alloc_insert(dir->cache, entry->name, entry)) {
+			free_cache_entry(entry);
+			ok = 0;
+			break;
+		}
+		entry->image_size = sizes[1];
+	}
+	if (!ok) {
+		cpi_warnf(ctx, N_("Ignoring invalid plug-in scan cache %s."), dir->cache_file);
+		free_dir_cache(dir);
+		if ((dir->cache = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL)) == NULL) {
+			fclose(fh);
+			return 0;
+		}
+		dir->cache_dirty = 1;
+	}
+	fclose(fh);
+	return 1;
+}
+
+/**
+ * Drops cache entries that were not seen during the latest scan.
+ * 
+ * @param dir the directory
+ */
+static void prune_dir_cache(lpl_dir_t *dir) {
+	hscan_t hscan;
+	hnode_t *hnode;
+	
+	hash_scan_begin(&hscan, dir->cache);
+	while ((hnode = hash_scan_next(&hscan)) != NULL) {
+		lpl_cache_entry_t *entry = hnode_get(hnode);
+		if (!entry->seen) {
+			hash_scan_delfree(dir->cache, hnode);
+			free_cache_entry(entry);
+			dir->cache_dirty = 1;
+		}
+	}
+}
+
+/**
+ * Saves the scan cache of the specified directory. The cache file is
+ * replaced atomically where the platform allows it.
+ * 
+ * @param ctx the plug-in context
+ * @param dir the directory
+ */
+static void save_dir_cache(cp_context_t *ctx, lpl_dir_t *dir) {
+	hscan_t hscan;
+	hnode_t *hnode;
+	char *tmp_file = NULL;
+	FILE *fh = NULL;
+	int ok = 0;
+	
+	// Write the cache into a temporary file
+	do {
+		uint32_t hdr[4];
+		
+		if ((tmp_file = malloc((strlen(dir->cache_file) + 5) * sizeof(char))) == NULL) {
+			break;
+		}
+		strcpy(tmp_file, dir->cache_file);
+		strcat(tmp_file, ".tmp");
+		if ((fh = fopen(tmp_file, "wb")) == NULL) {
+			break;
+		}
+		hdr[0] = LPL_CACHE_MAGIC;
+		hdr[1] = LPL_CACHE_VERSION;
+		hdr[2] = hash_count(dir->cache);
+		hdr[3] = 0;
+		if (fwrite(hdr, sizeof(uint32_t), 4, fh) != 4) {
+			break;
+		}
+		ok = 1;
+		hash_scan_begin(&hscan, dir->cache);
+		while (ok && (hnode = hash_scan_next(&hscan)) != NULL) {
+			lpl_cache_entry_t *entry = hnode_get(hnode);
+			uint32_t sizes[2];
+			
+			sizes[0] = strlen(entry->name) + 1;
+			sizes[1] = entry->image_size;
+			if (fwrite(sizes, sizeof(uint32_t), 2, fh) != 2
+				|| fwrite(&(entry->key), sizeof(lpl_file_key_t), 1, fh) != 1
+				|| fwrite(entry->name, sizeof(char), sizes[0], fh) != sizes[0]
+				|| fwrite(entry->image, 1, sizes[1], fh) != sizes[1]) {
+				ok = 0;
+			}
+		}
+		if (fclose(fh)) {
+			ok = 0;
+		}
+		fh = NULL;
+		
+		// Replace the cache file
+		if (ok && rename(tmp_file, dir->cache_file)) {
+			remove(dir->cache_file);
+			ok = !rename(tmp_file, dir->cache_file);
+		}
+		
+	} while (0);
+	
+	// Report failure and clean up
+	if (fh != NULL) {
+		fclose(fh);
+	}
+	if (ok) {
+		dir->cache_dirty = 0;
+	} else {
+		cpi_warnf(ctx, N_("Could not save plug-in scan cache %s."), dir->cache_file);
+		if (tmp_file != NULL) {
+			remove(tmp_file);
+		}
+	}
+	free(tmp_file);
+}
+
+/**
+ * Stores the image of a loaded plug-in in the scan cache of its directory.
+ * 
+ * @param cand the plug-in candidate
+ */
+static void update_dir_cache(lpl_candidate_t *cand) {
+	lpl_cache_entry_t *entry;
+	hnode_t *hnode;
+	void *image;
+	size_t image_size;
+	
+	if ((image = cpi_encode_plugin_image(cand->plugin, &image_size)) == NULL) {
+		return;
+	}
+	if ((hnode = hash_lookup(cand->dir->cache, cand->name)) != NULL) {
+		entry = hnode_get(hnode);
+		free(entry->image);
+	} else {
+		if ((entry = malloc(sizeof(lpl_cache_entry_t))) == NULL) {
+			free(image);
+			return;
+		}
+		memset(entry, 0, sizeof(lpl_cache_entry_t));
+		if ((entry->name = strdup(cand->name)) == NULL
+			|| !hash_alloc_insert(cand->dir->cache, entry->name, entry)) {
+			free(image);
+			free_cache_entry(entry);
+			return;
+		}
+	}
+	entry->key = cand->key;
+	entry->image = image;
+	entry->image_size = image_size;
+	entry->seen = 1;
+	cand->dir->cache_dirty = 1;
+}
+
+#ifdef HAVE_STAT
+
+/**
+ * Returns whether the specified plug-in has a compiled plug-in descriptor
+ * which is not older than its plug-in descriptor.
+ * 
+ * @param path the plug-in path
+ * @return whether the compiled descriptor is up to date
+ */
+static int has_current_image(const char *path) {
+	struct stat ist, dst;
+	char *file;
+	int current;
+	
+	if ((file = malloc((strlen(path) + strlen(CP_PLUGIN_DESCRIPTOR) + strlen(CP_PLUGIN_IMAGE) + 2) * sizeof(char))) == NULL) {
+		return 0;
+	}
+	sprintf(file, "%s%c%s", path, CP_FNAMESEP_CHAR, CP_PLUGIN_IMAGE);
+	if (stat(file, &ist)) {
+		current = 0;
+	} else {
+		sprintf(file, "%s%c%s", path, CP_FNAMESEP_CHAR, CP_PLUGIN_DESCRIPTOR);
+		current = (stat(file, &dst)
+			|| ist.st_mtime > dst.st_mtime
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+			|| (ist.st_mtime == dst.st_mtime && ist.st_mtim.tv_nsec >= dst.st_mtim.tv_nsec)
+#else
+			|| ist.st_mtime == dst.st_mtime
+#endif
+			);
+	}
+	free(file);
+	return current;
+}
+
+#endif
+
+/**
+ * Tries to load a plug-in candidate from its compiled plug-in descriptor.
+ * A missing or outdated compiled descriptor is silently ignored.
+ * 
+ * @param ctx the plug-in context
+ * @param cand the plug-in candidate
+ */
+static void load_compiled_candidate(cp_context_t *ctx, lpl_candidate_t *cand) {
+	cp_status_t status;
+	
+#ifdef HAVE_STAT
+	if (!has_current_image(cand->path)) {
+		return;
+	}
+#endif
+	if ((cand->plugin = cpi_map_plugin_image(ctx, cand->path, &status)) != NULL) {
+		cand->registered = 1;
+	} else if (status != CP_ERR_IO) {
+		cpi_warnf(ctx, N_("Ignoring invalid compiled plug-in descriptor in %s."), cand->path);
+	}
+}
+
+/**
+ * Tries to load a plug-in candidate from the scan cache of its directory.
+ * The state of the descriptor file is not checked if the plug-in directory
+ * is being watched and it is known to be unchanged.
+ * 
+ * @param ctx the plug-in context
+ * @param cand the plug-in candidate
+ */
+static void load_cached_candidate(cp_context_t *ctx, lpl_candidate_t *cand) {
+	lpl_cache_entry_t *entry;
+	hnode_t *hnode;
+	
+	if (!cand->unchanged
+		&& !(cand->has_key = get_file_key(cand->path, &(cand->key)))) {
+		return;
+	}
+	if ((hnode = hash_lookup(cand->dir->cache, cand->name)) == NULL) {
+		return;
+	}
+	entry = hnode_get(hnode);
+	if ((cand->unchanged || !memcmp(&(entry->key), &(cand->key), sizeof(lpl_file_key_t)))
+		&& (cand->plugin = cpi_load_plugin_image(ctx, entry->image, entry->image_size, cand->path, NULL)) != NULL) {
+		cand->registered = 1;
+		entry->seen = 1;
+		cpi_debugf(ctx, N_("Plug-in descriptor in %s was loaded from the scan cache."), cand->path);
+	}
+}
+
+/**
+ * Adds a possible plug-in location to the candidate table.
+ * 
+ * @param ctx the plug-in context
+ * @param cands the candidate table
+ * @param cands_size the allocated size of the candidate table
+ * @param num_cands the number of candidates
+ * @param dir the collection directory
+ * @param name the name of the plug-in directory within the collection
+ * @return the added candidate or NULL if insufficient memory
+ */
+static lpl_candidate_t *add_candidate(cp_context_t *ctx, lpl_candidate_t **cands, int *cands_size, int *num_cands, lpl_dir_t *dir, const char *name) {
+	lpl_candidate_t *cand;
+	char *pdir_path;
+	int dir_path_len;
+	
+	// Allocate memory for the candidate table
+	if (*num_cands >= *cands_size) {
+		lpl_candidate_t *new_cands;
+		int ns = (*cands_size == 0 ? 64 : *cands_size * 2);
+		
+		if ((new_cands = realloc(*cands, ns * sizeof(lpl_candidate_t))) == NULL) {
+			cpi_errorf(ctx, N_("Could not check possible plug-in location %s%c%s due to insufficient system resources."), dir->path, CP_FNAMESEP_CHAR, name);
+			return NULL;
+		}
+		*cands = new_cands;
+		*cands_size = ns;
+	}
+	
+	// Construct plug-in path
+	dir_path_len = strlen(dir->path);
+	if (dir->path[dir_path_len - 1] == CP_FNAMESEP_CHAR) {
+		dir_path_len--;
+	}
+	if ((pdir_path = malloc((dir_path_len + 1 + strlen(name) + 1) * sizeof(char))) == NULL) {
+		cpi_errorf(ctx, N_("Could not check possible plug-in location %s%c%s due to insufficient system resources."), dir->path, CP_FNAMESEP_CHAR, name);
+		return NULL;
+	}
+	strncpy(pdir_path, dir->path, dir_path_len);
+	pdir_path[dir_path_len] = CP_FNAMESEP_CHAR;
+	strcpy(pdir_path + dir_path_len + 1, name);
+	cand = *cands + *num_cands;
+	memset(cand, 0, sizeof(lpl_candidate_t));
+	cand->path = pdir_path;
+	cand->name = pdir_path + dir_path_len + 1;
+	cand->dir = dir;
+	(*num_cands)++;
+	return cand;
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+/**
+ * Adds a watch for a directory. Does nothing if the directory is already
+ * being watched.
+ * 
+ * @param lpl the local plug-in loader data
+ * @param dir the collection directory
+ * @param name the name of the plug-in directory, or NULL for the collection directory
+ * @param path the path of the directory to be watched
+ * @return the watch descriptor or -1 on failure
+ */
+static int add_watch(lpl_data_t *lpl, lpl_dir_t *dir, const char *name, const char *path) {
+	lpl_watch_t *watch;
+	int wd;
+	
+	if ((wd = inotify_add_watch(lpl->watch_fd, path, (name != NULL ? LPL_PLUGIN_EVENTS : LPL_DIR_EVENTS))) < 0) {
+		return -1;
+	}
+	if (hash_lookup(lpl->watches, (void *) (intptr_t) wd) != NULL) {
+		return wd;
+	}
+	if ((watch = malloc(sizeof(lpl_watch_t))) != NULL) {
+		watch->dir = dir;
+		watch->name = NULL;
+		if ((name == NULL || (watch->name = strdup(name)) != NULL)
+			&& hash_alloc_insert(lpl->watches, (void *) (intptr_t) wd, watch)) {
+			return wd;
+		}
+		free(watch->name);
+		free(watch);
+	}
+	inotify_rm_watch(lpl->watch_fd, wd);
+	errno = ENOMEM;
+	return -1;
+}
+
+/**
+ * Marks a plug-in directory entry of a watched collection changed. The
+ * entry is created if it does not exist.
+ * 
+ * @param lpl the local plug-in loader data
+ * @param dir the collection directory
+ * @param name the name of the plug-in directory
+ */
+static void mark_entry_changed(lpl_data_t *lpl, lpl_dir_t *dir, const char *name) {
+	lpl_entry_t *entry;
+	hnode_t *hnode;
+	
+	if (dir->entries == NULL) {
+		return;
+	}
+	if ((hnode = hash_lookup(dir->entries, name)) != NULL) {
+		entry = hnode_get(hnode);
+	} else {
+		if ((entry = malloc(sizeof(lpl_entry_t))) == NULL) {
+			
+			// List the directory again
+			free_dir_entries(lpl, dir);
+			return;
+		}
+		memset(entry, 0, sizeof(lpl_entry_t));
+		entry->wd = -1;
+		entry->seq = dir->next_entry_seq++;
+		if ((entry->name = strdup(name)) == NULL
+			|| !hash_alloc_insert(dir->entries, entry->name, entry)) {
+			free_entry(lpl, entry);
+			free_dir_entries(lpl, dir);
+			return;
+		}
+	}
+	entry->changed = 1;
+}
+
+/**
+ * Reads the pending watch events and marks the affected plug-in
+ * directories changed.
+ * 
+ * @param ctx the plug-in context
+ * @param lpl the local plug-in loader data
+ */
+static void read_watch_events(cp_context_t *ctx, lpl_data_t *lpl) {
+	union {
+		struct inotify_event event;
+		char buffer[4096];
+	} events;
+	ssize_t len;
+	
+	while ((len = read(lpl->watch_fd, &events, sizeof(events))) > 0) {
+		char *ptr;
+		
+		for (ptr = events.buffer; ptr < events.buffer + len; ptr += sizeof(struct inotify_event) + ((struct inotify_event *) ptr)->len) {
+			struct inotify_event *event = (struct inotify_event *) ptr;
+			lpl_watch_t *watch;
+			hnode_t *hnode;
+			
+			// Rescan everything if events have been lost
+			if (event->mask & IN_Q_OVERFLOW) {
+				lnode_t *lnode;
+				
+				cpi_debug(ctx, N_("Plug-in directory watch events were lost."));
+				for (lnode = list_first(lpl->dirs); lnode != NULL; lnode = list_next(lpl->dirs, lnode)) {
+					free_dir_entries(lpl, lnode_get(lnode));
+				}
+				continue;
+			}
+			if ((hnode = hash_lookup(lpl->watches, (void *) (intptr_t) event->wd)) == NULL) {
+				continue;
+			}
+			watch = hnode_get(hnode);
+			
+			// Events for the collection directory
+			if (watch->name == NULL) {
+				if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+					free_dir_entries(lpl, watch->dir);
+				} else if (event->len > 0 && event->name[0] != '\0' && event->name[0] != '.') {
+					mark_entry_changed(lpl, watch->dir, event->name);
+				}
+			}
+			
+			// Events for a plug-in directory
+			else {
+				lpl_dir_t *dir = watch->dir;
+				
+				// Stop watching a removed or moved plug-in directory
+				if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+					hnode_t *hn2;
+					
+					if (dir->entries != NULL
+						&& (hn2 = hash_lookup(dir->entries, watch->name)) != NULL) {
+						((lpl_entry_t *) hnode_get(hn2))->wd = -1;
+					}
+					mark_entry_changed(lpl, dir, watch->name);
+					remove_watch(lpl, event->wd);
+				} else {
+					mark_entry_changed(lpl, dir, watch->name);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Compares two watched candidates by the order in which their plug-in
+ * directory entries were found.
+ * 
+ * @param c1 the first candidate
+ * @param c2 the second candidate
+ * @return negative, zero or positive as for strcmp
+ */
+static int comp_candidate_seq(const void *c1, const void *c2) {
+	unsigned int s1 = ((const lpl_candidate_t *) c1)->entry->seq;
+	unsigned int s2 = ((const lpl_candidate_t *) c2)->entry->seq;
+	
+	return (s1 < s2 ? -1 : (s1 > s2 ? 1 : 0));
+}
+
+/**
+ * Collects the possible plug-in locations in a watched collection
+ * directory. The directory is listed only if it has not been listed
+ * before or if the watch events may have been lost. Otherwise, the
+ * plug-in directories are known from the watch events and the plug-in
+ * directories not changed since the latest scan are marked unchanged.
+ * 
+ * @param ctx the plug-in context
+ * @param lpl the local plug-in loader data
+ * @param d the collection directory
+ * @param cands the candidate table
+ * @param cands_size the allocated size of the candidate table
+ * @param num_cands the number of candidates
+ */
+static void collect_watched_candidates(cp_context_t *ctx, lpl_data_t *lpl, lpl_dir_t *d, lpl_candidate_t **cands, int *cands_size, int *num_cands) {
+	hscan_t hscan;
+	hnode_t *hnode;
+	int first = *num_cands;
+	
+	// List the directory, if necessary
+	if (d->entries == NULL) {
+		DIR *dir;
+		struct dirent *de;
+		
+		if ((d->entries = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL)) == NULL) {
+			cpi_errorf(ctx, N_("Could not watch plug-in directory %s due to insufficient system resources."), d->path);
+			return;
+		}
+		
+		// Watch the directory before listing it so that no changes are lost
+		if (d->wd < 0 && (d->wd = add_watch(lpl, d, NULL, d->path)) < 0) {
+			cpi_errorf(ctx, N_("Could not watch plug-in directory %s: %s"), d->path, strerror(errno));
+			free_dir_entries(lpl, d);
+			return;
+		}
+		if ((dir = opendir(d->path)) == NULL) {
+			cpi_errorf(ctx, N_("Could not open plug-in directory %s: %s"), d->path, strerror(errno));
+			free_dir_entries(lpl, d);
+			return;
+		}
+		errno = 0;
+		while ((de = readdir(dir)) != NULL) {
+			if (de->d_name[0] != '\0' && de->d_name[0] != '.') {
+				mark_entry_changed(lpl, d, de->d_name);
+				if (d->entries == NULL) {
+					break;
+				}
+			}
+			errno = 0;
+		}
+		if (errno) {
+			cpi_errorf(ctx, N_("Could not read plug-in directory %s: %s"), d->path, strerror(errno));
+			free_dir_entries(lpl, d);
+		}
+		closedir(dir);
+		if (d->entries == NULL) {
+			return;
+		}
+	}
+	
+	// Go through the plug-in directories
+	hash_scan_begin(&hscan, d->entries);
+	while ((hnode = hash_scan_next(&hscan)) != NULL) {
+		lpl_entry_t *entry = hnode_get(hnode);
+		lpl_candidate_t *cand;
+		
+		// Skip unchanged plug-in directories that failed to load
+		if (!entry->changed && entry->failed) {
+			continue;
+		}
+		if ((cand = add_candidate(ctx, cands, cands_size, num_cands, d, entry->name)) == NULL) {
+			continue;
+		}
+		
+		// Start watching changed plug-in directories, dropping removed ones
+		if (entry->changed) {
+			if (entry->wd < 0 && (entry->wd = add_watch(lpl, d, entry->name, cand->path)) < 0) {
+				if (errno == ENOENT || errno == ENOTDIR) {
+					(*num_cands)--;
+					free(cand->path);
+					hash_scan_delfree(d->entries, hnode);
+					free_entry(lpl, entry);
+					continue;
+				}
+				cpi_warnf(ctx, N_("Could not watch plug-in directory %s: %s"), cand->path, strerror(errno));
+			} else {
+				entry->changed = 0;
+			}
+			entry->failed = 0;
+		} else {
+			cand->unchanged = 1;
+		}
+		cand->entry = entry;
+	}
+	
+	// Keep the directory scan order regardless of the hash order
+	if (*num_cands - first > 1) {
+		qsort(*cands + first, *num_cands - first, sizeof(lpl_candidate_t), comp_candidate_seq);
+	}
+}
+
+#endif
+
+/**
+ * Collects the possible plug-in locations in the registered plug-in
+ * directories. The locations are returned in directory registration order
+ * and, within a directory, in the order the directory entries are read.
+ * The caller must have locked the context.
+ * 
+ * @param ctx the plug-in context
+ * @param lpl the local plug-in loader data
+ * @param num_cands filled with the number of returned locations
+ * @return a newly allocated array of candidates, or NULL if none
+ */
+static lpl_candidate_t *collect_candidates(cp_context_t *ctx, lpl_data_t *lpl, int *num_cands) {
+	lpl_candidate_t *cands = NULL;
+	int cands_size = 0;
+	int n = 0;
+	lnode_t *lnode;
+	
+#ifdef HAVE_SYS_INOTIFY_H
+	if (lpl->watch_fd >= 0) {
+		read_watch_events(ctx, lpl);
+	}
+#endif
+	
+	// Scan plug-in directories for possible plug-in locations
+	lnode = list_first(lpl->dirs);
+	while (lnode != NULL) {
+		lpl_dir_t *d;
+		DIR *dir;
+		
+		d = lnode_get(lnode);
+		lnode = list_next(lpl->dirs, lnode);
+		if (d->cache == NULL) {
+			if (d->cache_file != NULL) {
+				if (!load_dir_cache(ctx, d)) {
+					cpi_errorf(ctx, N_("Could not load plug-in scan cache %s due to insufficient system resources."), d->cache_file);
+				}
+			} else if (lpl->watch_fd >= 0) {
+				d->cache = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL);
+			}
+		}
+#ifdef HAVE_SYS_INOTIFY_H
+		if (lpl->watch_fd >= 0) {
+			collect_watched_candidates(ctx, lpl, d, &cands, &cands_size, &n);
+			continue;
+		}
+#endif
+		dir = opendir(d->path);
+		if (dir != NULL) {
+			struct dirent *de;
+			
+			errno = 0;
+			while ((de = readdir(dir)) != NULL) {
+				if (de->d_name[0] != '\0' && de->d_name[0] != '.') {
+					
+					// continue loading plug-ins from other locations on failure
+					add_candidate(ctx, &cands, &cands_size, &n, d, de->d_name);
+				}
+				errno = 0;
+			}
+			if (errno) {
+				cpi_errorf(ctx, N_("Could not read plug-in directory %s: %s"), d->path, strerror(errno));
+				// continue loading plug-ins from other directories 
+			}
+			closedir(dir);
+		} else {
+			cpi_errorf(ctx, N_("Could not open plug-in directory %s: %s"), d->path, strerror(errno));
+			// continue loading plug-ins from other directories 
+		}
+	}
+	
+	*num_cands = n;
+	return cands;
+}
+
+#ifdef CP_THREADS
+
+/**
+ * Parses plug-in descriptors until there are no more candidates left in
+ * the job.
+ * 
+ * @param arg the parsing job
+ */
+static void parse_descriptors(void *arg) {
+	lpl_parse_job_t *job = arg;
+	
+	cpi_lock_mutex(job->mutex);
+	while (job->next_cand < job->num_cands) {
+		lpl_candidate_t *cand = job->cands + job->next_cand;
+		list_t *log = job->logs + job->next_cand;
+		
+		job->next_cand++;
+		if (cand->plugin == NULL) {
+			cpi_unlock_mutex(job->mutex);
+			cand->plugin = cpi_parse_plugin_descriptor(job->ctx, cand->path, log, NULL);
+			cpi_lock_mutex(job->mutex);
+		}
+	}
+	cpi_unlock_mutex(job->mutex);
+}
+
+/**
+ * Parses the plug-in descriptors of the candidates not yet loaded using a
+ * bounded pool of worker threads. The calling thread participates in
+ * parsing and keeps holding the context lock, so the context is not
+ * accessed by the workers. Parsing messages are logged in candidate order
+ * once all the descriptors have been parsed.
+ * 
+ * @param ctx the plug-in context
+ * @param cands the plug-in candidates
+ * @param num_cands the number of candidates
+ * @param max_threads the maximum number of threads, including the calling thread
+ * @return whether the descriptors were parsed, or zero if out of resources
+ */
+static int parse_descriptors_parallel(cp_context_t *ctx, lpl_candidate_t *cands, int num_cands, int max_threads) {
+	lpl_parse_job_t job;
+	cpi_thread_t **threads = NULL;
+	int num_threads = 0;
+	int i;
+	
+	memset(&job, 0, sizeof(job));
+	do {
+		
+		// Initialize the job
+		if ((job.mutex = cpi_create_mutex()) == NULL) {
+			break;
+		}
+		if ((job.logs = malloc(num_cands * sizeof(list_t))) == NULL) {
+			break;
+		}
+		for (i = 0; i < num_cands; i++) {
+			list_init(job.logs + i, LISTCOUNT_T_MAX);
+		}
+		job.ctx = ctx;
+		job.cands = cands;
+		job.num_cands = num_cands;
+		job.next_cand = 0;
+		
+		// Start the worker threads
+		if (max_threads > num_cands) {
+			max_threads = num_cands;
+		}
+		if ((threads = malloc((max_threads - 1) * sizeof(cpi_thread_t *))) == NULL) {
+			break;
+		}
+		for (num_threads = 0; num_threads < max_threads - 1; num_threads++) {
+			if ((threads[num_threads] = cpi_create_thread(parse_descriptors, &job)) == NULL) {
+				break;
+			}
+		}
+		
+		// Parse descriptors in this thread as well and wait for the workers
+		parse_descriptors(&job);
+		for (i = 0; i < num_threads; i++) {
+			cpi_join_thread(threads[i]);
+		}
+		
+		// Deliver the parsing messages
+		for (i = 0; i < num_cands; i++) {
+			cpi_flush_log(ctx, job.logs + i);
+		}
+		
+	} while (0);
+	
+	// Release resources
+	if (threads != NULL) {
+		free(threads);
+	}
+	if (job.logs != NULL) {
+		free(job.logs);
+	}
+	if (job.mutex != NULL) {
+		cpi_destroy_mutex(job.mutex);
+	}
+	
+	return job.next_cand == num_cands;
+}
+
+#endif
+
+/**
+ * Adds a loaded plug-in to the set of available plug-ins unless an equal or
+ * later version of the same plug-in is already included. Takes over the
+ * reference to the plug-in information.
+ * 
+ * @param ctx the plug-in context
+ * @param avail_plugins the available plug-ins, keyed by identifier
+ * @param plugin the loaded plug-in
+ */
+static void add_avail_plugin(cp_context_t *ctx, hash_t *avail_plugins, cp_plugin_info_t *plugin) {
+	hnode_t *hnode;
+	
+	// Check if equal or later version of the plug-in is already known
+	if ((hnode = hash_lookup(avail_plugins, plugin->identifier)) != NULL) {
+		cp_plugin_info_t *plugin2 = hnode_get(hnode);
+		if (cpi_vercmp(plugin->version, plugin2->version) > 0) {
+			hash_delete_free(avail_plugins, hnode);
+			cp_release_info(ctx, plugin2);
+			hnode = NULL;
+		}
+	}
+	
+	// Insert plug-in to the list of available plug-ins, or release it
+	if (hnode == NULL) {
+		if (!hash_alloc_insert(avail_plugins, plugin->identifier, plugin)) {
+			cpi_errorf(ctx, N_("Plug-in %s version %s could not be loaded due to insufficient system resources."), plugin->identifier, plugin->version);
+			cp_release_info(ctx, plugin);
+		}
+	} else {
+		cp_release_info(ctx, plugin);
+	}
 }
 
 static cp_plugin_info_t **lpl_scan_plugins(void *data, cp_context_t *ctx) {
+	lpl_data_t *lpl;
 	hash_t *avail_plugins = NULL;
-	char *pdir_path = NULL;
-	int pdir_path_size = 0;
-	list_t *dirs;
+	lpl_candidate_t *cands = NULL;
+	int num_cands = 0;
 	cp_plugin_info_t **plugins = NULL;
+	int i;
 	
 	CHECK_NOT_NULL(data);
 	CHECK_NOT_NULL(ctx);
 	
-	dirs = (list_t*) data;
+	lpl = (lpl_data_t *) data;
 	do {
 		lnode_t *lnode;
 		hscan_t hscan;
 		hnode_t *hnode;
 		int num_avail_plugins;
-		int i;
+		int parsed = 0;
 	
 		// Create a hash for available plug-ins 
 		if ((avail_plugins = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL)) == NULL) {
 			break;
 		}
 	
-		// Scan plug-in loaders for available plug-ins 
-		lnode = list_first(dirs);
-		while (lnode != NULL) {			
-			const char *dir_path;
-			DIR *dir;
+		// Collect possible plug-in locations
+		cands = collect_candidates(ctx, lpl, &num_cands);
+		
+		// Load plug-ins having compiled descriptors
+		for (i = 0; i < num_cands; i++) {
+			load_compiled_candidate(ctx, cands + i);
+		}
+		
+		// Load unchanged plug-ins from the scan caches
+		for (lnode = list_first(lpl->dirs); lnode != NULL; lnode = list_next(lpl->dirs, lnode)) {
+			lpl_dir_t *d = lnode_get(lnode);
 			
-			dir_path = lnode_get(lnode);
-			dir = opendir(dir_path);
-			if (dir != NULL) {
-				int dir_path_len;
-				struct dirent *de;
-				
-				dir_path_len = strlen(dir_path);
-				if (dir_path[dir_path_len - 1] == CP_FNAMESEP_CHAR) {
-					dir_path_len--;
+			if (d->cache != NULL) {
+				hash_scan_begin(&hscan, d->cache);
+				while ((hnode = hash_scan_next(&hscan)) != NULL) {
+					((lpl_cache_entry_t *) hnode_get(hnode))->seen = 0;
 				}
-				errno = 0;
-				while ((de = readdir(dir)) != NULL) {
-					if (de->d_name[0] != '\0' && de->d_name[0] != '.') {
-						int pdir_path_len = dir_path_len + 1 + strlen(de->d_name) + 1;
-						cp_plugin_info_t *plugin;
-						cp_status_t s;
-						hnode_t *hnode;
-
-						// Allocate memory for plug-in descriptor path 
-						if (pdir_path_size <= pdir_path_len) {
-							char *new_pdir_path;
-						
-							if (pdir_path_size == 0) {
-								pdir_path_size = 128;
-							}
-							while (pdir_path_size <= pdir_path_len) {
-								pdir_path_size *= 2;
-							}
-							new_pdir_path = realloc(pdir_path, pdir_path_size * sizeof(char));
-							if (new_pdir_path == NULL) {
-								cpi_errorf(ctx, N_("Could not check possible plug-in location %s%c%s due to insufficient system resources."), dir_path, CP_FNAMESEP_CHAR, de->d_name);
-
-								// continue loading plug-ins from other directories 
-								continue;
-							}
-							pdir_path = new_pdir_path;
-						}
-					
-						// Construct plug-in descriptor path 
-						strcpy(pdir_path, dir_path);
-						pdir_path[dir_path_len] = CP_FNAMESEP_CHAR;
-						strcpy(pdir_path + dir_path_len + 1, de->d_name);
-							
-						// Try to load a plug-in 
-						plugin = cp_load_plugin_descriptor(ctx, pdir_path, &s);
-						if (plugin == NULL) {
-						
-							// continue loading plug-ins from other directories 
-							continue;
-						}
-					
-						// Insert plug-in to the list of available plug-ins 
-						if ((hnode = hash_lookup(avail_plugins, plugin->identifier)) != NULL) {
-							cp_plugin_info_t *plugin2 = hnode_get(hnode);
-							if (cpi_vercmp(plugin->version, plugin2->version) > 0) {
-								hash_delete_free(avail_plugins, hnode);
-								cp_release_info(ctx, plugin2);
-								hnode = NULL;
-							}
-						}
-						if (hnode == NULL) {
-							if (!hash_alloc_insert(avail_plugins, plugin->identifier, plugin)) {
-								cpi_errorf(ctx, N_("Plug-in %s version %s could not be loaded due to insufficient system resources."), plugin->identifier, plugin->version);
-								cp_release_info(ctx, plugin);
-
-								// continue loading plug-ins from other directories 
-								continue;
-							}
-						}
-						
-					}
-					errno = 0;
+			}
+		}
+		for (i = 0; i < num_cands; i++) {
+			if (cands[i].plugin == NULL && cands[i].dir->cache != NULL) {
+				load_cached_candidate(ctx, cands + i);
+			}
+		}
+		
+		// Parse the remaining plug-in descriptors
+#ifdef CP_THREADS
+		if (lpl->scan_threads > 1 && num_cands > 1) {
+			parsed = parse_descriptors_parallel(ctx, cands, num_cands, lpl->scan_threads);
+		}
+#endif
+		if (!parsed) {
+			for (i = 0; i < num_cands; i++) {
+				if (cands[i].plugin == NULL) {
+					cands[i].plugin = cpi_parse_plugin_descriptor(ctx, cands[i].path, NULL, NULL);
+				}
+			}
+		}
+		
+		// Register plug-ins and choose the available ones in scan order
+		for (i = 0; i < num_cands; i++) {
+			lpl_candidate_t *cand = cands + i;
+			cp_plugin_info_t *plugin = cand->plugin;
+			
+			if (plugin == NULL) {
+				if (cand->entry != NULL) {
+					cand->entry->failed = 1;
 				}
-				if (errno) {
-					cpi_errorf(ctx, N_("Could not read plug-in directory %s: %s"), dir_path, strerror(errno));
-					// continue loading plug-ins from other directories 
+				continue;
+			}
+			if (!cand->registered) {
+				if (cpi_register_plugin_info(ctx, plugin) != CP_OK) {
+					cand->plugin = NULL;
+					continue;
+				}
+				if (cand->dir->cache != NULL && cand->has_key) {
+					update_dir_cache(cand);
 				}
-				closedir(dir);
-			} else {
-				cpi_errorf(ctx, N_("Could not open plug-in directory %s: %s"), dir_path, strerror(errno));
-				// continue loading plug-ins from other directories 
 			}
+			cand->plugin = NULL;
+			add_avail_plugin(ctx, avail_plugins, plugin);
+		}
+		
+		// Save modified scan caches
+		for (lnode = list_first(lpl->dirs); lnode != NULL; lnode = list_next(lpl->dirs, lnode)) {
+			lpl_dir_t *d = lnode_get(lnode);
 			
-			lnode = list_next(dirs, lnode);
+			if (d->cache != NULL) {
+				prune_dir_cache(d);
+				if (d->cache_file != NULL && d->cache_dirty) {
+					save_dir_cache(ctx, d);
+				}
+			}
 		}
 
 		// Construct an array of plug-ins
@@ -337,8 +1574,18 @@ static cp_plugin_info_t **lpl_scan_plugins(void *data, cp_context_t *ctx) {
 	} while (0);
 	
 	// Release resources 
-	if (pdir_path != NULL) {
-		free(pdir_path);
+	if (cands != NULL) {
+		for (i = 0; i < num_cands; i++) {
+			if (cands[i].plugin != NULL) {
+				if (cands[i].registered) {
+					cp_release_info(ctx, cands[i].plugin);
+				} else {
+					cpi_free_plugin(cands[i].plugin);
+				}
+			}
+			free(cands[i].path);
+		}
+		free(cands);
 	}
 	if (avail_plugins != NULL) {
 		hscan_t hscan;
@@ -31,12 +31,15 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
 #include <assert.h>
 #include "../kazlib/hash.h"
 #include "cpluff.h"
 #include "defines.h"
 #include "internal.h"
 #include "util.h"
+#include "atomic.h"
 
 
 /* ------------------------------------------------------------------------
@@ -68,6 +71,72 @@ typedef struct symbol_info_t {
 	
 } symbol_info_t;
 
+typedef struct symbol_cache_entry_t symbol_cache_entry_t;
+typedef struct symbol_cache_snapshot_t symbol_cache_snapshot_t;
+
+/// A cached resolved symbol
+struct symbol_cache_entry_t {
+	
+	// The identifier of the providing plug-in, owned by the entry
+	char *provider_id;
+	
+	// The name of the symbol, owned by the entry
+	char *name;
+	
+	// The pointer associated with the symbol
+	void *symbol;
+	
+	// Uses handed out through the cache, or -1 once evicted
+	int uses;
+	
+	// Insertion sequence number, the oldest entry is evicted first
+	unsigned int seq;
+	
+	// Next evicted entry waiting to be freed
+	symbol_cache_entry_t *next_retired;
+	
+};
+
+/// Immutable set of cached symbols for lock-free readers
+struct symbol_cache_snapshot_t {
+	
+	// The number of cached symbols
+	int num_entries;
+	
+	// Entries sorted by provider identifier and symbol name
+	symbol_cache_entry_t **by_name;
+	
+	// The same entries sorted by symbol pointer
+	symbol_cache_entry_t **by_symbol;
+	
+	// Next retired snapshot waiting to be freed
+	symbol_cache_snapshot_t *next_retired;
+	
+};
+
+/// Cache of recently resolved symbols of a plug-in context
+struct cpi_symbol_cache_t {
+	
+	// The maximum number of cached symbols, zero if caching is disabled
+	int max_entries;
+	
+	// The published snapshot, or NULL if no symbols are cached
+	symbol_cache_snapshot_t *snapshot;
+	
+	// Retired snapshots which may still be in use
+	symbol_cache_snapshot_t *retired_snapshots;
+	
+	// Evicted entries which may still be in use
+	symbol_cache_entry_t *retired_entries;
+	
+	// The number of threads currently reading a snapshot
+	int readers;
+	
+	// The sequence number of the next inserted entry
+	unsigned int next_seq;
+	
+};
+
 
 /* ------------------------------------------------------------------------
  * Function definitions
@@ -130,22 +199,99 @@ CP_C_API cp_status_t cp_define_symbol(cp_context_t *context, const char *name, v
 	return status;
 }
 
-CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const char *name, cp_status_t *error) {
+/**
+ * Decreases the usage count of a resolved symbol and forgets the symbol
+ * when it is not used anymore. The usage count of the symbol provider is
+ * decreased but the provider information is not released. The caller must
+ * have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param ptr the pointer associated with the symbol
+ * @return the symbol provider information or NULL if the symbol is unknown
+ */
+static symbol_provider_info_t *unuse_symbol(cp_context_t *context, const void *ptr) {
+	hnode_t *node;
+	symbol_info_t *symbol_info;
+	symbol_provider_info_t *provider_info;
+	
+	// Look up the symbol
+	if (context->resolved_symbols == NULL
+		|| (node = hash_lookup(context->resolved_symbols, ptr)) == NULL) {
+		cpi_errorf(context, N_("Could not release unknown symbol at address %p."), ptr);
+		return NULL;
+	}
+	symbol_info = hnode_get(node);
+	provider_info = symbol_info->provider_info;
+
+	// Decrease usage count
+	assert(symbol_info->usage_count > 0);
+	symbol_info->usage_count--;
+	assert(provider_info->usage_count > 0);
+	provider_info->usage_count--;
+
+	// Check if the symbol is not being used anymore
+	if (symbol_info->usage_count == 0) {
+		hash_delete_free(context->resolved_symbols, node);
+		free(symbol_info);
+		if (cpi_is_logged(context, CP_LOG_DEBUG)) {
+			char owner[64];
+			/* TRANSLATORS: First %s is the context owner */
+			cpi_debugf(context, N_("%s released the symbol at address %p defined by plug-in %s."), cpi_context_owner(context, owner, sizeof(owner)), ptr, provider_info->plugin->plugin->identifier);
+		}
+	}
+	
+	return provider_info;
+}
+
+/**
+ * Releases the symbol provider information and removes the dynamic
+ * dependency to the provider if none of its symbols are used anymore.
+ * The caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param provider_info the symbol provider information
+ */
+static void unuse_provider(cp_context_t *context, symbol_provider_info_t *provider_info) {
+	hnode_t *node;
+	
+	if (provider_info->usage_count == 0) {
+		if ((node = hash_lookup(context->symbol_providers, provider_info->plugin)) != NULL
+			&& hnode_get(node) == provider_info) {
+			hash_delete_free(context->symbol_providers, node);
+		}
+		if (!provider_info->imported
+			&& cpi_ptrset_contains(context->plugin->imported, provider_info->plugin)) {
+			cpi_ptrset_remove(context->plugin->imported, provider_info->plugin);
+			cpi_ptrset_remove(provider_info->plugin->importing, context->plugin);
+			cpi_debugf(context, N_("A dynamic dependency from plug-in %s to plug-in %s was removed."), context->plugin->plugin->identifier, provider_info->plugin->plugin->identifier);
+		}
+		free(provider_info);
+	}
+}
+
+/**
+ * Resolves symbols provided by the specified plug-in. The provider is
+ * looked up and started and the dynamic dependency is created only once.
+ * On failure no symbols are resolved. The caller must have locked the
+ * context.
+ * 
+ * @param context the plug-in context
+ * @param id the identifier of the symbol defining plug-in
+ * @param names the names of the symbols
+ * @param symbols filled with the pointers associated with the symbols
+ * @param num the number of symbols, at least one
+ * @return @ref CP_OK (zero) on success or a status code on failure
+ */
+static cp_status_t resolve_symbols(cp_context_t *context, const char *id, const char * const *names, void **symbols, int num) {
 	cp_status_t status = CP_OK;
-	int error_reported = 1;
+	int error_reported = 0;
 	hnode_t *node;
-	void *symbol = NULL;
-	symbol_info_t *symbol_info = NULL;
 	symbol_provider_info_t *provider_info = NULL;
 	cp_plugin_t *pp = NULL;
+	const char *name = names[0];
+	int i = 0;
 
-	CHECK_NOT_NULL(context);
-	CHECK_NOT_NULL(id);
-	CHECK_NOT_NULL(name);
-	
-	// Resolve the symbol
-	cpi_lock_context(context);
-	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER | CPI_CF_STOP, __func__);
+	assert(num > 0);
 	do {
 
 		// Allocate space for symbol hashes, if necessary
@@ -177,25 +323,6 @@ CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const c
 			break;
 		}
 
-		// Check for a context specific symbol
-		if (pp->defined_symbols != NULL && (node = hash_lookup(pp->defined_symbols, name)) != NULL) {
-			symbol = hnode_get(node);
-		}
-
-		// Fall back to global symbols, if necessary
-		if (symbol == NULL && pp->runtime_lib != NULL) {
-			symbol = DLSYM(pp->runtime_lib, name);
-		}
-		if (symbol == NULL) {
-			const char *error = DLERROR();
-			if (error == NULL) {
-				error = _("Unspecified error.");
-			}
-			cpi_warnf(context, N_("Symbol %s in plug-in %s could not be resolved: %s"), name, id, error);
-			status = CP_ERR_UNKNOWN;
-			break;
-		}
-
 		// Lookup or initialize symbol provider information
 		if ((node = hash_lookup(context->symbol_providers, pp)) != NULL) {
 			provider_info = hnode_get(node);
@@ -213,25 +340,8 @@ CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const c
 			}
 		}
 		
-		// Lookup or initialize symbol information
-		if ((node = hash_lookup(context->resolved_symbols, symbol)) != NULL) {
-			symbol_info = hnode_get(node);
-		} else {
-			if ((symbol_info = malloc(sizeof(symbol_info_t))) == NULL) {
-				status = CP_ERR_RESOURCE;
-				break;
-			}
-			memset(symbol_info, 0, sizeof(symbol_info_t));
-			symbol_info->provider_info = provider_info;
-			if (!hash_alloc_insert(context->resolved_symbols, symbol, symbol_info)) {
-				status = CP_ERR_RESOURCE;
-				break;
-			}
-		}
-		
 		// Add dependencies (for plug-in)
-		if (provider_info != NULL
-			&& !provider_info->imported
+		if (!provider_info->imported
 			&& provider_info->usage_count == 0) {
 			if (!cpi_ptrset_add(context->plugin->imported, pp)) {
 				status = CP_ERR_RESOURCE;
@@ -244,36 +354,558 @@ CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const c
 			}
 			cpi_debugf(context, N_("A dynamic dependency was created from plug-in %s to plug-in %s."), context->plugin->plugin->identifier, pp->plugin->identifier);
 		}
+
+		// Resolve the symbols
+		for (i = 0; i < num; i++) {
+			void *symbol = NULL;
+			symbol_info_t *symbol_info;
+			
+			name = names[i];
+			
+			// Check for a context specific symbol
+			if (pp->defined_symbols != NULL && (node = hash_lookup(pp->defined_symbols, name)) != NULL) {
+				symbol = hnode_get(node);
+			}
+
+			// Check the declared and indexed symbol exports
+			if (symbol == NULL && pp->exported_symbols != NULL && (node = hash_lookup(pp->exported_symbols, name)) != NULL) {
+				symbol = hnode_get(node);
+			}
+
+			// Fall back to global symbols, if necessary
+			if (symbol == NULL && pp->runtime_lib != NULL) {
+				symbol = DLSYM(pp->runtime_lib, name);
+			}
+			if (symbol == NULL) {
+				const char *error = DLERROR();
+				if (error == NULL) {
+					error = _("Unspecified error.");
+				}
+				cpi_warnf(context, N_("Symbol %s in plug-in %s could not be resolved: %s"), name, id, error);
+				status = CP_ERR_UNKNOWN;
+				break;
+			}
+
+			// Lookup or initialize symbol information
+			if ((node = hash_lookup(context->resolved_symbols, symbol)) != NULL) {
+				symbol_info = hnode_get(node);
+			} else {
+				if ((symbol_info = malloc(sizeof(symbol_info_t))) == NULL) {
+					status = CP_ERR_RESOURCE;
+					break;
+				}
+				memset(symbol_info, 0, sizeof(symbol_info_t));
+				symbol_info->provider_info = provider_info;
+				if (!hash_alloc_insert(context->resolved_symbols, symbol, symbol_info)) {
+					free(symbol_info);
+					status = CP_ERR_RESOURCE;
+					break;
+				}
+			}
 		
-		// Increase usage counts
-		symbol_info->usage_count++;
-		provider_info->usage_count++;
+			// Increase usage counts
+			symbol_info->usage_count++;
+			provider_info->usage_count++;
+			symbols[i] = symbol;
 
-		if (cpi_is_logged(context, CP_LOG_DEBUG)) {
-			char owner[64];
-			/* TRANSLATORS: First %s is the context owner */
-			cpi_debugf(context, N_("%s resolved symbol %s defined by plug-in %s."), cpi_context_owner(context, owner, sizeof(owner)), name, id);
+			if (cpi_is_logged(context, CP_LOG_DEBUG)) {
+				char owner[64];
+				/* TRANSLATORS: First %s is the context owner */
+				cpi_debugf(context, N_("%s resolved symbol %s defined by plug-in %s."), cpi_context_owner(context, owner, sizeof(owner)), name, id);
+			}
 		}
+		
 	} while (0);
 
-	// Clean up
-	if (symbol_info != NULL && symbol_info->usage_count == 0) {
-		if ((node = hash_lookup(context->resolved_symbols, symbol)) != NULL) {
-			hash_delete_free(context->resolved_symbols, node);
+	// Undo partial resolution on failure
+	if (status != CP_OK) {
+		while (i > 0) {
+			unuse_symbol(context, symbols[--i]);
 		}
-		free(symbol_info);
-	}
-	if (provider_info != NULL && provider_info->usage_count == 0) {
-		if ((node = hash_lookup(context->symbol_providers, pp)) != NULL) {
-			hash_delete_free(context->symbol_providers, node);
+		if (provider_info != NULL) {
+			unuse_provider(context, provider_info);
 		}
-		free(provider_info);
 	}
 
 	// Report insufficient memory error
 	if (status == CP_ERR_RESOURCE && !error_reported) {
 		cpi_errorf(context, N_("Symbol %s in plug-in %s could not be resolved due to insufficient memory."), name, id);
 	}
+
+	return status;
+}
+
+// Symbol cache
+
+static int comp_cache_entry_name(const void *p1, const void *p2) {
+	const symbol_cache_entry_t *e1 = *((symbol_cache_entry_t * const *) p1);
+	const symbol_cache_entry_t *e2 = *((symbol_cache_entry_t * const *) p2);
+	int c;
+	
+	if ((c = strcmp(e1->provider_id, e2->provider_id)) != 0) {
+		return c;
+	}
+	return strcmp(e1->name, e2->name);
+}
+
+static int comp_cache_entry_symbol(const void *p1, const void *p2) {
+	uintptr_t s1 = (uintptr_t) (*((symbol_cache_entry_t * const *) p1))->symbol;
+	uintptr_t s2 = (uintptr_t) (*((symbol_cache_entry_t * const *) p2))->symbol;
+	
+	return (s1 > s2) - (s1 < s2);
+}
+
+/**
+ * Pins the published symbol cache snapshot for reading without locking
+ * the context. Each call must be matched by a call to unpin_symbol_cache.
+ * 
+ * @param cache the symbol cache
+ * @return the snapshot or NULL if no symbols are cached
+ */
+static symbol_cache_snapshot_t *pin_symbol_cache(cpi_symbol_cache_t *cache) {
+	cpi_atomic_add_int(&(cache->readers), 1);
+	cpi_atomic_fence();
+	return cpi_atomic_load_ptr(&(cache->snapshot));
+}
+
+static void unpin_symbol_cache(cpi_symbol_cache_t *cache) {
+	cpi_atomic_add_int(&(cache->readers), -1);
+}
+
+/**
+ * Frees the retired snapshots and evicted entries of a symbol cache if
+ * there are no readers. The caller must have locked the context.
+ * 
+ * @param cache the symbol cache
+ */
+static void reclaim_symbol_cache(cpi_symbol_cache_t *cache) {
+	cpi_atomic_fence();
+	if ((cache->retired_snapshots != NULL || cache->retired_entries != NULL)
+		&& cpi_atomic_add_int(&(cache->readers), 0) == 0) {
+		while (cache->retired_snapshots != NULL) {
+			symbol_cache_snapshot_t *snapshot = cache->retired_snapshots;
+			
+			cache->retired_snapshots = snapshot->next_retired;
+			free(snapshot);
+		}
+		while (cache->retired_entries != NULL) {
+			symbol_cache_entry_t *entry = cache->retired_entries;
+			
+			cache->retired_entries = entry->next_retired;
+			free(entry->provider_id);
+			free(entry->name);
+			free(entry);
+		}
+	}
+}
+
+/**
+ * Publishes a new snapshot of cached symbols and retires the previous one.
+ * The caller must have locked the context.
+ * 
+ * @param cache the symbol cache
+ * @param entries the cached entries
+ * @param num the number of entries
+ * @return non-zero on success or zero if out of memory
+ */
+static int publish_symbol_cache(cpi_symbol_cache_t *cache, symbol_cache_entry_t **entries, int num) {
+	symbol_cache_snapshot_t *snapshot = NULL;
+	symbol_cache_snapshot_t *old = cache->snapshot;
+	
+	if (num > 0) {
+		if ((snapshot = malloc(sizeof(symbol_cache_snapshot_t) + 2 * num * sizeof(symbol_cache_entry_t *))) == NULL) {
+			return 0;
+		}
+		snapshot->num_entries = num;
+		snapshot->by_name = (symbol_cache_entry_t **) (snapshot + 1);
+		snapshot->by_symbol = snapshot->by_name + num;
+		snapshot->next_retired = NULL;
+		memcpy(snapshot->by_name, entries, num * sizeof(symbol_cache_entry_t *));
+		memcpy(snapshot->by_symbol, entries, num * sizeof(symbol_cache_entry_t *));
+		qsort(snapshot->by_name, num, sizeof(symbol_cache_entry_t *), comp_cache_entry_name);
+		qsort(snapshot->by_symbol, num, sizeof(symbol_cache_entry_t *), comp_cache_entry_symbol);
+	}
+	if (!cpi_atomic_cas_ptr(&(cache->snapshot), old, snapshot)) {
+		assert(0);
+	}
+	if (old != NULL) {
+		old->next_retired = cache->retired_snapshots;
+		cache->retired_snapshots = old;
+	}
+	return 1;
+}
+
+/**
+ * Takes a use of a cached symbol unless the entry has been evicted.
+ * 
+ * @param entry the cache entry
+ * @return non-zero on success or zero if the entry has been evicted
+ */
+static int use_cache_entry(symbol_cache_entry_t *entry) {
+	int uses;
+	
+	while ((uses = cpi_atomic_add_int(&(entry->uses), 0)) >= 0) {
+		if (cpi_atomic_cas_int(&(entry->uses), uses, uses + 1)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Returns a use of a cached symbol unless the entry has no uses or has
+ * been evicted.
+ * 
+ * @param entry the cache entry
+ * @return non-zero on success or zero if the use must be released normally
+ */
+static int unuse_cache_entry(symbol_cache_entry_t *entry) {
+	int uses;
+	
+	while ((uses = cpi_atomic_add_int(&(entry->uses), 0)) > 0) {
+		if (cpi_atomic_cas_int(&(entry->uses), uses, uses - 1)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Looks up and uses a cached symbol without locking the context.
+ * 
+ * @param cache the symbol cache
+ * @param id the identifier of the symbol defining plug-in
+ * @param name the name of the symbol
+ * @return the pointer associated with the symbol or NULL if not cached
+ */
+static void *use_cached_symbol(cpi_symbol_cache_t *cache, const char *id, const char *name) {
+	symbol_cache_snapshot_t *snapshot;
+	void *symbol = NULL;
+	
+	if ((snapshot = pin_symbol_cache(cache)) != NULL) {
+		symbol_cache_entry_t key, *keyptr = &key, **found;
+		
+		key.provider_id = (char *) id;
+		key.name = (char *) name;
+		found = bsearch(&keyptr, snapshot->by_name, snapshot->num_entries, sizeof(symbol_cache_entry_t *), comp_cache_entry_name);
+		if (found != NULL && use_cache_entry(*found)) {
+			symbol = (*found)->symbol;
+		}
+	}
+	unpin_symbol_cache(cache);
+	return symbol;
+}
+
+/**
+ * Returns a use of a symbol obtained through the cache without locking
+ * the context.
+ * 
+ * @param cache the symbol cache
+ * @param ptr the pointer associated with the symbol
+ * @return non-zero on success or zero if the symbol must be released normally
+ */
+static int unuse_cached_symbol(cpi_symbol_cache_t *cache, const void *ptr) {
+	symbol_cache_snapshot_t *snapshot;
+	int released = 0;
+	
+	if ((snapshot = pin_symbol_cache(cache)) != NULL) {
+		symbol_cache_entry_t key, *keyptr = &key, **found;
+		
+		key.symbol = (void *) ptr;
+		found = bsearch(&keyptr, snapshot->by_symbol, snapshot->num_entries, sizeof(symbol_cache_entry_t *), comp_cache_entry_symbol);
+		if (found != NULL) {
+			symbol_cache_entry_t **last = snapshot->by_symbol + snapshot->num_entries;
+			
+			// The symbol may be cached under several names
+			while (found > snapshot->by_symbol && (*(found - 1))->symbol == ptr) {
+				found--;
+			}
+			for (; found < last && (*found)->symbol == ptr && !released; found++) {
+				released = unuse_cache_entry(*found);
+			}
+		}
+	}
+	unpin_symbol_cache(cache);
+	return released;
+}
+
+/**
+ * Evicts an entry which has already been removed from the published
+ * snapshot. The uses still handed out through the entry are turned into
+ * ordinary uses of the resolved symbol and the use held by the cache is
+ * released. The caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param entry the cache entry
+ */
+static void evict_cache_entry(cp_context_t *context, symbol_cache_entry_t *entry) {
+	cpi_symbol_cache_t *cache = context->symbol_cache;
+	int uses;
+	
+	// Stop handing out uses through the entry
+	do {
+		uses = cpi_atomic_add_int(&(entry->uses), 0);
+	} while (!cpi_atomic_cas_int(&(entry->uses), uses, -1));
+	assert(uses >= 0);
+	
+	if (uses > 0) {
+		hnode_t *node;
+		symbol_info_t *symbol_info;
+		
+		if ((node = hash_lookup(context->resolved_symbols, entry->symbol)) != NULL) {
+			symbol_info = hnode_get(node);
+			symbol_info->usage_count += uses - 1;
+			symbol_info->provider_info->usage_count += uses - 1;
+		}
+	} else {
+		symbol_provider_info_t *provider_info;
+		
+		if ((provider_info = unuse_symbol(context, entry->symbol)) != NULL) {
+			unuse_provider(context, provider_info);
+		}
+	}
+	entry->next_retired = cache->retired_entries;
+	cache->retired_entries = entry;
+}
+
+/**
+ * Adds a freshly resolved symbol to the symbol cache of the context, if
+ * enabled. The resolved use is taken over by the cache and handed out as
+ * the first use of the entry. The oldest entry is evicted if the cache is
+ * full. The caller must have locked the context.
+ * 
+ * @param context the plug-in context
+ * @param id the identifier of the symbol defining plug-in
+ * @param name the name of the symbol
+ * @param symbol the pointer associated with the symbol
+ */
+static void cache_symbol(cp_context_t *context, const char *id, const char *name, void *symbol) {
+	cpi_symbol_cache_t *cache = context->symbol_cache;
+	symbol_cache_entry_t *entry = NULL, *evicted = NULL;
+	symbol_cache_entry_t **entries = NULL;
+	int num = 0;
+	
+	if (cache == NULL || cache->max_entries <= 0) {
+		return;
+	}
+	do {
+		int i;
+		
+		// Create the entry
+		if ((entry = malloc(sizeof(symbol_cache_entry_t))) == NULL) {
+			break;
+		}
+		if ((entry->name = strdup(name)) == NULL) {
+			free(entry);
+			entry = NULL;
+			break;
+		}
+		if ((entry->provider_id = strdup(id)) == NULL) {
+			free(entry->name);
+			free(entry);
+			entry = NULL;
+			break;
+		}
+		entry->symbol = symbol;
+		entry->uses = 1;
+		entry->seq = cache->next_seq++;
+		entry->next_retired = NULL;
+
+		// Replace the oldest entry if the cache is full
+		if (cache->snapshot != NULL) {
+			num = cache->snapshot->num_entries;
+		}
+		if ((entries = malloc((num + 1) * sizeof(symbol_cache_entry_t *))) == NULL) {
+			break;
+		}
+		if (num > 0) {
+			memcpy(entries, cache->snapshot->by_name, num * sizeof(symbol_cache_entry_t *));
+		}
+		if (num >= cache->max_entries) {
+			int oldest = 0;
+			
+			for (i = 1; i < num; i++) {
+				if (entries[i]->seq - entries[oldest]->seq > UINT_MAX / 2) {
+					oldest = i;
+				}
+			}
+			evicted = entries[oldest];
+			entries[oldest] = entry;
+		} else {
+			entries[num++] = entry;
+		}
+		if (!publish_symbol_cache(cache, entries, num)) {
+			evicted = NULL;
+			break;
+		}
+		
+		// The entry now owns the resolved use
+		entry = NULL;
+		if (evicted != NULL) {
+			evict_cache_entry(context, evicted);
+		}
+	} while (0);
+	
+	// Release resources
+	if (entry != NULL) {
+		free(entry->provider_id);
+		free(entry->name);
+		free(entry);
+	}
+	free(entries);
+	reclaim_symbol_cache(cache);
+}
+
+CP_HIDDEN void cpi_flush_symbol_cache(cp_context_t *context, cp_plugin_t *provider) {
+	cpi_symbol_cache_t *cache = context->symbol_cache;
+	symbol_cache_snapshot_t *snapshot;
+	symbol_cache_entry_t **entries = NULL;
+	int i, num = 0;
+	
+	assert(cpi_is_context_locked(context));
+	if (cache == NULL || (snapshot = cache->snapshot) == NULL) {
+		return;
+	}
+	
+	// Keep the symbols of other providers, if possible
+	if (provider != NULL) {
+		if ((entries = malloc(snapshot->num_entries * sizeof(symbol_cache_entry_t *))) == NULL) {
+			provider = NULL;
+		} else {
+			for (i = 0; i < snapshot->num_entries; i++) {
+				if (strcmp(snapshot->by_name[i]->provider_id, provider->plugin->identifier)) {
+					entries[num++] = snapshot->by_name[i];
+				}
+			}
+			if (num == snapshot->num_entries) {
+				free(entries);
+				return;
+			}
+		}
+	}
+	if (!publish_symbol_cache(cache, entries, num)) {
+		provider = NULL;
+		publish_symbol_cache(cache, NULL, 0);
+	}
+	free(entries);
+	
+	// Evict the removed entries, the old snapshot is retired but not freed
+	for (i = 0; i < snapshot->num_entries; i++) {
+		symbol_cache_entry_t *entry = snapshot->by_name[i];
+		
+		if (provider == NULL || !strcmp(entry->provider_id, provider->plugin->identifier)) {
+			evict_cache_entry(context, entry);
+		}
+	}
+	reclaim_symbol_cache(cache);
+}
+
+CP_HIDDEN void cpi_flush_symbol_caches(cp_context_t *context, cp_plugin_t *provider) {
+	lnode_t *node;
+	
+	if (context->env->symbol_caching_contexts == NULL) {
+		return;
+	}
+	for (node = list_first(context->env->symbol_caching_contexts);
+		node != NULL;
+		node = list_next(context->env->symbol_caching_contexts, node)) {
+		cpi_flush_symbol_cache(lnode_get(node), provider);
+	}
+}
+
+CP_HIDDEN void cpi_free_symbol_cache(cp_context_t *context) {
+	cpi_symbol_cache_t *cache = context->symbol_cache;
+	
+	if (cache == NULL) {
+		return;
+	}
+	if (cache->snapshot != NULL) {
+		cpi_flush_symbol_cache(context, NULL);
+	}
+	assert(cpi_atomic_add_int(&(cache->readers), 0) == 0);
+	reclaim_symbol_cache(cache);
+	if (context->env->symbol_caching_contexts != NULL) {
+		cpi_ptrset_remove(context->env->symbol_caching_contexts, context);
+	}
+	context->symbol_cache = NULL;
+	free(cache);
+}
+
+CP_C_API cp_status_t cp_set_symbol_cache_size(cp_context_t *context, int max_symbols) {
+	cp_status_t status = CP_OK;
+	
+	CHECK_NOT_NULL(context);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER, __func__);
+	do {
+		cpi_symbol_cache_t *cache;
+		
+		// Create the cache on first use
+		if ((cache = context->symbol_cache) == NULL) {
+			if (max_symbols <= 0) {
+				break;
+			}
+			if (context->env->symbol_caching_contexts == NULL
+				&& (context->env->symbol_caching_contexts = list_create(LISTCOUNT_T_MAX)) == NULL) {
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+			if ((cache = malloc(sizeof(cpi_symbol_cache_t))) == NULL) {
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+			memset(cache, 0, sizeof(cpi_symbol_cache_t));
+			if (!cpi_ptrset_add(context->env->symbol_caching_contexts, context)) {
+				free(cache);
+				status = CP_ERR_RESOURCE;
+				break;
+			}
+			if (!cpi_atomic_cas_ptr(&(context->symbol_cache), NULL, cache)) {
+				assert(0);
+			}
+		}
+		
+		// Release the currently cached symbols
+		cpi_flush_symbol_cache(context, NULL);
+		cache->max_entries = (max_symbols > 0 ? max_symbols : 0);
+		
+	} while (0);
+	if (status != CP_OK) {
+		cpi_error(context, N_("The symbol cache could not be enabled due to insufficient memory."));
+	}
+	cpi_unlock_context(context);
+	
+	return status;
+}
+
+CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const char *name, cp_status_t *error) {
+	cpi_symbol_cache_t *cache;
+	cp_status_t status = CP_OK;
+	void *symbol = NULL;
+
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(id);
+	CHECK_NOT_NULL(name);
+	
+	// Use a cached symbol without locking, if possible
+	cpi_check_invocation_unlocked(context, CPI_CF_LOGGER | CPI_CF_LISTENER | CPI_CF_STOP, __func__);
+	if ((cache = cpi_atomic_load_ptr(&(context->symbol_cache))) != NULL
+		&& (symbol = use_cached_symbol(cache, id, name)) != NULL) {
+		if (error != NULL) {
+			*error = CP_OK;
+		}
+		return symbol;
+	}
+	
+	// Resolve the symbol
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER | CPI_CF_STOP, __func__);
+	if (context->symbol_cache == NULL
+		|| (symbol = use_cached_symbol(context->symbol_cache, id, name)) == NULL) {
+		if ((status = resolve_symbols(context, id, &name, &symbol, 1)) == CP_OK) {
+			cache_symbol(context, id, name, symbol);
+		}
+	}
 	cpi_unlock_context(context);
 
 	// Return error code
@@ -282,59 +914,88 @@ CP_C_API void * cp_resolve_symbol(cp_context_t *context, const char *id, const c
 	}
 	
 	// Return symbol
-	return symbol;
+	return (status == CP_OK ? symbol : NULL);
+}
+
+CP_C_API cp_status_t cp_resolve_symbols(cp_context_t *context, const char *id, const char * const *names, void **symbols, int num) {
+	cp_status_t status = CP_OK;
+	int i;
+
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(id);
+	CHECK_NOT_NULL(names);
+	CHECK_NOT_NULL(symbols);
+	
+	// Resolve the symbols
+	for (i = 0; i < num; i++) {
+		CHECK_NOT_NULL(names[i]);
+		symbols[i] = NULL;
+	}
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER | CPI_CF_STOP, __func__);
+	if (num > 0) {
+		status = resolve_symbols(context, id, names, symbols, num);
+	}
+	cpi_unlock_context(context);
+	
+	// Clear the symbols on failure
+	if (status != CP_OK) {
+		for (i = 0; i < num; i++) {
+			symbols[i] = NULL;
+		}
+	}
+	return status;
 }
 
 CP_C_API void cp_release_symbol(cp_context_t *context, const void *ptr) {
-	hnode_t *node;
-	symbol_info_t *symbol_info;
+	cpi_symbol_cache_t *cache;
 	symbol_provider_info_t *provider_info;
 	
 	CHECK_NOT_NULL(context);
 	CHECK_NOT_NULL(ptr);
 
+	// Return a use obtained through the symbol cache without locking
+	cpi_check_invocation_unlocked(context, CPI_CF_LOGGER | CPI_CF_LISTENER, __func__);
+	if ((cache = cpi_atomic_load_ptr(&(context->symbol_cache))) != NULL
+		&& unuse_cached_symbol(cache, ptr)) {
+		return;
+	}
+
 	cpi_lock_context(context);
 	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER, __func__);
-	do {
+	if ((provider_info = unuse_symbol(context, ptr)) != NULL) {
+		unuse_provider(context, provider_info);
+	}
+	cpi_unlock_context(context);
+}
 
-		// Look up the symbol
-		if ((node = hash_lookup(context->resolved_symbols, ptr)) == NULL) {
-			cpi_errorf(context, N_("Could not release unknown symbol at address %p."), ptr);
-			break;
-		}
-		symbol_info = hnode_get(node);
-		provider_info = symbol_info->provider_info;
-	
-		// Decrease usage count
-		assert(symbol_info->usage_count > 0);
-		symbol_info->usage_count--;
-		assert(provider_info->usage_count > 0);
-		provider_info->usage_count--;
+CP_C_API void cp_release_symbols(cp_context_t *context, void * const *symbols, int num) {
+	symbol_provider_info_t *provider_info, *last_provider = NULL;
+	int i;
 	
-		// Check if the symbol is not being used anymore
-		if (symbol_info->usage_count == 0) {
-			hash_delete_free(context->resolved_symbols, node);
-			free(symbol_info);
-			if (cpi_is_logged(context, CP_LOG_DEBUG)) {
-				char owner[64];
-				/* TRANSLATORS: First %s is the context owner */
-				cpi_debugf(context, N_("%s released the symbol at address %p defined by plug-in %s."), cpi_context_owner(context, owner, sizeof(owner)), ptr, provider_info->plugin->plugin->identifier);
-			}
+	CHECK_NOT_NULL(context);
+	CHECK_NOT_NULL(symbols);
+
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_LOGGER | CPI_CF_LISTENER, __func__);
+	for (i = 0; i < num; i++) {
+		CHECK_NOT_NULL(symbols[i]);
+		if (context->symbol_cache != NULL
+			&& unuse_cached_symbol(context->symbol_cache, symbols[i])) {
+			continue;
 		}
-	
-		// Check if the symbol providing plug-in is not being used anymore
-		if (provider_info->usage_count == 0) {
-			node = hash_lookup(context->symbol_providers, provider_info->plugin);
-			assert(node != NULL);
-			hash_delete_free(context->symbol_providers, node);
-			if (!provider_info->imported) {
-				cpi_ptrset_remove(context->plugin->imported, provider_info->plugin);
-				cpi_ptrset_remove(provider_info->plugin->importing, context->plugin);
-				cpi_debugf(context, N_("A dynamic dependency from plug-in %s to plug-in %s was removed."), context->plugin->plugin->identifier, provider_info->plugin->plugin->identifier);
-			}
-			free(provider_info);
+		if ((provider_info = unuse_symbol(context, symbols[i])) == NULL) {
+			continue;
 		}
 		
-	} while (0);
+		// Release providers when moving on, typically only once per batch
+		if (provider_info != last_provider && last_provider != NULL) {
+			unuse_provider(context, last_provider);
+		}
+		last_provider = provider_info;
+	}
+	if (last_provider != NULL) {
+		unuse_provider(context, last_provider);
+	}
 	cpi_unlock_context(context);
 }
@@ -0,0 +1,213 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+/** @file
+ * Indexing of the dynamic symbols of plug-in runtime libraries
+ */
+
+// dlinfo and RTLD_DI_LINKMAP are GNU extensions
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "../kazlib/hash.h"
+#include "cpluff.h"
+#include "defines.h"
+#include "internal.h"
+#include "util.h"
+
+#if defined(DLOPEN_POSIX) && defined(HAVE_LINK_H) && defined(HAVE_DLINFO)
+#define CPI_INDEX_RUNTIME_SYMBOLS 1
+#include <link.h>
+#include <elf.h>
+#endif
+
+
+/* ------------------------------------------------------------------------
+ * Function definitions
+ * ----------------------------------------------------------------------*/
+
+#ifdef CPI_INDEX_RUNTIME_SYMBOLS
+
+/**
+ * Returns the run-time address of a dynamic section entry. Most dynamic
+ * linkers relocate the dynamic section in place but some leave it
+ * read-only and unrelocated.
+ *
+ * @param lm the link map of the library
+ * @param ptr the address stored in the dynamic section
+ * @return the run-time address
+ */
+static const void *dyn_addr(const struct link_map *lm, ElfW(Addr) ptr) {
+	if (ptr < lm->l_addr) {
+		ptr += lm->l_addr;
+	}
+	return (const void *) ptr;
+}
+
+/**
+ * Returns the number of entries in a dynamic symbol table using a GNU
+ * style hash table. The table size is not recorded anywhere so it is
+ * derived from the last chain of the highest used bucket.
+ *
+ * @param gnu_hash the GNU hash table
+ * @return the number of symbol table entries
+ */
+static unsigned long count_gnu_hash_symbols(const Elf32_Word *gnu_hash) {
+	Elf32_Word nbuckets = gnu_hash[0];
+	Elf32_Word symoffset = gnu_hash[1];
+	Elf32_Word bloom_size = gnu_hash[2];
+	const Elf32_Word *buckets;
+	const Elf32_Word *chains;
+	Elf32_Word max = 0;
+	Elf32_Word i;
+
+	buckets = (const Elf32_Word *) ((const ElfW(Addr) *) (gnu_hash + 4) + bloom_size);
+	chains = buckets + nbuckets;
+	for (i = 0; i < nbuckets; i++) {
+		if (buckets[i] > max) {
+			max = buckets[i];
+		}
+	}
+	if (max < symoffset) {
+		return symoffset;
+	}
+	while (!(chains[max - symoffset] & 1)) {
+		max++;
+	}
+	return (unsigned long) max + 1;
+}
+
+CP_HIDDEN cp_status_t cpi_index_runtime_symbols(cp_context_t *context, cp_plugin_t *plugin) {
+	struct link_map *lm = NULL;
+	const ElfW(Dyn) *dyn;
+	const ElfW(Sym) *symtab = NULL;
+	const char *strtab = NULL;
+	const Elf32_Word *hash = NULL;
+	const Elf32_Word *gnu_hash = NULL;
+	const ElfW(Half) *versym = NULL;
+	unsigned long num_syms, i;
+
+	assert(plugin->runtime_lib != NULL);
+
+	if (dlinfo(plugin->runtime_lib, RTLD_DI_LINKMAP, &lm) != 0 || lm == NULL || lm->l_ld == NULL) {
+		cpi_warnf(context, N_("Plug-in %s runtime library symbols could not be indexed."), plugin->plugin->identifier);
+		return CP_OK;
+	}
+	for (dyn = lm->l_ld; dyn->d_tag != DT_NULL; dyn++) {
+		switch (dyn->d_tag) {
+			case DT_SYMTAB:
+				symtab = dyn_addr(lm, dyn->d_un.d_ptr);
+				break;
+			case DT_STRTAB:
+				strtab = dyn_addr(lm, dyn->d_un.d_ptr);
+				break;
+			case DT_HASH:
+				hash = dyn_addr(lm, dyn->d_un.d_ptr);
+				break;
+			case DT_GNU_HASH:
+				gnu_hash = dyn_addr(lm, dyn->d_un.d_ptr);
+				break;
+			case DT_VERSYM:
+				versym = dyn_addr(lm, dyn->d_un.d_ptr);
+				break;
+		}
+	}
+	if (symtab == NULL || strtab == NULL || (hash == NULL && gnu_hash == NULL)) {
+		cpi_warnf(context, N_("Plug-in %s runtime library symbols could not be indexed."), plugin->plugin->identifier);
+		return CP_OK;
+	}
+	num_syms = (hash != NULL ? (unsigned long) hash[1] : count_gnu_hash_symbols(gnu_hash));
+
+	if (plugin->exported_symbols == NULL
+		&& (plugin->exported_symbols = hash_create(HASHCOUNT_T_MAX, (int (*)(const void *, const void *)) strcmp, NULL)) == NULL) {
+		cpi_errorf(context, N_("Plug-in %s runtime library symbols could not be indexed due to insufficient memory."), plugin->plugin->identifier);
+		return CP_ERR_RESOURCE;
+	}
+
+	// The first entry is always the undefined symbol
+	for (i = 1; i < num_syms; i++) {
+		const ElfW(Sym) *sym = symtab + i;
+		
+		// The symbol info macros are the same for both ELF classes
+		int bind = ELF32_ST_BIND(sym->st_info);
+		int type = ELF32_ST_TYPE(sym->st_info);
+		const char *name;
+
+		// Only defined global functions and variables of a visible version
+		if (sym->st_shndx == SHN_UNDEF
+			|| sym->st_shndx == SHN_ABS
+			|| (bind != STB_GLOBAL && bind != STB_WEAK)
+			|| (type != STT_FUNC && type != STT_OBJECT)
+			|| ELF32_ST_VISIBILITY(sym->st_other) != STV_DEFAULT
+			|| (versym != NULL && (versym[i] & 0x8000))) {
+			continue;
+		}
+		name = strtab + sym->st_name;
+		if (name[0] == '\0'
+			|| hash_lookup(plugin->exported_symbols, name) != NULL) {
+			continue;
+		}
+		if (!hash_alloc_insert(plugin->exported_symbols, name, (void *) (lm->l_addr + sym->st_value))) {
+			cpi_errorf(context, N_("Plug-in %s runtime library symbols could not be indexed due to insufficient memory."), plugin->plugin->identifier);
+			return CP_ERR_RESOURCE;
+		}
+	}
+	cpi_debugf(context, N_("Indexed the runtime library symbols of plug-in %s."), plugin->plugin->identifier);
+	return CP_OK;
+}
+
+#else /*CPI_INDEX_RUNTIME_SYMBOLS*/
+
+CP_HIDDEN cp_status_t cpi_index_runtime_symbols(cp_context_t *context, cp_plugin_t *plugin) {
+	return CP_OK;
+}
+
+#endif /*CPI_INDEX_RUNTIME_SYMBOLS*/
+
+CP_C_API cp_status_t cp_index_runtime_symbols(cp_context_t *context, int index) {
+	cp_status_t status = CP_OK;
+
+	CHECK_NOT_NULL(context);
+	cpi_lock_context(context);
+	cpi_check_invocation(context, CPI_CF_ANY, __func__);
+#ifdef CPI_INDEX_RUNTIME_SYMBOLS
+	context->env->index_runtime_symbols = (index != 0);
+#else
+	if (index) {
+		cpi_error(context, N_("Indexing runtime library symbols is not supported on this platform."));
+		status = CP_ERR_RUNTIME;
+	}
+#endif
+	cpi_unlock_context(context);
+
+	return status;
+}
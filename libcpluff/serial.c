@@ -31,8 +31,43 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
 #include "cpluff.h"
 #include "internal.h"
+#ifdef CP_THREADS
+#include "thread.h"
+#include "atomic.h"
+#endif
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_EVENTFD_H)
+#define CPI_RUN_FDS 1
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+/// The maximum number of file descriptor events handled per poll
+#define RUN_POLL_EVENTS 16
+
+/// A timed run function called again a period after it returns
+#define RUN_TIMER_DELAY 1
+
+/// A timed run function called at a fixed rate
+#define RUN_TIMER_RATE 2
+
+/// How many run functions a busy worker runs between checking for timed run functions
+#define RUN_WAIT_CHECK_INTERVAL 16
 
 
 /* ------------------------------------------------------------------------
@@ -51,15 +86,756 @@ typedef struct run_func_t {
 	/// Whether currently in execution
 	int in_execution;
 	
+	/// The file descriptor the function waits for, or -1 if none
+	int fd;
+	
+	/// The file descriptor events waited for, CP_FD_READ and/or CP_FD_WRITE
+	int fd_events;
+	
+	/// The timer kind, RUN_TIMER_DELAY, RUN_TIMER_RATE or zero if not timed
+	int timer;
+	
+	/// The delay or period of a timed run function in milliseconds
+	unsigned long period;
+	
+	/// The time of the next call of a timed run function
+	uint64_t deadline;
+	
+#ifdef CP_THREADS
+
+	/// The run queue of a scheduler holding this function, or NULL if none
+	struct run_queue_t *queue;
+	
+	/// The list node of this function in the run queues
+	lnode_t *queue_node;
+	
+	/// The list node of this function in the functions of the scheduler
+	lnode_t sched_node;
+
+#endif
+	
 } run_func_t;
 
-CP_C_API cp_status_t cp_run_function(cp_context_t *ctx, cp_run_func_t runfunc) {
+#ifdef CP_THREADS
+
+/// A run queue owned by a worker thread of a multi-threaded run
+typedef struct run_queue_t {
+	
+	/// The scheduler this queue belongs to
+	cpi_run_scheduler_t *scheduler;
+	
+	/// The mutex protecting the queue
+	cpi_mutex_t *mutex;
+	
+	/// Waiting run functions, taken from the front by the owner and from the back by others
+	list_t funcs;
+	
+	/// The number of run functions executed by the owner
+	unsigned int runs;
+	
+} run_queue_t;
+
+/// The scheduler of a multi-threaded run
+struct cpi_run_scheduler_t {
+	
+	/// The plug-in context
+	cp_context_t *context;
+	
+	/// The run queues, one per worker thread
+	run_queue_t *queues;
+	
+	/// The number of run queues
+	int num_queues;
+	
+	/// The run queue receiving the next registered run function
+	int next_queue;
+	
+	/// All scheduled run functions, waiting or in execution
+	list_t funcs;
+	
+	/// The number of worker threads waiting for work (atomic)
+	int idle;
+	
+};
+
+#endif
+
+/// Run functions waiting for their deadlines
+struct cpi_run_timers_t {
+	
+	/// The list nodes of the run functions as a binary min-heap by deadline
+	lnode_t **heap;
+	
+	/// The number of run functions in the heap
+	int num_heap;
+	
+	/// The capacity of the heap
+	int size;
+	
+	/// The number of registered timed run functions, waiting or not
+	int num_funcs;
+	
+};
+
+#ifdef CPI_RUN_FDS
+
+/// The poller of run functions waiting for file descriptors
+struct cpi_run_poller_t {
+	
+	/// The epoll instance watching the file descriptors
+	int epoll_fd;
+	
+	/// The event file descriptor used to wake up a polling thread
+	int wake_fd;
+	
+	/// The run functions waiting for their file descriptors
+	list_t funcs;
+	
+	/// Whether some thread is currently polling
+	int polling;
+	
+	/// The number of threads keeping others from polling
+	int holds;
+	
+};
+
+#endif
+
+
+/* ------------------------------------------------------------------------
+ * Function definitions
+ * ----------------------------------------------------------------------*/
+
+#ifdef CP_THREADS
+
+/**
+ * Hands a run function over to the scheduler of a multi-threaded run.
+ * Registered run functions are distributed over the run queues in a
+ * round-robin fashion. Must be called holding the context lock.
+ * 
+ * @param sched the scheduler
+ * @param node the list node of the run function, not in any list
+ */
+static void schedule_run_func(cpi_run_scheduler_t *sched, lnode_t *node) {
+	run_func_t *rf = lnode_get(node);
+	run_queue_t *queue = sched->queues + sched->next_queue;
+	
+	sched->next_queue = (sched->next_queue + 1) % sched->num_queues;
+	lnode_init(&rf->sched_node, rf);
+	list_append(&sched->funcs, &rf->sched_node);
+	rf->queue_node = node;
+	cpi_lock_mutex(queue->mutex);
+	list_append(&queue->funcs, node);
+	rf->queue = queue;
+	cpi_unlock_mutex(queue->mutex);
+	cpi_signal_context(sched->context);
+}
+
+#endif
+
+/**
+ * Queues a run function for execution, handing it over to the scheduler
+ * of a multi-threaded run if one is in progress. Must be called holding
+ * the context lock.
+ *
+ * @param ctx the plug-in context
+ * @param node the list node of the run function, not in any list
+ */
+static void queue_run_func(cp_context_t *ctx, lnode_t *node) {
+#ifdef CP_THREADS
+	if (ctx->env->run_scheduler != NULL) {
+		schedule_run_func(ctx->env->run_scheduler, node);
+		return;
+	}
+#endif
+	list_append(ctx->env->run_funcs, node);
+	if (ctx->env->run_wait == NULL) {
+		ctx->env->run_wait = node;
+	}
+	cpi_signal_context(ctx);
+}
+
+#ifdef CPI_RUN_FDS
+
+/**
+ * Returns whether there are run functions waiting for file descriptors.
+ *
+ * @param env the plug-in environment
+ * @return whether there are run functions waiting for file descriptors
+ */
+static int has_run_fds(cp_plugin_env_t *env) {
+	return (env->run_poller != NULL && !list_isempty(&env->run_poller->funcs));
+}
+
+/**
+ * Returns whether this thread may poll the file descriptors of the
+ * waiting run functions. Only one thread polls at a time.
+ *
+ * @param env the plug-in environment
+ * @return whether this thread may poll
+ */
+static int can_poll_run_fds(cp_plugin_env_t *env) {
+	return (has_run_fds(env)
+		&& !env->run_poller->polling
+		&& !env->run_poller->holds);
+}
+
+/**
+ * Wakes up the thread polling the file descriptors, if any, so that it
+ * reconsiders what to do. Must be called holding the context lock.
+ *
+ * @param env the plug-in environment
+ */
+static void wake_run_poller(cp_plugin_env_t *env) {
+	if (env->run_poller != NULL && env->run_poller->polling) {
+		uint64_t one = 1;
+
+		if (write(env->run_poller->wake_fd, &one, sizeof(one)) < 0) {
+
+			// The counter is already non-zero so the poller wakes up anyway
+		}
+	}
+}
+
+/**
+ * Returns the epoll events corresponding to run function events.
+ *
+ * @param events the run function events
+ * @return the epoll events of a one-shot watch
+ */
+static uint32_t run_fd_epoll_events(int events) {
+	return ((events & CP_FD_READ) ? EPOLLIN : 0)
+		| ((events & CP_FD_WRITE) ? EPOLLOUT : 0)
+		| EPOLLONESHOT;
+}
+
+/**
+ * Starts watching the file descriptor of a new run function, creating the
+ * poller on first use. Must be called holding the context lock.
+ *
+ * @param ctx the plug-in context
+ * @param node the list node of the run function, not in any list
+ * @return CP_OK (0) on success, CP_ERR_RESOURCE if the poller could not
+ * 		be created or CP_ERR_RUNTIME if the file descriptor can not be watched,
+ * 		for example because another run function already waits for it
+ */
+static cp_status_t watch_run_fd(cp_context_t *ctx, lnode_t *node) {
+	cpi_run_poller_t *poller = ctx->env->run_poller;
+	run_func_t *rf = lnode_get(node);
+	struct epoll_event event;
+
+	if (poller == NULL) {
+		if ((poller = malloc(sizeof(cpi_run_poller_t))) == NULL) {
+			return CP_ERR_RESOURCE;
+		}
+		memset(poller, 0, sizeof(cpi_run_poller_t));
+		list_init(&poller->funcs, LISTCOUNT_T_MAX);
+		poller->wake_fd = -1;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.ptr = NULL;
+		if ((poller->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0
+			|| (poller->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0
+			|| epoll_ctl(poller->epoll_fd, EPOLL_CTL_ADD, poller->wake_fd, &event) != 0) {
+			if (poller->epoll_fd >= 0) {
+				close(poller->epoll_fd);
+			}
+			if (poller->wake_fd >= 0) {
+				close(poller->wake_fd);
+			}
+			free(poller);
+			return CP_ERR_RESOURCE;
+		}
+		ctx->env->run_poller = poller;
+	}
+	memset(&event, 0, sizeof(event));
+	event.events = run_fd_epoll_events(rf->fd_events);
+	event.data.ptr = node;
+	if (epoll_ctl(poller->epoll_fd, EPOLL_CTL_ADD, rf->fd, &event) != 0) {
+		return CP_ERR_RUNTIME;
+	}
+	list_append(&poller->funcs, node);
+	return CP_OK;
+}
+
+/**
+ * Polls the file descriptors of the waiting run functions and queues the
+ * ready run functions for execution. The context is unlocked while
+ * polling. Must be called holding the context lock and only if
+ * can_poll_run_fds returns non-zero.
+ *
+ * @param ctx the plug-in context
+ * @param timeout the maximum time to wait in milliseconds or -1 to wait
+ * 		until something happens
+ */
+static void poll_run_fds(cp_context_t *ctx, int timeout) {
+	cpi_run_poller_t *poller = ctx->env->run_poller;
+	struct epoll_event events[RUN_POLL_EVENTS];
+	int n, i;
+
+	poller->polling = 1;
+	cpi_unlock_context(ctx);
+	n = epoll_wait(poller->epoll_fd, events, RUN_POLL_EVENTS, timeout);
+	cpi_lock_context(ctx);
+	poller->polling = 0;
+
+	// Other threads do not free waiting run functions while polling
+	for (i = 0; i < n; i++) {
+		lnode_t *node = events[i].data.ptr;
+
+		if (node == NULL) {
+			uint64_t count;
+
+			if (read(poller->wake_fd, &count, sizeof(count)) < 0) {
+
+				// Already reset by an earlier wake-up event
+			}
+		} else {
+			list_delete(&poller->funcs, node);
+			queue_run_func(ctx, node);
+		}
+	}
+	cpi_signal_context(ctx);
+}
+
+#else /*CPI_RUN_FDS*/
+
+#define has_run_fds(env) 0
+#define wake_run_poller(env) do {} while (0)
+
+#endif /*CPI_RUN_FDS*/
+
+/**
+ * Returns the current time of a monotonic clock, if available.
+ *
+ * @return the current time in milliseconds
+ */
+static uint64_t current_time(void) {
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#elif defined(_WIN32)
+	return GetTickCount64();
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (uint64_t) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
+/**
+ * Returns the deadline of a timed run function.
+ *
+ * @param node the list node of the run function
+ * @return the deadline
+ */
+static uint64_t run_timer_deadline(lnode_t *node) {
+	return ((run_func_t *) lnode_get(node))->deadline;
+}
+
+/**
+ * Moves a run function towards the root of the timer heap until the heap
+ * is ordered.
+ *
+ * @param timers the timers
+ * @param i the heap index of the run function
+ */
+static void sift_run_timer_up(cpi_run_timers_t *timers, int i) {
+	lnode_t *node = timers->heap[i];
+	uint64_t deadline = run_timer_deadline(node);
+
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+
+		if (run_timer_deadline(timers->heap[parent]) <= deadline) {
+			break;
+		}
+		timers->heap[i] = timers->heap[parent];
+		i = parent;
+	}
+	timers->heap[i] = node;
+}
+
+/**
+ * Moves a run function towards the leaves of the timer heap until the
+ * heap is ordered.
+ *
+ * @param timers the timers
+ * @param i the heap index of the run function
+ */
+static void sift_run_timer_down(cpi_run_timers_t *timers, int i) {
+	lnode_t *node = timers->heap[i];
+	uint64_t deadline = run_timer_deadline(node);
+
+	while (2 * i + 1 < timers->num_heap) {
+		int child = 2 * i + 1;
+
+		if (child + 1 < timers->num_heap
+			&& run_timer_deadline(timers->heap[child + 1]) < run_timer_deadline(timers->heap[child])) {
+			child++;
+		}
+		if (deadline <= run_timer_deadline(timers->heap[child])) {
+			break;
+		}
+		timers->heap[i] = timers->heap[child];
+		i = child;
+	}
+	timers->heap[i] = node;
+}
+
+/**
+ * Reserves room in the timer heap for a new timed run function so that
+ * the run function can always be rearmed later. Must be called holding
+ * the context lock.
+ *
+ * @param ctx the plug-in context
+ * @return CP_OK (0) on success or CP_ERR_RESOURCE if out of memory
+ */
+static cp_status_t reserve_run_timer(cp_context_t *ctx) {
+	cpi_run_timers_t *timers = ctx->env->run_timers;
+
+	if (timers == NULL) {
+		if ((timers = malloc(sizeof(cpi_run_timers_t))) == NULL) {
+			return CP_ERR_RESOURCE;
+		}
+		memset(timers, 0, sizeof(cpi_run_timers_t));
+		ctx->env->run_timers = timers;
+	}
+	if (timers->num_funcs == timers->size) {
+		int size = (timers->size > 0 ? 2 * timers->size : 8);
+		lnode_t **heap;
+
+		if ((heap = realloc(timers->heap, size * sizeof(lnode_t *))) == NULL) {
+			return CP_ERR_RESOURCE;
+		}
+		timers->heap = heap;
+		timers->size = size;
+	}
+	timers->num_funcs++;
+	return CP_OK;
+}
+
+/**
+ * Makes a timed run function wait for its deadline. Must be called
+ * holding the context lock.
+ *
+ * @param ctx the plug-in context
+ * @param node the list node of the run function, not in any list
+ */
+static void arm_run_timer(cp_context_t *ctx, lnode_t *node) {
+	cpi_run_timers_t *timers = ctx->env->run_timers;
+
+	assert(timers->num_heap < timers->size);
+	timers->heap[timers->num_heap++] = node;
+	sift_run_timer_up(timers, timers->num_heap - 1);
+
+	// Waiting threads must wake up earlier for a new first deadline
+	if (timers->heap[0] == node) {
+		cpi_signal_context(ctx);
+		wake_run_poller(ctx->env);
+	}
+}
+
+/**
+ * Makes a timed run function that is to be rerun wait for its next
+ * deadline. Must be called holding the context lock.
+ *
+ * @param ctx the plug-in context
+ * @param node the list node of the run function, not in any list
+ */
+static void rearm_run_timer(cp_context_t *ctx, lnode_t *node) {
+	run_func_t *rf = lnode_get(node);
+	uint64_t now = current_time();
+
+	if (rf->timer == RUN_TIMER_RATE) {
+
+		// Skip the periods missed while the run function was late
+		rf->deadline += rf->period;
+		if (rf->deadline < now) {
+			rf->deadline += ((now - rf->deadline) / rf->period + 1) * rf->period;
+		}
+	} else {
+		rf->deadline = now + rf->period;
+	}
+	arm_run_timer(ctx, node);
+}
+
+/**
+ * Returns whether there are timed run functions waiting for deadlines.
+ *
+ * @param env the plug-in environment
+ * @return whether there are waiting timed run functions
+ */
+static int has_run_timers(cp_plugin_env_t *env) {
+	return (env->run_timers != NULL && env->run_timers->num_heap > 0);
+}
+
+/**
+ * Queues the timed run functions whose deadline has passed. Must be
+ * called holding the context lock.
+ *
+ * @param ctx the plug-in context
+ * @return the time until the next deadline in milliseconds or -1 if no
+ * 		timed run functions are waiting
+ */
+static int dispatch_run_timers(cp_context_t *ctx) {
+	cpi_run_timers_t *timers = ctx->env->run_timers;
+	uint64_t now, deadline;
+
+	if (!has_run_timers(ctx->env)) {
+		return -1;
+	}
+	now = current_time();
+	while (timers->num_heap > 0
+		&& run_timer_deadline(timers->heap[0]) <= now) {
+		lnode_t *node = timers->heap[0];
+
+		timers->heap[0] = timers->heap[--timers->num_heap];
+		if (timers->num_heap > 0) {
+			sift_run_timer_down(timers, 0);
+		}
+		queue_run_func(ctx, node);
+	}
+	if (timers->num_heap == 0) {
+		return -1;
+	}
+	deadline = run_timer_deadline(timers->heap[0]);
+	return (deadline - now > INT_MAX ? INT_MAX : (int) (deadline - now));
+}
+
+/**
+ * Returns whether there are run functions waiting for file descriptors
+ * or deadlines.
+ *
+ * @param env the plug-in environment
+ * @return whether there are waiting run functions
+ */
+static int has_run_waits(cp_plugin_env_t *env) {
+	return (has_run_fds(env) || has_run_timers(env));
+}
+
+/**
+ * Queues the run functions whose file descriptor is ready or whose
+ * deadline has passed, without waiting. Must be called holding the
+ * context lock.
+ *
+ * @param ctx the plug-in context
+ */
+static void check_run_waits(cp_context_t *ctx) {
+	dispatch_run_timers(ctx);
+#ifdef CPI_RUN_FDS
+	if (can_poll_run_fds(ctx->env)) {
+		poll_run_fds(ctx, 0);
+	}
+#endif
+}
+
+/**
+ * Waits for something to run. If there are run functions waiting for
+ * file descriptors and no other thread is polling then this thread polls,
+ * otherwise it waits for the context to be signalled. Must be called
+ * holding the context lock.
+ *
+ * @param ctx the plug-in context
+ * @param timeout the maximum time to wait in milliseconds or -1 to wait
+ * 		until something happens
+ */
+static void wait_run_work(cp_context_t *ctx, int timeout) {
+#ifdef CPI_RUN_FDS
+	if (can_poll_run_fds(ctx->env)) {
+		poll_run_fds(ctx, timeout);
+		return;
+	}
+#endif
+	if (timeout >= 0) {
+		cpi_wait_context_timed(ctx, timeout);
+	} else {
+		cpi_wait_context(ctx);
+	}
+}
+
+/**
+ * Frees an unregistered run function and stops watching its file
+ * descriptor or releases its room in the timer heap. Must be called
+ * holding the context lock.
+ *
+ * @param ctx the plug-in context
+ * @param node the list node of the run function, not in any list
+ */
+static void free_run_func(cp_context_t *ctx, lnode_t *node) {
+	run_func_t *rf = lnode_get(node);
+
+#ifdef CPI_RUN_FDS
+	if (rf->fd >= 0) {
+		struct epoll_event event;
+
+		memset(&event, 0, sizeof(event));
+		epoll_ctl(ctx->env->run_poller->epoll_fd, EPOLL_CTL_DEL, rf->fd, &event);
+
+		// A poller with nothing left to watch should reconsider
+		if (!has_run_fds(ctx->env)) {
+			wake_run_poller(ctx->env);
+		}
+	}
+#endif
+	if (rf->timer) {
+		ctx->env->run_timers->num_funcs--;
+	}
+	lnode_destroy(node);
+	free(rf);
+}
+
+/**
+ * Makes a run function that is to be rerun wait for its file descriptor
+ * again. The run function is unregistered if the file descriptor can not
+ * be watched anymore. Must be called holding the context lock.
+ *
+ * @param ctx the plug-in context
+ * @param node the list node of the run function, not in any list
+ */
+static void rewatch_run_fd(cp_context_t *ctx, lnode_t *node) {
+#ifdef CPI_RUN_FDS
+	cpi_run_poller_t *poller = ctx->env->run_poller;
+	run_func_t *rf = lnode_get(node);
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = run_fd_epoll_events(rf->fd_events);
+	event.data.ptr = node;
+	list_append(&poller->funcs, node);
+	if (epoll_ctl(poller->epoll_fd, EPOLL_CTL_MOD, rf->fd, &event) != 0) {
+		cpi_errorf(ctx, N_("Plug-in %s run function waiting for file descriptor %d was unregistered because the file descriptor could not be watched."), rf->plugin->plugin->identifier, rf->fd);
+		list_delete(&poller->funcs, node);
+		free_run_func(ctx, node);
+	}
+#else
+	free_run_func(ctx, node);
+#endif
+}
+
+/**
+ * Makes a run function that is to be rerun wait for its file descriptor
+ * or deadline again, or queues it if it does not wait for anything.
+ * Must be called holding the context lock.
+ *
+ * @param ctx the plug-in context
+ * @param node the list node of the run function, not in any list
+ */
+static void requeue_run_func(cp_context_t *ctx, lnode_t *node) {
+	run_func_t *rf = lnode_get(node);
+
+	if (rf->fd >= 0) {
+		rewatch_run_fd(ctx, node);
+	} else if (rf->timer) {
+		rearm_run_timer(ctx, node);
+	} else {
+		queue_run_func(ctx, node);
+	}
+}
+
+/**
+ * Unregisters the timed run functions of a plug-in that are waiting for
+ * their deadlines. Must be called holding the context lock.
+ *
+ * @param ctx the plug-in context
+ * @param plugin the plug-in
+ */
+static void remove_run_timers(cp_context_t *ctx, cp_plugin_t *plugin) {
+	cpi_run_timers_t *timers = ctx->env->run_timers;
+	int i, n = 0;
+
+	if (timers == NULL) {
+		return;
+	}
+	for (i = 0; i < timers->num_heap; i++) {
+		lnode_t *node = timers->heap[i];
+
+		if (((run_func_t *) lnode_get(node))->plugin == plugin) {
+			free_run_func(ctx, node);
+		} else {
+			timers->heap[n++] = node;
+		}
+	}
+	if (n < timers->num_heap) {
+		timers->num_heap = n;
+		for (i = n / 2 - 1; i >= 0; i--) {
+			sift_run_timer_down(timers, i);
+		}
+	}
+}
+
+/**
+ * Returns whether two run function entries denote the same registration.
+ *
+ * @param rf the registered run function
+ * @param tmpl the run function being registered
+ * @return whether the entries match
+ */
+static int same_run_func(const run_func_t *rf, const run_func_t *tmpl) {
+	return (rf->runfunc == tmpl->runfunc
+		&& rf->plugin == tmpl->plugin
+		&& rf->fd == tmpl->fd
+		&& rf->timer == tmpl->timer
+		&& (!rf->timer || rf->period == tmpl->period));
+}
+
+/**
+ * Returns whether a run function is in a list of run functions.
+ *
+ * @param funcs the list of run functions
+ * @param tmpl the run function being registered
+ * @return whether the run function was found
+ */
+static int has_run_func(list_t *funcs, const run_func_t *tmpl) {
+	lnode_t *node;
+
+	for (node = list_first(funcs); node != NULL; node = list_next(funcs, node)) {
+		if (same_run_func(lnode_get(node), tmpl)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Returns whether a run function is waiting for its deadline.
+ *
+ * @param timers the timers or NULL if none have been registered
+ * @param tmpl the run function being registered
+ * @return whether the run function was found
+ */
+static int has_run_timer(cpi_run_timers_t *timers, const run_func_t *tmpl) {
+	int i;
+
+	if (timers == NULL) {
+		return 0;
+	}
+	for (i = 0; i < timers->num_heap; i++) {
+		if (same_run_func(lnode_get(timers->heap[i]), tmpl)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Registers a run function for the plug-in of the specified context.
+ *
+ * @param ctx the plug-in context of the registering plug-in
+ * @param tmpl the run function to be registered, specifying the function
+ * 		and what it waits for
+ * @param func the name of the API function for invocation checks
+ * @return CP_OK (0) on success or an error code on failure
+ */
+static cp_status_t register_run_func(cp_context_t *ctx, const run_func_t *tmpl, const char *func) {
+	run_func_t key;
 	lnode_t *node = NULL;
 	run_func_t *rf = NULL;
 	cp_status_t status = CP_OK;
-	
-	CHECK_NOT_NULL(ctx);
-	CHECK_NOT_NULL(runfunc);
+
 	if (ctx->plugin == NULL) {
 		cpi_fatalf(_("Only plug-ins can register run functions."));
 	}
@@ -67,25 +843,30 @@ CP_C_API cp_status_t cp_run_function(cp_context_t *ctx, cp_run_func_t runfunc) {
 		&& ctx->plugin->state != CP_PLUGIN_STARTING) {
 		cpi_fatalf(_("Only starting or active plug-ins can register run functions."));
 	}
-	
+
+	key = *tmpl;
+	key.plugin = ctx->plugin;
 	cpi_lock_context(ctx);
-	cpi_check_invocation(ctx, CPI_CF_STOP | CPI_CF_LOGGER, __func__);
+	cpi_check_invocation(ctx, CPI_CF_STOP | CPI_CF_LOGGER, func);
 	do {
-		int found = 0;
-		lnode_t *n;
-	
+
 		// Check if already registered
-		n = list_first(ctx->env->run_funcs);
-		while (n != NULL && !found) {
-			run_func_t *r = lnode_get(n);
-			if (runfunc == r->runfunc && ctx->plugin == r->plugin) {
-				found = 1;
-			}
-			n = list_next(ctx->env->run_funcs, n);
+		if (has_run_func(ctx->env->run_funcs, &key)
+			|| has_run_timer(ctx->env->run_timers, &key)) {
+			break;
 		}
-		if (found) {
+#ifdef CP_THREADS
+		if (ctx->env->run_scheduler != NULL
+			&& has_run_func(&ctx->env->run_scheduler->funcs, &key)) {
 			break;
 		}
+#endif
+#ifdef CPI_RUN_FDS
+		if (ctx->env->run_poller != NULL
+			&& has_run_func(&ctx->env->run_poller->funcs, &key)) {
+			break;
+		}
+#endif
 
 		// Allocate memory for a new run function entry
 		if ((rf = malloc(sizeof(run_func_t))) == NULL) {
@@ -96,26 +877,43 @@ CP_C_API cp_status_t cp_run_function(cp_context_t *ctx, cp_run_func_t runfunc) {
 			status = CP_ERR_RESOURCE;
 			break;
 		}
-		
+
 		// Initialize run function entry
-		memset(rf, 0, sizeof(run_func_t));
-		rf->runfunc = runfunc;
-		rf->plugin = ctx->plugin;
-		
-		// Append the run function to queue
-		list_append(ctx->env->run_funcs, node);
-		if (ctx->env->run_wait == NULL) {
-			ctx->env->run_wait = node;
+		*rf = key;
+
+#ifdef CPI_RUN_FDS
+		// Wait for the file descriptor before queueing the run function
+		if (rf->fd >= 0) {
+			if ((status = watch_run_fd(ctx, node)) == CP_OK) {
+				cpi_signal_context(ctx);
+			}
+			break;
 		}
+#endif
+
+		// Wait for the deadline before queueing the run function
+		if (rf->timer) {
+			if ((status = reserve_run_timer(ctx)) == CP_OK) {
+				rf->deadline = current_time() + rf->period;
+				arm_run_timer(ctx, node);
+			}
+			break;
+		}
+
+		// Append the run function to queue
+		queue_run_func(ctx, node);
+		wake_run_poller(ctx->env);
 
 	} while (0);
 
 	// Log error
 	if (status == CP_ERR_RESOURCE) {
 		cpi_error(ctx, N_("Could not register a run function due to insufficient memory."));
-	}	
+	} else if (status == CP_ERR_RUNTIME) {
+		cpi_errorf(ctx, N_("Could not register a run function waiting for file descriptor %d."), key.fd);
+	}
 	cpi_unlock_context(ctx);
-	
+
 	// Free resources on error
 	if (status != CP_OK) {
 		if (node != NULL) {
@@ -125,41 +923,478 @@ CP_C_API cp_status_t cp_run_function(cp_context_t *ctx, cp_run_func_t runfunc) {
 			free(rf);
 		}
 	}
-	
+
 	return status;
 }
 
-CP_C_API void cp_run_plugins(cp_context_t *ctx) {
-	while (cp_run_plugins_step(ctx));
+CP_C_API cp_status_t cp_run_function(cp_context_t *ctx, cp_run_func_t runfunc) {
+	run_func_t tmpl;
+
+	CHECK_NOT_NULL(ctx);
+	CHECK_NOT_NULL(runfunc);
+	memset(&tmpl, 0, sizeof(run_func_t));
+	tmpl.runfunc = runfunc;
+	tmpl.fd = -1;
+	return register_run_func(ctx, &tmpl, __func__);
 }
 
-CP_C_API int cp_run_plugins_step(cp_context_t *ctx) {
-	int runnables;
-	
+CP_C_API cp_status_t cp_run_function_on_fd(cp_context_t *ctx, int fd, int events, cp_run_func_t runfunc) {
+#ifdef CPI_RUN_FDS
+	run_func_t tmpl;
+#endif
+
 	CHECK_NOT_NULL(ctx);
+	CHECK_NOT_NULL(runfunc);
+	if (fd < 0 || !(events & (CP_FD_READ | CP_FD_WRITE))) {
+		cpi_fatalf(_("Run functions must wait for a valid file descriptor to become readable or writable."));
+	}
+#ifdef CPI_RUN_FDS
+	memset(&tmpl, 0, sizeof(run_func_t));
+	tmpl.runfunc = runfunc;
+	tmpl.fd = fd;
+	tmpl.fd_events = events;
+	return register_run_func(ctx, &tmpl, __func__);
+#else
 	cpi_lock_context(ctx);
-	if (ctx->env->run_wait != NULL) {
-		lnode_t *node = ctx->env->run_wait;
-		run_func_t *rf = lnode_get(node);
-		int rerun;
-		
-		ctx->env->run_wait = list_next(ctx->env->run_funcs, node);
-		rf->in_execution = 1;
+	cpi_check_invocation(ctx, CPI_CF_STOP | CPI_CF_LOGGER, __func__);
+	cpi_error(ctx, N_("Run functions waiting for file descriptors are not supported on this platform."));
+	cpi_unlock_context(ctx);
+	return CP_ERR_RUNTIME;
+#endif
+}
+
+/**
+ * Registers a timed run function for the plug-in of the specified context.
+ *
+ * @param ctx the plug-in context of the registering plug-in
+ * @param timer the timer kind, RUN_TIMER_DELAY or RUN_TIMER_RATE
+ * @param period the delay or period in milliseconds
+ * @param runfunc the run function to be registered
+ * @param func the name of the API function for invocation checks
+ * @return CP_OK (0) on success or an error code on failure
+ */
+static cp_status_t register_run_timer(cp_context_t *ctx, int timer, unsigned long period, cp_run_func_t runfunc, const char *func) {
+	run_func_t tmpl;
+
+	memset(&tmpl, 0, sizeof(run_func_t));
+	tmpl.runfunc = runfunc;
+	tmpl.fd = -1;
+	tmpl.timer = timer;
+	tmpl.period = period;
+	return register_run_func(ctx, &tmpl, func);
+}
+
+CP_C_API cp_status_t cp_run_function_after(cp_context_t *ctx, unsigned long delay, cp_run_func_t runfunc) {
+	CHECK_NOT_NULL(ctx);
+	CHECK_NOT_NULL(runfunc);
+	return register_run_timer(ctx, RUN_TIMER_DELAY, delay, runfunc, __func__);
+}
+
+CP_C_API cp_status_t cp_run_function_every(cp_context_t *ctx, unsigned long period, cp_run_func_t runfunc) {
+	CHECK_NOT_NULL(ctx);
+	CHECK_NOT_NULL(runfunc);
+	if (period == 0) {
+		cpi_fatalf(_("Periodic run functions must have a non-zero period."));
+	}
+	return register_run_timer(ctx, RUN_TIMER_RATE, period, runfunc, __func__);
+}
+
+/**
+ * Runs the first waiting run function. The run function is moved out of
+ * the waiting part of the queue while it executes so that other threads
+ * do not run it concurrently. Must be called holding the context lock.
+ *
+ * @param ctx the plug-in context
+ */
+static void run_next_function(cp_context_t *ctx) {
+	lnode_t *node = ctx->env->run_wait;
+	run_func_t *rf = lnode_get(node);
+	int rerun;
+
+	ctx->env->run_wait = list_next(ctx->env->run_funcs, node);
+	rf->in_execution = 1;
+	cpi_unlock_context(ctx);
+	rerun = rf->runfunc(rf->plugin->plugin_data);
+	cpi_lock_context(ctx);
+	rf->in_execution = 0;
+	list_delete(ctx->env->run_funcs, node);
+	if (!rerun) {
+		free_run_func(ctx, node);
+	} else {
+		requeue_run_func(ctx, node);
+	}
+	cpi_signal_context(ctx);
+}
+
+CP_C_API void cp_run_plugins(cp_context_t *ctx) {
+	CHECK_NOT_NULL(ctx);
+	cpi_lock_context(ctx);
+	while (1) {
+
+		// Check waiting run functions without waiting for them
+		if (ctx->env->run_wait == NULL) {
+			check_run_waits(ctx);
+		} else {
+			dispatch_run_timers(ctx);
+		}
+		if (ctx->env->run_wait == NULL) {
+			break;
+		}
+		run_next_function(ctx);
+	}
+	cpi_unlock_context(ctx);
+}
+
+#ifdef CP_THREADS
+
+/**
+ * Destroys a scheduler of a multi-threaded run. The run queues must be
+ * empty.
+ *
+ * @param sched the scheduler
+ */
+static void destroy_run_scheduler(cpi_run_scheduler_t *sched) {
+	int i;
+
+	for (i = 0; i < sched->num_queues; i++) {
+		cpi_destroy_mutex(sched->queues[i].mutex);
+	}
+	free(sched->queues);
+	free(sched);
+}
+
+/**
+ * Creates a scheduler with a run queue for each worker thread.
+ *
+ * @param ctx the plug-in context
+ * @param num_queues the number of run queues
+ * @return the scheduler or NULL if there is insufficient memory
+ */
+static cpi_run_scheduler_t *create_run_scheduler(cp_context_t *ctx, int num_queues) {
+	cpi_run_scheduler_t *sched;
+
+	if ((sched = malloc(sizeof(cpi_run_scheduler_t))) == NULL) {
+		return NULL;
+	}
+	memset(sched, 0, sizeof(cpi_run_scheduler_t));
+	sched->context = ctx;
+	list_init(&sched->funcs, LISTCOUNT_T_MAX);
+	if ((sched->queues = malloc(num_queues * sizeof(run_queue_t))) == NULL) {
+		free(sched);
+		return NULL;
+	}
+	while (sched->num_queues < num_queues) {
+		run_queue_t *queue = sched->queues + sched->num_queues;
+
+		queue->scheduler = sched;
+		queue->runs = 0;
+		list_init(&queue->funcs, LISTCOUNT_T_MAX);
+		if ((queue->mutex = cpi_create_mutex()) == NULL) {
+			destroy_run_scheduler(sched);
+			return NULL;
+		}
+		sched->num_queues++;
+	}
+	return sched;
+}
+
+/**
+ * Locks all run queues of a scheduler in index order.
+ *
+ * @param sched the scheduler
+ */
+static void lock_run_queues(cpi_run_scheduler_t *sched) {
+	int i;
+
+	for (i = 0; i < sched->num_queues; i++) {
+		cpi_lock_mutex(sched->queues[i].mutex);
+	}
+}
+
+/**
+ * Unlocks all run queues of a scheduler.
+ *
+ * @param sched the scheduler
+ */
+static void unlock_run_queues(cpi_run_scheduler_t *sched) {
+	int i;
+
+	for (i = sched->num_queues - 1; i >= 0; i--) {
+		cpi_unlock_mutex(sched->queues[i].mutex);
+	}
+}
+
+/**
+ * Takes a waiting run function for execution. A worker takes from the
+ * front of its own run queue and, if that is empty, steals from the back
+ * of the run queues of the other workers.
+ *
+ * @param own the run queue of the worker
+ * @return the run function or NULL if none is waiting
+ */
+static run_func_t *take_run_func(run_queue_t *own) {
+	cpi_run_scheduler_t *sched = own->scheduler;
+	int index = own - sched->queues;
+	int i;
+
+	for (i = 0; i < sched->num_queues; i++) {
+		run_queue_t *queue = sched->queues + (index + i) % sched->num_queues;
+		run_func_t *rf = NULL;
+		lnode_t *node;
+
+		cpi_lock_mutex(queue->mutex);
+		node = (queue == own ? list_first(&queue->funcs) : list_last(&queue->funcs));
+		if (node != NULL) {
+			list_delete(&queue->funcs, node);
+			rf = lnode_get(node);
+			rf->queue = NULL;
+			rf->in_execution = 1;
+		}
+		cpi_unlock_mutex(queue->mutex);
+		if (rf != NULL) {
+			return rf;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Waits until a run function can be taken for execution or there are
+ * no scheduled run functions left. Run functions waiting for file
+ * descriptors or deadlines do not keep the run going but, while other
+ * workers are still running, an idle worker may poll the file
+ * descriptors and queues the run functions whose deadline has passed.
+ *
+ * @param own the run queue of the worker
+ * @return the run function or NULL if the run has ended
+ */
+static run_func_t *wait_run_func(run_queue_t *own) {
+	cpi_run_scheduler_t *sched = own->scheduler;
+	cp_context_t *ctx = sched->context;
+	run_func_t *rf;
+
+	// Become idle before looking again so that no reschedule is missed
+	cpi_lock_context(ctx);
+	cpi_atomic_add_int(&sched->idle, 1);
+	while (1) {
+		int timeout = dispatch_run_timers(ctx);
+
+		if ((rf = take_run_func(own)) != NULL) {
+			break;
+		}
+		if (list_isempty(&sched->funcs)) {
+
+			// Pick up ready run functions before ending the run
+			check_run_waits(ctx);
+			if ((rf = take_run_func(own)) != NULL
+				|| list_isempty(&sched->funcs)) {
+				break;
+			}
+			continue;
+		}
+		wait_run_work(ctx, timeout);
+	}
+	cpi_atomic_add_int(&sched->idle, -1);
+	cpi_unlock_context(ctx);
+	return rf;
+}
+
+/**
+ * Reschedules a run function to the run queue of the worker that
+ * executed it or releases it if it is not to be rerun. The context is
+ * only locked if the run function is released, if it waits for its file
+ * descriptor or deadline again or if idle workers should be woken up to
+ * steal.
+ *
+ * @param own the run queue of the worker
+ * @param rf the executed run function
+ * @param rerun whether the run function asked to be rerun
+ */
+static void finish_run_func(run_queue_t *own, run_func_t *rf, int rerun) {
+	cpi_run_scheduler_t *sched = own->scheduler;
+	cp_context_t *ctx = sched->context;
+	int release, rewatch;
+	int wake = 0;
+
+	// Others may take the run function as soon as it is back in the queue
+	cpi_lock_mutex(own->mutex);
+	rf->in_execution = 0;
+	release = (!rerun || rf->plugin->run_stopping);
+	rewatch = (!release && (rf->fd >= 0 || rf->timer));
+	if (!release && !rewatch) {
+		list_append(&own->funcs, rf->queue_node);
+		rf->queue = own;
+		wake = (list_count(&own->funcs) > 1);
+	}
+	cpi_unlock_mutex(own->mutex);
+	if (release || rewatch) {
+		cpi_lock_context(ctx);
+		list_delete(&sched->funcs, &rf->sched_node);
+		if (release) {
+			free_run_func(ctx, rf->queue_node);
+		} else {
+			requeue_run_func(ctx, rf->queue_node);
+		}
+		cpi_signal_context(ctx);
+
+		// An idle worker polling may have to end the run
+		wake_run_poller(ctx->env);
+		cpi_unlock_context(ctx);
+	} else if (wake && cpi_atomic_add_int(&sched->idle, 0) > 0) {
+		cpi_lock_context(ctx);
+		cpi_signal_context(ctx);
 		cpi_unlock_context(ctx);
-		rerun = rf->runfunc(rf->plugin->plugin_data);
+	}
+}
+
+/**
+ * Executes scheduled run functions until there are no run functions
+ * left, waiting or in execution. While no worker is idle, the workers take turns checking
+ * the file descriptors and deadlines now and then.
+ *
+ * @param arg the run queue of the worker
+ */
+static void run_scheduled_funcs(void *arg) {
+	run_queue_t *own = arg;
+	cp_context_t *ctx = own->scheduler->context;
+	run_func_t *rf;
+
+	while ((rf = take_run_func(own)) != NULL
+		|| (rf = wait_run_func(own)) != NULL) {
+		finish_run_func(own, rf, rf->runfunc(rf->plugin->plugin_data));
+		if (++own->runs % RUN_WAIT_CHECK_INTERVAL == 0
+			&& cpi_atomic_add_int(&own->scheduler->idle, 0) == 0) {
+			cpi_lock_context(ctx);
+			check_run_waits(ctx);
+			cpi_unlock_context(ctx);
+		}
+	}
+}
+
+#endif
+
+CP_C_API void cp_run_plugins_mt(cp_context_t *ctx, int num_threads) {
+	CHECK_NOT_NULL(ctx);
+#ifdef CP_THREADS
+	if (num_threads > 1) {
+		cpi_run_scheduler_t *sched = NULL;
+
+		// Hand the waiting run functions over to a new scheduler
 		cpi_lock_context(ctx);
-		rf->in_execution = 0;
-		list_delete(ctx->env->run_funcs, node);
-		if (rerun) {
-			list_append(ctx->env->run_funcs, node);
-			if (ctx->env->run_wait == NULL) {
-				ctx->env->run_wait = node;
+		if (ctx->env->run_scheduler == NULL
+			&& (sched = create_run_scheduler(ctx, num_threads)) != NULL) {
+			while (ctx->env->run_wait != NULL) {
+				lnode_t *node = ctx->env->run_wait;
+
+				ctx->env->run_wait = list_next(ctx->env->run_funcs, node);
+				list_delete(ctx->env->run_funcs, node);
+				schedule_run_func(sched, node);
+			}
+			ctx->env->run_scheduler = sched;
+		}
+		cpi_unlock_context(ctx);
+
+		if (sched != NULL) {
+			cpi_thread_t **threads;
+			int n = 0;
+			int i;
+
+			// Start the worker threads and run functions in this thread as well
+			if ((threads = malloc((num_threads - 1) * sizeof(cpi_thread_t *))) != NULL) {
+				for (n = 0; n < num_threads - 1; n++) {
+					if ((threads[n] = cpi_create_thread(run_scheduled_funcs, sched->queues + n + 1)) == NULL) {
+						break;
+					}
+				}
+			}
+			run_scheduled_funcs(sched->queues);
+			for (i = 0; i < n; i++) {
+				cpi_join_thread(threads[i]);
+			}
+			if (threads != NULL) {
+				free(threads);
+			}
+
+			// Return run functions registered after the workers finished
+			cpi_lock_context(ctx);
+			for (i = 0; i < sched->num_queues; i++) {
+				list_t *funcs = &sched->queues[i].funcs;
+				lnode_t *node;
+
+				while ((node = list_first(funcs)) != NULL) {
+					run_func_t *rf = lnode_get(node);
+
+					list_delete(funcs, node);
+					list_delete(&sched->funcs, &rf->sched_node);
+					rf->queue = NULL;
+					list_append(ctx->env->run_funcs, node);
+					if (ctx->env->run_wait == NULL) {
+						ctx->env->run_wait = node;
+					}
+				}
 			}
+			ctx->env->run_scheduler = NULL;
+			cpi_unlock_context(ctx);
+			destroy_run_scheduler(sched);
+			return;
+		}
+	}
+#endif
+	cp_run_plugins(ctx);
+}
+
+CP_C_API void cp_run_plugins_blocking(cp_context_t *ctx) {
+	unsigned int requests;
+	
+	CHECK_NOT_NULL(ctx);
+	cpi_lock_context(ctx);
+	
+	// Only stop requests made during this run apply to it
+	requests = ctx->env->run_stop_requests;
+	while (ctx->env->run_stop_requests == requests) {
+		int timeout = dispatch_run_timers(ctx);
+
+		if (ctx->env->run_wait != NULL) {
+			run_next_function(ctx);
+		} else if (has_run_waits(ctx->env)) {
+			wait_run_work(ctx, timeout);
 		} else {
-			lnode_destroy(node);
-			free(rf);
+#ifdef CP_THREADS
+			
+			// Wait for a new run function or a stop request
+			cpi_wait_context(ctx);
+#else
+			
+			// Nothing else could register a run function while waiting
+			break;
+#endif
 		}
-		cpi_signal_context(ctx);
+	}
+	cpi_unlock_context(ctx);
+}
+
+CP_C_API void cp_request_run_stop(cp_context_t *ctx) {
+	CHECK_NOT_NULL(ctx);
+	cpi_lock_context(ctx);
+	ctx->env->run_stop_requests++;
+	cpi_signal_context(ctx);
+	wake_run_poller(ctx->env);
+	cpi_unlock_context(ctx);
+}
+
+CP_C_API int cp_run_plugins_step(cp_context_t *ctx) {
+	int runnables;
+	
+	CHECK_NOT_NULL(ctx);
+	cpi_lock_context(ctx);
+	dispatch_run_timers(ctx);
+#ifdef CPI_RUN_FDS
+	if (ctx->env->run_wait == NULL && can_poll_run_fds(ctx->env)) {
+		poll_run_fds(ctx, 0);
+	}
+#endif
+	if (ctx->env->run_wait != NULL) {
+		run_next_function(ctx);
 	}
 	runnables = (ctx->env->run_wait != NULL);
 	cpi_unlock_context(ctx);
@@ -169,10 +1404,24 @@ CP_C_API int cp_run_plugins_step(cp_context_t *ctx) {
 CP_HIDDEN void cpi_stop_plugin_run(cp_plugin_t *plugin) {
 	int stopped = 0;
 	cp_context_t *ctx;
+#ifdef CPI_RUN_FDS
+	cpi_run_poller_t *poller;
+#endif
 	
 	CHECK_NOT_NULL(plugin);
 	ctx = plugin->context;
 	assert(cpi_is_context_locked(ctx));
+#ifdef CPI_RUN_FDS
+	
+	// Keep run functions from being polled while they are unregistered
+	if ((poller = ctx->env->run_poller) != NULL) {
+		poller->holds++;
+		while (poller->polling) {
+			wake_run_poller(ctx->env);
+			cpi_wait_context(ctx);
+		}
+	}
+#endif
 	while (!stopped) {
 		lnode_t *node;
 		
@@ -190,16 +1439,84 @@ CP_HIDDEN void cpi_stop_plugin_run(cp_plugin_t *plugin) {
 						ctx->env->run_wait = list_next(ctx->env->run_funcs, node);
 					}
 					list_delete(ctx->env->run_funcs, node);
-					lnode_destroy(node);
-					free(rf);
+					free_run_func(ctx, node);
 				}
 			}
 			node = next_node;
 		}
+		remove_run_timers(ctx, plugin);
+#ifdef CPI_RUN_FDS
+		if (poller != NULL) {
+			node = list_first(&poller->funcs);
+			while (node != NULL) {
+				run_func_t *rf = lnode_get(node);
+				lnode_t *next_node = list_next(&poller->funcs, node);
+				
+				if (rf->plugin == plugin) {
+					list_delete(&poller->funcs, node);
+					free_run_func(ctx, node);
+				}
+				node = next_node;
+			}
+		}
+#endif
+		
+#ifdef CP_THREADS
+		if (ctx->env->run_scheduler != NULL) {
+			cpi_run_scheduler_t *sched = ctx->env->run_scheduler;
+			
+			// Remove waiting run functions and keep others from being rerun
+			lock_run_queues(sched);
+			plugin->run_stopping = 1;
+			node = list_first(&sched->funcs);
+			while (node != NULL) {
+				run_func_t *rf = lnode_get(node);
+				lnode_t *next_node = list_next(&sched->funcs, node);
+				
+				if (rf->plugin == plugin) {
+					if (rf->queue != NULL) {
+						list_delete(&rf->queue->funcs, rf->queue_node);
+						list_delete(&sched->funcs, node);
+						free_run_func(ctx, rf->queue_node);
+					} else {
+						stopped = 0;
+					}
+				}
+				node = next_node;
+			}
+			unlock_run_queues(sched);
+			cpi_signal_context(ctx);
+		}
+#endif
 		
 		// If some run functions were in execution, wait for them to finish
 		if (!stopped) {
 			cpi_wait_context(ctx);
 		}
 	}
+	plugin->run_stopping = 0;
+#ifdef CPI_RUN_FDS
+	if (poller != NULL) {
+		poller->holds--;
+		cpi_signal_context(ctx);
+	}
+#endif
+}
+
+CP_HIDDEN void cpi_free_run_waits(cp_plugin_env_t *env) {
+#ifdef CPI_RUN_FDS
+	if (env->run_poller != NULL) {
+		assert(list_isempty(&env->run_poller->funcs));
+		close(env->run_poller->epoll_fd);
+		close(env->run_poller->wake_fd);
+		free(env->run_poller);
+		env->run_poller = NULL;
+	}
+#endif
+	if (env->run_timers != NULL) {
+		assert(env->run_timers->num_funcs == 0);
+		free(env->run_timers->heap);
+		free(env->run_timers);
+		env->run_timers = NULL;
+	}
 }
@@ -43,6 +43,9 @@ extern "C" {
 // A generic mutex implementation 
 typedef struct cpi_mutex_t cpi_mutex_t;
 
+// A generic thread implementation
+typedef struct cpi_thread_t cpi_thread_t;
+
 
 /* ------------------------------------------------------------------------
  * Function declarations
@@ -92,6 +95,15 @@ CP_HIDDEN void cpi_unlock_mutex(cpi_mutex_t *mutex);
  */
 CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex);
 
+/**
+ * Waits on the specified mutex until it is signaled or the specified
+ * time has elapsed. Otherwise works like ::cpi_wait_mutex.
+ * 
+ * @param mutex the mutex to wait on
+ * @param timeout the maximum time to wait in milliseconds
+ */
+CP_HIDDEN void cpi_wait_mutex_timed(cpi_mutex_t *mutex, unsigned long timeout);
+
 /**
  * Signals the specified mutex waking all the threads currently waiting on
  * the mutex. The calling thread must hold the mutex. The mutex is not
@@ -101,6 +113,26 @@ CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex);
  */
 CP_HIDDEN void cpi_signal_mutex(cpi_mutex_t *mutex);
 
+// Thread functions
+
+/**
+ * Creates and starts a new thread executing the specified function.
+ * The thread must be eventually released using ::cpi_join_thread.
+ * 
+ * @param func the function to be executed in the new thread
+ * @param arg the argument to be passed to the function
+ * @return the created thread or NULL if no resources available
+ */
+CP_HIDDEN cpi_thread_t * cpi_create_thread(void (*func)(void *arg), void *arg);
+
+/**
+ * Waits for the specified thread to terminate and releases the
+ * associated resources.
+ * 
+ * @param thread the thread to be joined
+ */
+CP_HIDDEN void cpi_join_thread(cpi_thread_t *thread);
+
 #if !defined(NDEBUG)
 
 /**
@@ -33,6 +33,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <sys/time.h>
 #include <pthread.h>
 #include "cpluff.h"
 #include "defines.h"
@@ -65,6 +67,20 @@ struct cpi_mutex_t {
 	
 };
 
+// A generic thread implementation
+struct cpi_thread_t {
+
+	/// The underlying operating system thread
+	pthread_t os_thread;
+
+	/// The function to be executed
+	void (*func)(void *arg);
+
+	/// The argument for the function
+	void *arg;
+
+};
+
 
 /* ------------------------------------------------------------------------
  * Function definitions
@@ -169,7 +185,14 @@ CP_HIDDEN void cpi_unlock_mutex(cpi_mutex_t *mutex) {
 	unlock_mutex(&(mutex->os_mutex));
 }
 
-CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
+/**
+ * Waits on a mutex until it is signaled or the specified absolute time
+ * is reached.
+ * 
+ * @param mutex the mutex to wait on
+ * @param abstime the absolute time to wait until or NULL to wait forever
+ */
+static void wait_mutex(cpi_mutex_t *mutex, const struct timespec *abstime) {
 	pthread_t self = pthread_self();
 	
 	assert(mutex != NULL);
@@ -186,7 +209,15 @@ CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
 		}
 		
 		// Wait for signal
-		if ((ec = pthread_cond_wait(&(mutex->os_cond_wake), &(mutex->os_mutex)))) {
+		if (abstime != NULL) {
+			ec = pthread_cond_timedwait(&(mutex->os_cond_wake), &(mutex->os_mutex), abstime);
+			if (ec == ETIMEDOUT) {
+				ec = 0;
+			}
+		} else {
+			ec = pthread_cond_wait(&(mutex->os_cond_wake), &(mutex->os_mutex));
+		}
+		if (ec) {
 			cpi_fatalf(_("Could not wait for a condition variable due to error %d."), ec);
 		}
 		
@@ -200,6 +231,25 @@ CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
 	unlock_mutex(&(mutex->os_mutex));
 }
 
+CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
+	wait_mutex(mutex, NULL);
+}
+
+CP_HIDDEN void cpi_wait_mutex_timed(cpi_mutex_t *mutex, unsigned long timeout) {
+	struct timeval now;
+	struct timespec abstime;
+	
+	// Condition variables use the real time clock by default
+	gettimeofday(&now, NULL);
+	abstime.tv_sec = now.tv_sec + timeout / 1000;
+	abstime.tv_nsec = now.tv_usec * 1000L + (long) (timeout % 1000) * 1000000L;
+	if (abstime.tv_nsec >= 1000000000L) {
+		abstime.tv_sec++;
+		abstime.tv_nsec -= 1000000000L;
+	}
+	wait_mutex(mutex, &abstime);
+}
+
 CP_HIDDEN void cpi_signal_mutex(cpi_mutex_t *mutex) {
 	pthread_t self = pthread_self();
 	
@@ -220,6 +270,39 @@ CP_HIDDEN void cpi_signal_mutex(cpi_mutex_t *mutex) {
 	unlock_mutex(&(mutex->os_mutex));
 }
 
+static void *thread_main(void *arg) {
+	cpi_thread_t *thread = arg;
+	
+	thread->func(thread->arg);
+	return NULL;
+}
+
+CP_HIDDEN cpi_thread_t * cpi_create_thread(void (*func)(void *arg), void *arg) {
+	cpi_thread_t *thread;
+	
+	assert(func != NULL);
+	if ((thread = malloc(sizeof(cpi_thread_t))) == NULL) {
+		return NULL;
+	}
+	thread->func = func;
+	thread->arg = arg;
+	if (pthread_create(&(thread->os_thread), NULL, thread_main, thread)) {
+		free(thread);
+		return NULL;
+	}
+	return thread;
+}
+
+CP_HIDDEN void cpi_join_thread(cpi_thread_t *thread) {
+	int ec;
+	
+	assert(thread != NULL);
+	if ((ec = pthread_join(thread->os_thread, NULL))) {
+		cpi_fatalf(_("Could not join a thread due to error %d."), ec);
+	}
+	free(thread);
+}
+
 #if !defined(NDEBUG)
 CP_HIDDEN int cpi_is_mutex_locked(cpi_mutex_t *mutex) {
 	int locked;
@@ -68,6 +68,20 @@ struct cpi_mutex_t {
 	
 };
 
+// A generic thread implementation
+struct cpi_thread_t {
+
+	/// The underlying operating system thread
+	HANDLE os_thread;
+
+	/// The function to be executed
+	void (*func)(void *arg);
+
+	/// The argument for the function
+	void *arg;
+
+};
+
 
 /* ------------------------------------------------------------------------
  * Function definitions
@@ -149,8 +163,10 @@ static void unlock_mutex(HANDLE mutex) {
 	}
 }
 
-static void wait_for_event(HANDLE event) {
-	if (WaitForSingleObject(event, INFINITE) != WAIT_OBJECT_0) {
+static void wait_for_event(HANDLE event, DWORD timeout) {
+	DWORD rc = WaitForSingleObject(event, timeout);
+	
+	if (rc != WAIT_OBJECT_0 && rc != WAIT_TIMEOUT) {
 		char buffer[256];
 		DWORD ec = GetLastError();
 		cpi_fatalf(_("Could not wait for an event due to error %ld: %s"),
@@ -182,7 +198,7 @@ static void lock_mutex_holding(cpi_mutex_t *mutex) {
 	while (mutex->lock_count != 0
 			&& self != mutex->os_thread) {
 		unlock_mutex(mutex->os_mutex);
-		wait_for_event(mutex->os_cond_lock);
+		wait_for_event(mutex->os_cond_lock, INFINITE);
 		lock_mutex(mutex->os_mutex);
 	}
 	mutex->os_thread = self;
@@ -212,7 +228,14 @@ CP_HIDDEN void cpi_unlock_mutex(cpi_mutex_t *mutex) {
 	unlock_mutex(mutex->os_mutex);
 }
 
-CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
+/**
+ * Waits on a mutex until it is signaled or the specified time has
+ * elapsed.
+ * 
+ * @param mutex the mutex to wait on
+ * @param timeout the maximum time to wait in milliseconds or INFINITE
+ */
+static void wait_mutex(cpi_mutex_t *mutex, DWORD timeout) {
 	DWORD self = GetCurrentThreadId();
 	
 	assert(mutex != NULL);
@@ -228,7 +251,7 @@ CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
 		unlock_mutex(mutex->os_mutex);
 		
 		// Wait for signal
-		wait_for_event(mutex->os_cond_wake);
+		wait_for_event(mutex->os_cond_wake, timeout);
 		
 		// Reset wake signal if last one waking up
 		lock_mutex(mutex->os_mutex);
@@ -246,6 +269,14 @@ CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
 	unlock_mutex(mutex->os_mutex);
 }
 
+CP_HIDDEN void cpi_wait_mutex(cpi_mutex_t *mutex) {
+	wait_mutex(mutex, INFINITE);
+}
+
+CP_HIDDEN void cpi_wait_mutex_timed(cpi_mutex_t *mutex, unsigned long timeout) {
+	wait_mutex(mutex, (timeout < INFINITE ? (DWORD) timeout : INFINITE - 1));
+}
+
 CP_HIDDEN void cpi_signal_mutex(cpi_mutex_t *mutex) {
 	DWORD self = GetCurrentThreadId();
 	
@@ -260,6 +291,39 @@ CP_HIDDEN void cpi_signal_mutex(cpi_mutex_t *mutex) {
 	unlock_mutex(mutex->os_mutex);	
 }
 
+static DWORD WINAPI thread_main(LPVOID arg) {
+	cpi_thread_t *thread = arg;
+	
+	thread->func(thread->arg);
+	return 0;
+}
+
+CP_HIDDEN cpi_thread_t * cpi_create_thread(void (*func)(void *arg), void *arg) {
+	cpi_thread_t *thread;
+	
+	assert(func != NULL);
+	if ((thread = malloc(sizeof(cpi_thread_t))) == NULL) {
+		return NULL;
+	}
+	thread->func = func;
+	thread->arg = arg;
+	if ((thread->os_thread = CreateThread(NULL, 0, thread_main, thread, 0, NULL)) == NULL) {
+		free(thread);
+		return NULL;
+	}
+	return thread;
+}
+
+CP_HIDDEN void cpi_join_thread(cpi_thread_t *thread) {
+	int ec;
+	
+	assert(thread != NULL);
+	wait_for_event(thread->os_thread, INFINITE);
+	ec = CloseHandle(thread->os_thread);
+	assert(ec);
+	free(thread);
+}
+
 #if !defined(NDEBUG)
 CP_HIDDEN int cpi_is_mutex_locked(cpi_mutex_t *mutex) {
 	int locked;
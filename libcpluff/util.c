@@ -38,6 +38,61 @@
 #include "cpluff.h"
 #include "defines.h"
 #include "util.h"
+#include "atomic.h"
+
+
+/* ------------------------------------------------------------------------
+ * Constants
+ * ----------------------------------------------------------------------*/
+
+/// Default size of the first arena block
+#define CP_ARENA_BLOCK_SIZE 1024
+
+/// Alignment of arena allocations
+#define ARENA_ALIGN (sizeof(arena_align_t))
+
+/// Rounds a size up to the arena alignment
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/// A type having the strictest alignment requirement of basic types
+typedef union arena_align_t {
+	void *p;
+	long l;
+	double d;
+	long double ld;
+} arena_align_t;
+
+/// A memory block of an arena
+typedef struct arena_block_t arena_block_t;
+
+struct arena_block_t {
+	
+	/// The previously allocated block, or NULL
+	arena_block_t *next;
+	
+	/// The size of the data area
+	size_t size;
+	
+	/// The number of bytes used in the data area
+	size_t used;
+	
+	/// The data area, aligned at the arena alignment
+	arena_align_t data[];
+};
+
+struct cpi_arena_t {
+	
+	/// The current block, linked to the previously allocated blocks
+	arena_block_t *blocks;
+	
+	/// The latest allocation, or NULL
+	void *last;
+};
 
 
 /* ------------------------------------------------------------------------
@@ -49,7 +104,10 @@ CP_HIDDEN int cpi_comp_ptr(const void *ptr1, const void *ptr2) {
 }
 
 CP_HIDDEN hash_val_t cpi_hashfunc_ptr(const void *ptr) {
-	return (hash_val_t) ptr;
+	hash_val_t h = (hash_val_t) ptr;
+	
+	// Fold in higher bits because hash chains are selected by the low bits
+	return h ^ (h >> 4) ^ (h >> 12);
 }
 
 CP_HIDDEN int cpi_ptrset_add(list_t *set, void *ptr) {
@@ -97,6 +155,215 @@ CP_HIDDEN void cpi_process_free_ptr(list_t *list, lnode_t *node, void *dummy) {
 	free(ptr);
 }
 
+/**
+ * Allocates a new arena block with at least the specified data size.
+ * 
+ * @param size the minimum size of the data area
+ * @return the block or NULL if memory allocation failed
+ */
+static arena_block_t *create_arena_block(size_t size) {
+	arena_block_t *block;
+	
+	size = ARENA_ROUND(size);
+	if ((block = malloc(sizeof(arena_block_t) + size)) != NULL) {
+		block->next = NULL;
+		block->size = size;
+		block->used = 0;
+	}
+	return block;
+}
+
+CP_HIDDEN cpi_arena_t *cpi_create_arena(size_t block_size) {
+	arena_block_t *block;
+	cpi_arena_t *arena;
+	
+	// The arena itself is the first allocation of the first block
+	if (block_size == 0) {
+		block_size = CP_ARENA_BLOCK_SIZE;
+	}
+	if ((block = create_arena_block(ARENA_ROUND(sizeof(cpi_arena_t)) + block_size)) == NULL) {
+		return NULL;
+	}
+	arena = (cpi_arena_t *) block->data;
+	block->used = ARENA_ROUND(sizeof(cpi_arena_t));
+	arena->blocks = block;
+	arena->last = NULL;
+	return arena;
+}
+
+CP_HIDDEN void *cpi_arena_alloc(cpi_arena_t *arena, size_t size) {
+	arena_block_t *block = arena->blocks;
+	void *ptr;
+	
+	size = ARENA_ROUND(size);
+	if (block->size - block->used < size) {
+		size_t bs;
+		
+		// Grow the block size geometrically to keep the block count low
+		bs = 2 * block->size;
+		if (bs < size) {
+			bs = size;
+		}
+		if ((block = create_arena_block(bs)) == NULL) {
+			return NULL;
+		}
+		block->next = arena->blocks;
+		arena->blocks = block;
+	}
+	ptr = ((char *) block->data) + block->used;
+	block->used += size;
+	arena->last = ptr;
+	return ptr;
+}
+
+CP_HIDDEN void *cpi_arena_realloc(cpi_arena_t *arena, void *ptr, size_t old_size, size_t new_size) {
+	void *np;
+	
+	if (ptr == NULL) {
+		return cpi_arena_alloc(arena, new_size);
+	}
+	
+	// Resize the latest allocation in place, if possible
+	if (ptr == arena->last) {
+		arena_block_t *block = arena->blocks;
+		size_t offset = ((char *) ptr) - ((char *) block->data);
+		
+		if (block->size - offset >= ARENA_ROUND(new_size)) {
+			block->used = offset + ARENA_ROUND(new_size);
+			return ptr;
+		}
+	} else if (new_size <= old_size) {
+		return ptr;
+	}
+	
+	// Otherwise copy the contents to a new allocation
+	if ((np = cpi_arena_alloc(arena, new_size)) != NULL) {
+		memcpy(np, ptr, old_size < new_size ? old_size : new_size);
+	}
+	return np;
+}
+
+CP_HIDDEN char *cpi_arena_strdup(cpi_arena_t *arena, const char *str) {
+	size_t size = strlen(str) + 1;
+	char *dup;
+	
+	if ((dup = cpi_arena_alloc(arena, size)) != NULL) {
+		memcpy(dup, str, size);
+	}
+	return dup;
+}
+
+CP_HIDDEN void cpi_destroy_arena(cpi_arena_t *arena) {
+	arena_block_t *block;
+	
+	// The first block containing the arena itself is released last
+	block = arena->blocks;
+	while (block != NULL) {
+		arena_block_t *next = block->next;
+		free(block);
+		block = next;
+	}
+}
+
+
+// Reclaiming objects published to lock-free readers
+
+/*
+ * A reader increments the reader count of the epoch it observed and
+ * backs off if the epoch changed in between. Retired objects wait in the
+ * retired list until the expiring list is empty. They are then moved to
+ * the expiring list and the epoch is flipped, so new readers can not
+ * access them. The expiring objects are reclaimed when the reader count
+ * of the previous epoch drops to zero, either by a writer or on behalf of
+ * the last reader leaving. The epoch is flipped only after the previous
+ * expiring objects have been reclaimed, so the readers of the previous
+ * epoch never hold objects retired in the current one.
+ */
+
+CP_HIDDEN int cpi_enter_epoch(cpi_epochs_t *epochs) {
+	int epoch;
+	
+	for (;;) {
+		epoch = cpi_atomic_load_int(&(epochs->epoch));
+		cpi_atomic_add_int(&(epochs->readers[epoch]), 1);
+		cpi_atomic_fence();
+		if (cpi_atomic_load_int(&(epochs->epoch)) == epoch) {
+			return epoch;
+		}
+		
+		// Backing off may release objects held back by the count
+		if (cpi_leave_epoch(epochs, epoch)) {
+			return -1;
+		}
+	}
+}
+
+CP_HIDDEN int cpi_leave_epoch(cpi_epochs_t *epochs, int epoch) {
+	assert(epoch == 0 || epoch == 1);
+	return (cpi_atomic_add_int(&(epochs->readers[epoch]), -1) == 0
+		&& cpi_atomic_load_ptr(&(epochs->expiring)) != NULL
+		&& cpi_atomic_load_int(&(epochs->epoch)) != epoch);
+}
+
+CP_HIDDEN void cpi_retire(cpi_epochs_t *epochs, cpi_retired_t *obj) {
+	obj->next = epochs->retired;
+	epochs->retired = obj;
+}
+
+/**
+ * Appends a list of retired objects to another one.
+ * 
+ * @param list the list to append to, or NULL
+ * @param tail the list to be appended
+ * @return the combined list
+ */
+static cpi_retired_t *append_retired(cpi_retired_t *list, cpi_retired_t *tail) {
+	cpi_retired_t *last;
+	
+	if (list == NULL) {
+		return tail;
+	}
+	for (last = list; last->next != NULL; last = last->next);
+	last->next = tail;
+	return list;
+}
+
+CP_HIDDEN cpi_retired_t *cpi_reclaim_retired(cpi_epochs_t *epochs) {
+	cpi_retired_t *reclaimed = NULL;
+	cpi_retired_t *expiring;
+	int epoch = epochs->epoch;
+	
+	// Reclaim the expiring objects once the previous epoch has been left
+	cpi_atomic_fence();
+	if ((expiring = epochs->expiring) != NULL
+		&& cpi_atomic_load_int(&(epochs->readers[1 - epoch])) == 0) {
+		if (!cpi_atomic_cas_ptr(&(epochs->expiring), expiring, NULL)) {
+			assert(0);
+		}
+		reclaimed = expiring;
+		expiring = NULL;
+	}
+	
+	// Start expiring the retired objects by flipping the epoch
+	if (expiring == NULL && epochs->retired != NULL) {
+		expiring = epochs->retired;
+		epochs->retired = NULL;
+		if (!cpi_atomic_cas_ptr(&(epochs->expiring), NULL, expiring)
+			|| !cpi_atomic_cas_int(&(epochs->epoch), epoch, 1 - epoch)) {
+			assert(0);
+		}
+		cpi_atomic_fence();
+		if (cpi_atomic_load_int(&(epochs->readers[epoch])) == 0) {
+			if (!cpi_atomic_cas_ptr(&(epochs->expiring), expiring, NULL)) {
+				assert(0);
+			}
+			reclaimed = append_retired(reclaimed, expiring);
+		}
+	}
+	
+	return reclaimed;
+}
+
 static const char *vercmp_nondigit_end(const char *v) {
 	while (*v != '\0' && (*v < '0' || *v > '9')) {
 		v++;
@@ -38,6 +38,49 @@ extern "C" {
 #endif //__cplusplus
 
 
+/* ------------------------------------------------------------------------
+ * Data types
+ * ----------------------------------------------------------------------*/
+
+/**
+ * A memory arena from which memory is allocated by bumping a pointer and
+ * which is released at once using ::cpi_destroy_arena.
+ */
+typedef struct cpi_arena_t cpi_arena_t;
+
+/// An object retired from lock-free readers, linked to the next one
+typedef struct cpi_retired_t cpi_retired_t;
+
+struct cpi_retired_t {
+	
+	/// The next retired object, or NULL
+	cpi_retired_t *next;
+	
+};
+
+/**
+ * Reader epochs for reclaiming objects published to lock-free readers.
+ * Readers register in the current epoch, and writers flip the epoch when
+ * retiring objects. Retired objects are reclaimed once the readers of the
+ * epoch in which they were retired have left. Initialize with zeroes.
+ */
+typedef struct cpi_epochs_t {
+	
+	/// The current epoch, either 0 or 1
+	int epoch;
+	
+	/// The number of readers in each epoch
+	int readers[2];
+	
+	/// Objects retired in the current epoch, protected by the writer lock
+	cpi_retired_t *retired;
+	
+	/// Objects waiting for the readers of the previous epoch, or NULL
+	cpi_retired_t *expiring;
+	
+} cpi_epochs_t;
+
+
 /* ------------------------------------------------------------------------
  * Function declarations
  * ----------------------------------------------------------------------*/
@@ -102,6 +145,98 @@ CP_HIDDEN int cpi_ptrset_contains(list_t *set, const void *ptr) CP_GCC_PURE;
 CP_HIDDEN void cpi_process_free_ptr(list_t *list, lnode_t *node, void *dummy);
 
 
+// Memory arenas
+
+/**
+ * Creates a new memory arena.
+ * @param block_size the size of the first memory block, or zero for default
+ * @return the arena or NULL if memory allocation failed
+ */
+CP_HIDDEN cpi_arena_t *cpi_create_arena(size_t block_size);
+
+/**
+ * Allocates memory from an arena. The memory is suitably aligned for any
+ * kind of variable.
+ * @param arena the arena
+ * @param size the number of bytes to allocate
+ * @return pointer to the allocated memory, or NULL if memory allocation failed
+ */
+CP_HIDDEN void *cpi_arena_alloc(cpi_arena_t *arena, size_t size) CP_GCC_NONNULL(1);
+
+/**
+ * Resizes memory allocated from an arena. The memory is resized in place
+ * if it is the latest allocation and there is room left in the current
+ * block or if it is shrunk. Otherwise new memory is allocated and the
+ * contents are copied, leaving the old memory unused until the arena is
+ * destroyed.
+ * @param arena the arena
+ * @param ptr the memory to be resized, or NULL to allocate new memory
+ * @param old_size the current size of the memory
+ * @param new_size the requested size of the memory
+ * @return pointer to the resized memory, or NULL if memory allocation failed
+ */
+CP_HIDDEN void *cpi_arena_realloc(cpi_arena_t *arena, void *ptr, size_t old_size, size_t new_size) CP_GCC_NONNULL(1);
+
+/**
+ * Makes a copy of the specified string in an arena.
+ * @param arena the arena
+ * @param str the string to be copied
+ * @return copy of the string, or NULL if memory allocation failed
+ */
+CP_HIDDEN char *cpi_arena_strdup(cpi_arena_t *arena, const char *str) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Destroys an arena releasing all memory allocated from it.
+ * @param arena the arena
+ */
+CP_HIDDEN void cpi_destroy_arena(cpi_arena_t *arena);
+
+
+// Reclaiming objects published to lock-free readers
+
+/**
+ * Registers a lock-free reader in the current epoch. Objects published
+ * when the call returns stay valid until the matching ::cpi_leave_epoch.
+ * Rarely, the reader has to reclaim retired objects as described for
+ * ::cpi_leave_epoch before trying again.
+ * 
+ * @param epochs the reader epochs
+ * @return the epoch to be passed to ::cpi_leave_epoch, or -1 if the
+ * 	caller must reclaim retired objects and try again
+ */
+CP_HIDDEN int cpi_enter_epoch(cpi_epochs_t *epochs) CP_GCC_NONNULL(1);
+
+/**
+ * Unregisters a lock-free reader. If the reader was the last one holding
+ * back retired objects, the caller must acquire the writer lock and call
+ * ::cpi_reclaim_retired to reclaim them.
+ * 
+ * @param epochs the reader epochs
+ * @param epoch the epoch returned by ::cpi_enter_epoch
+ * @return whether the caller must reclaim retired objects
+ */
+CP_HIDDEN int cpi_leave_epoch(cpi_epochs_t *epochs, int epoch) CP_GCC_NONNULL(1);
+
+/**
+ * Retires an object that is no longer published to lock-free readers.
+ * The caller must hold the writer lock.
+ * 
+ * @param epochs the reader epochs
+ * @param obj the retired object
+ */
+CP_HIDDEN void cpi_retire(cpi_epochs_t *epochs, cpi_retired_t *obj) CP_GCC_NONNULL(1, 2);
+
+/**
+ * Returns the retired objects no longer accessible to lock-free readers,
+ * moving on to the next epoch if possible. The caller must hold the writer
+ * lock and is responsible for freeing the returned objects.
+ * 
+ * @param epochs the reader epochs
+ * @return the list of reclaimable objects, or NULL if none
+ */
+CP_HIDDEN cpi_retired_t *cpi_reclaim_retired(cpi_epochs_t *epochs) CP_GCC_NONNULL(1);
+
+
 // Version strings
 
 /**
@@ -524,6 +524,18 @@ public:
 		return pinfo->runtime_funcs_symbol;
 	}
 
+    /**
+     * Returns the name of symbol pointing to the symbol export table of
+     * the plug-in runtime or NULL if none. This corresponds to the
+     * @a exports attribute of the @a runtime element in a plug-in
+     * descriptor.
+     * 
+     * @return the name of the symbol pointing to the symbol export table or NULL
+     */
+	inline const char* runtime_exports_symbol() const {
+		return pinfo->runtime_exports_symbol;
+	}
+
 	/**
 	 * Returns the extension points provided by this plug-in.
 	 * 
@@ -22,7 +22,12 @@
  *-----------------------------------------------------------------------*/
 
 #include <stdio.h>
+#include <string.h>
 #include "test.h"
+#ifdef HAVE_SYS_INOTIFY_H
+#include <errno.h>
+#include <sys/stat.h>
+#endif
 
 void nocollections(void) {
 	cp_context_t *ctx;
@@ -116,3 +121,99 @@ void scanunregcollection(void) {
 	cp_destroy();
 	check(errors == 0);
 }
+
+#ifdef HAVE_SYS_INOTIFY_H
+static void write_file(const char *path, const char *data, size_t size) {
+	FILE *fh;
+	
+	check((fh = fopen(path, "wb")) != NULL);
+	check(fwrite(data, sizeof(char), size, fh) == size);
+	check(fclose(fh) == 0);
+}
+
+static void make_dir(const char *path) {
+	check(mkdir(path, 0777) == 0 || errno == EEXIST);
+}
+
+static void count_cache_loads(cp_log_severity_t severity, const char *msg, const char *apid, void *user_data) {
+	int *loads = user_data;
+	
+	// Counts the loads of callbackcounter and unchanged separately
+	if (strstr(msg, "loaded from the scan cache") != NULL) {
+		loads[strstr(msg, "unchanged") != NULL]++;
+	}
+}
+#endif
+
+void watchcollection(void) {
+	cp_context_t *ctx;
+	int errors;
+#ifdef HAVE_SYS_INOTIFY_H
+	static const char unchanged_xml[] = "<?xml version=\"1.0\"?>\n<plugin id=\"unchanged\" version=\"1\"/>\n";
+	static const char modified_xml[] = "<?xml version=\"1.0\"?>\n<plugin id=\"callbackcounter\" version=\"2\"/>\n";
+	cp_plugin_info_t *plugin;
+	int loads[2] = { 0, 0 };
+	char buffer[256];
+	size_t size;
+	FILE *fh;
+	
+	// Watch a private copy of the plug-ins to be modified
+	make_dir("tmp/watched");
+	make_dir("tmp/watched/callbackcounter");
+	make_dir("tmp/watched/unchanged");
+	check((fh = fopen("tmp/install/plugins/callbackcounter/plugin.xml", "rb")) != NULL);
+	size = fread(buffer, sizeof(char), sizeof(buffer), fh);
+	fclose(fh);
+	check(size > 0 && size < sizeof(buffer));
+	write_file("tmp/watched/callbackcounter/plugin.xml", buffer, size);
+	write_file("tmp/watched/unchanged/plugin.xml", unchanged_xml, strlen(unchanged_xml));
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_logger(ctx, count_cache_loads, loads, CP_LOG_DEBUG) == CP_OK);
+	check(cp_register_pcollection(ctx, "tmp/watched") == CP_OK);
+	check(cp_watch_pcollections(ctx, 1) == CP_OK);
+	check(cp_get_pcollections_watch_fd(ctx) >= 0);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_get_plugin_state(ctx, "callbackcounter") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "unchanged") == CP_PLUGIN_INSTALLED);
+	
+	// Unchanged plug-ins are provided from memory instead of being reparsed
+	check(cp_uninstall_plugin(ctx, "callbackcounter") == CP_OK);
+	loads[0] = loads[1] = 0;
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_get_plugin_state(ctx, "callbackcounter") == CP_PLUGIN_INSTALLED);
+	check(loads[0] == 1 && loads[1] == 1);
+	
+	// Removed and added plug-ins
+	check(cp_uninstall_plugin(ctx, "callbackcounter") == CP_OK);
+	check(rename("tmp/watched/callbackcounter", "tmp/watchedplugin") == 0);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_get_plugin_state(ctx, "callbackcounter") == CP_PLUGIN_UNINSTALLED);
+	check(rename("tmp/watchedplugin", "tmp/watched/callbackcounter") == 0);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_get_plugin_state(ctx, "callbackcounter") == CP_PLUGIN_INSTALLED);
+	
+	// Modified plug-ins are reparsed while the others are not
+	write_file("tmp/watched/callbackcounter/plugin.xml", modified_xml, strlen(modified_xml));
+	loads[0] = loads[1] = 0;
+	check(cp_scan_plugins(ctx, CP_SP_UPGRADE) == CP_OK);
+	check((plugin = cp_get_plugin_info(ctx, "callbackcounter", NULL)) != NULL);
+	check(plugin->version != NULL && !strcmp(plugin->version, "2"));
+	cp_release_info(ctx, plugin);
+	check(loads[0] == 0 && loads[1] == 1);
+	
+	check(cp_watch_pcollections(ctx, 0) == CP_OK);
+	check(cp_get_pcollections_watch_fd(ctx) == -1);
+	
+	// The loader is destroyed while still watching
+	check(cp_watch_pcollections(ctx, 1) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_get_pcollections_watch_fd(ctx) >= 0);
+	cp_destroy();
+	check(errors == 0);
+#else
+	ctx = init_context(CP_LOG_ERROR + 1, &errors);
+	check(cp_watch_pcollections(ctx, 1) == CP_ERR_RESOURCE);
+	check(cp_get_pcollections_watch_fd(ctx) == -1);
+	cp_destroy();
+#endif
+}
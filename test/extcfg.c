@@ -21,6 +21,8 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *-----------------------------------------------------------------------*/
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "test.h"
 
@@ -65,3 +67,123 @@ void extcfgutils(void) {
 	cp_destroy_context(ctx);
 	check(errors == 0); 
 }
+
+void extcfgindex(void) {
+	static const char *names[] = { "zeta", "alpha", "child", "beta", "childish", "chi", "alpha" };
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin, *other;
+	cp_cfg_element_t *cfg, *ce, app;
+	const char *str;
+	char *buffer;
+	char path[64];
+	size_t len = 0;
+	int errors;
+	cp_status_t status;
+	int i;
+	
+	// Construct a descriptor with many children and attributes
+	check((buffer = malloc(64 * 128)) != NULL);
+	len += sprintf(buffer + len, "<plugin id=\"index\"><extension point=\"ep\" a9=\"9\" a1=\"1\" a5=\"5\" a3=\"3\" a7=\"7\" a2=\"2\" a8=\"8\" a4=\"4\" a6=\"6\" a0=\"0\">");
+	for (i = 0; i < 70; i++) {
+		len += sprintf(buffer + len, "<%s n=\"%d\"><leaf>%d</leaf></%s>", names[i % 7], i, i, names[i % 7]);
+	}
+	len += sprintf(buffer + len, "</extension></plugin>");
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor_from_memory(ctx, buffer, len, &status)) != NULL && status == CP_OK);
+	check((other = cp_load_plugin_descriptor_from_memory(ctx, buffer, len, &status)) != NULL && status == CP_OK);
+	free(buffer);
+	cfg = plugin->extensions[0].configuration;
+	
+	// Repeat the lookups, the second time after the other plug-in is gone
+	for (i = 0; i < 2; i++) {
+		if (i == 1) {
+			check(cp_lookup_cfg_element(other->extensions[0].configuration, "chi") != NULL);
+			cp_release_info(ctx, other);
+		}
+		check((ce = cp_lookup_cfg_element(cfg, "alpha")) != NULL && ce->index == 1);
+		check((ce = cp_lookup_cfg_element(cfg, "zeta")) != NULL && ce->index == 0);
+		check((ce = cp_lookup_cfg_element(cfg, "childish")) != NULL && ce->index == 4);
+		check((ce = cp_lookup_cfg_element(cfg, "chi")) != NULL && ce->index == 5);
+		check((ce = cp_lookup_cfg_element(cfg, "child/leaf/../../beta")) != NULL && ce->index == 3);
+		check(cp_lookup_cfg_element(cfg, "ch") == NULL);
+		check(cp_lookup_cfg_element(cfg, "childishness") == NULL);
+		check(cp_lookup_cfg_element(cfg, "aaa") == NULL);
+		check(cp_lookup_cfg_element(cfg, "zzz") == NULL);
+		check((str = cp_lookup_cfg_value(cfg, "alpha/leaf")) != NULL && !strcmp(str, "1"));
+		check((str = cp_lookup_cfg_value(cfg, "beta@n")) != NULL && !strcmp(str, "3"));
+		check((str = cp_lookup_cfg_value(cfg, "@a0")) != NULL && !strcmp(str, "0"));
+		check((str = cp_lookup_cfg_value(cfg, "@a9")) != NULL && !strcmp(str, "9"));
+		check((str = cp_lookup_cfg_value(cfg, "@point")) != NULL && !strcmp(str, "ep"));
+		check(cp_lookup_cfg_value(cfg, "@a") == NULL);
+		check(cp_lookup_cfg_value(cfg, "@b") == NULL);
+		sprintf(path, "chi/../%s@n", "alpha");
+		check((str = cp_lookup_cfg_value(cfg, path)) != NULL && !strcmp(str, "1"));
+	}
+
+	// Elements constructed by the application are looked up without an index
+	memset(&app, 0, sizeof(app));
+	app.name = "app";
+	app.num_children = cfg->num_children;
+	app.children = cfg->children;
+	check((ce = cp_lookup_cfg_element(&app, "chi")) != NULL && ce->index == 5);
+	check(cp_lookup_cfg_element(&app, "zzz") == NULL);
+
+	cp_release_info(ctx, plugin);
+	cp_destroy_context(ctx);
+	check(errors == 0); 
+}
+
+void extcfgpath(void) {
+	static const char *paths[] = {
+		"structure/parameter",
+		"structure/deeper/struct/is",
+		"@name",
+		"structure@nonexisting",
+		"non/existing",
+		"structure/../..",
+		"structure/",
+		"",
+		NULL
+	};
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin;
+	cp_extension_t *ext;
+	cp_cfg_element_t *cebase;
+	cp_cfg_path_t *path;
+	const char *str;
+	int errors;
+	cp_status_t status;
+	int i;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	for (i = 0, ext = NULL; ext == NULL && i < plugin->num_extensions; i++) {
+		cp_extension_t *e = plugin->extensions + i;
+		if (e->identifier != NULL && !strcmp(e->local_id, "ext1")) {
+			ext = e;
+		}
+	}
+	check(ext != NULL);
+	
+	// Compiled paths match path lookups
+	for (i = 0; paths[i] != NULL; i++) {
+		check((path = cp_compile_cfg_path(ctx, paths[i], &status)) != NULL && status == CP_OK);
+		check(cp_eval_cfg_value(path, ext->configuration) == cp_lookup_cfg_value(ext->configuration, paths[i]));
+		if (strchr(paths[i], '@') == NULL) {
+			check(cp_eval_cfg_element(path, ext->configuration) == cp_lookup_cfg_element(ext->configuration, paths[i]));
+		}
+		cp_release_info(ctx, path);
+	}
+	
+	// Relative paths and attribute selectors
+	check((cebase = cp_lookup_cfg_element(ext->configuration, "structure/deeper/struct/is")) != NULL);
+	check((path = cp_compile_cfg_path(ctx, "../../../../@name", &status)) != NULL && status == CP_OK);
+	check((str = cp_eval_cfg_value(path, cebase)) != NULL && !strcmp(str, "Extension 1"));
+	check(cp_eval_cfg_element(path, cebase) == ext->configuration);
+	check(cp_eval_cfg_value(path, ext->configuration) == NULL);
+	cp_release_info(ctx, path);
+	
+	cp_release_info(ctx, plugin);
+	cp_destroy_context(ctx);
+	check(errors == 0); 
+}
@@ -57,3 +57,37 @@ void fatalerrorreset(void) {
 	cp_set_fatal_error_handler(NULL);
 	cause_fatal_error();
 }
+
+void fatalerrorunknowninfo(void) {
+	cp_context_t *ctx;
+	void *obj;
+	
+	// Unknown objects are reported without touching memory around them
+	cp_set_fatal_error_handler(error_handler);
+	check((obj = malloc(1)) != NULL);
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	cp_release_info(ctx, obj);
+	free(obj);
+	free_test_resources();
+	exit(1);
+}
+
+static cp_plugin_info_t *logged_plugin;
+
+static void releasing_logger(cp_log_severity_t severity, const char *msg, const char *apid, void *user_data) {
+	cp_release_info(user_data, logged_plugin);
+}
+
+void fatalerrorreleaseinlogger(void) {
+	cp_context_t *ctx;
+	
+	// Releasing from a logger is fatal even if nothing is deallocated
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	check((logged_plugin = cp_load_plugin_descriptor(ctx, plugindir("minimal"), NULL)) != NULL);
+	check(cp_install_plugin(ctx, logged_plugin) == CP_OK);
+	check(cp_register_logger(ctx, releasing_logger, ctx, CP_LOG_INFO) == CP_OK);
+	cp_set_fatal_error_handler(error_handler);
+	cp_log(ctx, CP_LOG_INFO, "Releasing from a logger");
+	free_test_resources();
+	exit(1);
+}
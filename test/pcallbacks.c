@@ -25,7 +25,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include "plugins-source/callbackcounter/callbackcounter.h"
+#include "plugins-source/fdrunner/fdrunner.h"
+#include "plugins-source/multirunner/multirunner.h"
+#include "plugins-source/timerrunner/timerrunner.h"
 #include "test.h"
+#include <unistd.h>
 
 static char *argv[] = { "testarg0", NULL };
 
@@ -117,3 +121,305 @@ void plugincallbacks(void) {
 	/* Free the counter data that was intentionally leaked by the plug-in */
 	free(counters);
 }
+
+void plugincallbacksmt(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	mrr_data_t *data;
+	int errors;
+	
+#ifndef CP_THREADS
+	exit(77);
+#endif
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/multirunner", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check((data = cp_resolve_symbol(ctx, "multirunner", "mrr_data", &status)) != NULL && status == CP_OK);
+	
+	// A single thread never runs the run functions in parallel
+	data->limit = 200;
+	cp_run_plugins(ctx);
+	check(data->runs[0] == 200 && data->runs[2] == 200);
+	check(data->parallel == 0);
+	
+	// A thread pool runs them in parallel but never concurrently with themselves
+	check(cp_stop_plugin(ctx, "multirunner") == CP_OK);
+	check(cp_start_plugin(ctx, "multirunner") == CP_OK);
+	cp_run_plugins_mt(ctx, 4);
+	check(data->runs[0] == 200 && data->runs[2] == 200);
+	check(data->runs[1] == 1 && data->runs[3] == 1);
+	check(data->parallel > 0);
+	check(data->overlaps == 0);
+	check(!cp_run_plugins_step(ctx));
+	cp_release_symbol(ctx, data);
+	
+	check(cp_stop_plugin(ctx, "multirunner") == CP_OK);
+	check(data->running_at_stop == 0);
+	check(data->late_runs == 0);
+	cp_destroy();
+	check(errors == 0);
+}
+
+#ifdef CP_THREADS
+struct run_stop_data {
+	cp_context_t *ctx;
+	test_counter_t *runs;
+};
+
+static void count_runs(cp_log_severity_t severity, const char *msg, const char *apid, void *user_data) {
+	if (apid != NULL && !strcmp(msg, "Run function called.")) {
+		increment_test_counter(user_data);
+	}
+}
+
+static void start_and_request_run_stop(void *d) {
+	struct run_stop_data *data = d;
+	
+	// Register a run function, normally while the blocking run is waiting
+	check(cp_start_plugin(data->ctx, "callbackcounter") == CP_OK);
+	
+	// Request the stop once the run function has been called for the last time
+	wait_test_counter(data->runs, 3);
+	cp_request_run_stop(data->ctx);
+}
+#endif
+
+void pluginrunblocking(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	int errors;
+	cbc_counters_t *counters;
+#ifdef CP_THREADS
+	struct run_stop_data data;
+	test_thread_t *helper;
+#endif
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/callbackcounter", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	
+#ifdef CP_THREADS
+	data.ctx = ctx;
+	data.runs = create_test_counter();
+	check(cp_register_logger(ctx, count_runs, data.runs, CP_LOG_DEBUG) == CP_OK);
+	
+	// A stop requested before the blocking run does not apply to it
+	cp_request_run_stop(ctx);
+	helper = start_test_thread(start_and_request_run_stop, &data);
+	cp_run_plugins_blocking(ctx);
+	join_test_thread(helper);
+	cp_unregister_logger(ctx, count_runs);
+	destroy_test_counter(data.runs);
+#else
+	// Without threads the blocking run returns when there is nothing to run
+	check(cp_start_plugin(ctx, "callbackcounter") == CP_OK);
+	cp_run_plugins_blocking(ctx);
+#endif
+	check((counters = cp_resolve_symbol(ctx, "callbackcounter", "cbc_counters", &status)) != NULL && status == CP_OK);
+	check(counters->run == 3);
+	check(!cp_run_plugins_step(ctx));
+	cp_release_symbol(ctx, counters);
+	
+	// Stop plug-in
+	check(cp_stop_plugin(ctx, "callbackcounter") == CP_OK);
+	check(counters->stop == 1);
+	cp_destroy();
+	check(errors == 0);
+	
+	/* Free the counter data that was intentionally leaked by the plug-in */
+	free(counters);
+}
+
+void pluginrunfd(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	int errors;
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_EVENTFD_H)
+	fdr_data_t *data;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/fdrunner", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check((data = cp_resolve_symbol(ctx, "fdrunner", "fdr_data", &status)) != NULL && status == CP_OK);
+	check(data->other_status == CP_ERR_RUNTIME);
+	check(errors == 1);
+	
+	// The run function is only called when the pipe is readable
+	check(!cp_run_plugins_step(ctx));
+	check(data->run == 0);
+	check(write(data->write_fd, "a", 1) == 1);
+	check(!cp_run_plugins_step(ctx));
+	check(data->run == 1);
+	check(!cp_run_plugins_step(ctx));
+	check(data->run == 1);
+	
+	// A non-blocking run does not wait for the pipe
+	cp_run_plugins(ctx);
+	check(data->run == 1);
+	
+	// Run until the run function unregisters itself
+	check(write(data->write_fd, "bq", 2) == 2);
+	cp_run_plugins(ctx);
+	check(data->run == 3);
+	cp_release_symbol(ctx, data);
+	
+	// Stopping the plug-in unregisters a waiting run function
+	check(cp_stop_plugin(ctx, "fdrunner") == CP_OK);
+	check(cp_start_plugin(ctx, "fdrunner") == CP_OK);
+	check(cp_stop_plugin(ctx, "fdrunner") == CP_OK);
+	cp_destroy();
+	check(errors == 2);
+#else
+	ctx = init_context(CP_LOG_ERROR + 1, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/fdrunner", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check(cp_start_plugin(ctx, "fdrunner") != CP_OK);
+	cp_destroy();
+#endif
+}
+
+void pluginruntimer(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	trr_data_t *data;
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/timerrunner", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check((data = cp_resolve_symbol(ctx, "timerrunner", "trr_data", &status)) != NULL && status == CP_OK);
+	
+	// Timed run functions are not called or waited for before their deadlines
+	check(!cp_run_plugins_step(ctx));
+	cp_run_plugins(ctx);
+	check(data->delayed == 0 && data->periodic == 0);
+	
+	// Run until the timed run functions unregister themselves
+	while (data->delayed < 3 || data->periodic < 4) {
+		usleep(10000);
+		cp_run_plugins(ctx);
+	}
+	check(data->delayed == 3);
+	check(data->periodic == 4);
+	
+	// The same using several threads
+	check(cp_stop_plugin(ctx, "timerrunner") == CP_OK);
+	check(cp_start_plugin(ctx, "timerrunner") == CP_OK);
+	while (data->delayed < 3 || data->periodic < 4) {
+		usleep(10000);
+		cp_run_plugins_mt(ctx, 2);
+	}
+	check(data->delayed == 3);
+	check(data->periodic == 4);
+#ifndef CP_THREADS
+	
+	// Without threads a blocking run waits for the deadlines and returns
+	check(cp_stop_plugin(ctx, "timerrunner") == CP_OK);
+	check(cp_start_plugin(ctx, "timerrunner") == CP_OK);
+	cp_run_plugins_blocking(ctx);
+	check(data->delayed == 3);
+	check(data->periodic == 4);
+#endif
+	cp_release_symbol(ctx, data);
+	
+	// Stopping the plug-in unregisters waiting timed run functions
+	check(cp_stop_plugin(ctx, "timerrunner") == CP_OK);
+	check(cp_start_plugin(ctx, "timerrunner") == CP_OK);
+	check(cp_stop_plugin(ctx, "timerrunner") == CP_OK);
+	cp_destroy();
+	check(errors == 0);
+}
+
+void pluginrunqueues(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	mrr_data_t *data;
+	int errors;
+	
+#ifndef CP_THREADS
+	exit(77);
+#endif
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/multirunner", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check((data = cp_resolve_symbol(ctx, "multirunner", "mrr_data", &status)) != NULL && status == CP_OK);
+	
+	// The odd run functions leave the second run queue empty for stealing
+	data->limit = 200;
+	cp_run_plugins_mt(ctx, 2);
+	check(data->runs[0] == 200 && data->runs[2] == 200);
+	check(data->runs[1] == 1 && data->runs[3] == 1);
+	check(data->overlaps == 0);
+	check(data->migrations > 0);
+	cp_release_symbol(ctx, data);
+	
+	check(cp_stop_plugin(ctx, "multirunner") == CP_OK);
+	check(data->running_at_stop == 0);
+	check(data->late_runs == 0);
+	cp_destroy();
+	check(errors == 0);
+}
+
+#ifdef CP_THREADS
+static void run_plugins_mt(void *ctx) {
+	cp_run_plugins_mt(ctx, 3);
+}
+
+static void count_first_runs(cp_log_severity_t severity, const char *msg, const char *apid, void *user_data) {
+	if (apid != NULL && !strcmp(msg, "Run function called for the first time.")) {
+		increment_test_counter(user_data);
+	}
+}
+#endif
+
+void pluginrunqueuesstop(void) {
+#ifdef CP_THREADS
+	cp_context_t *ctx;
+	cp_status_t status;
+	cp_plugin_info_t *plugin;
+	test_thread_t *runner;
+	test_counter_t *first_runs;
+	mrr_data_t *data;
+	int errors;
+	int i;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, "tmp/install/plugins/multirunner", &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check((data = cp_resolve_symbol(ctx, "multirunner", "mrr_data", &status)) != NULL && status == CP_OK);
+	data->limit = 0;
+	cp_release_symbol(ctx, data);
+	first_runs = create_test_counter();
+	check(cp_register_logger(ctx, count_first_runs, first_runs, CP_LOG_DEBUG) == CP_OK);
+	
+	// Stop the plug-in once all its run functions rerun on the workers
+	runner = start_test_thread(run_plugins_mt, ctx);
+	wait_test_counter(first_runs, MRR_NUM_FUNCS);
+	check(cp_stop_plugin(ctx, "multirunner") == CP_OK);
+	join_test_thread(runner);
+	cp_unregister_logger(ctx, count_first_runs);
+	destroy_test_counter(first_runs);
+	for (i = 0; i < MRR_NUM_FUNCS; i++) {
+		check(data->runs[i] > 0);
+	}
+	check(data->overlaps == 0);
+	check(data->running_at_stop == 0);
+	check(data->late_runs == 0);
+	cp_destroy();
+	check(errors == 0);
+#else
+	exit(77);
+#endif
+}
@@ -22,6 +22,7 @@
  *-----------------------------------------------------------------------*/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "test.h"
 
@@ -157,3 +158,232 @@ void plugindeploop(void) {
 
 	cp_destroy();	
 }
+
+struct plugindepmt_order {
+	const char *plugins[16];
+	int num_plugins;
+};
+
+static void plugindepmt_listener(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data) {
+	struct plugindepmt_order *order = user_data;
+	
+	if (new_state == CP_PLUGIN_ACTIVE && order->num_plugins < 16) {
+		order->plugins[order->num_plugins++] = plugin_id;
+	}
+}
+
+static int ordered_before(struct plugindepmt_order *order, const char *first, const char *second) {
+	int i;
+	
+	for (i = 0; i < order->num_plugins; i++) {
+		if (!strcmp(order->plugins[i], first)) {
+			return 1;
+		} else if (!strcmp(order->plugins[i], second)) {
+			return 0;
+		}
+	}
+	return 0;
+}
+
+void plugindepmt(void) {
+	cp_context_t *ctx;
+	struct plugindepmt_order order;
+	const char * const ids[] = { "chain1", "sloop1", "loop5" };
+	const char * const ids_unknown[] = { "nonexisting", "chain2" };
+	const char * const act_none[] = { NULL };
+	const char * const act_chain23[] = { "chain2", "chain3", NULL };
+	const char * const act_started[] = { "chain1", "chain2", "chain3", "sloop1", "sloop2", "loop1", "loop2", "loop3", "loop4", "loop5", NULL };
+	
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	check((cp_register_pcollection(ctx, pcollectiondir("dependencies"))) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	memset(&order, 0, sizeof(order));
+	check(cp_register_plistener(ctx, plugindepmt_listener, &order) == CP_OK);
+	
+	// Start the selected plug-ins concurrently, including static loops
+	check(cp_start_plugins_mt(ctx, ids, 3, 4) == CP_OK);
+	check(active(ctx, act_started));
+	check(order.num_plugins == 10);
+	check(ordered_before(&order, "chain3", "chain2"));
+	check(ordered_before(&order, "chain2", "chain1"));
+	check(ordered_before(&order, "loop4", "loop2"));
+	check(ordered_before(&order, "loop3", "loop5"));
+	cp_stop_plugins(ctx);
+	check(active(ctx, act_none));
+	
+	// Start all the plug-ins, failing the ones with missing dependencies
+	order.num_plugins = 0;
+	check(cp_start_plugins_mt(ctx, NULL, 0, 4) == CP_ERR_DEPENDENCY);
+	check(active(ctx, act_started));
+	check(order.num_plugins == 10);
+	check(ordered_before(&order, "chain3", "chain2"));
+	check(ordered_before(&order, "chain2", "chain1"));
+
+	// Unknown plug-ins are reported but do not prevent starting the others
+	cp_stop_plugins(ctx);
+	check(cp_start_plugins_mt(ctx, ids_unknown, 2, 2) == CP_ERR_UNKNOWN);
+	check(active(ctx, act_chain23));
+	
+	cp_destroy();
+}
+
+static void plugindepmtstop_listener(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data) {
+	struct plugindepmt_order *order = user_data;
+	
+	if (new_state == CP_PLUGIN_RESOLVED && old_state >= CP_PLUGIN_STOPPING && order->num_plugins < 16) {
+		order->plugins[order->num_plugins++] = plugin_id;
+	}
+}
+
+void plugindepmtstop(void) {
+	cp_context_t *ctx;
+	struct plugindepmt_order order;
+	const char * const act_none[] = { NULL };
+	const char * const ids[] = { "chain1", "chain2", "chain3", "sloop1", "sloop2", "loop1", "loop2", "loop3", "loop4", "loop5" };
+	int i;
+	
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	check((cp_register_pcollection(ctx, pcollectiondir("dependencies"))) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_start_plugins_mt(ctx, ids, 10, 1) == CP_OK);
+	memset(&order, 0, sizeof(order));
+	check(cp_register_plistener(ctx, plugindepmtstop_listener, &order) == CP_OK);
+	
+	// Stop concurrently, importing plug-ins before the imported ones
+	cp_stop_plugins_mt(ctx, 4);
+	check(active(ctx, act_none));
+	check(order.num_plugins == 10);
+	check(ordered_before(&order, "chain1", "chain2"));
+	check(ordered_before(&order, "chain2", "chain3"));
+	check(ordered_before(&order, "loop2", "loop4"));
+	check(ordered_before(&order, "loop5", "loop3"));
+	
+	// Uninstall everything after a concurrent stop
+	check(cp_start_plugins_mt(ctx, ids, 10, 4) == CP_OK);
+	cp_uninstall_plugins_mt(ctx, 4);
+	for (i = 0; i < 10; i++) {
+		check(cp_get_plugin_state(ctx, ids[i]) == CP_PLUGIN_UNINSTALLED);
+	}
+	check(cp_get_plugin_state(ctx, "missingdep") == CP_PLUGIN_UNINSTALLED);
+	
+	cp_destroy();
+}
+
+struct plugindepmt_states {
+	cp_plugin_state_t states[16];
+	int num_states;
+};
+
+static void plugindepmtruntime_listener(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data) {
+	struct plugindepmt_states *states = user_data;
+	
+	if ((new_state == CP_PLUGIN_STARTING
+		|| new_state == CP_PLUGIN_ACTIVE
+		|| new_state == CP_PLUGIN_STOPPING
+		|| (new_state == CP_PLUGIN_RESOLVED && old_state == CP_PLUGIN_STOPPING))
+		&& states->num_states < 16) {
+		states->states[states->num_states++] = new_state;
+	}
+}
+
+static void install_plugin(cp_context_t *ctx, const char *path) {
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	
+	check((plugin = cp_load_plugin_descriptor(ctx, path, &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+}
+
+void plugindepmtruntime(void) {
+	cp_context_t *ctx;
+	struct plugindepmt_states states;
+	const char * const ids[] = { "concurrent", "concurrentpeer" };
+	const char * const act_none[] = { NULL };
+	const char * const act_both[] = { "concurrent", "concurrentpeer", NULL };
+	int errors;
+	
+#ifndef CP_THREADS
+	exit(77);
+#endif
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	install_plugin(ctx, "tmp/install/plugins/concurrent");
+	install_plugin(ctx, "tmp/install/plugins/concurrentpeer");
+	memset(&states, 0, sizeof(states));
+	check(cp_register_plistener(ctx, plugindepmtruntime_listener, &states) == CP_OK);
+	
+	// The start functions wait for each other, so both are starting at once
+	check(cp_start_plugins_mt(ctx, ids, 2, 2) == CP_OK);
+	check(active(ctx, act_both));
+	check(states.num_states == 4);
+	check(states.states[0] == CP_PLUGIN_STARTING);
+	check(states.states[1] == CP_PLUGIN_STARTING);
+	check(states.states[2] == CP_PLUGIN_ACTIVE);
+	check(states.states[3] == CP_PLUGIN_ACTIVE);
+	cp_stop_plugins_mt(ctx, 2);
+	check(active(ctx, act_none));
+	
+	cp_destroy();
+	check(errors == 0);
+}
+
+static int stopped_concurrently(struct plugindepmt_states *states) {
+	return (states->num_states == 4
+		&& states->states[0] == CP_PLUGIN_STOPPING
+		&& states->states[1] == CP_PLUGIN_STOPPING
+		&& states->states[2] == CP_PLUGIN_RESOLVED
+		&& states->states[3] == CP_PLUGIN_RESOLVED);
+}
+
+void plugindepmtstopruntime(void) {
+	cp_context_t *ctx;
+	struct plugindepmt_states states;
+	const char * const ids[] = { "concurrent", "concurrentpeer" };
+	const char * const act_none[] = { NULL };
+	int errors;
+	
+#ifndef CP_THREADS
+	exit(77);
+#endif
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	install_plugin(ctx, "tmp/install/plugins/concurrent");
+	install_plugin(ctx, "tmp/install/plugins/concurrentpeer");
+	memset(&states, 0, sizeof(states));
+	check(cp_register_plistener(ctx, plugindepmtruntime_listener, &states) == CP_OK);
+	
+	// The stop functions wait for each other, so both are stopping at once
+	check(cp_start_plugins_mt(ctx, ids, 2, 2) == CP_OK);
+	states.num_states = 0;
+	cp_stop_plugins_mt(ctx, 2);
+	check(active(ctx, act_none));
+	check(stopped_concurrently(&states));
+	
+	// The same when stopping the plug-ins for uninstallation
+	check(cp_start_plugins_mt(ctx, ids, 2, 2) == CP_OK);
+	states.num_states = 0;
+	cp_uninstall_plugins_mt(ctx, 2);
+	check(cp_get_plugin_state(ctx, "concurrent") == CP_PLUGIN_UNINSTALLED);
+	check(cp_get_plugin_state(ctx, "concurrentpeer") == CP_PLUGIN_UNINSTALLED);
+	check(stopped_concurrently(&states));
+	
+	cp_destroy();
+	check(errors == 0);
+}
+
+static void reentrant_error_handler(const char *msg) {
+	free_test_resources();
+	exit(0);
+}
+
+void plugindepmtreentrant(void) {
+	cp_context_t *ctx;
+	const char * const ids[] = { "reentrant" };
+	
+	// Stopping a plug-in from its concurrently called start function fails
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	install_plugin(ctx, "tmp/install/plugins/reentrant");
+	cp_set_fatal_error_handler(reentrant_error_handler);
+	cp_start_plugins_mt(ctx, ids, 1, 2);
+	free_test_resources();
+	exit(1);
+}
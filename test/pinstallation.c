@@ -22,6 +22,8 @@
  *-----------------------------------------------------------------------*/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "test.h"
 
 void install(void) {
@@ -99,3 +101,284 @@ void uninstall(void) {
 	cp_destroy();
 	check(errors == 0);	
 }
+
+struct installbatch_counter {
+	cp_context_t *ctx;
+	int installed;
+	int complete;
+};
+
+static void installbatch_listener(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data) {
+	struct installbatch_counter *counter = user_data;
+	
+	if (old_state == CP_PLUGIN_UNINSTALLED && new_state == CP_PLUGIN_INSTALLED) {
+		counter->installed++;
+	}
+	if (cp_get_plugin_state(counter->ctx, "minimal") == CP_PLUGIN_INSTALLED
+		&& cp_get_plugin_state(counter->ctx, "maximal") == CP_PLUGIN_INSTALLED) {
+		counter->complete++;
+	}
+}
+
+void installbatch(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugins[2];
+	cp_status_t status;
+	struct installbatch_counter counter = { NULL, 0, 0 };
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	counter.ctx = ctx;
+	check(cp_register_plistener(ctx, installbatch_listener, &counter) == CP_OK);
+	check((plugins[0] = cp_load_plugin_descriptor(ctx, plugindir("minimal"), &status)) != NULL && status == CP_OK);
+	check((plugins[1] = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	check(cp_install_plugins(ctx, plugins, 2) == CP_OK);
+	cp_release_info(ctx, plugins[0]);
+	cp_release_info(ctx, plugins[1]);
+	check(cp_get_plugin_state(ctx, "minimal") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "maximal") == CP_PLUGIN_INSTALLED);
+	check(counter.installed == 2);
+	check(counter.complete == 2);
+	check(cp_install_plugins(ctx, NULL, 0) == CP_OK);
+	cp_destroy();
+	check(errors == 0);
+}
+
+void installbatchconflict(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugins[3];
+	cp_status_t status;
+	struct installbatch_counter counter = { NULL, 0, 0 };
+	int i;
+	
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	counter.ctx = ctx;
+	check(cp_register_plistener(ctx, installbatch_listener, &counter) == CP_OK);
+	check((plugins[0] = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	check((plugins[1] = cp_load_plugin_descriptor(ctx, plugindir("minimal"), &status)) != NULL && status == CP_OK);
+	check((plugins[2] = cp_load_plugin_descriptor(ctx, plugindir("minimal"), &status)) != NULL && status == CP_OK);
+	
+	// Conflict within the batch installs nothing
+	check(cp_install_plugins(ctx, plugins, 3) == CP_ERR_CONFLICT);
+	check(cp_get_plugin_state(ctx, "maximal") == CP_PLUGIN_UNINSTALLED);
+	check(cp_get_plugin_state(ctx, "minimal") == CP_PLUGIN_UNINSTALLED);
+	check(counter.installed == 0);
+	
+	// Conflict with an installed plug-in installs nothing
+	check(cp_install_plugin(ctx, plugins[1]) == CP_OK);
+	check(counter.installed == 1);
+	check(cp_install_plugins(ctx, plugins, 2) == CP_ERR_CONFLICT);
+	check(cp_get_plugin_state(ctx, "maximal") == CP_PLUGIN_UNINSTALLED);
+	check(counter.installed == 1);
+	
+	check(cp_install_plugins(ctx, plugins, 1) == CP_OK);
+	check(cp_get_plugin_state(ctx, "maximal") == CP_PLUGIN_INSTALLED);
+	check(counter.installed == 2);
+	for (i = 0; i < 3; i++) {
+		cp_release_info(ctx, plugins[i]);
+	}
+	cp_destroy();
+}
+
+void extensionscache(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin;
+	cp_extension_t **ext1, **ext2, **all1, **all2;
+	cp_status_t status;
+	int num, errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	
+	// Repeated queries share the same array
+	check((ext1 = cp_get_extensions_info(ctx, "maximal.extpt1", &status, &num)) != NULL && status == CP_OK && num == 1);
+	check((ext2 = cp_get_extensions_info(ctx, "maximal.extpt1", &status, &num)) != NULL && status == CP_OK && num == 1);
+	check(ext1 == ext2);
+	cp_release_info(ctx, ext2);
+	check((all1 = cp_get_extensions_info(ctx, NULL, &status, &num)) != NULL && status == CP_OK && num == 4);
+	check((all2 = cp_get_extensions_info(ctx, NULL, &status, &num)) != NULL && status == CP_OK && num == 4);
+	check(all1 == all2);
+	cp_release_info(ctx, all2);
+	
+	// Uninstalling replaces the arrays but the old ones stay valid
+	check(cp_uninstall_plugin(ctx, "maximal") == CP_OK);
+	check((ext2 = cp_get_extensions_info(ctx, "maximal.extpt1", &status, &num)) != NULL && status == CP_OK && num == 0);
+	check(ext2 != ext1 && ext2[0] == NULL);
+	cp_release_info(ctx, ext2);
+	check((all2 = cp_get_extensions_info(ctx, NULL, &status, &num)) != NULL && status == CP_OK && num == 0);
+	check(all2 != all1 && all2[0] == NULL);
+	cp_release_info(ctx, all2);
+	check(!strcmp(ext1[0]->plugin->identifier, "maximal"));
+	check(ext1[1] == NULL && all1[4] == NULL);
+	
+	// Installing again returns fresh arrays
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	check((ext2 = cp_get_extensions_info(ctx, "maximal.extpt1", &status, &num)) != NULL && status == CP_OK && num == 1);
+	check(ext2 != ext1 && ext2[0]->plugin == plugin);
+	cp_release_info(ctx, ext2);
+	cp_release_info(ctx, ext1);
+	cp_release_info(ctx, all1);
+	cp_release_info(ctx, plugin);
+	cp_destroy();
+	check(errors == 0);
+}
+
+void extensionsiter(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin;
+	cp_extension_t *e;
+	cp_ext_iter_t iter;
+	int n, errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	
+	// Nothing to iterate before installation
+	check(cp_ext_iter_begin(ctx, &iter, "maximal.extpt1") == CP_OK);
+	check(cp_ext_iter_next(&iter) == NULL);
+	cp_ext_iter_end(&iter);
+	
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("maximal"), NULL)) != NULL);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check(cp_ext_iter_begin(ctx, &iter, "maximal.extpt1") == CP_OK);
+	check((e = cp_ext_iter_next(&iter)) != NULL);
+	check(!strcmp(e->ext_point_id, "maximal.extpt1"));
+	check(cp_ext_iter_next(&iter) == NULL);
+	cp_ext_iter_end(&iter);
+	
+	// An iteration is not affected by uninstallation
+	check(cp_ext_iter_begin(ctx, &iter, NULL) == CP_OK);
+	check(cp_uninstall_plugin(ctx, "maximal") == CP_OK);
+	for (n = 0; (e = cp_ext_iter_next(&iter)) != NULL; n++) {
+		check(!strcmp(e->plugin->identifier, "maximal"));
+	}
+	check(n == 4);
+	cp_ext_iter_end(&iter);
+	
+	cp_destroy();
+	check(errors == 0);
+}
+
+struct pluginstates_checker {
+	cp_context_t *ctx;
+	int events;
+	int mismatches;
+};
+
+static void pluginstates_listener(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data) {
+	struct pluginstates_checker *checker = user_data;
+	
+	checker->events++;
+	if (cp_get_plugin_state(checker->ctx, plugin_id) != new_state) {
+		checker->mismatches++;
+	}
+}
+
+void pluginstates(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin;
+	struct pluginstates_checker checker = { NULL, 0, 0 };
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	checker.ctx = ctx;
+	check(cp_register_plistener(ctx, pluginstates_listener, &checker) == CP_OK);
+	check(cp_get_plugin_state(ctx, "minimal") == CP_PLUGIN_UNINSTALLED);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("minimal"), NULL)) != NULL);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	cp_release_info(ctx, plugin);
+	check(cp_get_plugin_state(ctx, "minimal") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "nonexisting") == CP_PLUGIN_UNINSTALLED);
+	check(cp_start_plugin(ctx, "minimal") == CP_OK);
+	check(cp_get_plugin_state(ctx, "minimal") == CP_PLUGIN_ACTIVE);
+	check(cp_stop_plugin(ctx, "minimal") == CP_OK);
+	check(cp_get_plugin_state(ctx, "minimal") == CP_PLUGIN_RESOLVED);
+	check(cp_uninstall_plugin(ctx, "minimal") == CP_OK);
+	check(cp_get_plugin_state(ctx, "minimal") == CP_PLUGIN_UNINSTALLED);
+	check(checker.events > 4);
+	check(checker.mismatches == 0);
+	cp_destroy();
+	check(errors == 0);
+}
+
+void plugininforefs(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin, *info1, *info2;
+	cp_status_t status;
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("maximal"), NULL)) != NULL);
+	check(cp_install_plugin(ctx, plugin) == CP_OK);
+	check((info1 = cp_get_plugin_info(ctx, "maximal", &status)) == plugin && status == CP_OK);
+	check((info2 = cp_get_plugin_info(ctx, "maximal", &status)) == plugin && status == CP_OK);
+	cp_release_info(ctx, info2);
+	
+	// Information held by the client outlives the installation
+	check(cp_uninstall_plugin(ctx, "maximal") == CP_OK);
+	check(cp_get_plugin_info(ctx, "maximal", &status) == NULL && status == CP_ERR_UNKNOWN);
+	check(!strcmp(info1->identifier, "maximal"));
+	cp_release_info(ctx, info1);
+	check(!strcmp(plugin->identifier, "maximal"));
+	cp_release_info(ctx, plugin);
+	cp_destroy();
+	check(errors == 0);
+}
+
+#ifdef CP_THREADS
+struct registryreclaim_counts {
+	int registered;
+	int deallocated;
+};
+
+static void registryreclaim_logger(cp_log_severity_t severity, const char *msg, const char *apid, void *user_data) {
+	struct registryreclaim_counts *counts = user_data;
+	
+	if (!strncmp(msg, "Registered a new reference counted object", 41)) {
+		counts->registered++;
+	} else if (!strncmp(msg, "Deallocated the reference counted object", 40)) {
+		counts->deallocated++;
+	}
+}
+
+static void registryreclaim_reader(void *arg) {
+	cp_context_t *ctx = arg;
+	int i;
+	
+	for (i = 0; i < 100000; i++) {
+		cp_get_plugin_state(ctx, "minimal");
+	}
+}
+#endif
+
+void registryreclaim(void) {
+#ifdef CP_THREADS
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin;
+	struct registryreclaim_counts counts = { 0, 0 };
+	test_thread_t *reader;
+	int i, errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_logger(ctx, registryreclaim_logger, &counts, CP_LOG_DEBUG) == CP_OK);
+	
+	// Snapshots retired during steady reading are freed by the readers
+	reader = start_test_thread(registryreclaim_reader, ctx);
+	for (i = 0; i < 50; i++) {
+		check((plugin = cp_load_plugin_descriptor(ctx, plugindir("minimal"), NULL)) != NULL);
+		check(cp_install_plugin(ctx, plugin) == CP_OK);
+		cp_release_info(ctx, plugin);
+		check(cp_uninstall_plugin(ctx, "minimal") == CP_OK);
+	}
+	join_test_thread(reader);
+	
+	// No plug-in information is held back after the reader has left
+	check(counts.registered >= 50);
+	check(counts.deallocated == counts.registered);
+	cp_destroy();
+	check(errors == 0);
+#else
+	exit(77);
+#endif
+}
@@ -22,6 +22,7 @@
  *-----------------------------------------------------------------------*/
 
 #include <stdio.h>
+#include <string.h>
 #include "test.h"
 
 void oneploader(void) {
@@ -163,3 +164,96 @@ void unregploader(void) {
 	cp_destroy();
 	check(errors == 0);
 }
+
+void ploaderparallel(void) {
+	cp_context_t *ctx;
+	cp_plugin_loader_t *loader;
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	int errors;
+
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	loader = cp_create_local_ploader(&status);
+	check(loader != NULL);
+	check(status == CP_OK);
+	cp_lpl_set_scan_threads(loader, 4);
+	check(cp_register_ploader(ctx, loader) == CP_OK);
+	check(cp_lpl_register_dir(loader, pcollectiondir("collection1")) == CP_OK);
+	check(cp_lpl_register_dir(loader, pcollectiondir("collection1v3")) == CP_OK);
+	check(cp_lpl_register_dir(loader, pcollectiondir("collection1v2")) == CP_OK);
+	check(cp_lpl_register_dir(loader, pcollectiondir("collection2")) == CP_OK);
+	check(cp_lpl_register_dir(loader, pcollectiondir("dependencies")) == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check((plugin = cp_get_plugin_info(ctx, "plugin1", &status)) != NULL && status == CP_OK);
+	check(!strcmp(plugin->version, "3"));
+	cp_release_info(ctx, plugin);
+	check(cp_get_plugin_state(ctx, "plugin2a") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "plugin2b") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "chain1") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "loop5") == CP_PLUGIN_INSTALLED);
+	cp_destroy();
+	check(errors == 0);
+}
+
+static void count_cache_loads(cp_log_severity_t severity, const char *msg, const char *apid, void *user_data) {
+	int *loads = user_data;
+	
+	// Counts the loads from collection1 and collection2 separately
+	if (strstr(msg, "loaded from the scan cache") != NULL) {
+		loads[strstr(msg, "collection2") != NULL]++;
+	}
+}
+
+// Scans using the caches, checking how many plug-ins each cache provided
+static void check_cached_scan(int cached1, int cached2) {
+	cp_context_t *ctx;
+	cp_plugin_loader_t *loader;
+	cp_plugin_info_t *plugin;
+	cp_status_t status;
+	int loads[2] = { 0, 0 };
+	int errors;
+
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_logger(ctx, count_cache_loads, loads, CP_LOG_DEBUG) == CP_OK);
+	loader = cp_create_local_ploader(&status);
+	check(loader != NULL);
+	check(status == CP_OK);
+	check(cp_register_ploader(ctx, loader) == CP_OK);
+	check(cp_lpl_register_dir(loader, pcollectiondir("collection1")) == CP_OK);
+	check(cp_lpl_register_dir(loader, pcollectiondir("collection2")) == CP_OK);
+	check(cp_lpl_set_cache_file(loader, pcollectiondir("collection1"), "tmp/ploadercache1") == CP_OK);
+	check(cp_lpl_set_cache_file(loader, pcollectiondir("collection2"), "tmp/ploadercache2") == CP_OK);
+	check(cp_lpl_set_cache_file(loader, pcollectiondir("collection1v2"), "tmp/ploadercache3") == CP_ERR_UNKNOWN);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check((plugin = cp_get_plugin_info(ctx, "plugin1", &status)) != NULL && status == CP_OK);
+	check(plugin->version == NULL);
+	check(plugin->plugin_path != NULL);
+	cp_release_info(ctx, plugin);
+	check(cp_get_plugin_state(ctx, "plugin2a") == CP_PLUGIN_INSTALLED);
+	check(cp_get_plugin_state(ctx, "plugin2b") == CP_PLUGIN_INSTALLED);
+	check(loads[0] == cached1 && loads[1] == cached2);
+	cp_destroy();
+	check(errors == 0);
+}
+
+void ploadercache(void) {
+	FILE *fh;
+	
+	remove("tmp/ploadercache1");
+	remove("tmp/ploadercache2");
+	
+	// Scan without a cache and then with the created cache
+	check_cached_scan(0, 0);
+	check((fh = fopen("tmp/ploadercache1", "rb")) != NULL);
+	fclose(fh);
+	check((fh = fopen("tmp/ploadercache2", "rb")) != NULL);
+	fclose(fh);
+	check_cached_scan(1, 2);
+	
+	// An invalid cache is ignored and rebuilt
+	check((fh = fopen("tmp/ploadercache1", "wb")) != NULL);
+	fputs("invalid", fh);
+	fclose(fh);
+	check_cached_scan(0, 2);
+	check_cached_scan(1, 2);
+}
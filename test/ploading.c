@@ -42,6 +42,89 @@ void loadonlymaximal(void) {
 	check(errors == 0);
 }
 
+static int str_equals(const char *s1, const char *s2) {
+	return (s1 == NULL ? s2 == NULL : s2 != NULL && !strcmp(s1, s2));
+}
+
+static void check_cfg_equals(const cp_cfg_element_t *ce1, const cp_cfg_element_t *ce2) {
+	unsigned int i;
+	
+	check(str_equals(ce1->name, ce2->name));
+	check(str_equals(ce1->value, ce2->value));
+	check(ce1->index == ce2->index);
+	check(ce1->num_atts == ce2->num_atts);
+	for (i = 0; i < 2 * ce1->num_atts; i++) {
+		check(str_equals(ce1->atts[i], ce2->atts[i]));
+	}
+	check(ce1->num_children == ce2->num_children);
+	for (i = 0; i < ce1->num_children; i++) {
+		check(ce2->children[i].parent == ce2);
+		check_cfg_equals(ce1->children + i, ce2->children + i);
+	}
+}
+
+void loadmaximalimage(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin, *plugin2;
+	cp_status_t status;
+	unsigned int i;
+	int errors;
+	FILE *f;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	check(cp_save_plugin_image(ctx, plugin, "tmp" CP_FNAMESEP_STR "plugin.bin") == CP_OK);
+	check((plugin2 = cp_load_plugin_image(ctx, "tmp", &status)) != NULL && status == CP_OK);
+	check(!strcmp(plugin2->plugin_path, "tmp"));
+	check(str_equals(plugin->identifier, plugin2->identifier));
+	check(str_equals(plugin->name, plugin2->name));
+	check(str_equals(plugin->version, plugin2->version));
+	check(str_equals(plugin->provider_name, plugin2->provider_name));
+	check(str_equals(plugin->abi_bw_compatibility, plugin2->abi_bw_compatibility));
+	check(str_equals(plugin->api_bw_compatibility, plugin2->api_bw_compatibility));
+	check(str_equals(plugin->req_cpluff_version, plugin2->req_cpluff_version));
+	check(str_equals(plugin->runtime_lib_name, plugin2->runtime_lib_name));
+	check(str_equals(plugin->runtime_funcs_symbol, plugin2->runtime_funcs_symbol));
+	check(str_equals(plugin->runtime_exports_symbol, plugin2->runtime_exports_symbol));
+	check(plugin->num_imports == plugin2->num_imports);
+	for (i = 0; i < plugin->num_imports; i++) {
+		check(str_equals(plugin->imports[i].plugin_id, plugin2->imports[i].plugin_id));
+		check(str_equals(plugin->imports[i].version, plugin2->imports[i].version));
+		check(plugin->imports[i].optional == plugin2->imports[i].optional);
+	}
+	check(plugin->num_ext_points == plugin2->num_ext_points);
+	for (i = 0; i < plugin->num_ext_points; i++) {
+		check(plugin2->ext_points[i].plugin == plugin2);
+		check(str_equals(plugin->ext_points[i].local_id, plugin2->ext_points[i].local_id));
+		check(str_equals(plugin->ext_points[i].identifier, plugin2->ext_points[i].identifier));
+		check(str_equals(plugin->ext_points[i].name, plugin2->ext_points[i].name));
+		check(str_equals(plugin->ext_points[i].schema_path, plugin2->ext_points[i].schema_path));
+	}
+	check(plugin->num_extensions == plugin2->num_extensions);
+	for (i = 0; i < plugin->num_extensions; i++) {
+		check(plugin2->extensions[i].plugin == plugin2);
+		check(str_equals(plugin->extensions[i].ext_point_id, plugin2->extensions[i].ext_point_id));
+		check(str_equals(plugin->extensions[i].local_id, plugin2->extensions[i].local_id));
+		check(str_equals(plugin->extensions[i].identifier, plugin2->extensions[i].identifier));
+		check(str_equals(plugin->extensions[i].name, plugin2->extensions[i].name));
+		check(plugin2->extensions[i].configuration->parent == NULL);
+		check_cfg_equals(plugin->extensions[i].configuration, plugin2->extensions[i].configuration);
+	}
+	cp_release_info(ctx, plugin);
+	cp_release_info(ctx, plugin2);
+	
+	// An invalid image is rejected
+	check((f = fopen("tmp" CP_FNAMESEP_STR "plugin.bin", "wb")) != NULL);
+	for (i = 0; i < 64; i++) {
+		fputc('x', f);
+	}
+	fclose(f);
+	check(cp_load_plugin_image(ctx, "tmp", &status) == NULL && status == CP_ERR_MALFORMED);
+	remove("tmp" CP_FNAMESEP_STR "plugin.bin");
+	cp_destroy();
+	check(errors == 1);
+}
+
 void loadonlymaximalfrommemory(void) {
 	cp_context_t *ctx;
 	cp_plugin_info_t *plugin;
@@ -75,3 +158,84 @@ void loadonlymaximalfrommemory(void) {
 	cp_destroy();
 	check(errors == 0);
 }
+
+void loadlargeconfiguration(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin;
+	cp_cfg_element_t *ce;
+	cp_status_t status;
+	char *buffer;
+	char value[32];
+	size_t len = 0;
+	int errors, i;
+	unsigned int j;
+
+	/* Construct a descriptor with more configuration elements than initially allocated */
+	check((buffer = malloc(64 * 128)) != NULL);
+	len += sprintf(buffer + len, "<plugin id=\"large\"><extension point=\"ep\">");
+	for (i = 0; i < 40; i++) {
+		len += sprintf(buffer + len, "<child index=\"%d\">value %d<grandchild>x</grandchild> more</child>", i, i);
+	}
+	len += sprintf(buffer + len, "</extension></plugin>");
+
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin = cp_load_plugin_descriptor_from_memory(ctx, buffer, len, &status)) != NULL && status == CP_OK);
+	free(buffer);
+	check(plugin->num_extensions == 1);
+	ce = plugin->extensions[0].configuration;
+	check(ce != NULL && ce->num_children == 40);
+	for (j = 0; j < ce->num_children; j++) {
+		cp_cfg_element_t *child = ce->children + j;
+		
+		check(child->parent == ce);
+		check(child->index == j);
+		check(child->num_children == 1);
+		check(child->children[0].parent == child);
+		check(!strcmp(child->children[0].value, "x"));
+		sprintf(value, "value %u more", j);
+		check(child->value != NULL && !strcmp(child->value, value));
+		sprintf(value, "%u", j);
+		check(!strcmp(cp_lookup_cfg_value(child, "@index"), value));
+	}
+	cp_release_info(ctx, plugin);
+	cp_destroy();
+	check(errors == 0);
+}
+
+void loadinternedidentifiers(void) {
+	cp_context_t *ctx;
+	cp_plugin_info_t *plugin1, *plugin2;
+	cp_extension_t **extensions;
+	cp_status_t status;
+	char id[16], epid[32];
+	int errors, num;
+
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check((plugin1 = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	check((plugin2 = cp_load_plugin_descriptor(ctx, plugindir("maximal"), &status)) != NULL && status == CP_OK);
+	
+	/* Identifiers are shared between descriptors */
+	check(plugin1 != plugin2);
+	check(plugin1->identifier == plugin2->identifier);
+	check(plugin1->num_ext_points > 0);
+	check(plugin1->ext_points[0].identifier == plugin2->ext_points[0].identifier);
+	check(plugin1->num_extensions > 0);
+	check(plugin1->extensions[0].ext_point_id == plugin2->extensions[0].ext_point_id);
+	
+	/* Look ups work with copies of the identifiers */
+	check(cp_install_plugin(ctx, plugin1) == CP_OK);
+	strcpy(id, plugin1->identifier);
+	check(cp_get_plugin_state(ctx, id) == CP_PLUGIN_INSTALLED);
+	strcpy(epid, plugin1->extensions[0].ext_point_id);
+	check((extensions = cp_get_extensions_info(ctx, epid, &status, &num)) != NULL && status == CP_OK);
+	check(num > 0);
+	cp_release_info(ctx, extensions);
+	check(cp_get_plugin_state(ctx, "unknown") == CP_PLUGIN_UNINSTALLED);
+	check(cp_uninstall_plugin(ctx, id) == CP_OK);
+	check(cp_get_plugin_state(ctx, id) == CP_PLUGIN_UNINSTALLED);
+	
+	cp_release_info(ctx, plugin1);
+	cp_release_info(ctx, plugin2);
+	cp_destroy();
+	check(errors == 0);
+}
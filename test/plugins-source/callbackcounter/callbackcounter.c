@@ -73,6 +73,9 @@ static int run(void *d) {
 	struct runtime_data *data = d;
 	
 	data->counters->run++;
+	
+	// Lets a test in another thread follow the runs
+	cp_log(data->ctx, CP_LOG_DEBUG, "Run function called.");
 	return (data->counters->run < 3);
 }
 
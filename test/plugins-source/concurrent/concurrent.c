@@ -0,0 +1,110 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <cpluff.h>
+
+/// Maximum time to wait for the peer plug-in, in milliseconds
+#define PEER_TIMEOUT 2000
+
+struct runtime_data {
+	cp_context_t *ctx;
+	const char *peer;
+};
+
+static void *create(cp_context_t *ctx) {
+	struct runtime_data *data;
+	
+	if ((data = malloc(sizeof(struct runtime_data))) == NULL) {
+		return NULL;
+	}
+	memset(data, 0, sizeof(struct runtime_data));
+	data->ctx = ctx;
+	return data;
+}
+
+/*
+ * Waits until the peer plug-in has reached the starting or stopping state
+ * or the timeout expires. Only concurrently started or stopped peers get
+ * there in time, which the test program observes from the plug-in events.
+ */
+static void wait_peer(struct runtime_data *data, int starting) {
+	int i;
+	
+	for (i = 0; i < PEER_TIMEOUT; i++) {
+		cp_plugin_state_t state = cp_get_plugin_state(data->ctx, data->peer);
+		
+		if (starting ? (state == CP_PLUGIN_STARTING || state == CP_PLUGIN_ACTIVE) : state != CP_PLUGIN_ACTIVE) {
+			break;
+		}
+		usleep(1000);
+	}
+}
+
+static int start(void *d) {
+	struct runtime_data *data = d;
+	cp_plugin_info_t *info;
+	
+	// The plug-ins concurrent and concurrentpeer wait for each other
+	if ((info = cp_get_plugin_info(data->ctx, NULL, NULL)) == NULL) {
+		return CP_ERR_RUNTIME;
+	}
+	data->peer = (strcmp(info->identifier, "concurrent") ? "concurrent" : "concurrentpeer");
+	cp_release_info(data->ctx, info);
+	wait_peer(data, 1);
+	return CP_OK;
+}
+
+static void stop(void *d) {
+	struct runtime_data *data = d;
+	
+	wait_peer(data, 0);
+}
+
+static int start_reentrant(void *d) {
+	struct runtime_data *data = d;
+	
+	// Stopping the plug-in from its own start function is not allowed
+	cp_stop_plugin(data->ctx, "reentrant");
+	return CP_OK;
+}
+
+static void destroy(void *d) {
+	free(d);
+}
+
+CP_EXPORT cp_plugin_runtime_t cc_runtime = {
+	create,
+	start,
+	stop,
+	destroy
+};
+
+CP_EXPORT cp_plugin_runtime_t cc_reentrant_runtime = {
+	create,
+	start_reentrant,
+	NULL,
+	destroy
+};
@@ -0,0 +1,107 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <cpluff.h>
+#include "fdrunner.h"
+
+struct runtime_data {
+	cp_context_t *ctx;
+	int read_fd;
+	fdr_data_t shared;
+};
+
+static void *create(cp_context_t *ctx) {
+	struct runtime_data *data;
+	
+	if ((data = malloc(sizeof(struct runtime_data))) == NULL) {
+		return NULL;
+	}
+	memset(data, 0, sizeof(struct runtime_data));
+	data->ctx = ctx;
+	data->read_fd = -1;
+	data->shared.write_fd = -1;
+	return data;
+}
+
+static int run(void *d) {
+	struct runtime_data *data = d;
+	char c;
+	
+	// Consume one byte per call and stop on 'q'
+	data->shared.run++;
+	if (read(data->read_fd, &c, 1) != 1 || c == 'q') {
+		return 0;
+	}
+	return 1;
+}
+
+static int other(void *d) {
+	return 0;
+}
+
+static int start(void *d) {
+	struct runtime_data *data = d;
+	int fds[2];
+	
+	if (pipe(fds) != 0) {
+		return CP_ERR_RESOURCE;
+	}
+	data->read_fd = fds[0];
+	data->shared.write_fd = fds[1];
+	if (cp_define_symbol(data->ctx, "fdr_data", &data->shared) != CP_OK
+		|| cp_run_function_on_fd(data->ctx, data->read_fd, CP_FD_READ, run) != CP_OK) {
+		return CP_ERR_RUNTIME;
+	}
+	
+	// Only one run function can wait for the pipe
+	data->shared.other_status = cp_run_function_on_fd(data->ctx, data->read_fd, CP_FD_READ, other);
+	return CP_OK;
+}
+
+static void stop(void *d) {
+	struct runtime_data *data = d;
+	
+	// The run function has been unregistered before the plug-in stops
+	if (data->read_fd >= 0) {
+		close(data->read_fd);
+		data->read_fd = -1;
+	}
+	if (data->shared.write_fd >= 0) {
+		close(data->shared.write_fd);
+		data->shared.write_fd = -1;
+	}
+}
+
+static void destroy(void *d) {
+	free(d);
+}
+
+CP_EXPORT cp_plugin_runtime_t fdr_runtime = {
+	create,
+	start,
+	stop,
+	destroy
+};
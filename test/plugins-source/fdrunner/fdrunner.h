@@ -0,0 +1,51 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef FDRUNNER_H_
+#define FDRUNNER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A type for fdr_data_t structure */
+typedef struct fdr_data_t fdr_data_t;
+
+/** Data shared with the test program */
+struct fdr_data_t {
+	
+	/** The write end of the pipe the run function waits for */
+	int write_fd;
+	
+	/** Call counter for the run function */
+	int run;
+	
+	/** The status of registering another run function for the same pipe */
+	int other_status;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*FDRUNNER_H_*/
@@ -0,0 +1,176 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef CP_THREADS
+#include <pthread.h>
+#endif
+#include <cpluff.h>
+#include "multirunner.h"
+
+/// How long a run function keeps running, in microseconds
+#define RUN_DURATION 100
+
+struct runtime_data {
+	cp_context_t *ctx;
+#ifdef CP_THREADS
+	pthread_mutex_t mutex;
+	pthread_t threads[MRR_NUM_FUNCS];
+#endif
+	int running[MRR_NUM_FUNCS];
+	int stopped;
+	mrr_data_t shared;
+};
+
+#ifdef CP_THREADS
+#define lock_data(data) pthread_mutex_lock(&(data)->mutex)
+#define unlock_data(data) pthread_mutex_unlock(&(data)->mutex)
+#else
+#define lock_data(data) do {} while (0)
+#define unlock_data(data) do {} while (0)
+#endif
+
+static void *create(cp_context_t *ctx) {
+	struct runtime_data *data;
+	
+	if ((data = malloc(sizeof(struct runtime_data))) == NULL) {
+		return NULL;
+	}
+	memset(data, 0, sizeof(struct runtime_data));
+#ifdef CP_THREADS
+	if (pthread_mutex_init(&data->mutex, NULL)) {
+		free(data);
+		return NULL;
+	}
+#endif
+	data->ctx = ctx;
+	return data;
+}
+
+/*
+ * Records a call of the run function with the specified index, keeps
+ * running for a while and returns whether the run function is to be rerun.
+ */
+static int run(struct runtime_data *data, int i) {
+	int rerun, first, j;
+	
+	lock_data(data);
+	if (data->running[i]) {
+		data->shared.overlaps++;
+	}
+	for (j = 0; j < MRR_NUM_FUNCS; j++) {
+		if (j != i && data->running[j]) {
+			data->shared.parallel++;
+			break;
+		}
+	}
+	if (data->stopped) {
+		data->shared.late_runs++;
+	}
+#ifdef CP_THREADS
+	if (data->shared.runs[i] > 0 && !pthread_equal(data->threads[i], pthread_self())) {
+		data->shared.migrations++;
+	}
+	data->threads[i] = pthread_self();
+#endif
+	data->running[i] = 1;
+	first = (++data->shared.runs[i] == 1);
+	unlock_data(data);
+	
+	// Lets a test in another thread know that all run functions have run
+	if (first) {
+		cp_log(data->ctx, CP_LOG_DEBUG, "Run function called for the first time.");
+	}
+	usleep(RUN_DURATION);
+	lock_data(data);
+	data->running[i] = 0;
+	if (data->shared.limit == 0) {
+		rerun = 1;
+	} else {
+		rerun = (i % 2 == 0 && data->shared.runs[i] < data->shared.limit);
+	}
+	unlock_data(data);
+	return rerun;
+}
+
+#define RUN_FUNC(i) static int run##i(void *d) { return run(d, i); }
+RUN_FUNC(0)
+RUN_FUNC(1)
+RUN_FUNC(2)
+RUN_FUNC(3)
+
+static int start(void *d) {
+	struct runtime_data *data = d;
+	cp_run_func_t funcs[MRR_NUM_FUNCS] = { run0, run1, run2, run3 };
+	int i;
+	
+	data->stopped = 0;
+	memset(data->running, 0, sizeof(data->running));
+	data->shared.overlaps = 0;
+	data->shared.parallel = 0;
+	data->shared.migrations = 0;
+	data->shared.running_at_stop = 0;
+	data->shared.late_runs = 0;
+	memset(data->shared.runs, 0, sizeof(data->shared.runs));
+	if (cp_define_symbol(data->ctx, "mrr_data", &data->shared) != CP_OK) {
+		return CP_ERR_RUNTIME;
+	}
+	for (i = 0; i < MRR_NUM_FUNCS; i++) {
+		if (cp_run_function(data->ctx, funcs[i]) != CP_OK) {
+			return CP_ERR_RUNTIME;
+		}
+	}
+	return CP_OK;
+}
+
+static void stop(void *d) {
+	struct runtime_data *data = d;
+	int i;
+	
+	// All run functions should have returned by now
+	lock_data(data);
+	for (i = 0; i < MRR_NUM_FUNCS; i++) {
+		data->shared.running_at_stop += data->running[i];
+	}
+	data->stopped = 1;
+	unlock_data(data);
+}
+
+static void destroy(void *d) {
+#ifdef CP_THREADS
+	pthread_mutex_destroy(&((struct runtime_data *) d)->mutex);
+#endif
+	free(d);
+}
+
+CP_EXPORT cp_plugin_runtime_t mrr_runtime = {
+	create,
+	start,
+	stop,
+	destroy
+};
@@ -0,0 +1,73 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef MULTIRUNNER_H_
+#define MULTIRUNNER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The number of run functions registered by the plug-in */
+#define MRR_NUM_FUNCS 4
+
+/** A type for mrr_data_t structure */
+typedef struct mrr_data_t mrr_data_t;
+
+/**
+ * Data shared with the test program. The test program may only set the
+ * limit and read the counters while the plug-in is not being run.
+ */
+struct mrr_data_t {
+	
+	/**
+	 * The number of calls after which the even run functions stop
+	 * rerunning while the odd ones are called only once, or zero to rerun
+	 * all run functions until the plug-in is stopped
+	 */
+	int limit;
+	
+	/** Call counters for the run functions */
+	int runs[MRR_NUM_FUNCS];
+	
+	/** The number of calls made while the same run function was running */
+	int overlaps;
+	
+	/** The number of calls made while another run function was running */
+	int parallel;
+	
+	/** The number of calls made in another thread than the previous call */
+	int migrations;
+	
+	/** The number of run functions running when the plug-in was stopped */
+	int running_at_stop;
+	
+	/** The number of calls made after the plug-in was stopped */
+	int late_runs;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*MULTIRUNNER_H_*/
@@ -95,3 +95,10 @@ CP_EXPORT cp_plugin_runtime_t su_runtime = {
 	stop,
 	destroy
 };
+
+static char exported_string[] = "Exported string";
+
+CP_EXPORT cp_symbol_export_t su_exports[] = {
+	{ "su_exported_string", exported_string },
+	{ NULL, NULL }
+};
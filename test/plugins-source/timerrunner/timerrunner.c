@@ -0,0 +1,82 @@
+/*-------------------------------------------------------------------------
+ * C-Pluff, a plug-in framework for C
+ * Copyright 2007 Johannes Lehtinen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <cpluff.h>
+#include "timerrunner.h"
+
+struct runtime_data {
+	cp_context_t *ctx;
+	trr_data_t shared;
+};
+
+static void *create(cp_context_t *ctx) {
+	struct runtime_data *data;
+	
+	if ((data = malloc(sizeof(struct runtime_data))) == NULL) {
+		return NULL;
+	}
+	memset(data, 0, sizeof(struct runtime_data));
+	data->ctx = ctx;
+	return data;
+}
+
+static int delayed(void *d) {
+	struct runtime_data *data = d;
+	
+	// Called three times
+	return (++data->shared.delayed < 3);
+}
+
+static int periodic(void *d) {
+	struct runtime_data *data = d;
+	
+	// Called four times
+	return (++data->shared.periodic < 4);
+}
+
+static int start(void *d) {
+	struct runtime_data *data = d;
+	
+	data->shared.delayed = 0;
+	data->shared.periodic = 0;
+	if (cp_define_symbol(data->ctx, "trr_data", &data->shared) != CP_OK
+		|| cp_run_function_after(data->ctx, 50, delayed) != CP_OK
+		|| cp_run_function_every(data->ctx, 20, periodic) != CP_OK) {
+		return CP_ERR_RUNTIME;
+	} else {
+		return CP_OK;
+	}
+}
+
+static void destroy(void *d) {
+	free(d);
+}
+
+CP_EXPORT cp_plugin_runtime_t trr_runtime = {
+	create,
+	start,
+	NULL,
+	destroy
+};
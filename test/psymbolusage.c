@@ -49,3 +49,172 @@ void symbolusage(void) {
 	cp_destroy();
 	check(errors == 0);
 }
+
+void symbolbatch(void) {
+	cp_context_t *ctx;
+	const char *names[] = { "used_string", "su_runtime", "nonexisting" };
+	void *symbols[3], *failed[3];
+	int errors;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	
+	// Resolve symbols in one batch, starting the plug-in implicitly
+	check(cp_resolve_symbols(ctx, "symuser", names, symbols, 2) == CP_OK);
+	check(cp_get_plugin_state(ctx, "symuser") == CP_PLUGIN_ACTIVE);
+	check(symbols[0] != NULL && strcmp(symbols[0], "Provided string") == 0);
+	check(symbols[1] != NULL);
+	
+	// Batches share usage counts with single symbols
+	check(cp_resolve_symbols(ctx, "symuser", names, symbols + 2, 1) == CP_OK);
+	check(symbols[2] == symbols[0]);
+	cp_release_symbol(ctx, symbols[2]);
+	
+	// A failing batch resolves nothing
+	check(cp_resolve_symbols(ctx, "symuser", names, failed, 3) == CP_ERR_UNKNOWN);
+	check(failed[0] == NULL && failed[1] == NULL && failed[2] == NULL);
+	check(cp_resolve_symbols(ctx, "nonexisting", names, failed, 1) == CP_ERR_UNKNOWN);
+	check(failed[0] == NULL);
+	
+	// Releasing the batch allows the provider to be stopped
+	cp_release_symbols(ctx, symbols, 2);
+	check(cp_stop_plugin(ctx, "symuser") == CP_OK);
+	cp_destroy();
+	check(errors == 0);
+}
+
+void symbolexports(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	int errors;
+	const char *str;
+	void *runtime;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	
+	// A static symbol is only reachable through the export table
+	check((str = cp_resolve_symbol(ctx, "symuser", "su_exported_string", &status)) != NULL && status == CP_OK);
+	check(strcmp(str, "Exported string") == 0);
+	
+	// Symbols not in the table are resolved by the dynamic linker
+	check((runtime = cp_resolve_symbol(ctx, "symuser", "su_runtime", &status)) != NULL && status == CP_OK);
+	cp_release_symbol(ctx, runtime);
+	cp_release_symbol(ctx, str);
+
+	cp_destroy();
+	check(errors == 0);
+}
+
+void symbolindexing(void) {
+	cp_context_t *ctx, *refctx;
+	cp_status_t status;
+	int errors;
+	int indexing;
+	const char *str;
+	void *runtime, *refruntime;
+	
+	ctx = init_context(CP_LOG_ERROR + 1, &errors);
+	
+	// Indexing is not supported on all platforms
+	indexing = (cp_index_runtime_symbols(ctx, 1) == CP_OK);
+	check(indexing || errors == 1);
+	errors = 0;
+	
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check((refctx = cp_create_context(&status)) != NULL && status == CP_OK);
+	check(cp_register_pcollection(refctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(refctx, 0) == CP_OK);
+	
+	// Indexed symbols match those resolved by the dynamic linker
+	check((runtime = cp_resolve_symbol(ctx, "symuser", "su_runtime", &status)) != NULL && status == CP_OK);
+	check((refruntime = cp_resolve_symbol(refctx, "symuser", "su_runtime", &status)) != NULL && status == CP_OK);
+	check(runtime == refruntime);
+	
+	// The declared export table still takes precedence
+	check((str = cp_resolve_symbol(ctx, "symuser", "su_exported_string", &status)) != NULL && status == CP_OK);
+	check(strcmp(str, "Exported string") == 0);
+	
+	// Undefined symbols are still not found
+	check(cp_resolve_symbol(ctx, "symuser", "nonexisting", &status) == NULL && status != CP_OK);
+	errors = 0;
+	
+	cp_release_symbol(refctx, refruntime);
+	cp_release_symbol(ctx, runtime);
+	cp_release_symbol(ctx, str);
+	cp_destroy_context(refctx);
+	cp_destroy();
+	check(errors == 0);
+}
+
+void symbolcache(void) {
+	cp_context_t *ctx;
+	cp_status_t status;
+	int errors;
+	void *runtime, *runtime2, *str, *used;
+	
+	ctx = init_context(CP_LOG_ERROR, &errors);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_set_symbol_cache_size(ctx, 2) == CP_OK);
+	
+	// Repeated resolving returns the cached symbol
+	check((runtime = cp_resolve_symbol(ctx, "symuser", "su_runtime", &status)) != NULL && status == CP_OK);
+	check((runtime2 = cp_resolve_symbol(ctx, "symuser", "su_runtime", &status)) == runtime && status == CP_OK);
+	cp_release_symbol(ctx, runtime2);
+	cp_release_symbol(ctx, runtime);
+	check((runtime = cp_resolve_symbol(ctx, "symuser", "su_runtime", &status)) != NULL && status == CP_OK);
+	
+	// Evicting a symbol in use keeps it resolved
+	check((str = cp_resolve_symbol(ctx, "symuser", "su_exported_string", &status)) != NULL && status == CP_OK);
+	check((used = cp_resolve_symbol(ctx, "symuser", "used_string", &status)) != NULL && status == CP_OK);
+	cp_release_symbols(ctx, &str, 1);
+	cp_release_symbol(ctx, runtime);
+	cp_release_symbol(ctx, used);
+	check(cp_get_plugin_state(ctx, "symuser") == CP_PLUGIN_ACTIVE);
+	
+	// Disabling the cache turns cached uses into ordinary ones
+	check((runtime = cp_resolve_symbol(ctx, "symuser", "su_runtime", &status)) != NULL && status == CP_OK);
+	check(cp_set_symbol_cache_size(ctx, 0) == CP_OK);
+	cp_release_symbol(ctx, runtime);
+	check(cp_set_symbol_cache_size(ctx, 2) == CP_OK);
+	
+	// Stopping the provider releases its cached symbols
+	check((runtime = cp_resolve_symbol(ctx, "symuser", "su_runtime", &status)) != NULL && status == CP_OK);
+	cp_release_symbol(ctx, runtime);
+	check(cp_stop_plugin(ctx, "symuser") == CP_OK);
+	check(cp_get_plugin_state(ctx, "symuser") == CP_PLUGIN_RESOLVED);
+	
+	cp_destroy();
+	check(errors == 0);
+}
+
+static void cached_symbol_listener(const char *plugin_id, cp_plugin_state_t old_state, cp_plugin_state_t new_state, void *user_data) {
+	cp_resolve_symbol(user_data, "symuser", "su_runtime", NULL);
+}
+
+static void cached_symbol_error_handler(const char *msg) {
+	free_test_resources();
+	exit(0);
+}
+
+void symbolcachelistener(void) {
+	cp_context_t *ctx;
+	void *runtime;
+	
+	// Resolving a cached symbol from an event listener is still fatal
+	ctx = init_context(CP_LOG_ERROR + 1, NULL);
+	check(cp_register_pcollection(ctx, "tmp/install/plugins") == CP_OK);
+	check(cp_scan_plugins(ctx, 0) == CP_OK);
+	check(cp_set_symbol_cache_size(ctx, 2) == CP_OK);
+	check((runtime = cp_resolve_symbol(ctx, "symuser", "su_runtime", NULL)) != NULL);
+	cp_release_symbol(ctx, runtime);
+	check(cp_register_plistener(ctx, cached_symbol_listener, ctx) == CP_OK);
+	cp_set_fatal_error_handler(cached_symbol_error_handler);
+	cp_start_plugin(ctx, "callbackcounter");
+	free_test_resources();
+	exit(1);
+}
@@ -86,6 +86,63 @@ CP_HIDDEN const char *pcollectiondir(const char *collection) CP_GCC_NONNULL(1);
  */
 CP_HIDDEN cp_context_t *init_context(cp_log_severity_t min_disp_sev, int *error_counter);
 
+#ifdef CP_THREADS
+
+/** An opaque type for a test thread */
+typedef struct test_thread_t test_thread_t;
+
+/**
+ * Starts a new thread executing the specified function.
+ * Checks for any failures on the way.
+ * 
+ * @param func the function to be executed
+ * @param arg the argument passed to the function
+ * @return the started thread
+ */
+CP_HIDDEN test_thread_t *start_test_thread(void (*func)(void *arg), void *arg) CP_GCC_NONNULL(1);
+
+/**
+ * Waits for a test thread to finish and frees it.
+ * 
+ * @param thread the thread
+ */
+CP_HIDDEN void join_test_thread(test_thread_t *thread) CP_GCC_NONNULL(1);
+
+/** An opaque type for a counter that test threads can wait on */
+typedef struct test_counter_t test_counter_t;
+
+/**
+ * Creates a new test counter initialized to zero.
+ * Checks for any failures on the way.
+ * 
+ * @return the created counter
+ */
+CP_HIDDEN test_counter_t *create_test_counter(void);
+
+/**
+ * Increments a test counter and wakes up the threads waiting on it.
+ * 
+ * @param counter the counter
+ */
+CP_HIDDEN void increment_test_counter(test_counter_t *counter) CP_GCC_NONNULL(1);
+
+/**
+ * Waits until a test counter has reached the specified value.
+ * 
+ * @param counter the counter
+ * @param value the value to wait for
+ */
+CP_HIDDEN void wait_test_counter(test_counter_t *counter, int value) CP_GCC_NONNULL(1);
+
+/**
+ * Destroys a test counter.
+ * 
+ * @param counter the counter
+ */
+CP_HIDDEN void destroy_test_counter(test_counter_t *counter) CP_GCC_NONNULL(1);
+
+#endif
+
 /**
  * Frees any test resources. This can be called to ensure there are no memory
  * leaks due to leaked test resources.
@@ -25,6 +25,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include "test.h"
+#if defined(CP_THREADS) && defined(_WIN32)
+#include <windows.h>
+#elif defined(CP_THREADS)
+#include <pthread.h>
+#endif
 #include "../libcpluff/internal.h"
 
 static const char *argv0;
@@ -130,6 +135,121 @@ CP_HIDDEN const char *pcollectiondir(const char *collection) {
 	return pcollectiondir_buffer;
 }
 
+#ifdef CP_THREADS
+
+struct test_thread_t {
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	pthread_t thread;
+#endif
+	void (*func)(void *arg);
+	void *arg;
+};
+
+#ifdef _WIN32
+static DWORD WINAPI test_thread_main(LPVOID t) {
+#else
+static void *test_thread_main(void *t) {
+#endif
+	test_thread_t *thread = t;
+	
+	thread->func(thread->arg);
+	return 0;
+}
+
+CP_HIDDEN test_thread_t *start_test_thread(void (*func)(void *arg), void *arg) {
+	test_thread_t *thread;
+	
+	check((thread = malloc(sizeof(test_thread_t))) != NULL);
+	thread->func = func;
+	thread->arg = arg;
+#ifdef _WIN32
+	check((thread->handle = CreateThread(NULL, 0, test_thread_main, thread, 0, NULL)) != NULL);
+#else
+	check(pthread_create(&thread->thread, NULL, test_thread_main, thread) == 0);
+#endif
+	return thread;
+}
+
+CP_HIDDEN void join_test_thread(test_thread_t *thread) {
+#ifdef _WIN32
+	check(WaitForSingleObject(thread->handle, INFINITE) == WAIT_OBJECT_0);
+	CloseHandle(thread->handle);
+#else
+	check(pthread_join(thread->thread, NULL) == 0);
+#endif
+	free(thread);
+}
+
+struct test_counter_t {
+#ifdef _WIN32
+	CRITICAL_SECTION cs;
+	CONDITION_VARIABLE cond;
+#else
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+#endif
+	int value;
+};
+
+CP_HIDDEN test_counter_t *create_test_counter(void) {
+	test_counter_t *counter;
+	
+	check((counter = malloc(sizeof(test_counter_t))) != NULL);
+	counter->value = 0;
+#ifdef _WIN32
+	InitializeCriticalSection(&counter->cs);
+	InitializeConditionVariable(&counter->cond);
+#else
+	check(pthread_mutex_init(&counter->mutex, NULL) == 0);
+	check(pthread_cond_init(&counter->cond, NULL) == 0);
+#endif
+	return counter;
+}
+
+CP_HIDDEN void increment_test_counter(test_counter_t *counter) {
+#ifdef _WIN32
+	EnterCriticalSection(&counter->cs);
+	counter->value++;
+	WakeAllConditionVariable(&counter->cond);
+	LeaveCriticalSection(&counter->cs);
+#else
+	check(pthread_mutex_lock(&counter->mutex) == 0);
+	counter->value++;
+	check(pthread_cond_broadcast(&counter->cond) == 0);
+	check(pthread_mutex_unlock(&counter->mutex) == 0);
+#endif
+}
+
+CP_HIDDEN void wait_test_counter(test_counter_t *counter, int value) {
+#ifdef _WIN32
+	EnterCriticalSection(&counter->cs);
+	while (counter->value < value) {
+		check(SleepConditionVariableCS(&counter->cond, &counter->cs, INFINITE));
+	}
+	LeaveCriticalSection(&counter->cs);
+#else
+	check(pthread_mutex_lock(&counter->mutex) == 0);
+	while (counter->value < value) {
+		check(pthread_cond_wait(&counter->cond, &counter->mutex) == 0);
+	}
+	check(pthread_mutex_unlock(&counter->mutex) == 0);
+#endif
+}
+
+CP_HIDDEN void destroy_test_counter(test_counter_t *counter) {
+#ifdef _WIN32
+	DeleteCriticalSection(&counter->cs);
+#else
+	check(pthread_cond_destroy(&counter->cond) == 0);
+	check(pthread_mutex_destroy(&counter->mutex) == 0);
+#endif
+	free(counter);
+}
+
+#endif
+
 CP_HIDDEN void free_test_resources(void) {
 	if (plugindir_buffer != NULL) {
 		free(plugindir_buffer);